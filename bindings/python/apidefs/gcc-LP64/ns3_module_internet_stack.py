@@ -1934,10 +1934,6 @@ def register_Ns3TcpHeader_methods(root_module, cls):
     cls.add_method('SetFlags', 
                    'void', 
                    [param('uint8_t', 'flags')])
-    ## tcp-header.h: void ns3::TcpHeader::SetLength(uint8_t length) [member function]
-    cls.add_method('SetLength', 
-                   'void', 
-                   [param('uint8_t', 'length')])
     ## tcp-header.h: void ns3::TcpHeader::SetSequenceNumber(ns3::SequenceNumber32 sequenceNumber) [member function]
     cls.add_method('SetSequenceNumber', 
                    'void', 
@@ -0,0 +1,149 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *
+ * A chain of routers, one per logical processor, with echo traffic in
+ * both directions on every link.  The delay of the link between the
+ * routers i and i+1 is i+1 milliseconds, so that the lookahead differs
+ * between the pairs of neighbours.
+ *
+ *   RANK 0       RANK 1        RANK 2
+ *     r0 --1ms--- r1 ---2ms--- r2 --- ...
+ *
+ * Every logical processor prints one line with the number of packets
+ * received by its router, the time of the last reception and a digest
+ * of the times and sizes of all the receptions.  The lines must not
+ * depend on the SynchronizationMode of DistributedSimulatorImpl:
+ * utils/mpi-sync-test.py runs this program with mpirun in both modes
+ * and compares them.  A second line gives the MPI statistics of the
+ * logical processor, which do depend on the synchronization.
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/simulator-module.h"
+#include "ns3/node-module.h"
+#include "ns3/helper-module.h"
+#include "ns3/mpi-interface.h"
+
+#include <iostream>
+
+#ifdef NS3_MPI
+#include <mpi.h>
+#endif
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("DistributedSyncCheck");
+
+#ifdef NS3_MPI
+static uint32_t g_rxCount = 0;
+static uint64_t g_rxDigest = 0;
+static Time g_lastRx;
+
+// The digest does not depend on the order of the receptions which have
+// the same timestamp.
+static void
+RxTrace (Ptr<const Packet> p)
+{
+  uint64_t hash = Simulator::Now ().GetTimeStep () * 2654435761ULL + p->GetSize ();
+  g_rxCount++;
+  g_rxDigest += hash * hash;
+  g_lastRx = Simulator::Now ();
+}
+#endif
+
+int
+main (int argc, char *argv[])
+{
+#ifdef NS3_MPI
+  MpiInterface::Enable (&argc, &argv);
+
+  std::string sync = "Barrier";
+  uint32_t packets = 100;
+  CommandLine cmd;
+  cmd.AddValue ("sync", "Synchronization of the logical processors: Barrier or NullMessage", sync);
+  cmd.AddValue ("packets", "Number of packets sent in each direction of each link", packets);
+  cmd.Parse (argc, argv);
+
+  Config::SetDefault ("ns3::DistributedSimulatorImpl::SynchronizationMode", StringValue (sync));
+  GlobalValue::Bind ("SimulatorImplementationType",
+                     StringValue ("ns3::DistributedSimulatorImpl"));
+
+  uint32_t systemId = MpiInterface::GetSystemId ();
+  uint32_t systemCount = MpiInterface::GetSize ();
+  if (systemCount == 1)
+    {
+      std::cout << "This simulation requires at least 2 logical processors." << std::endl;
+      return 1;
+    }
+
+  NodeContainer routers;
+  for (uint32_t i = 0; i < systemCount; ++i)
+    {
+      routers.Add (CreateObject<Node> (i));
+    }
+
+  InternetStackHelper stack;
+  stack.Install (routers);
+
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.1.0", "255.255.255.0");
+
+  UdpEchoServerHelper server (9);
+  server.Install (routers.Get (systemId)).Start (Seconds (0.0));
+
+  for (uint32_t i = 0; i + 1 < systemCount; ++i)
+    {
+      PointToPointHelper link;
+      link.SetDeviceAttribute ("DataRate", StringValue ("10Mbps"));
+      link.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (i + 1)));
+      NetDeviceContainer devices = link.Install (routers.Get (i), routers.Get (i + 1));
+      Ipv4InterfaceContainer interfaces = address.Assign (devices);
+      address.NewNetwork ();
+
+      for (uint32_t j = 0; j < 2; ++j)
+        {
+          if (routers.Get (i + j)->GetSystemId () != systemId)
+            {
+              continue;
+            }
+          devices.Get (j)->TraceConnectWithoutContext ("MacRx", MakeCallback (&RxTrace));
+          UdpEchoClientHelper client (interfaces.GetAddress (1 - j), 9);
+          client.SetAttribute ("MaxPackets", UintegerValue (packets));
+          client.SetAttribute ("Interval", TimeValue (MicroSeconds (1000 + 100 * i + 10 * j)));
+          client.SetAttribute ("PacketSize", UintegerValue (100 + 10 * i + j));
+          client.Install (routers.Get (i + j)).Start (MilliSeconds (1));
+        }
+    }
+
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+
+  std::cout << "rank " << systemId
+            << " rx " << g_rxCount
+            << " last " << g_lastRx.GetTimeStep ()
+            << " digest " << g_rxDigest << std::endl;
+  std::cout << "stats " << systemId
+            << " messages " << MpiInterface::GetTxMessages ()
+            << " bytes " << MpiInterface::GetTxBytes ()
+            << " buffers " << MpiInterface::GetPeakSendBuffers ()
+            << " blocked " << MpiInterface::GetBlockedTime () << std::endl;
+
+  Simulator::Destroy ();
+  return 0;
+#else
+  NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
+#endif
+}
@@ -72,6 +72,22 @@ CheckQueueSize (Ptr<Queue> queue)
   fPlotQueueAvg.close();
 }
 
+// Floyd's reference curves keep the average queue size between the two
+// thresholds: the mean of the samples must lie there too.
+bool
+CheckAverageQueueSize (double minTh, double maxTh)
+{
+  double average = avgQueueSize / checkTimes;
+  std::cout << "Average queue size " << average
+            << ", expected between " << minTh << " and " << maxTh << std::endl;
+  if (average < minTh || average > maxTh)
+    {
+      std::cout << "FAIL: the average queue size does not match the reference curves" << std::endl;
+      return false;
+    }
+  return true;
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -81,6 +97,7 @@ main (int argc, char *argv[])
   bool flowMonitor = true;
   bool m_writeResults = true;
   uint32_t redTest = 0;
+  bool sack = false;
 
   // The times
   double global_start_time;
@@ -106,6 +123,7 @@ main (int argc, char *argv[])
   // Configuration and command line parameter parsing
   CommandLine cmd;
   cmd.AddValue ("testnumber", "Run test 1 or 3", redTest);
+  cmd.AddValue ("sack", "Use TCP SACK instead of Reno", sack);
   cmd.Parse (argc, argv);
 
   if ((redTest == 0) || ((redTest != 1) && (redTest != 3)))
@@ -129,7 +147,15 @@ main (int argc, char *argv[])
   NodeContainer n3n4 = NodeContainer (c.Get (3), c.Get (4));
   NodeContainer n3n5 = NodeContainer (c.Get (3), c.Get (5));
 
-  Config::SetDefault ("ns3::TcpL4Protocol::SocketType", StringValue ("ns3::TcpReno"));
+  if (sack)
+    {
+      Config::SetDefault ("ns3::TcpL4Protocol::SocketType", StringValue ("ns3::TcpSack"));
+      Config::SetDefault ("ns3::TcpSocketBase::UseSack", BooleanValue (true));
+    }
+  else
+    {
+      Config::SetDefault ("ns3::TcpL4Protocol::SocketType", StringValue ("ns3::TcpReno"));
+    }
   // 42 = headers size
   Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (1000 - 42));
   Config::SetDefault ("ns3::TcpSocket::DelAckCount", UintegerValue (1));
@@ -140,19 +166,23 @@ main (int argc, char *argv[])
   Config::SetDefault ("ns3::RedQueue::MeanPktSize", UintegerValue (500));
   Config::SetDefault ("ns3::RedQueue::Wait", BooleanValue (true));
   Config::SetDefault ("ns3::RedQueue::Gentle", BooleanValue (true));
-  Config::SetDefault ("ns3::RedQueue::m_minTh", DoubleValue (5));
+  double minTh = 5;
+  double maxTh;
+  Config::SetDefault ("ns3::RedQueue::m_minTh", DoubleValue (minTh));
   Config::SetDefault ("ns3::RedQueue::QueueLimit", UintegerValue (25));
   Config::SetDefault ("ns3::RedQueue::LinkBandwidth", StringValue(redDataRate));
   Config::SetDefault ("ns3::RedQueue::LinkDelay", StringValue(redLinkDelay));
 
   if (redTest == 1)
     {
-      Config::SetDefault ("ns3::RedQueue::m_maxTh", DoubleValue (15));
+      maxTh = 15;
+      Config::SetDefault ("ns3::RedQueue::m_maxTh", DoubleValue (maxTh));
       Config::SetDefault ("ns3::RedQueue::m_qW", DoubleValue (0.002));
     }
   else // test 3
     {
-      Config::SetDefault ("ns3::RedQueue::m_maxTh", DoubleValue (10));
+      maxTh = 10;
+      Config::SetDefault ("ns3::RedQueue::m_maxTh", DoubleValue (maxTh));
       Config::SetDefault ("ns3::RedQueue::m_qW", DoubleValue (0.003));
     }
 
@@ -285,6 +315,8 @@ main (int argc, char *argv[])
   Simulator::Stop (Seconds (sink_stop_time));
   Simulator::Run ();
 
+  bool valid = CheckAverageQueueSize (minTh, maxTh);
+
   if (flowMonitor)
     {
       flowmon->SerializeToXmlFile ("red.flowmon", false, false);
@@ -292,5 +324,5 @@ main (int argc, char *argv[])
 
   Simulator::Destroy ();
 
-  return 0;
+  return valid ? 0 : 1;
 }
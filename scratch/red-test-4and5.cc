@@ -72,6 +72,22 @@ CheckQueueSize (Ptr<Queue> queue)
   fPlotQueueAvg.close();
 }
 
+// Floyd's reference curves keep the average queue size between the two
+// thresholds: the mean of the samples must lie there too.
+bool
+CheckAverageQueueSize (double minTh, double maxTh)
+{
+  double average = avgQueueSize / checkTimes;
+  std::cout << "Average queue size " << average
+            << ", expected between " << minTh << " and " << maxTh << std::endl;
+  if (average < minTh || average > maxTh)
+    {
+      std::cout << "FAIL: the average queue size does not match the reference curves" << std::endl;
+      return false;
+    }
+  return true;
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -82,6 +98,7 @@ main (int argc, char *argv[])
   bool flowMonitor = true;
   bool m_writeResults = true;
   uint32_t redTest = 0;
+  bool sack = false;
 
   // The times
   double global_start_time;
@@ -104,6 +121,7 @@ main (int argc, char *argv[])
   // Configuration and command line parameter parsing
   CommandLine cmd;
   cmd.AddValue ("testnumber", "Run test 1 or 3", redTest);
+  cmd.AddValue ("sack", "Use TCP SACK instead of Reno", sack);
   cmd.Parse (argc, argv);
 
   if ((redTest == 0) || ((redTest != 4) && (redTest != 5)))
@@ -127,13 +145,23 @@ main (int argc, char *argv[])
   NodeContainer n3n4 = NodeContainer (c.Get (3), c.Get (4));
   NodeContainer n3n5 = NodeContainer (c.Get (3), c.Get (5));
 
-  Config::SetDefault ("ns3::TcpL4Protocol::SocketType", StringValue ("ns3::TcpReno"));
+  if (sack)
+    {
+      Config::SetDefault ("ns3::TcpL4Protocol::SocketType", StringValue ("ns3::TcpSack"));
+      Config::SetDefault ("ns3::TcpSocketBase::UseSack", BooleanValue (true));
+    }
+  else
+    {
+      Config::SetDefault ("ns3::TcpL4Protocol::SocketType", StringValue ("ns3::TcpReno"));
+    }
   // 42 = headers size
   Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (1000 - 42));
   Config::SetDefault ("ns3::TcpSocket::DelAckCount", UintegerValue (1));
   GlobalValue::Bind ("ChecksumEnabled", BooleanValue (false));
 
   uint32_t meanPktSize = 500;
+  double minTh;
+  double maxTh;
 
   // RED params
   Config::SetDefault ("ns3::RedQueue::MeanPktSize", UintegerValue (meanPktSize));
@@ -145,16 +173,20 @@ main (int argc, char *argv[])
   if (redTest == 4) // packet mode
     {
       Config::SetDefault ("ns3::RedQueue::Mode", StringValue("Packets"));
-      Config::SetDefault ("ns3::RedQueue::m_minTh", DoubleValue (5));
-      Config::SetDefault ("ns3::RedQueue::m_maxTh", DoubleValue (15));
+      minTh = 5;
+      maxTh = 15;
+      Config::SetDefault ("ns3::RedQueue::m_minTh", DoubleValue (minTh));
+      Config::SetDefault ("ns3::RedQueue::m_maxTh", DoubleValue (maxTh));
       Config::SetDefault ("ns3::RedQueue::QueueLimit", UintegerValue (25));
     }
   else // test 5, byte mode
     {
       Config::SetDefault ("ns3::RedQueue::Mode", StringValue("Bytes"));
       Config::SetDefault ("ns3::RedQueue::m_ns1Compat", BooleanValue (true));
-      Config::SetDefault ("ns3::RedQueue::m_minTh", DoubleValue (5 * meanPktSize));
-      Config::SetDefault ("ns3::RedQueue::m_maxTh", DoubleValue (15 * meanPktSize));
+      minTh = 5 * meanPktSize;
+      maxTh = 15 * meanPktSize;
+      Config::SetDefault ("ns3::RedQueue::m_minTh", DoubleValue (minTh));
+      Config::SetDefault ("ns3::RedQueue::m_maxTh", DoubleValue (maxTh));
       Config::SetDefault ("ns3::RedQueue::QueueLimit", UintegerValue (25 * meanPktSize));
     }
 
@@ -360,6 +392,8 @@ main (int argc, char *argv[])
   Simulator::Stop (Seconds (sink_stop_time));
   Simulator::Run ();
 
+  bool valid = CheckAverageQueueSize (minTh, maxTh);
+
   if (flowMonitor)
     {
       flowmon->SerializeToXmlFile ("red.flowmon", false, false);
@@ -367,5 +401,5 @@ main (int argc, char *argv[])
 
   Simulator::Destroy ();
 
-  return 0;
+  return valid ? 0 : 1;
 }
@@ -0,0 +1,120 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <sstream>
+#include <cstdio>
+
+#include "ns3/test.h"
+#include "ns3/binary-trace-file.h"
+#include "ns3/packet.h"
+
+using namespace ns3;
+
+// ===========================================================================
+// Test case to make sure that the records written to a binary trace file
+// are read back unchanged, across chunks.
+// ===========================================================================
+class BinaryTraceRoundTripTestCase : public TestCase
+{
+public:
+  BinaryTraceRoundTripTestCase ();
+
+private:
+  virtual bool DoRun (void);
+};
+
+BinaryTraceRoundTripTestCase::BinaryTraceRoundTripTestCase ()
+  : TestCase ("Check that BinaryTraceReader reads back the records of BinaryTraceFile")
+{
+}
+
+bool
+BinaryTraceRoundTripTestCase::DoRun (void)
+{
+  std::string filename = GetTempDir () + "binary-trace.btr";
+  uint8_t data[] = {0x45, 0x00, 0x00, 0x54, 0xab, 0xcd};
+  std::vector<uint64_t> uids;
+
+  // 10 records per chunk, so that the 25 records span three chunks and
+  // the third context is added after the first chunk.
+  Ptr<BinaryTraceFile> file = Create<BinaryTraceFile> (filename, 4, 10);
+  uint32_t contexts[3];
+  contexts[0] = file->AddContext ("/NodeList/0/DeviceList/1/MacRx");
+  contexts[1] = file->AddContext ("/NodeList/2/DeviceList/0/TxQueue/Enqueue");
+  NS_TEST_ASSERT_MSG_EQ (file->AddContext ("/NodeList/0/DeviceList/1/MacRx"), contexts[0], "Contexts are interned");
+  for (uint32_t i = 0; i < 25; ++i)
+    {
+      if (i == 12)
+        {
+          contexts[2] = file->AddContext ("/NodeList/3/DeviceList/2/TxQueue/Drop");
+        }
+      // the packets of odd size are smaller than the bytes kept.
+      Ptr<Packet> p = Create<Packet> (data, (i % 2) ? 2 : sizeof (data));
+      uids.push_back (p->GetUid ());
+      file->Write (MicroSeconds (100 * i), contexts[i < 12 ? i % 2 : 2], i, i + 1,
+                   (BinaryTraceFile::EventType)(i % 4), p);
+    }
+  file->Close ();
+  NS_TEST_ASSERT_MSG_EQ (file->Fail (), false, "Write must not fail");
+
+  BinaryTraceReader reader;
+  NS_TEST_ASSERT_MSG_EQ (reader.Open (filename), true, "Open must succeed");
+  NS_TEST_ASSERT_MSG_EQ (reader.GetPacketBytes (), 4, "Unexpected number of packet bytes");
+  BinaryTraceReader::Record record;
+  for (uint32_t i = 0; i < 25; ++i)
+    {
+      NS_TEST_ASSERT_MSG_EQ (reader.Read (record), true, "Record " << i << " is missing");
+      NS_TEST_EXPECT_MSG_EQ (record.time, MicroSeconds (100 * i), "Unexpected time in record " << i);
+      std::string context = i >= 12 ? "/NodeList/3/DeviceList/2/TxQueue/Drop" :
+        (i % 2) ? "/NodeList/2/DeviceList/0/TxQueue/Enqueue" : "/NodeList/0/DeviceList/1/MacRx";
+      NS_TEST_EXPECT_MSG_EQ (record.context, context, "Unexpected context in record " << i);
+      NS_TEST_EXPECT_MSG_EQ (record.node, i, "Unexpected node in record " << i);
+      NS_TEST_EXPECT_MSG_EQ (record.device, i + 1, "Unexpected device in record " << i);
+      NS_TEST_EXPECT_MSG_EQ (record.event, i % 4, "Unexpected event in record " << i);
+      NS_TEST_EXPECT_MSG_EQ (record.uid, uids[i], "Unexpected uid in record " << i);
+      NS_TEST_EXPECT_MSG_EQ (record.size, ((i % 2) ? 2 : sizeof (data)), "Unexpected size in record " << i);
+      NS_TEST_ASSERT_MSG_EQ (record.bytes.size (), 4, "Unexpected number of bytes in record " << i);
+      NS_TEST_EXPECT_MSG_EQ ((uint32_t)record.bytes[1], 0, "Unexpected bytes in record " << i);
+      NS_TEST_EXPECT_MSG_EQ ((uint32_t)record.bytes[3], ((i % 2) ? 0 : 0x54), "Unexpected bytes in record " << i);
+    }
+  NS_TEST_EXPECT_MSG_EQ (reader.Read (record), false, "Too many records");
+
+  std::ostringstream os;
+  NS_TEST_EXPECT_MSG_EQ (BinaryTraceReader::ConvertToAscii (filename, os), true, "Conversion must succeed");
+  std::istringstream is (os.str ());
+  std::string line;
+  std::getline (is, line);
+  std::ostringstream expected;
+  expected << "+ 0 /NodeList/0/DeviceList/1/MacRx uid=" << uids[0] << " size=6 bytes=45000054";
+  NS_TEST_EXPECT_MSG_EQ (line, expected.str (), "Unexpected ascii line");
+
+  remove (filename.c_str ());
+  return GetErrorStatus ();
+}
+
+class BinaryTraceFileTestSuite : public TestSuite
+{
+public:
+  BinaryTraceFileTestSuite ();
+};
+
+BinaryTraceFileTestSuite::BinaryTraceFileTestSuite ()
+  : TestSuite ("binary-trace-file", UNIT)
+{
+  AddTestCase (new BinaryTraceRoundTripTestCase);
+}
+
+BinaryTraceFileTestSuite binaryTraceFileTestSuite;
@@ -0,0 +1,399 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <iomanip>
+#include <cstring>
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "ns3/fatal-impl.h"
+#include "packet.h"
+#include "binary-trace-file.h"
+
+NS_LOG_COMPONENT_DEFINE ("BinaryTraceFile");
+
+namespace ns3 {
+
+const uint32_t BinaryTraceFile::MAGIC;
+const uint16_t BinaryTraceFile::VERSION_MAJOR;
+const uint16_t BinaryTraceFile::VERSION_MINOR;
+const uint32_t BinaryTraceFile::DICTIONARY;
+const uint32_t BinaryTraceFile::RECORDS;
+
+namespace {
+
+/* size of a record in a RECORDS chunk, without the packet bytes */
+const uint32_t RECORD_SIZE = 8 + 4 + 4 + 4 + 1 + 8 + 4;
+
+void
+Append (std::vector<uint8_t> &buffer, uint64_t value, uint32_t size)
+{
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      buffer.push_back ((value >> (8 * i)) & 0xff);
+    }
+}
+
+uint64_t
+Extract (const uint8_t *buffer, uint32_t size)
+{
+  uint64_t value = 0;
+  for (uint32_t i = 0; i < size; ++i)
+    {
+      value |= ((uint64_t)buffer[i]) << (8 * i);
+    }
+  return value;
+}
+
+} // anonymous namespace
+
+BinaryTraceFile::BinaryTraceFile (std::string filename, uint32_t packetBytes, uint32_t chunkSize)
+  : m_file (filename.c_str (), std::ios::out | std::ios::binary),
+    m_fatalBuf (this),
+    m_fatalStream (&m_fatalBuf),
+    m_packetBytes (packetBytes),
+    m_chunkSize (chunkSize)
+{
+  NS_LOG_FUNCTION (this << filename << packetBytes << chunkSize);
+  NS_ASSERT (m_chunkSize > 0);
+  FatalImpl::RegisterStream (&m_fatalStream);
+
+  std::vector<uint8_t> header;
+  Append (header, MAGIC, 4);
+  Append (header, VERSION_MAJOR, 2);
+  Append (header, VERSION_MINOR, 2);
+  Append (header, m_packetBytes, 4);
+  Append (header, 0, 4);
+  m_file.write ((const char *)&header[0], header.size ());
+}
+
+BinaryTraceFile::~BinaryTraceFile ()
+{
+  NS_LOG_FUNCTION (this);
+  FatalImpl::UnregisterStream (&m_fatalStream);
+  Close ();
+}
+
+bool
+BinaryTraceFile::Fail (void) const
+{
+  return m_file.fail ();
+}
+
+uint32_t
+BinaryTraceFile::AddContext (std::string context)
+{
+  std::map<std::string, uint32_t>::const_iterator i = m_contexts.find (context);
+  if (i != m_contexts.end ())
+    {
+      return i->second;
+    }
+  uint32_t index = m_contexts.size ();
+  m_contexts[context] = index;
+  m_newContexts.push_back (std::make_pair (index, context));
+  return index;
+}
+
+void
+BinaryTraceFile::Write (Time t, uint32_t context, uint32_t node, uint32_t device,
+                        enum EventType event, Ptr<const Packet> p)
+{
+  NS_ASSERT (context < m_contexts.size ());
+  m_time.push_back (t.GetTimeStep ());
+  m_context.push_back (context);
+  m_node.push_back (node);
+  m_device.push_back (device);
+  m_event.push_back (event);
+  m_uid.push_back (p->GetUid ());
+  m_size.push_back (p->GetSize ());
+  if (m_packetBytes > 0)
+    {
+      uint32_t start = m_bytes.size ();
+      m_bytes.resize (start + m_packetBytes, 0);
+      p->CopyData (&m_bytes[start], m_packetBytes);
+    }
+  if (m_time.size () == m_chunkSize)
+    {
+      WriteChunks ();
+    }
+}
+
+void
+BinaryTraceFile::WriteChunks (void)
+{
+  std::vector<uint8_t> chunk;
+  if (!m_newContexts.empty ())
+    {
+      Append (chunk, DICTIONARY, 4);
+      Append (chunk, 0, 4);
+      Append (chunk, m_newContexts.size (), 4);
+      for (std::vector<std::pair<uint32_t, std::string> >::const_iterator i = m_newContexts.begin ();
+           i != m_newContexts.end (); ++i)
+        {
+          Append (chunk, i->first, 4);
+          Append (chunk, i->second.size (), 4);
+          chunk.insert (chunk.end (), i->second.begin (), i->second.end ());
+        }
+      uint32_t size = chunk.size () - 8;
+      for (uint32_t i = 0; i < 4; ++i)
+        {
+          chunk[4 + i] = (size >> (8 * i)) & 0xff;
+        }
+      m_newContexts.clear ();
+    }
+
+  uint32_t n = m_time.size ();
+  if (n > 0)
+    {
+      Append (chunk, RECORDS, 4);
+      Append (chunk, 4 + n * (RECORD_SIZE + m_packetBytes), 4);
+      Append (chunk, n, 4);
+      for (uint32_t i = 0; i < n; ++i)
+        {
+          Append (chunk, m_time[i], 8);
+        }
+      for (uint32_t i = 0; i < n; ++i)
+        {
+          Append (chunk, m_context[i], 4);
+        }
+      for (uint32_t i = 0; i < n; ++i)
+        {
+          Append (chunk, m_node[i], 4);
+        }
+      for (uint32_t i = 0; i < n; ++i)
+        {
+          Append (chunk, m_device[i], 4);
+        }
+      chunk.insert (chunk.end (), m_event.begin (), m_event.end ());
+      for (uint32_t i = 0; i < n; ++i)
+        {
+          Append (chunk, m_uid[i], 8);
+        }
+      for (uint32_t i = 0; i < n; ++i)
+        {
+          Append (chunk, m_size[i], 4);
+        }
+      chunk.insert (chunk.end (), m_bytes.begin (), m_bytes.end ());
+
+      m_time.clear ();
+      m_context.clear ();
+      m_node.clear ();
+      m_device.clear ();
+      m_event.clear ();
+      m_uid.clear ();
+      m_size.clear ();
+      m_bytes.clear ();
+    }
+
+  if (!chunk.empty ())
+    {
+      m_file.write ((const char *)&chunk[0], chunk.size ());
+    }
+}
+
+void
+BinaryTraceFile::Close (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_file.is_open ())
+    {
+      WriteChunks ();
+      m_file.close ();
+    }
+}
+
+BinaryTraceFile::FatalStreamBuf::FatalStreamBuf (BinaryTraceFile *file)
+  : m_traceFile (file)
+{
+}
+
+int
+BinaryTraceFile::FatalStreamBuf::sync (void)
+{
+  // the records of the current chunk are only in memory
+  if (m_traceFile->m_file.is_open ())
+    {
+      m_traceFile->WriteChunks ();
+      m_traceFile->m_file.flush ();
+    }
+  return 0;
+}
+
+BinaryTraceReader::BinaryTraceReader ()
+  : m_packetBytes (0),
+    m_count (0),
+    m_next (0),
+    m_truncated (false)
+{
+}
+
+bool
+BinaryTraceReader::Open (std::string filename)
+{
+  m_file.open (filename.c_str (), std::ios::in | std::ios::binary);
+  uint8_t header[16];
+  m_file.read ((char *)header, sizeof (header));
+  if (m_file.fail ()
+      || Extract (header, 4) != BinaryTraceFile::MAGIC
+      || Extract (header + 4, 2) != BinaryTraceFile::VERSION_MAJOR)
+    {
+      return false;
+    }
+  m_packetBytes = Extract (header + 8, 4);
+  m_contexts.clear ();
+  m_count = 0;
+  m_next = 0;
+  m_truncated = false;
+  return true;
+}
+
+uint32_t
+BinaryTraceReader::GetPacketBytes (void) const
+{
+  return m_packetBytes;
+}
+
+bool
+BinaryTraceReader::ReadChunk (void)
+{
+  while (true)
+    {
+      uint8_t header[8];
+      m_file.read ((char *)header, sizeof (header));
+      if (m_file.fail ())
+        {
+          // a clean end of file falls between two chunks.
+          m_truncated = m_file.gcount () != 0;
+          return false;
+        }
+      m_truncated = true;
+      uint32_t type = Extract (header, 4);
+      uint32_t size = Extract (header + 4, 4);
+      m_chunk.resize (size);
+      if (size > 0)
+        {
+          m_file.read ((char *)&m_chunk[0], size);
+          if (m_file.fail ())
+            {
+              return false;
+            }
+        }
+
+      if (type == BinaryTraceFile::DICTIONARY && size >= 4)
+        {
+          uint32_t count = Extract (&m_chunk[0], 4);
+          uint32_t offset = 4;
+          for (uint32_t i = 0; i < count; ++i)
+            {
+              if (offset + 8 > size)
+                {
+                  return false;
+                }
+              uint32_t index = Extract (&m_chunk[offset], 4);
+              uint32_t length = Extract (&m_chunk[offset + 4], 4);
+              offset += 8;
+              if (offset + length > size)
+                {
+                  return false;
+                }
+              if (index >= m_contexts.size ())
+                {
+                  m_contexts.resize (index + 1);
+                }
+              m_contexts[index] = std::string ((const char *)&m_chunk[offset], length);
+              offset += length;
+            }
+        }
+      else if (type == BinaryTraceFile::RECORDS && size >= 4)
+        {
+          m_count = Extract (&m_chunk[0], 4);
+          m_next = 0;
+          if (size != 4 + (uint64_t)m_count * (RECORD_SIZE + m_packetBytes))
+            {
+              return false;
+            }
+          m_truncated = false;
+          if (m_count > 0)
+            {
+              return true;
+            }
+        }
+      // other chunk types are skipped.
+      m_truncated = false;
+    }
+}
+
+bool
+BinaryTraceReader::Read (Record &record)
+{
+  if (m_next == m_count && !ReadChunk ())
+    {
+      return false;
+    }
+  uint32_t n = m_count;
+  uint32_t i = m_next++;
+  const uint8_t *columns = &m_chunk[4];
+  record.time = TimeStep (Extract (columns + 8 * i, 8));
+  uint32_t context = Extract (columns + 8 * n + 4 * i, 4);
+  record.context = context < m_contexts.size () ? m_contexts[context] : "";
+  record.node = Extract (columns + 12 * n + 4 * i, 4);
+  record.device = Extract (columns + 16 * n + 4 * i, 4);
+  record.event = (enum BinaryTraceFile::EventType) columns[20 * n + i];
+  record.uid = Extract (columns + 21 * n + 8 * i, 8);
+  record.size = Extract (columns + 29 * n + 4 * i, 4);
+  const uint8_t *bytes = columns + RECORD_SIZE * n + m_packetBytes * i;
+  record.bytes.assign (bytes, bytes + m_packetBytes);
+  return true;
+}
+
+void
+BinaryTraceReader::PrintAscii (std::ostream &os, const Record &record)
+{
+  static const char events[] = {'+', '-', 'd', 'r'};
+  char event = (uint32_t)record.event < sizeof (events) ? events[record.event] : '?';
+  os << event << " " << record.time.GetSeconds () << " " << record.context
+     << " uid=" << record.uid << " size=" << record.size;
+  if (!record.bytes.empty ())
+    {
+      std::ios::fmtflags flags = os.flags ();
+      char fill = os.fill ('0');
+      os << " bytes=" << std::hex;
+      for (std::vector<uint8_t>::const_iterator i = record.bytes.begin (); i != record.bytes.end (); ++i)
+        {
+          os << std::setw (2) << (uint32_t)*i;
+        }
+      os.flags (flags);
+      os.fill (fill);
+    }
+  os << std::endl;
+}
+
+bool
+BinaryTraceReader::ConvertToAscii (std::string filename, std::ostream &os)
+{
+  BinaryTraceReader reader;
+  if (!reader.Open (filename))
+    {
+      return false;
+    }
+  Record record;
+  while (reader.Read (record))
+    {
+      PrintAscii (os, record);
+    }
+  return !reader.m_truncated;
+}
+
+} // namespace ns3
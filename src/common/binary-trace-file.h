@@ -0,0 +1,230 @@
+/* -*- Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef BINARY_TRACE_FILE_H
+#define BINARY_TRACE_FILE_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <stdint.h>
+#include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+class Packet;
+
+/**
+ * \brief Compact binary alternative to the ascii trace files.
+ *
+ * Every record holds the time of the event, its type (enqueue, dequeue,
+ * drop or receive), the node and device which reported it, the uid and
+ * size of the packet, the first bytes of the packet (usually its
+ * headers) and the trace context.  The context strings are stored once
+ * in a dictionary and the records refer to them by index.
+ *
+ * The records are collected in chunks which are written column by
+ * column.  A file starts with a 16 byte header:
+ *   - uint32_t magic number 0x6e733362
+ *   - uint16_t major and minor version numbers (1 and 0)
+ *   - uint32_t number of bytes of packet kept per record
+ *   - uint32_t reserved, zero
+ *
+ * followed by the chunks.  Each chunk starts with its type and the
+ * size of the rest of the chunk, both uint32_t, so that readers can
+ * skip the chunks they do not know:
+ *   - DICTIONARY chunks hold a uint32_t count followed by the new context
+ *     strings, each one as its uint32_t index, its uint32_t length and its
+ *     characters.  They always come before the first record which uses
+ *     them.
+ *   - RECORDS chunks hold a uint32_t count n followed by the columns:
+ *     n int64_t time steps, n uint32_t context indexes, n uint32_t node
+ *     ids, n uint32_t device indexes, n uint8_t event types, n uint64_t
+ *     packet uids, n uint32_t packet sizes and n times the packet bytes.
+ *
+ * All the integers are little endian.  The packet bytes of a record are
+ * padded with zeroes if the packet is smaller than the number of bytes
+ * kept.  Use BinaryTraceReader to read the files back.
+ */
+class BinaryTraceFile : public SimpleRefCount<BinaryTraceFile>
+{
+public:
+  enum EventType {
+    ENQUEUE = 0,    /**< '+' in the ascii traces */
+    DEQUEUE = 1,    /**< '-' in the ascii traces */
+    DROP = 2,       /**< 'd' in the ascii traces */
+    RECEIVE = 3     /**< 'r' in the ascii traces */
+  };
+
+  /**
+   * \param filename name of the file to create
+   * \param packetBytes number of bytes of each packet to keep
+   * \param chunkSize number of records per chunk
+   */
+  BinaryTraceFile (std::string filename, uint32_t packetBytes = 0, uint32_t chunkSize = 4096);
+  ~BinaryTraceFile ();
+
+  /**
+   * \return true if the underlying file could not be opened or written.
+   */
+  bool Fail (void) const;
+
+  /**
+   * \param context a trace context
+   * \return the index of the context in the dictionary of the file
+   *
+   * The same index is returned for all the calls with the same string.
+   */
+  uint32_t AddContext (std::string context);
+
+  /**
+   * \brief Record an event
+   *
+   * \param t time of the event
+   * \param context index of the trace context, as returned by AddContext
+   * \param node id of the node
+   * \param device index of the device in the node
+   * \param event type of the event
+   * \param p packet
+   */
+  void Write (Time t, uint32_t context, uint32_t node, uint32_t device,
+              enum EventType event, Ptr<const Packet> p);
+
+  /**
+   * Write the pending records and close the file.
+   */
+  void Close (void);
+
+  static const uint32_t MAGIC = 0x6e733362;
+  static const uint16_t VERSION_MAJOR = 1;
+  static const uint16_t VERSION_MINOR = 0;
+  static const uint32_t DICTIONARY = 1;
+  static const uint32_t RECORDS = 2;
+
+private:
+  /**
+   * The stream registered with the fatal error handler: flushing it
+   * writes the records which are not in the file yet.
+   */
+  class FatalStreamBuf : public std::streambuf
+  {
+  public:
+    FatalStreamBuf (BinaryTraceFile *file);
+  protected:
+    virtual int sync (void);
+  private:
+    BinaryTraceFile *m_traceFile;
+  };
+  friend class FatalStreamBuf;
+
+  void WriteChunks (void);
+
+  std::ofstream m_file;
+  FatalStreamBuf m_fatalBuf;
+  std::ostream m_fatalStream;
+  uint32_t m_packetBytes;
+  uint32_t m_chunkSize;
+  std::map<std::string, uint32_t> m_contexts;
+  std::vector<std::pair<uint32_t, std::string> > m_newContexts;
+  std::vector<int64_t> m_time;
+  std::vector<uint32_t> m_context;
+  std::vector<uint32_t> m_node;
+  std::vector<uint32_t> m_device;
+  std::vector<uint8_t> m_event;
+  std::vector<uint64_t> m_uid;
+  std::vector<uint32_t> m_size;
+  std::vector<uint8_t> m_bytes;
+};
+
+/**
+ * \brief Read the files written by BinaryTraceFile.
+ */
+class BinaryTraceReader
+{
+public:
+  struct Record
+  {
+    Time time;
+    std::string context;
+    uint32_t node;
+    uint32_t device;
+    enum BinaryTraceFile::EventType event;
+    uint64_t uid;
+    uint32_t size;
+    std::vector<uint8_t> bytes;
+  };
+
+  BinaryTraceReader ();
+
+  /**
+   * \param filename name of the file to read
+   * \return false if the file could not be opened or is not a binary
+   *         trace file.
+   */
+  bool Open (std::string filename);
+
+  /**
+   * \param record [out] the next record of the file
+   * \return false at the end of the file, or if the file is truncated or
+   *         invalid.
+   */
+  bool Read (Record &record);
+
+  /**
+   * \return the number of bytes of each packet kept in the records.
+   */
+  uint32_t GetPacketBytes (void) const;
+
+  /**
+   * \brief Print a record in the format of the ascii traces
+   *
+   * The line starts like the ones written by the AsciiTraceHelper sinks
+   * with a context.  The packets themselves are not kept in the binary
+   * file, so their description is replaced by their uid, their size and
+   * the bytes kept, in hexadecimal.
+   *
+   * \param os output stream
+   * \param record record to print
+   */
+  static void PrintAscii (std::ostream &os, const Record &record);
+
+  /**
+   * \brief Convert a binary trace file to the ascii format
+   *
+   * \param filename name of the binary trace file
+   * \param os output stream
+   * \return false if the file could not be read entirely.
+   */
+  static bool ConvertToAscii (std::string filename, std::ostream &os);
+
+private:
+  bool ReadChunk (void);
+
+  std::ifstream m_file;
+  uint32_t m_packetBytes;
+  std::vector<std::string> m_contexts;
+  std::vector<uint8_t> m_chunk;
+  uint32_t m_count;
+  uint32_t m_next;
+  bool m_truncated;
+};
+
+} // namespace ns3
+
+#endif /* BINARY_TRACE_FILE_H */
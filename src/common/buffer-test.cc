@@ -1,6 +1,10 @@
 #include "buffer.h"
 #include "ns3/random-variable.h"
 #include "ns3/test.h"
+#include <sstream>
+#include <string>
+#include <cstring>
+#include <algorithm>
 
 namespace ns3 {
 
@@ -318,9 +322,187 @@ BufferTest::DoRun (void)
   i.Write (buffer.Begin (), buffer.End ());
   ENSURE_WRITTEN_BYTES (other, 9, 0x1, 0x2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3, 0x4);
 
+  // copy prefixes which end before, in and after the zero area
+  uint8_t expected[] = {0x1, 0x2, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3, 0x4};
+  uint32_t prefixes[] = {0, 1, 4, 8, 9, 20};
+  for (uint32_t j = 0; j < sizeof (prefixes) / sizeof (prefixes[0]); j++)
+    {
+      uint8_t copy[20];
+      memset (copy, 0xff, sizeof (copy));
+      uint32_t copied = buffer.CopyData (copy, prefixes[j]);
+      uint32_t size = std::min (prefixes[j], (uint32_t)sizeof (expected));
+      NS_TEST_EXPECT_MSG_EQ (copied, size, "CopyData of " << prefixes[j] << " bytes");
+      NS_TEST_EXPECT_MSG_EQ (memcmp (copy, expected, size), 0, "CopyData of " << prefixes[j] << " bytes");
+      NS_TEST_EXPECT_MSG_EQ ((uint32_t)copy[size], 0xff, "CopyData of " << prefixes[j] << " bytes overflows");
+      std::ostringstream os;
+      buffer.CopyData (&os, prefixes[j]);
+      NS_TEST_EXPECT_MSG_EQ (os.str (), std::string ((char *)expected, size), "CopyData of " << prefixes[j] << " bytes to a stream");
+    }
+
+  // aggregate fragments whose zero areas are adjacent, with data
+  // written after the zero area of the destination
+  buffer = Buffer (2000);
+  buffer.AddAtStart (8);
+  buffer.Begin ().WriteU8 (0x1, 8);
+  buffer.AddAtEnd (14);
+  i = buffer.End ();
+  i.Prev (14);
+  i.WriteU8 (0x2, 14);
+  frag0 = buffer.CreateFragment (0, 1000);
+  frag1 = buffer.CreateFragment (1000, buffer.GetSize () - 1000);
+  frag0.AddAtStart (25);
+  frag0.RemoveAtStart (25);
+  frag0.AddAtEnd (frag1);
+  NS_TEST_EXPECT_MSG_EQ (frag0.GetSize (), buffer.GetSize (), "Aggregated fragments");
+  uint8_t whole[2022];
+  uint8_t aggregated[2022];
+  buffer.CopyData (whole, sizeof (whole));
+  frag0.CopyData (aggregated, sizeof (aggregated));
+  NS_TEST_EXPECT_MSG_EQ (memcmp (whole, aggregated, sizeof (whole)), 0, "Aggregated fragments");
+
+  return GetErrorStatus ();
+}
+//-----------------------------------------------------------------------------
+class BufferFreeListTest : public TestCase {
+public:
+  virtual bool DoRun (void);
+  BufferFreeListTest ();
+};
+
+BufferFreeListTest::BufferFreeListTest ()
+  : TestCase ("Buffer free lists") {
+}
+
+bool
+BufferFreeListTest::DoRun (void)
+{
+  {
+    // a jumbo buffer does not keep the smaller ones out of the cache
+    Buffer jumbo;
+    jumbo.AddAtStart (9000);
+  }
+  {
+    Buffer warm;
+    warm.AddAtStart (100);
+  }
+  Buffer::FreeListStatistics before = Buffer::GetFreeListStatistics ();
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      Buffer small;
+      small.AddAtStart (100);
+    }
+  Buffer::FreeListStatistics after = Buffer::GetFreeListStatistics ();
+  NS_TEST_ASSERT_MSG_EQ (after.misses, before.misses, "Small buffers bypass the cache");
+  NS_TEST_ASSERT_MSG_EQ (after.allocations - before.allocations, 20, "Unexpected number of allocations");
+
+  // more buffers than the cache of a thread can hold go through the depot
+  std::vector<Buffer> buffers;
+  for (uint32_t i = 0; i < 200; i++)
+    {
+      buffers.push_back (Buffer (1000));
+      buffers.back ().AddAtStart (1000);
+    }
+  buffers.clear ();
+  before = Buffer::GetFreeListStatistics ();
+  NS_TEST_ASSERT_MSG_EQ ((before.depotTransfers > after.depotTransfers), true, "The depot was not used");
+  for (uint32_t i = 0; i < 200; i++)
+    {
+      buffers.push_back (Buffer (1000));
+      buffers.back ().AddAtStart (1000);
+    }
+  after = Buffer::GetFreeListStatistics ();
+  NS_TEST_ASSERT_MSG_EQ (after.misses, before.misses, "The buffers were not taken back from the depot");
+
+  // the buffers which do not fit in a full depot are deleted and counted
+  buffers.clear ();
+  for (uint32_t i = 0; i < 2000; i++)
+    {
+      buffers.push_back (Buffer (4000));
+      buffers.back ().AddAtStart (4000);
+    }
+  before = Buffer::GetFreeListStatistics ();
+  buffers.clear ();
+  after = Buffer::GetFreeListStatistics ();
+  NS_TEST_ASSERT_MSG_EQ (after.releases - before.releases, 2000, "Unexpected number of releases");
+  NS_TEST_ASSERT_MSG_EQ ((after.overflows > before.overflows), true, "The deletions of a full depot were not counted");
   return GetErrorStatus ();
 }
+
 //-----------------------------------------------------------------------------
+class BufferChecksumTest : public TestCase {
+public:
+  virtual bool DoRun (void);
+  BufferChecksumTest ();
+private:
+  uint16_t CalculateReference (const uint8_t *data, uint32_t size, uint32_t sum);
+};
+
+BufferChecksumTest::BufferChecksumTest ()
+  : TestCase ("Buffer checksums") {
+}
+
+// the RFC 1071 sum of the words read by Iterator::ReadU16
+uint16_t
+BufferChecksumTest::CalculateReference (const uint8_t *data, uint32_t size, uint32_t sum)
+{
+  for (uint32_t j = 0; j + 1 < size; j += 2)
+    {
+      sum += data[j] | (data[j + 1] << 8);
+    }
+  if (size & 1)
+    {
+      sum += data[size - 1];
+    }
+  while (sum >> 16)
+    {
+      sum = (sum & 0xffff) + (sum >> 16);
+    }
+  return ~sum;
+}
+
+bool
+BufferChecksumTest::DoRun (void)
+{
+  UniformVariable rng;
+  for (uint32_t n = 0; n < 200; n++)
+    {
+      // random data before and after a zero area of random size
+      uint32_t before = rng.GetInteger (0, 100);
+      uint32_t zeroes = rng.GetInteger (0, 1600);
+      uint32_t after = rng.GetInteger (0, 100);
+      Buffer buffer (zeroes);
+      buffer.AddAtStart (before);
+      Buffer::Iterator i = buffer.Begin ();
+      for (uint32_t j = 0; j < before; j++)
+        {
+          i.WriteU8 (rng.GetInteger (0, 255));
+        }
+      buffer.AddAtEnd (after);
+      i = buffer.End ();
+      i.Prev (after);
+      for (uint32_t j = 0; j < after; j++)
+        {
+          i.WriteU8 (rng.GetInteger (0, 255));
+        }
+      uint8_t *data = new uint8_t[buffer.GetSize () + 1];
+      buffer.CopyData (data, buffer.GetSize ());
+
+      uint32_t offset = rng.GetInteger (0, buffer.GetSize ());
+      uint32_t size = rng.GetInteger (0, buffer.GetSize () - offset);
+      uint32_t initial = rng.GetInteger (0, 0x3ffff);
+      i = buffer.Begin ();
+      i.Next (offset);
+      uint16_t checksum = i.CalculateIpChecksum (size, initial);
+      NS_TEST_EXPECT_MSG_EQ (checksum, CalculateReference (data + offset, size, initial),
+                             "Checksum of " << size << " bytes at " << offset <<
+                             " with the zero area at " << before << "-" << before + zeroes);
+      NS_TEST_EXPECT_MSG_EQ (i.GetDistanceFrom (buffer.Begin ()), offset + size,
+                             "The iterator moves past the bytes of the checksum");
+      delete [] data;
+    }
+  return GetErrorStatus ();
+}
+
 class BufferTestSuite : public TestSuite
 {
 public:
@@ -331,6 +513,8 @@ BufferTestSuite::BufferTestSuite ()
   : TestSuite ("buffer", UNIT)
 {
   AddTestCase (new BufferTest);
+  AddTestCase (new BufferFreeListTest);
+  AddTestCase (new BufferChecksumTest);
 }
 
 BufferTestSuite g_bufferTestSuite;
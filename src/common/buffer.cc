@@ -20,6 +20,11 @@
 #include "buffer.h"
 #include "ns3/assert.h"
 #include "ns3/log.h"
+#include "ns3/core-config.h"
+#include "ns3/simulator-config.h"
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 
 NS_LOG_COMPONENT_DEFINE ("Buffer");
 
@@ -46,109 +51,295 @@ static struct Zeroes
 namespace ns3 {
 
 
+#ifdef NS3_MULTITHREADING
+__thread uint32_t Buffer::g_recommendedStart = 0;
+#else
 uint32_t Buffer::g_recommendedStart = 0;
-#ifdef BUFFER_FREE_LIST
-/* The following macros are pretty evil but they are needed to allow us to
- * keep track of 3 possible states for the g_freeList variable:
- *  - uninitialized means that no one has created a buffer yet
- *    so no one has created the associated free list (it is created
- *    on-demand when the first buffer is created)
- *  - initialized means that the free list exists and is valid
- *  - destroyed means that the static destructors of this compilation unit
- *    have run so, the free list has been cleared from its content
- * The key is that in destroyed state, we are careful not re-create it
- * which is a typical weakness of lazy evaluation schemes which use 
- * '0' as a special value to indicate both un-initialized and destroyed.
- * Note that it is important to use '0' as the marker for un-initialized state
- * because the variable holding this state information is initialized to zero
- * which the compiler assigns to zero-memory which is initialized to _zero_
- * before the constructors run so this ensures perfect handling of crazy 
- * constructor orderings.
+#endif
+/* The byte storage is recycled in power-of-two size classes: the
+ * Buffer::Data of class i hold BUFFER_MIN_SIZE << i bytes. Each thread
+ * caches up to BUFFER_CACHE_SIZE free Buffer::Data per class, in a list
+ * linked through the Buffer::Data themselves. When its cache is full,
+ * a thread gives a batch of BUFFER_BATCH_SIZE Buffer::Data to the
+ * depot, shared by all the threads and protected by a mutex. When its
+ * cache is empty, it takes a batch back. A Buffer::Data freed by
+ * another thread than the one which allocated it thus goes back to the
+ * threads which need it.
  */
-#define MAGIC_DESTROYED (~(long) 0)
-#define IS_UNINITIALIZED(x) (x == (Buffer::FreeList*)0)
-#define IS_DESTROYED(x) (x == (Buffer::FreeList*)MAGIC_DESTROYED)
-#define IS_INITIALIZED(x) (!IS_UNINITIALIZED(x) && !IS_DESTROYED(x))
-#define DESTROYED ((Buffer::FreeList*)MAGIC_DESTROYED)
-#define UNINITIALIZED ((Buffer::FreeList*)0)
-uint32_t Buffer::g_maxSize = 0;
-Buffer::FreeList *Buffer::g_freeList = 0;
-struct Buffer::LocalStaticDestructor Buffer::g_localStaticDestructor;
-
-Buffer::LocalStaticDestructor::~LocalStaticDestructor(void)
-{
-  if (IS_INITIALIZED(g_freeList))
+#define BUFFER_MIN_SIZE_SHIFT 5
+#define BUFFER_MIN_SIZE (1 << BUFFER_MIN_SIZE_SHIFT)
+#define BUFFER_N_SIZE_CLASSES 12
+#define BUFFER_MAX_SIZE (BUFFER_MIN_SIZE << (BUFFER_N_SIZE_CLASSES - 1))
+#define BUFFER_CACHE_SIZE 64
+#define BUFFER_BATCH_SIZE 32
+// number of batches of each size class kept in the depot
+#define BUFFER_DEPOT_SIZE 32
+
+#ifdef HAVE_THREAD_LOCAL_STORAGE
+#define BUFFER_THREAD_LOCAL __thread
+#else
+#define BUFFER_THREAD_LOCAL
+#endif
+
+namespace {
+
+struct BufferFreeBlock
+{
+  struct BufferFreeBlock *next;
+};
+
+struct BufferCache
+{
+  struct BufferFreeBlock *head[BUFFER_N_SIZE_CLASSES];
+  uint32_t n[BUFFER_N_SIZE_CLASSES];
+  struct Buffer::FreeListStatistics stats;
+  bool registered;
+};
+
+struct BufferDepot
+{
+  struct BufferFreeBlock *batches[BUFFER_N_SIZE_CLASSES][BUFFER_DEPOT_SIZE];
+  uint32_t n[BUFFER_N_SIZE_CLASSES];
+};
+
+// zero-initialized: all the caches start empty
+BUFFER_THREAD_LOCAL struct BufferCache g_bufferCache;
+struct BufferDepot g_bufferDepot;
+// set when the static destructors of this file have run: the Buffer::Data
+// freed later are deleted. The threads test it without the depot mutex,
+// with a plain atomic load since it is read on every Create and Recycle.
+uint32_t g_bufferDepotDestroyed = 0;
+#ifdef HAVE_PTHREAD_H
+pthread_mutex_t g_bufferDepotMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_key_t g_bufferCacheKey;
+pthread_once_t g_bufferCacheKeyOnce = PTHREAD_ONCE_INIT;
+#endif /* HAVE_PTHREAD_H */
+
+// returns the number of Buffer::Data deleted
+uint32_t
+DeleteBlocks (struct BufferFreeBlock *block)
+{
+  uint32_t n = 0;
+  while (block != 0)
+    {
+      struct BufferFreeBlock *next = block->next;
+      delete [] reinterpret_cast<uint8_t *> (block);
+      block = next;
+      n++;
+    }
+  return n;
+}
+
+bool
+IsDepotDestroyed (void)
+{
+  return __atomic_load_n (&g_bufferDepotDestroyed, __ATOMIC_ACQUIRE) != 0;
+}
+
+void
+LockDepot (void)
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock (&g_bufferDepotMutex);
+#endif /* HAVE_PTHREAD_H */
+}
+
+void
+UnlockDepot (void)
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_unlock (&g_bufferDepotMutex);
+#endif /* HAVE_PTHREAD_H */
+}
+
+// gives a list of Buffer::Data of the size class to the depot, or
+// deletes it if the depot is full and counts the deletions in stats.
+void
+PutBatch (uint32_t sizeClass, struct BufferFreeBlock *batch,
+          struct Buffer::FreeListStatistics *stats)
+{
+  LockDepot ();
+  if (!g_bufferDepotDestroyed && g_bufferDepot.n[sizeClass] < BUFFER_DEPOT_SIZE)
+    {
+      g_bufferDepot.batches[sizeClass][g_bufferDepot.n[sizeClass]++] = batch;
+      batch = 0;
+    }
+  UnlockDepot ();
+  stats->overflows += DeleteBlocks (batch);
+}
+
+struct BufferFreeBlock *
+GetBatch (uint32_t sizeClass)
+{
+  struct BufferFreeBlock *batch = 0;
+  LockDepot ();
+  if (g_bufferDepot.n[sizeClass] > 0)
     {
-      for (Buffer::FreeList::iterator i = g_freeList->begin ();
-           i != g_freeList->end (); i++)
+      batch = g_bufferDepot.batches[sizeClass][--g_bufferDepot.n[sizeClass]];
+    }
+  UnlockDepot ();
+  return batch;
+}
+
+// gives the whole cache of the calling thread to the depot.
+void
+FlushCache (struct BufferCache *cache)
+{
+  for (uint32_t i = 0; i < BUFFER_N_SIZE_CLASSES; i++)
+    {
+      if (cache->head[i] != 0)
         {
-          Buffer::Deallocate (*i);
+          PutBatch (i, cache->head[i], &cache->stats);
+          cache->head[i] = 0;
+          cache->n[i] = 0;
         }
-      delete g_freeList;
-      g_freeList = DESTROYED;
     }
+  cache->stats.size = 0;
+}
+
+#ifdef HAVE_PTHREAD_H
+void
+ThreadExit (void *cache)
+{
+  FlushCache (static_cast<struct BufferCache *> (cache));
+}
+
+void
+CreateCacheKey (void)
+{
+  pthread_key_create (&g_bufferCacheKey, &ThreadExit);
+}
+#endif /* HAVE_PTHREAD_H */
+
+struct BufferCache *
+GetCache (void)
+{
+  struct BufferCache *cache = &g_bufferCache;
+#ifdef HAVE_PTHREAD_H
+  if (!cache->registered)
+    {
+      // the cache of a thread goes to the depot when the thread exits
+      pthread_once (&g_bufferCacheKeyOnce, &CreateCacheKey);
+      pthread_setspecific (g_bufferCacheKey, cache);
+      cache->registered = true;
+    }
+#endif /* HAVE_PTHREAD_H */
+  return cache;
+}
+
+// the smallest size class which can hold size bytes
+uint32_t
+GetSizeClass (uint32_t size)
+{
+  if (size <= BUFFER_MIN_SIZE)
+    {
+      return 0;
+    }
+  return 32 - __builtin_clz (size - 1) - BUFFER_MIN_SIZE_SHIFT;
+}
+
+static struct BufferDepotDestructor
+{
+  ~BufferDepotDestructor ()
+  {
+    LockDepot ();
+    __sync_lock_test_and_set (&g_bufferDepotDestroyed, 1);
+    UnlockDepot ();
+    FlushCache (&g_bufferCache);
+    for (uint32_t i = 0; i < BUFFER_N_SIZE_CLASSES; i++)
+      {
+        while (g_bufferDepot.n[i] > 0)
+          {
+            DeleteBlocks (g_bufferDepot.batches[i][--g_bufferDepot.n[i]]);
+          }
+      }
+  }
+} g_bufferDepotDestructor;
+
+} // anonymous namespace
+
+struct Buffer::FreeListStatistics
+Buffer::GetFreeListStatistics (void)
+{
+  return g_bufferCache.stats;
 }
 
 void
 Buffer::Recycle (struct Buffer::Data *data)
 {
   NS_ASSERT (data->m_count == 0);
-  NS_ASSERT (!IS_UNINITIALIZED(g_freeList));
-  g_maxSize = std::max (g_maxSize, data->m_size);
-  /* feed into free list */
-  if (data->m_size < g_maxSize ||
-      IS_DESTROYED(g_freeList) ||
-      g_freeList->size () > 1000)
+  struct BufferCache *cache = GetCache ();
+  cache->stats.releases++;
+  if (data->m_size > BUFFER_MAX_SIZE || IsDepotDestroyed ())
     {
+      cache->stats.overflows++;
       Buffer::Deallocate (data);
+      return;
     }
-  else
+  uint32_t sizeClass = GetSizeClass (data->m_size);
+  NS_ASSERT ((uint32_t)(BUFFER_MIN_SIZE << sizeClass) == data->m_size);
+  if (cache->n[sizeClass] == BUFFER_CACHE_SIZE)
     {
-      NS_ASSERT (IS_INITIALIZED(g_freeList));
-      g_freeList->push_back (data);
+      // give the oldest half of the cache to the depot
+      struct BufferFreeBlock *last = cache->head[sizeClass];
+      for (uint32_t i = 1; i < BUFFER_CACHE_SIZE - BUFFER_BATCH_SIZE; i++)
+        {
+          last = last->next;
+        }
+      PutBatch (sizeClass, last->next, &cache->stats);
+      last->next = 0;
+      cache->n[sizeClass] -= BUFFER_BATCH_SIZE;
+      cache->stats.size -= BUFFER_BATCH_SIZE;
+      cache->stats.depotTransfers++;
     }
+  struct BufferFreeBlock *block = reinterpret_cast<struct BufferFreeBlock *> (data);
+  block->next = cache->head[sizeClass];
+  cache->head[sizeClass] = block;
+  cache->n[sizeClass]++;
+  cache->stats.size++;
 }
 
 Buffer::Data *
 Buffer::Create (uint32_t dataSize)
 {
-  /* try to find a buffer correctly sized. */
-  if (IS_UNINITIALIZED(g_freeList))
-    {
-      g_freeList = new Buffer::FreeList ();
-    }
-  else if (IS_INITIALIZED(g_freeList))
+  struct BufferCache *cache = GetCache ();
+  cache->stats.allocations++;
+  if (dataSize <= BUFFER_MAX_SIZE && !IsDepotDestroyed ())
     {
-      while (!g_freeList->empty ()) 
+      uint32_t sizeClass = GetSizeClass (dataSize);
+      if (cache->head[sizeClass] == 0)
         {
-          struct Buffer::Data *data = g_freeList->back ();
-          g_freeList->pop_back ();
-          if (data->m_size >= dataSize) 
+          struct BufferFreeBlock *batch = GetBatch (sizeClass);
+          if (batch != 0)
             {
-              data->m_count = 1;
-              return data;
+              uint32_t n = 0;
+              for (struct BufferFreeBlock *cur = batch; cur != 0; cur = cur->next)
+                {
+                  n++;
+                }
+              cache->head[sizeClass] = batch;
+              cache->n[sizeClass] = n;
+              cache->stats.size += n;
+              cache->stats.depotTransfers++;
             }
-          Buffer::Deallocate (data);
+        }
+      struct BufferFreeBlock *block = cache->head[sizeClass];
+      if (block != 0)
+        {
+          cache->head[sizeClass] = block->next;
+          cache->n[sizeClass]--;
+          cache->stats.size--;
+          struct Buffer::Data *data = reinterpret_cast<struct Buffer::Data *> (block);
+          data->m_size = BUFFER_MIN_SIZE << sizeClass;
+          data->m_count = 1;
+          return data;
         }
     }
+  cache->stats.misses++;
   struct Buffer::Data *data = Buffer::Allocate (dataSize);
   NS_ASSERT (data->m_count == 1);
   return data;
 }
-#else /* BUFFER_FREE_LIST */
-void
-Buffer::Recycle (struct Buffer::Data *data)
-{
-  NS_ASSERT (data->m_count == 0);
-  Deallocate (data);
-}
-
-Buffer::Data *
-Buffer::Create (uint32_t size)
-{
-  return Allocate (size);
-}
-#endif /* BUFFER_FREE_LIST */
 
 struct Buffer::Data *
 Buffer::Allocate (uint32_t reqSize)
@@ -158,6 +349,11 @@ Buffer::Allocate (uint32_t reqSize)
       reqSize = 1;
     }
   NS_ASSERT (reqSize >= 1);
+  if (reqSize <= BUFFER_MAX_SIZE)
+    {
+      // round up to the size class, so that the data can be recycled
+      reqSize = BUFFER_MIN_SIZE << GetSizeClass (reqSize);
+    }
   uint32_t size = reqSize - 1 + sizeof (struct Buffer::Data);
   uint8_t *b = new uint8_t [size];
   struct Buffer::Data *data = reinterpret_cast<struct Buffer::Data*>(b);
@@ -557,6 +753,25 @@ Buffer::CreateFullCopy (void) const
   return *this;
 }
 
+void
+Buffer::Unshare (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (CheckInternalState ());
+  if (m_data->m_count == 1)
+    {
+      return;
+    }
+  struct Buffer::Data *data = Buffer::Create (m_data->m_size);
+  memcpy (data->m_data + m_start, m_data->m_data + m_start, GetInternalSize ());
+  // the old data is still referenced by another buffer.
+  m_data->m_count--;
+  m_data = data;
+  m_data->m_dirtyStart = m_start;
+  m_data->m_dirtyEnd = m_end;
+  NS_ASSERT (CheckInternalState ());
+}
+
 uint32_t 
 Buffer::GetSerializedSize (void) const
 {
@@ -724,28 +939,26 @@ Buffer::PeekData (void) const
 void
 Buffer::CopyData(std::ostream *os, uint32_t size) const
 {
-  if (size > 0)
+  // Only the requested prefix is visited.  The zero area is not stored,
+  // so it is written from the static block of zeroes.
+  uint32_t tmpsize = std::min (m_zeroAreaStart - m_start, size);
+  if (tmpsize > 0)
     {
-      uint32_t tmpsize = std::min (m_zeroAreaStart-m_start, size);
-      os->write((const char*)(m_data->m_data + m_start), tmpsize);
-      if (size > tmpsize) 
-        { 
-          size -= m_zeroAreaStart-m_start;
-          tmpsize = std::min (m_zeroAreaEnd - m_zeroAreaStart, size);
-          uint32_t left = tmpsize;
-          while (left > 0)
-            {
-              uint32_t toWrite = std::min (left, g_zeroes.size);
-              os->write (g_zeroes.buffer, toWrite);
-              left -= toWrite;
-            }
-          if (size > tmpsize)
-            {
-              size -= tmpsize;
-              tmpsize = std::min (m_end - m_zeroAreaEnd, size);
-              os->write ((const char*)(m_data->m_data + m_zeroAreaStart), tmpsize); 
-            }
-        }
+      os->write ((const char*)(m_data->m_data + m_start), tmpsize);
+      size -= tmpsize;
+    }
+  tmpsize = std::min (m_zeroAreaEnd - m_zeroAreaStart, size);
+  size -= tmpsize;
+  while (tmpsize > 0)
+    {
+      uint32_t toWrite = std::min (tmpsize, g_zeroes.size);
+      os->write (g_zeroes.buffer, toWrite);
+      tmpsize -= toWrite;
+    }
+  tmpsize = std::min (m_end - m_zeroAreaEnd, size);
+  if (tmpsize > 0)
+    {
+      os->write ((const char*)(m_data->m_data + m_zeroAreaStart), tmpsize);
     }
 }
 
@@ -753,31 +966,17 @@ uint32_t
 Buffer::CopyData (uint8_t *buffer, uint32_t size) const
 {
   uint32_t originalSize = size;
-  if (size > 0)
-    {
-      uint32_t tmpsize = std::min (m_zeroAreaStart-m_start, size);
-      memcpy (buffer, (const char*)(m_data->m_data + m_start), tmpsize);
-      buffer += tmpsize;
-      if (size > tmpsize) 
-        { 
-          size -= m_zeroAreaStart-m_start;
-          tmpsize = std::min (m_zeroAreaEnd - m_zeroAreaStart, size);
-          uint32_t left = tmpsize;
-          while (left > 0)
-            {
-              uint32_t toWrite = std::min (left, g_zeroes.size);
-              memcpy (buffer, g_zeroes.buffer, toWrite);
-              left -= toWrite;
-              buffer += toWrite;
-            }
-          if (size > tmpsize)
-            {
-              size -= tmpsize;
-              tmpsize = std::min (m_end - m_zeroAreaEnd, size);
-              memcpy (buffer, (const char*)(m_data->m_data + m_zeroAreaStart), tmpsize);
-            }
-        }
-    }
+  uint32_t tmpsize = std::min (m_zeroAreaStart - m_start, size);
+  memcpy (buffer, m_data->m_data + m_start, tmpsize);
+  buffer += tmpsize;
+  size -= tmpsize;
+  tmpsize = std::min (m_zeroAreaEnd - m_zeroAreaStart, size);
+  memset (buffer, 0, tmpsize);
+  buffer += tmpsize;
+  size -= tmpsize;
+  tmpsize = std::min (m_end - m_zeroAreaEnd, size);
+  memcpy (buffer, m_data->m_data + m_zeroAreaStart, tmpsize);
+  size -= tmpsize;
   return originalSize - size;
 }
 
@@ -846,25 +1045,32 @@ Buffer::Iterator::Write (Iterator start, Iterator end)
   //  Iterator cur = start;
   NS_ASSERT_MSG (CheckNoZero (m_current, m_current + size),
                  GetWriteErrorMessage ());
+  // the destination is entirely before or after our zero area
+  uint8_t *to = &m_data[m_current];
+  if (m_current >= m_zeroEnd)
+    {
+      to -= m_zeroEnd - m_zeroStart;
+    }
   if (start.m_current <= start.m_zeroStart)
     {
       uint32_t toCopy = std::min (size, start.m_zeroStart - start.m_current);
-      memcpy (&m_data[m_current], &start.m_data[start.m_current], toCopy);
+      memcpy (to, &start.m_data[start.m_current], toCopy);
       start.m_current += toCopy;
       m_current += toCopy;
+      to += toCopy;
       size -= toCopy;
     }
   if (start.m_current <= start.m_zeroEnd)
     {
       uint32_t toCopy = std::min (size, start.m_zeroEnd - start.m_current);
-      memset (&m_data[m_current], 0, toCopy);
+      memset (to, 0, toCopy);
       start.m_current += toCopy;
       m_current += toCopy;
+      to += toCopy;
       size -= toCopy;
     }
   uint32_t toCopy = std::min (size, start.m_dataEnd - start.m_current);
   uint8_t *from = &start.m_data[start.m_current - (start.m_zeroEnd-start.m_zeroStart)];
-  uint8_t *to = &m_data[m_current];
   memcpy (to, from, toCopy);
   m_current += toCopy;
 }
@@ -1115,6 +1321,60 @@ Buffer::Iterator::Read (uint8_t *buffer, uint32_t size)
     }
 }
 
+/* The one's complement sum of the 16 bit words of [data, data + size),
+ * read as ReadU16 does, that is, in little-endian order. A zero byte is
+ * appended if size is odd. The words are added 64 bits at a time in
+ * host order and the sum is converted at the end, see RFC 1071.
+ */
+static uint16_t
+SumIpWords (const uint8_t *data, uint32_t size)
+{
+  uint64_t sum = 0;
+  while (size >= 32)
+    {
+      uint64_t words[4];
+      memcpy (words, data, sizeof (words));
+      sum += (words[0] & 0xffffffff) + (words[0] >> 32);
+      sum += (words[1] & 0xffffffff) + (words[1] >> 32);
+      sum += (words[2] & 0xffffffff) + (words[2] >> 32);
+      sum += (words[3] & 0xffffffff) + (words[3] >> 32);
+      data += 32;
+      size -= 32;
+    }
+  while (size >= 4)
+    {
+      uint32_t word;
+      memcpy (&word, data, 4);
+      sum += word;
+      data += 4;
+      size -= 4;
+    }
+  const uint16_t one = 1;
+  bool littleEndian = *reinterpret_cast<const uint8_t *> (&one) == 1;
+  if (size >= 2)
+    {
+      uint16_t word;
+      memcpy (&word, data, 2);
+      sum += word;
+      data += 2;
+      size -= 2;
+    }
+  if (size == 1)
+    {
+      sum += littleEndian ? data[0] : (data[0] << 8);
+    }
+  while (sum >> 16)
+    {
+      sum = (sum & 0xffff) + (sum >> 16);
+    }
+  uint16_t result = sum;
+  if (!littleEndian)
+    {
+      result = (result >> 8) | (result << 8);
+    }
+  return result;
+}
+
 uint16_t
 Buffer::Iterator::CalculateIpChecksum(uint16_t size)
 {
@@ -1125,13 +1385,32 @@ uint16_t
 Buffer::Iterator::CalculateIpChecksum(uint16_t size, uint32_t initialChecksum)
 {
   /* see RFC 1071 to understand this code. */
-  uint32_t sum = initialChecksum;
-
-  for (int j = 0; j < size/2; j++)
-    sum += ReadU16 ();
-
-  if (size & 1)
-    sum += ReadU8 ();
+  NS_ASSERT_MSG (m_current >= m_dataStart &&
+                 m_current + size <= m_dataEnd,
+                 GetReadErrorMessage ());
+  uint64_t sum = initialChecksum;
+  uint32_t start = m_current;
+  uint32_t end = m_current + size;
+
+  // the zero area adds nothing to the sum: only the bytes before and
+  // after it are read.
+  if (start < m_zeroStart)
+    {
+      sum += SumIpWords (&m_data[start], std::min (end, m_zeroStart) - start);
+    }
+  if (end > m_zeroEnd)
+    {
+      uint32_t from = std::max (start, m_zeroEnd);
+      uint16_t after = SumIpWords (&m_data[from - (m_zeroEnd - m_zeroStart)],
+                                   end - from);
+      if ((from - start) & 1)
+        {
+          // these bytes are not aligned on the words of the checksum
+          after = (after >> 8) | (after << 8);
+        }
+      sum += after;
+    }
+  m_current = end;
 
   while (sum >> 16)
     sum = (sum & 0xffff) + (sum >> 16);
@@ -25,8 +25,6 @@
 #include <ostream>
 #include "ns3/assert.h"
 
-#define noBUFFER_FREE_LIST 1
-
 namespace ns3 {
 
 /**
@@ -481,6 +479,14 @@ private:
 
   Buffer CreateFullCopy (void) const;
 
+  /**
+   * Make sure that the bytes of this buffer are not shared with any
+   * other buffer: this is needed before handing over a buffer to
+   * another thread because the reference count of the shared data is
+   * not atomic.
+   */
+  void Unshare (void);
+
   /**
    * \return the number of bytes required for serialization 
    */
@@ -516,9 +522,22 @@ private:
    * 
    * @param os the output stream
    * @param size the maximum amount of bytes to copy. If zero, nothing is copied.
+   *
+   * Only the first bytes of the buffer are read, and the virtual zero area
+   * is not materialized.
    */
   void CopyData (std::ostream *os, uint32_t size) const;
 
+  /** 
+   * Copy the specified amount of data from the buffer to the given memory area.
+   * 
+   * @param buffer the memory area, of at least size bytes
+   * @param size the maximum amount of bytes to copy.
+   * @return the number of bytes copied
+   *
+   * Only the first bytes of the buffer are read, and the virtual zero area
+   * is not materialized.
+   */
   uint32_t CopyData (uint8_t *buffer, uint32_t size) const;
 
   inline Buffer (Buffer const &o);
@@ -527,6 +546,35 @@ private:
   Buffer (uint32_t dataSize);
   Buffer (uint32_t dataSize, bool initialize);
   ~Buffer ();
+
+  /**
+   * The counters of the byte storage cache of the calling thread.
+   *
+   * The byte storage of the buffers is allocated in power-of-two size
+   * classes, up to 64KiB. Each thread keeps a small cache of free
+   * storage per size class, and exchanges batches of free storage with
+   * a depot shared by all the threads when its cache is empty or full.
+   */
+  struct FreeListStatistics
+  {
+    /// number of storage blocks handed out
+    uint64_t allocations;
+    /// number of storage blocks which had to be allocated with new
+    uint64_t misses;
+    /// number of storage blocks given back
+    uint64_t releases;
+    /// number of storage blocks deleted because they were larger than
+    /// the largest size class or because the depot was full
+    uint64_t overflows;
+    /// number of batches taken from or given to the depot
+    uint64_t depotTransfers;
+    /// number of storage blocks currently in the cache of the thread
+    uint32_t size;
+  };
+  /**
+   * \returns the allocation statistics of the calling thread.
+   */
+  static struct FreeListStatistics GetFreeListStatistics (void);
 private:
   /**
    * This data structure is variable-sized through its last member whose size
@@ -592,7 +640,11 @@ private:
    * writing data. i.e., m_start should be initialized to this 
    * value.
    */
+#ifdef NS3_MULTITHREADING
+  static __thread uint32_t g_recommendedStart;
+#else
   static uint32_t g_recommendedStart;
+#endif
 
   /* offset to the start of the virtual zero area from the start 
    * of m_data->m_data
@@ -611,16 +663,6 @@ private:
    */
   uint32_t m_end;
 
-#ifdef BUFFER_FREE_LIST
-  typedef std::vector<struct Buffer::Data*> FreeList;
-  struct LocalStaticDestructor 
-  {
-    ~LocalStaticDestructor ();
-  };
-  static uint32_t g_maxSize;
-  static FreeList *g_freeList;
-  static struct LocalStaticDestructor g_localStaticDestructor;
-#endif
 };
 
 } // namespace ns3
@@ -24,8 +24,10 @@
 
 NS_LOG_COMPONENT_DEFINE ("ByteTagList");
 
+#ifndef NS3_MULTITHREADING
+// the free list is shared by all the threads of the process
 #define USE_FREE_LIST 1
-#define FREE_LIST_SIZE 1000
+#endif
 #define OFFSET_MAX (2147483647)
 
 namespace ns3 {
@@ -44,6 +46,10 @@ public:
   ~ByteTagListDataFreeList ();
 } g_freeList;
 static uint32_t g_maxSize = 0;
+static uint32_t g_maxFreeListSize = 1000;
+#endif /* USE_FREE_LIST */
+static struct ByteTagList::FreeListStatistics g_stats;
+#ifdef USE_FREE_LIST
 
 ByteTagListDataFreeList::~ByteTagListDataFreeList ()
 {
@@ -56,6 +62,28 @@ ByteTagListDataFreeList::~ByteTagListDataFreeList ()
 }
 #endif /* USE_FREE_LIST */
 
+void
+ByteTagList::SetMaxFreeListSize (uint32_t maxSize)
+{
+  NS_LOG_FUNCTION (maxSize);
+#ifdef USE_FREE_LIST
+  g_maxFreeListSize = maxSize;
+  while (g_freeList.size () > g_maxFreeListSize)
+    {
+      uint8_t *buffer = (uint8_t *)g_freeList.back ();
+      g_freeList.pop_back ();
+      delete [] buffer;
+    }
+  g_stats.size = g_freeList.size ();
+#endif /* USE_FREE_LIST */
+}
+
+struct ByteTagList::FreeListStatistics
+ByteTagList::GetFreeListStatistics (void)
+{
+  return g_stats;
+}
+
 ByteTagList::Iterator::Item::Item (TagBuffer buf_)
   : buf (buf_)
 {
@@ -201,6 +229,21 @@ ByteTagList::Add (const ByteTagList &o)
     }
 }
 
+void
+ByteTagList::Unshare (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_data == 0 || m_data->count == 1)
+    {
+      return;
+    }
+  struct ByteTagListData *newData = Allocate (m_data->size);
+  memcpy (&newData->data, &m_data->data, m_used);
+  newData->dirty = m_used;
+  Deallocate (m_data);
+  m_data = newData;
+}
+
 void 
 ByteTagList::RemoveAll (void)
 {
@@ -339,10 +382,12 @@ struct ByteTagListData *
 ByteTagList::Allocate (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
+  g_stats.allocations++;
   while (!g_freeList.empty ())
     {
       struct ByteTagListData *data = g_freeList.back ();
       g_freeList.pop_back ();
+      g_stats.size--;
       NS_ASSERT (data != 0);
       if (data->size >= size)
         {
@@ -350,9 +395,11 @@ ByteTagList::Allocate (uint32_t size)
           data->dirty = 0;
           return data;
         }
+      g_stats.overflows++;
       uint8_t *buffer = (uint8_t *)data;
       delete [] buffer;
     }
+  g_stats.misses++;
   uint8_t *buffer = new uint8_t [std::max (size, g_maxSize) + sizeof (struct ByteTagListData) - 4];
   struct ByteTagListData *data = (struct ByteTagListData *)buffer;
   data->count = 1;
@@ -373,15 +420,18 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
   data->count--;
   if (data->count == 0)
     {
-      if (g_freeList.size () > FREE_LIST_SIZE ||
+      g_stats.releases++;
+      if (g_freeList.size () >= g_maxFreeListSize ||
           data->size < g_maxSize)
         {
+          g_stats.overflows++;
           uint8_t *buffer = (uint8_t *)data;
           delete [] buffer;
         }
       else
         {
           g_freeList.push_back (data);
+          g_stats.size++;
         }
     }
 }
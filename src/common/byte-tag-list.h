@@ -125,6 +125,12 @@ private:
    */
   void Add (const ByteTagList &o);
 
+  /**
+   * Make sure that the tags of this list are not shared with any
+   * other list.
+   */
+  void Unshare (void);
+
   void RemoveAll (void);
 
   /**
@@ -153,6 +159,36 @@ private:
    */
   void AddAtStart (int32_t adjustment, int32_t prependOffset);
 
+  /**
+   * The counters of the free list of tag storage.
+   */
+  struct FreeListStatistics
+  {
+    /// number of storage blocks handed out
+    uint64_t allocations;
+    /// number of storage blocks which had to be allocated with new
+    uint64_t misses;
+    /// number of storage blocks given back
+    uint64_t releases;
+    /// number of storage blocks deleted because the free list was full
+    /// or because they were too small to be reused
+    uint64_t overflows;
+    /// number of storage blocks currently in the free list
+    uint32_t size;
+  };
+  /**
+   * \param maxSize the maximum number of unused storage blocks kept for
+   *        reuse. The default is 1000.
+   *
+   * The free list is not used, and the statistics are not updated, if
+   * ns-3 is configured with --enable-multithreading.
+   */
+  static void SetMaxFreeListSize (uint32_t maxSize);
+  /**
+   * \returns the allocation statistics of the free list.
+   */
+  static struct FreeListStatistics GetFreeListStatistics (void);
+
 private:
   bool IsDirtyAtEnd (int32_t appendOffset);
   bool IsDirtyAtStart (int32_t prependOffset);
@@ -251,6 +251,7 @@ namespace ns3 {
 class PacketMetadataTest : public TestCase {
 public:
   PacketMetadataTest ();
+  PacketMetadataTest (std::string name);
   virtual ~PacketMetadataTest ();
   bool CheckHistory (Ptr<Packet> p, const char *file, int line, uint32_t n, ...);
   virtual bool DoRun (void);
@@ -262,6 +263,10 @@ PacketMetadataTest::PacketMetadataTest ()
   : TestCase ("Packet metadata")
 {}
 
+PacketMetadataTest::PacketMetadataTest (std::string name)
+  : TestCase (name)
+{}
+
 PacketMetadataTest::~PacketMetadataTest ()
 {}
 
@@ -777,6 +782,56 @@ PacketMetadataTest::DoRun (void)
   
   return !result;
 }
+
+// must run before PacketMetadataTest which enables all the types.
+class SelectivePacketMetadataTest : public PacketMetadataTest {
+public:
+  SelectivePacketMetadataTest ();
+  virtual bool DoRun (void);
+};
+
+SelectivePacketMetadataTest::SelectivePacketMetadataTest ()
+  : PacketMetadataTest ("Packet metadata of selected types")
+{}
+
+bool
+SelectivePacketMetadataTest::DoRun (void)
+{
+  bool result = true;
+
+  PacketMetadata::Enable (HistoryHeader<10>::GetTypeId ());
+
+  // the other headers and trailers are merged into the payload
+  Ptr<Packet> p = Create<Packet> (100);
+  ADD_HEADER (p, 5);
+  CHECK_HISTORY (p, 1, 105);
+  ADD_HEADER (p, 10);
+  CHECK_HISTORY (p, 2, 10, 105);
+  ADD_HEADER (p, 3);
+  CHECK_HISTORY (p, 3, 3, 10, 105);
+  ADD_TRAILER (p, 4);
+  CHECK_HISTORY (p, 3, 3, 10, 109);
+
+  // and removed from it, in place or from a copy
+  Ptr<Packet> p1 = p->Copy ();
+  REM_HEADER (p1, 3);
+  CHECK_HISTORY (p1, 2, 10, 109);
+  REM_HEADER (p1, 10);
+  CHECK_HISTORY (p1, 1, 109);
+  REM_HEADER (p1, 5);
+  CHECK_HISTORY (p1, 1, 104);
+  REM_TRAILER (p1, 4);
+  CHECK_HISTORY (p1, 1, 100);
+  CHECK_HISTORY (p, 3, 3, 10, 109);
+  REM_HEADER (p, 3);
+  REM_HEADER (p, 10);
+  REM_TRAILER (p, 4);
+  CHECK_HISTORY (p, 1, 105);
+  REM_HEADER (p, 5);
+  CHECK_HISTORY (p, 1, 100);
+
+  return !result;
+}
 //-----------------------------------------------------------------------------
 class PacketMetadataTestSuite : public TestSuite
 {
@@ -787,6 +842,7 @@ public:
 PacketMetadataTestSuite::PacketMetadataTestSuite ()
   : TestSuite ("packet-metadata", UNIT)
 {
+  AddTestCase (new SelectivePacketMetadataTest);
   AddTestCase (new PacketMetadataTest);
 }
 
@@ -37,6 +37,10 @@ bool PacketMetadata::m_metadataSkipped = false;
 uint32_t PacketMetadata::m_maxSize = 0;
 uint16_t PacketMetadata::m_chunkUid = 0;
 PacketMetadata::DataFreeList PacketMetadata::m_freeList;
+bool PacketMetadata::m_selective = false;
+std::vector<bool> PacketMetadata::m_recordedTypes;
+const uint32_t PacketMetadata::SMALL_ITEM_SIZE;
+const uint32_t PacketMetadata::EXTRA_ITEM_SIZE;
 
 PacketMetadata::DataFreeList::~DataFreeList ()
 {
@@ -58,6 +62,34 @@ PacketMetadata::Enable (void)
                  "to call ns3::PacketMetadata::Enable () near the beginning of"
                  " the program, before any packets are sent.");
   m_enable = true;
+  m_selective = false;
+}
+
+void
+PacketMetadata::Enable (TypeId tid)
+{
+  bool selective = m_selective || !m_enable;
+  Enable ();
+  m_selective = selective;
+  uint16_t uid = tid.GetUid ();
+  if (uid >= m_recordedTypes.size ())
+    {
+      m_recordedTypes.resize (uid + 1, false);
+    }
+  m_recordedTypes[uid] = true;
+}
+
+uint32_t
+PacketMetadata::GetTypeUid (TypeId tid)
+{
+  uint16_t uid = tid.GetUid ();
+  if (m_selective && (uid >= m_recordedTypes.size () || !m_recordedTypes[uid]))
+    {
+      // recorded as payload
+      return 0;
+    }
+  NS_ASSERT (uid < 0x8000);
+  return uid << 1;
 }
 
 void 
@@ -70,7 +102,6 @@ PacketMetadata::EnableChecking (void)
 void
 PacketMetadata::ReserveCopy (uint32_t size)
 {
-  std::cout << "reserving copy with: " << m_used << " + " << size << std::endl;
   struct PacketMetadata::Data *newData = PacketMetadata::Create (m_used + size);
   memcpy (newData->m_data, m_data->m_data, m_used);
   newData->m_dirtyEnd = m_used;
@@ -110,76 +141,6 @@ PacketMetadata::Reserve (uint32_t size)
     }
 }
 
-uint32_t 
-PacketMetadata::GetUleb128Size (uint32_t value) const
-{
-  if (value < 0x80)
-    {
-      return 1;
-    }
-  if (value < 0x4000)
-    {
-      return 2;
-    }
-  if (value < 0x200000)
-    {
-      return 3;
-    }
-  if (value < 0x10000000)
-    {
-      return 4;
-    }
-  return 5;
-}
-uint32_t
-PacketMetadata::ReadUleb128 (const uint8_t **pBuffer) const
-{
-  const uint8_t *buffer = *pBuffer;
-  uint32_t result = 0;
-  uint8_t byte;
-  result = 0;
-  byte = buffer[0];
-  result = (byte & (~0x80));
-  if (!(byte & 0x80))
-    {
-      *pBuffer = buffer + 1;
-      return result;
-    }
-  byte = buffer[1];
-  result |= (byte & (~0x80)) << 7;
-  if (!(byte & 0x80))
-    {
-      *pBuffer = buffer + 2;
-      return result;
-    }
-  byte = buffer[2];
-  result |= (byte & (~0x80)) << 14;
-  if (!(byte & 0x80))
-    {
-      *pBuffer = buffer + 3;
-      return result;
-    }
-  byte = buffer[3];
-  result |= (byte & (~0x80)) << 21;
-  if (!(byte & 0x80))
-    {
-      *pBuffer = buffer + 4;
-      return result;
-    }
-  byte = buffer[4];
-  result |= (byte & (~0x80)) << 28;
-  if (!(byte & 0x80))
-    {
-      *pBuffer = buffer + 5;
-      return result;
-    }
-  /* This means that the LEB128 number was not valid.
-   * ie: the last (5th) byte did not have the high-order bit zeroed.
-   */
-  NS_ASSERT (false);
-  return 0;
-}
-
 void
 PacketMetadata::Append16 (uint16_t value, uint8_t *buffer)
 {
@@ -195,70 +156,35 @@ PacketMetadata::Append32 (uint32_t value,  uint8_t *buffer)
   buffer[2] = (value >> 16) & 0xff;
   buffer[3] = (value >> 24) & 0xff;
 }
-
-void
-PacketMetadata::AppendValueExtra (uint32_t value, uint8_t *buffer)
+uint16_t
+PacketMetadata::Read16 (const uint8_t *buffer) const
 {
-  if (value < 0x200000)
-    {
-      uint8_t byte = value & (~0x80);
-      buffer[0] = 0x80 | byte;
-      value >>= 7;
-      byte = value & (~0x80);
-      buffer[1] = 0x80 | byte;
-      value >>= 7;
-      byte = value & (~0x80);
-      buffer[2] = value;
-      return;
-    }
-  if (value < 0x10000000)
-    {
-      uint8_t byte = value & (~0x80);
-      buffer[0] = 0x80 | byte;
-      value >>= 7;
-      byte = value & (~0x80);
-      buffer[1] = 0x80 | byte;
-      value >>= 7;
-      byte = value & (~0x80);
-      buffer[2] = 0x80 | byte;
-      value >>= 7;
-      buffer[3] = value;
-      return;
-    }
-  {
-    uint8_t byte = value & (~0x80);
-    buffer[0] = 0x80 | byte;
-    value >>= 7;
-    byte = value & (~0x80);
-    buffer[1] = 0x80 | byte;
-    value >>= 7;
-    byte = value & (~0x80);
-    buffer[2] = 0x80 | byte;
-    value >>= 7;
-    byte = value & (~0x80);
-    buffer[3] = 0x80 | byte;
-    value >>= 7;
-    buffer[4] = value;
-  }
+  return buffer[0] | (buffer[1] << 8);
+}
+uint32_t
+PacketMetadata::Read32 (const uint8_t *buffer) const
+{
+  return buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
 }
 
 void
-PacketMetadata::AppendValue (uint32_t value, uint8_t *buffer)
+PacketMetadata::WriteItems (uint8_t *buffer, uint16_t next, uint16_t prev,
+                            const struct PacketMetadata::SmallItem *item,
+                            const struct PacketMetadata::ExtraItem *extraItem)
 {
-  if (value < 0x80)
-    {
-      buffer[0] = value;
-      return;
-    }
-  if (value < 0x4000)
+  NS_ASSERT (item->typeUid <= 0xffff);
+  Append16 (next, buffer);
+  Append16 (prev, buffer + 2);
+  Append16 (item->typeUid, buffer + 4);
+  Append32 (item->size, buffer + 6);
+  Append16 (item->chunkUid, buffer + 10);
+  if (extraItem != 0)
     {
-      uint8_t byte = value & (~0x80);
-      buffer[0] = 0x80 | byte;
-      value >>= 7;
-      buffer[1] = value;
-      return;
+      buffer += SMALL_ITEM_SIZE;
+      Append32 (extraItem->fragmentStart, buffer);
+      Append32 (extraItem->fragmentEnd, buffer + 4);
+      Append32 (extraItem->packetUid, buffer + 8);
     }
-  AppendValueExtra (value, buffer);
 }
 
 void
@@ -319,33 +245,16 @@ PacketMetadata::AddSmall
  (const struct PacketMetadata::SmallItem *item)
 {
   NS_LOG_FUNCTION (this << item->next << item->prev << item->typeUid << item->size << item->chunkUid);
-  // talau: NS_ASSERT, garante que condicao seja verdadeira para proceguir.
   NS_ASSERT (m_data != 0);
   NS_ASSERT (m_used != item->prev && m_used != item->next);
-  uint32_t typeUidSize = GetUleb128Size (item->typeUid);
-  uint32_t sizeSize = GetUleb128Size (item->size);
-  //; value will be, 1,2,3,4 or 5
-  std::cout << "sizeSize " << sizeSize << std::endl;
-  uint32_t n =  2 + 2 + typeUidSize + sizeSize + 2;
+  uint32_t n = SMALL_ITEM_SIZE;
   if (m_used + n > m_data->m_size ||
-      (m_head != 0xffff &&
-       m_data->m_count != 1 &&
+      (m_data->m_count != 1 &&
        m_used != m_data->m_dirtyEnd))
     {
       ReserveCopy (n);
     }
-  uint8_t *buffer = &m_data->m_data[m_used];
-  // talau: Append16: add in [0] and [1] in buffer
-  Append16 (item->next, buffer);
-  // avance 2 positions in buffer
-  buffer += 2;
-  Append16 (item->prev, buffer);
-  buffer += 2;
-  AppendValue (item->typeUid, buffer);
-  buffer += typeUidSize;
-  AppendValue (item->size, buffer);
-  buffer += sizeSize;
-  Append16 (item->chunkUid, buffer);
+  WriteItems (&m_data->m_data[m_used], item->next, item->prev, item, 0);
   return n;
 }
 
@@ -358,41 +267,18 @@ PacketMetadata::AddBig (uint32_t next, uint32_t prev,
                    item->next << item->prev << item->typeUid << item->size << item->chunkUid <<
                    extraItem->fragmentStart << extraItem->fragmentEnd << extraItem->packetUid);
   NS_ASSERT (m_data != 0);
-  uint32_t typeUid = ((item->typeUid & 0x1) == 0x1) ? item->typeUid : item->typeUid+1;
+  struct PacketMetadata::SmallItem bigItem = *item;
+  bigItem.typeUid |= 0x1;
   NS_ASSERT (m_used != prev && m_used != next);
 
-  uint32_t typeUidSize = GetUleb128Size (typeUid);
-  uint32_t sizeSize = GetUleb128Size (item->size);
-  uint32_t fragStartSize = GetUleb128Size (extraItem->fragmentStart);
-  uint32_t fragEndSize = GetUleb128Size (extraItem->fragmentEnd);
-  uint32_t n = 2 + 2 + typeUidSize + sizeSize + 2 + fragStartSize + fragEndSize + 4;
-
+  uint32_t n = SMALL_ITEM_SIZE + EXTRA_ITEM_SIZE;
   if (m_used + n > m_data->m_size ||
-      (m_head != 0xffff &&
-       m_data->m_count != 1 &&
+      (m_data->m_count != 1 &&
        m_used != m_data->m_dirtyEnd))
     {
       ReserveCopy (n);
     }
-
-  uint8_t *buffer = &m_data->m_data[m_used];
-
-  Append16 (next, buffer);
-  buffer += 2;
-  Append16 (prev, buffer);
-  buffer += 2;
-  AppendValue (typeUid, buffer);
-  buffer += typeUidSize;
-  AppendValue (item->size, buffer);
-  buffer += sizeSize;
-  Append16 (item->chunkUid, buffer);
-  buffer += 2;
-  AppendValue (extraItem->fragmentStart, buffer);
-  buffer += fragStartSize;
-  AppendValue (extraItem->fragmentEnd, buffer);
-  buffer += fragEndSize;
-  Append32 (extraItem->packetUid, buffer);
-
+  WriteItems (&m_data->m_data[m_used], next, prev, &bigItem, extraItem);
   return n;
 }
 
@@ -424,33 +310,14 @@ PacketMetadata::ReplaceTail (PacketMetadata::SmallItem *item,
       available = m_data->m_size - m_tail;
     }
 
-  uint32_t typeUid = ((item->typeUid & 0x1) == 0x1) ? item->typeUid : item->typeUid+1;
-  uint32_t typeUidSize = GetUleb128Size (typeUid);
-  uint32_t sizeSize = GetUleb128Size (item->size);
-  uint32_t fragStartSize = GetUleb128Size (extraItem->fragmentStart);
-  uint32_t fragEndSize = GetUleb128Size (extraItem->fragmentEnd);
-  uint32_t n = 2 + 2 + typeUidSize + sizeSize + 2 + fragStartSize + fragEndSize + 4;
-
+  uint32_t n = SMALL_ITEM_SIZE + EXTRA_ITEM_SIZE;
   if (available >= n &&
       m_data->m_count == 1)
     {
-      uint8_t *buffer = &m_data->m_data[m_tail];
-      Append16 (item->next, buffer);
-      buffer += 2;
-      Append16 (item->prev, buffer);
-      buffer += 2;
-      AppendValue (typeUid, buffer);
-      buffer += typeUidSize;
-      AppendValue (item->size, buffer);
-      buffer += sizeSize;
-      Append16 (item->chunkUid, buffer);
-      buffer += 2;
-      AppendValue (extraItem->fragmentStart, buffer);
-      buffer += fragStartSize;
-      AppendValue (extraItem->fragmentEnd, buffer);
-      buffer += fragEndSize;
-      Append32 (extraItem->packetUid, buffer);
-      m_used = buffer - &m_data->m_data[0];
+      struct PacketMetadata::SmallItem bigItem = *item;
+      bigItem.typeUid |= 0x1;
+      WriteItems (&m_data->m_data[m_tail], item->next, item->prev, &bigItem, extraItem);
+      m_used = m_tail + n;
       m_data->m_dirtyEnd = m_used;
       return;
     }
@@ -466,10 +333,7 @@ PacketMetadata::ReplaceTail (PacketMetadata::SmallItem *item,
     {
       struct PacketMetadata::SmallItem tmpItem;
       PacketMetadata::ExtraItem tmpExtraItem;
-      //here on second run is the problem
-      std::cout << "read items trouble???"<< std::endl;
       ReadItems (current, &tmpItem, &tmpExtraItem);
-      std::cout << "END read items trouble???"<< std::endl;
       uint16_t written = h.AddBig (0xffff, h.m_tail, 
                                    &tmpItem, &tmpExtraItem);
       h.UpdateTail (written);
@@ -495,46 +359,37 @@ PacketMetadata::ReadItems (uint16_t current,
 {
   NS_LOG_FUNCTION (this << current);
   const uint8_t *buffer = &m_data->m_data[current];
-  item->next = buffer[0];
-  item->next |= (buffer[1]) << 8;
-  item->prev = buffer[2];
-  item->prev |= (buffer[3]) << 8;
-  buffer += 4;
-  item->typeUid = ReadUleb128 (&buffer);
-  item->size = ReadUleb128 (&buffer);
-  item->chunkUid = buffer[0];
-  item->chunkUid |= (buffer[1]) << 8;
-  buffer += 2;
+  item->next = Read16 (buffer);
+  item->prev = Read16 (buffer + 2);
+  item->typeUid = Read16 (buffer + 4);
+  item->size = Read32 (buffer + 6);
+  item->chunkUid = Read16 (buffer + 10);
 
   bool isExtra = (item->typeUid & 0x1) == 0x1;
   if (isExtra)
     {
-      extraItem->fragmentStart = ReadUleb128 (&buffer);
-      extraItem->fragmentEnd = ReadUleb128 (&buffer);
-      extraItem->packetUid = buffer[0];
-      extraItem->packetUid |= buffer[1] << 8;
-      extraItem->packetUid |= buffer[2] << 16;
-      extraItem->packetUid |= buffer[3] << 24;
-      buffer += 4;
-    }
-  else
-    {
-      extraItem->fragmentStart = 0;
-      extraItem->fragmentEnd = item->size;
-      extraItem->packetUid = m_packetUid;
-    }
-
-  std::cout << "buffer: " << (int) buffer << std::endl;
-  std::cout << "data  : " << (int) &m_data->m_data[m_data->m_size] << std::endl;
-  std::cout << "m_data->m_size(16bits): " << m_data->m_size << "; size = " << sizeof(m_data->m_size) << std::endl;
-
-  NS_ASSERT (buffer <= &m_data->m_data[m_data->m_size]);
-  return buffer - &m_data->m_data[current];
+      buffer += SMALL_ITEM_SIZE;
+      extraItem->fragmentStart = Read32 (buffer);
+      extraItem->fragmentEnd = Read32 (buffer + 4);
+      extraItem->packetUid = Read32 (buffer + 8);
+      NS_ASSERT (current + SMALL_ITEM_SIZE + EXTRA_ITEM_SIZE <= m_data->m_size);
+      return SMALL_ITEM_SIZE + EXTRA_ITEM_SIZE;
+    }
+  extraItem->fragmentStart = 0;
+  extraItem->fragmentEnd = item->size;
+  extraItem->packetUid = m_packetUid;
+  NS_ASSERT (current + SMALL_ITEM_SIZE <= m_data->m_size);
+  return SMALL_ITEM_SIZE;
 }
 
 struct PacketMetadata::Data *
 PacketMetadata::Create (uint32_t size)
 {
+#ifdef NS3_MULTITHREADING
+  // the free list and the size heuristic would be shared by all the
+  // threads of the process.
+  return PacketMetadata::Allocate (size);
+#else
   NS_LOG_LOGIC ("create size="<<size<<", max="<<m_maxSize);
   if (size > m_maxSize)
     {
@@ -555,11 +410,15 @@ PacketMetadata::Create (uint32_t size)
     }
   NS_LOG_LOGIC ("create alloc size="<<m_maxSize);
   return PacketMetadata::Allocate (m_maxSize);
+#endif
 }
 
 void
 PacketMetadata::Recycle (struct PacketMetadata::Data *data)
 {
+#ifdef NS3_MULTITHREADING
+  PacketMetadata::Deallocate (data);
+#else
   if (!m_enable)
     {
       PacketMetadata::Deallocate (data);
@@ -576,6 +435,7 @@ PacketMetadata::Recycle (struct PacketMetadata::Data *data)
     {
       m_freeList.push_back (data);
     }
+#endif
 }
 
 struct PacketMetadata::Data *
@@ -589,7 +449,6 @@ PacketMetadata::Allocate (uint32_t n)
   size += n - 10;
   uint8_t *buf = new uint8_t [size];
   struct PacketMetadata::Data *data = (struct PacketMetadata::Data *)buf;
-  //std::cout << "allocate " << n << std::endl;
   data->m_size = n;
   data->m_count = 1;
   data->m_dirtyEnd = 0;
@@ -612,10 +471,78 @@ PacketMetadata::CreateFragment (uint32_t start, uint32_t end) const
   return fragment;
 }
 
+/**
+ * \param current the offset of an item
+ * \param size the number of bytes of payload to add to the item
+ * \returns false if the item is not payload or is shared with
+ *          another packet.
+ *
+ * Only the size and the end of the fragment are rewritten: the
+ * offsets of the fields are those of WriteItems.
+ */
+bool
+PacketMetadata::GrowPayload (uint16_t current, uint32_t size)
+{
+  if (current == 0xffff || m_data->m_count != 1)
+    {
+      return false;
+    }
+  uint8_t *buffer = &m_data->m_data[current];
+  uint16_t typeUid = Read16 (buffer + 4);
+  if ((typeUid & 0xfffe) != 0)
+    {
+      return false;
+    }
+  Append32 (Read32 (buffer + 6) + size, buffer + 6);
+  if (typeUid & 0x1)
+    {
+      uint8_t *fragmentEnd = buffer + SMALL_ITEM_SIZE + 4;
+      Append32 (Read32 (fragmentEnd) + size, fragmentEnd);
+    }
+  return true;
+}
+
+/**
+ * \param current the offset of an item of payload
+ * \param size the number of bytes to remove from the item, smaller
+ *        than the size of the item
+ * \param atStart true to remove the bytes from the start of the item,
+ *        false to remove them from its end
+ * \returns false if the item is shared with another packet.
+ */
+bool
+PacketMetadata::ShrinkPayload (uint16_t current, uint32_t size, bool atStart)
+{
+  if (m_data->m_count != 1)
+    {
+      return false;
+    }
+  uint8_t *buffer = &m_data->m_data[current];
+  uint16_t typeUid = Read16 (buffer + 4);
+  NS_ASSERT ((typeUid & 0xfffe) == 0);
+  if (typeUid & 0x1)
+    {
+      uint8_t *fragment = buffer + SMALL_ITEM_SIZE + (atStart ? 0 : 4);
+      uint32_t offset = Read32 (fragment);
+      Append32 (atStart ? offset + size : offset - size, fragment);
+    }
+  else
+    {
+      NS_ASSERT (Read32 (buffer + 6) > size);
+      Append32 (Read32 (buffer + 6) - size, buffer + 6);
+    }
+  return true;
+}
+
 void 
 PacketMetadata::AddHeader (const Header &header, uint32_t size)
 {
-  uint32_t uid = header.GetInstanceTypeId ().GetUid () << 1;
+  if (!m_enable)
+    {
+      m_metadataSkipped = true;
+      return;
+    }
+  uint32_t uid = GetTypeUid (header.GetInstanceTypeId ());
   DoAddHeader (uid, size);
 }
 void
@@ -627,6 +554,10 @@ PacketMetadata::DoAddHeader (uint32_t uid, uint32_t size)
       m_metadataSkipped = true;
       return;
     }
+  if (uid == 0 && GrowPayload (m_head, size))
+    {
+      return;
+    }
 
   struct PacketMetadata::SmallItem item;
   /**
@@ -639,7 +570,6 @@ PacketMetadata::DoAddHeader (uint32_t uid, uint32_t size)
   item.typeUid = uid;
   item.size = size;
   item.chunkUid = m_chunkUid;
-  // item above have only that fields
   m_chunkUid++;
   uint16_t written = AddSmall (&item);
   UpdateHead (written);
@@ -647,18 +577,43 @@ PacketMetadata::DoAddHeader (uint32_t uid, uint32_t size)
 void 
 PacketMetadata::RemoveHeader (const Header &header, uint32_t size)
 {
-  uint32_t uid = header.GetInstanceTypeId ().GetUid () << 1;
-  NS_LOG_FUNCTION (this << uid << size);
   if (!m_enable) 
     {
       m_metadataSkipped = true;
       return;
     }
+  uint32_t uid = GetTypeUid (header.GetInstanceTypeId ());
+  NS_LOG_FUNCTION (this << uid << size);
+  if (m_head == 0xffff)
+    {
+      if (m_enableChecking)
+        {
+          NS_FATAL_ERROR ("Removing unexpected header.");
+        }
+      return;
+    }
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   uint32_t read = ReadItems (m_head, &item, &extraItem);
-  if ((item.typeUid & 0xfffffffe) != uid ||
-      item.size != size)
+  bool payload = uid == 0 && (item.typeUid & 0xfffffffe) == 0;
+  uint32_t currentSize = extraItem.fragmentEnd - extraItem.fragmentStart;
+  bool replace = false;
+  if (payload && currentSize > size)
+    {
+      // a header which is not recorded is a part of the payload.
+      if (ShrinkPayload (m_head, size, true))
+        {
+          return;
+        }
+      // the item is shared with another packet: replace it below.
+      replace = true;
+    }
+  else if (payload && currentSize == size)
+    {
+      // the header is the whole item of payload.
+    }
+  else if ((item.typeUid & 0xfffffffe) != uid ||
+           item.size != size)
     {
       if (m_enableChecking)
         {
@@ -676,7 +631,7 @@ PacketMetadata::RemoveHeader (const Header &header, uint32_t size)
         }
       return;
     }
-  if (m_head + read == m_used)
+  if (m_head + read == m_used && m_data->m_count == 1)
     {
       m_used = m_head;
     }
@@ -689,17 +644,27 @@ PacketMetadata::RemoveHeader (const Header &header, uint32_t size)
     {
       m_head = item.next;
     }
+  if (replace)
+    {
+      extraItem.fragmentStart += size;
+      uint16_t written = AddBig (m_head, 0xffff, &item, &extraItem);
+      UpdateHead (written);
+    }
 }
 void 
 PacketMetadata::AddTrailer (const Trailer &trailer, uint32_t size)
 {
-  uint32_t uid = trailer.GetInstanceTypeId ().GetUid () << 1;
-  NS_LOG_FUNCTION (this << uid << size);
   if (!m_enable)
     {
       m_metadataSkipped = true;
       return;
     }
+  uint32_t uid = GetTypeUid (trailer.GetInstanceTypeId ());
+  NS_LOG_FUNCTION (this << uid << size);
+  if (uid == 0 && GrowPayload (m_tail, size))
+    {
+      return;
+    }
   struct PacketMetadata::SmallItem item;
   item.next = 0xffff;
   item.prev = m_tail;
@@ -713,18 +678,43 @@ PacketMetadata::AddTrailer (const Trailer &trailer, uint32_t size)
 void 
 PacketMetadata::RemoveTrailer (const Trailer &trailer, uint32_t size)
 {
-  uint32_t uid = trailer.GetInstanceTypeId ().GetUid () << 1;
-  NS_LOG_FUNCTION (this << uid << size);
   if (!m_enable) 
     {
       m_metadataSkipped = true;
       return;
     }
+  uint32_t uid = GetTypeUid (trailer.GetInstanceTypeId ());
+  NS_LOG_FUNCTION (this << uid << size);
+  if (m_tail == 0xffff)
+    {
+      if (m_enableChecking)
+        {
+          NS_FATAL_ERROR ("Removing unexpected trailer.");
+        }
+      return;
+    }
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   uint32_t read = ReadItems (m_tail, &item, &extraItem);
-  if ((item.typeUid & 0xfffffffe) != uid ||
-      item.size != size)
+  bool payload = uid == 0 && (item.typeUid & 0xfffffffe) == 0;
+  uint32_t currentSize = extraItem.fragmentEnd - extraItem.fragmentStart;
+  bool replace = false;
+  if (payload && currentSize > size)
+    {
+      // a trailer which is not recorded is a part of the payload.
+      if (ShrinkPayload (m_tail, size, false))
+        {
+          return;
+        }
+      // the item is shared with another packet: replace it below.
+      replace = true;
+    }
+  else if (payload && currentSize == size)
+    {
+      // the trailer is the whole item of payload.
+    }
+  else if ((item.typeUid & 0xfffffffe) != uid ||
+           item.size != size)
     {
       if (m_enableChecking)
         {
@@ -742,7 +732,7 @@ PacketMetadata::RemoveTrailer (const Trailer &trailer, uint32_t size)
         }
       return;
     }
-  if (m_tail + read == m_used)
+  if (m_tail + read == m_used && m_data->m_count == 1)
     {
       m_used = m_tail;
     }
@@ -755,6 +745,21 @@ PacketMetadata::RemoveTrailer (const Trailer &trailer, uint32_t size)
     {
       m_tail = item.prev;
     }
+  if (replace)
+    {
+      extraItem.fragmentEnd -= size;
+      uint16_t written = AddBig (0xffff, m_tail, &item, &extraItem);
+      UpdateTail (written);
+    }
+}
+void
+PacketMetadata::Unshare (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_data->m_count > 1)
+    {
+      ReserveCopy (0);
+    }
 }
 void
 PacketMetadata::AddAtEnd (PacketMetadata const&o)
@@ -784,16 +789,12 @@ PacketMetadata::AddAtEnd (PacketMetadata const&o)
   // after this item.
   struct PacketMetadata::SmallItem tailItem;
   PacketMetadata::ExtraItem tailExtraItem;
-  std::cout << "read 1" << std::endl;
   uint32_t tailSize = ReadItems (m_tail, &tailItem, &tailExtraItem);
-  std::cout << "END read 1; tailsize " << tailSize << std::endl;
 
   uint16_t current;
   struct PacketMetadata::SmallItem item;
   PacketMetadata::ExtraItem extraItem;
-  std::cout << "read 2" << std::endl;
   o.ReadItems (o.m_head, &item, &extraItem);
-  std::cout << "END read 2" << std::endl;
   if (extraItem.packetUid == tailExtraItem.packetUid &&
       item.typeUid == tailItem.typeUid &&
       item.chunkUid == tailItem.chunkUid &&
@@ -806,9 +807,7 @@ PacketMetadata::AddAtEnd (PacketMetadata const&o)
        * location.
        */
       tailExtraItem.fragmentEnd = extraItem.fragmentEnd;
-      std::cout << "replacetail" << std::endl;
       ReplaceTail (&tailItem, &tailExtraItem, tailSize);
-      std::cout << "END replacetail" << std::endl;
       current = item.next;
     }
   else
@@ -822,9 +821,7 @@ PacketMetadata::AddAtEnd (PacketMetadata const&o)
    */
   while (current != 0xffff)
     {
-      std::cout << "read 3" << std::endl;
       o.ReadItems (current, &item, &extraItem);
-      std::cout << "END read 3" << std::endl;
       uint16_t written = AddBig (0xffff, m_tail, &item, &extraItem);
       UpdateTail (written);
       if (current == o.m_tail)
@@ -68,12 +68,16 @@ class Trailer;
  * of entries which can be stored in this linked list but it is
  * quite unlikely to hit this limit in practice.
  *
- * Each item of the linked list is a variable-sized byte buffer
- * made of a number of fields. Some of these fields are stored
- * as fixed-size 32 bit integers, others as fixed-size 16 bit 
- * integers, and some others as variable-size 32-bit integers.
- * The variable-size 32 bit integers are stored using the uleb128
- * encoding.
+ * Each item of the linked list is a fixed-size byte buffer made of
+ * a number of little-endian 16 and 32 bit integers: 12 bytes for the
+ * items which represent a whole header, trailer or payload, and 24
+ * bytes for the fragments.  Since the size of an item does not depend
+ * on the values it holds, an item can be rewritten in place.
+ *
+ * The metadata can be recorded for a few types of headers and trailers
+ * only: the other ones are then recorded as payload, and the payload
+ * bytes added next to an item of payload are merged into this item
+ * whenever its buffer is not shared with another packet.
  */
 class PacketMetadata 
 {
@@ -125,6 +129,15 @@ private:
   };
 
   static void Enable (void);
+  /**
+   * \param tid the type of a header or trailer
+   *
+   * Record the headers and trailers of type tid.  If this method is
+   * called before Enable, only the headers and trailers of the types
+   * enabled with this method are recorded, and the other ones are
+   * recorded as payload.  The subclasses of tid are not enabled.
+   */
+  static void Enable (TypeId tid);
   static void EnableChecking (void);
 
   inline PacketMetadata (uint64_t uid, uint32_t size);
@@ -150,6 +163,11 @@ private:
   void AddPaddingAtEnd (uint32_t end);
   void RemoveAtStart (uint32_t start);
   void RemoveAtEnd (uint32_t end);
+  /**
+   * Make sure that the metadata of this packet is not shared with
+   * any other packet.
+   */
+  void Unshare (void);
 
   uint64_t GetUid (void) const;
 
@@ -238,17 +256,17 @@ private:
        stored as a fixed-size 16 bit integer.
      */
     uint16_t prev;
-    /* the high 31 bits of this field identify the 
+    /* the high 15 bits of this field identify the 
        type of the header or trailer represented by 
        this item: the value zero represents payload.
        If the low bit of this uid is one, an ExtraItem
        structure follows this SmallItem structure.
-       stored as a variable-size 32 bit integer.
+       stored as a fixed-size 16 bit integer.
      */
     uint32_t typeUid;
     /* the size (in bytes) of the header or trailer represented
        by this element.
-       stored as a variable-size 32 bit integer.
+       stored as a fixed-size 32 bit integer.
      */
     uint32_t size;
     /* this field tries to uniquely identify each header or 
@@ -268,18 +286,19 @@ private:
   struct ExtraItem {
     /* offset (in bytes) from start of original header to 
        the start of the fragment still present.
-       stored as a variable-size 32 bit integer.
+       stored as a fixed-size 32 bit integer.
      */
     uint32_t fragmentStart;
     /* offset (in bytes) from start of original header to 
        the end of the fragment still present.
-       stored as a variable-size 32 bit integer.
+       stored as a fixed-size 32 bit integer.
      */
     uint32_t fragmentEnd;
     /* the packetUid of the packet in which this header or trailer
        was first added. It could be different from the m_packetUid
        field if the user has aggregated multiple packets into one.
-       stored as a fixed-size 64 bit integer.
+       stored as a fixed-size 32 bit integer: only the low 32 bits
+       are kept.
      */
     uint64_t packetUid;
   };
@@ -304,12 +323,15 @@ public:
                     uint32_t available);
   inline void UpdateHead (uint16_t written);
   inline void UpdateTail (uint16_t written);
-  inline uint32_t GetUleb128Size (uint32_t value) const;
-  uint32_t ReadUleb128 (const uint8_t **pBuffer) const;
   inline void Append16 (uint16_t value, uint8_t *buffer);
   inline void Append32 (uint32_t value, uint8_t *buffer);
-  inline void AppendValue (uint32_t value, uint8_t *buffer);
-  void AppendValueExtra (uint32_t value, uint8_t *buffer);
+  inline uint16_t Read16 (const uint8_t *buffer) const;
+  inline uint32_t Read32 (const uint8_t *buffer) const;
+  void WriteItems (uint8_t *buffer, uint16_t next, uint16_t prev,
+                   const struct PacketMetadata::SmallItem *item,
+                   const struct PacketMetadata::ExtraItem *extraItem);
+  bool GrowPayload (uint16_t current, uint32_t size);
+  bool ShrinkPayload (uint16_t current, uint32_t size, bool atStart);
   inline void Reserve (uint32_t n);
   void ReserveCopy (uint32_t n);
   uint32_t GetTotalSize (void) const;
@@ -317,6 +339,7 @@ public:
                       struct PacketMetadata::SmallItem *item,
                       struct PacketMetadata::ExtraItem *extraItem) const;
   void DoAddHeader (uint32_t uid, uint32_t size);
+  static uint32_t GetTypeUid (TypeId tid);
 
 
   static struct PacketMetadata::Data *Create (uint32_t size);
@@ -324,9 +347,16 @@ public:
   static struct PacketMetadata::Data *Allocate (uint32_t n);
   static void Deallocate (struct PacketMetadata::Data *data);
 
+  /* size of the encoding of a SmallItem and of an ExtraItem */
+  static const uint32_t SMALL_ITEM_SIZE = 2 + 2 + 2 + 4 + 2;
+  static const uint32_t EXTRA_ITEM_SIZE = 4 + 4 + 4;
+
   static DataFreeList m_freeList;
   static bool m_enable;
   static bool m_enableChecking;
+  // true if only the types of m_recordedTypes are recorded
+  static bool m_selective;
+  static std::vector<bool> m_recordedTypes;
 
   // set to true when adding metadata to a packet is skipped because
   // m_enable is false; used to detect enabling of metadata in the
@@ -23,65 +23,119 @@
 #include "ns3/fatal-error.h"
 #include "ns3/log.h"
 #include <string.h>
+#ifdef NS3_MULTITHREADING
+#include <pthread.h>
+#endif
 
 NS_LOG_COMPONENT_DEFINE ("PacketTagList");
 
 namespace ns3 {
 
-#ifdef USE_FREE_LIST
-
+// A TagData freed by another thread than the one which allocated it
+// goes to the free list of the thread which frees it.
+#ifdef NS3_MULTITHREADING
+__thread struct PacketTagList::TagData *PacketTagList::g_free = 0;
+__thread struct PacketTagList::FreeListStatistics PacketTagList::g_stats;
+__thread bool PacketTagList::g_freeListRegistered = false;
+static pthread_key_t g_freeListKey;
+static pthread_once_t g_freeListKeyOnce = PTHREAD_ONCE_INIT;
+#else
 struct PacketTagList::TagData *PacketTagList::g_free = 0;
-uint32_t PacketTagList::g_nfree = 0;
+struct PacketTagList::FreeListStatistics PacketTagList::g_stats;
+#endif
+uint32_t PacketTagList::g_maxNFree = 1000;
+
+#ifdef NS3_MULTITHREADING
+void
+PacketTagList::ThreadExit (void *freeList)
+{
+  while (g_free != 0)
+    {
+      struct TagData *data = g_free;
+      g_free = g_free->next;
+      delete data;
+    }
+  g_stats.size = 0;
+  g_freeListRegistered = false;
+}
+
+void
+PacketTagList::CreateFreeListKey (void)
+{
+  pthread_key_create (&g_freeListKey, &PacketTagList::ThreadExit);
+}
+
+void
+PacketTagList::RegisterFreeList (void)
+{
+  pthread_once (&g_freeListKeyOnce, &PacketTagList::CreateFreeListKey);
+  // the value is only used to have the destructor called
+  pthread_setspecific (g_freeListKey, &g_free);
+  g_freeListRegistered = true;
+}
+#endif
+
+void
+PacketTagList::SetMaxFreeListSize (uint32_t maxSize)
+{
+  NS_LOG_FUNCTION (maxSize);
+  g_maxNFree = maxSize;
+  while (g_stats.size > g_maxNFree)
+    {
+      struct TagData *data = g_free;
+      g_free = g_free->next;
+      g_stats.size--;
+      delete data;
+    }
+}
+
+struct PacketTagList::FreeListStatistics
+PacketTagList::GetFreeListStatistics (void)
+{
+  return g_stats;
+}
 
 struct PacketTagList::TagData *
-PacketTagList::AllocData (void) const
+PacketTagList::AllocData (void)
 {
-  NS_LOG_FUNCTION (g_nfree);
+  NS_LOG_FUNCTION (g_stats.size);
   struct PacketTagList::TagData *retval;
+  g_stats.allocations++;
   if (g_free != 0) 
     {
       retval = g_free;
-      g_free = g_free->m_next;
-      g_nfree--;
+      g_free = g_free->next;
+      g_stats.size--;
     } 
   else 
     {
+      g_stats.misses++;
       retval = new struct PacketTagList::TagData ();
     }
   return retval;
 }
 
 void
-PacketTagList::FreeData (struct TagData *data) const
+PacketTagList::FreeData (struct TagData *data)
 {
-  NS_LOG_FUNCTION (g_nfree << data);
-  if (g_nfree > 1000) 
+  NS_LOG_FUNCTION (g_stats.size << data);
+  g_stats.releases++;
+  if (g_stats.size >= g_maxNFree) 
     {
+      g_stats.overflows++;
       delete data;
       return;
     }
-  g_nfree++;
+#ifdef NS3_MULTITHREADING
+  if (!g_freeListRegistered)
+    {
+      RegisterFreeList ();
+    }
+#endif
+  g_stats.size++;
   data->next = g_free;
-  data->tid = TypeId ();
   g_free = data;
 }
-#else
-struct PacketTagList::TagData *
-PacketTagList::AllocData (void) const
-{
-  NS_LOG_FUNCTION_NOARGS ();
-  struct PacketTagList::TagData *retval;
-  retval = new struct PacketTagList::TagData ();
-  return retval;
-}
-
-void
-PacketTagList::FreeData (struct TagData *data) const
-{
-  NS_LOG_FUNCTION (data);
-  delete data;
-}
-#endif
 
 bool
 PacketTagList::Remove (Tag &tag)
@@ -167,6 +221,39 @@ PacketTagList::Peek (Tag &tag) const
   return false;
 }
 
+void
+PacketTagList::Unshare (void)
+{
+  NS_LOG_FUNCTION (this);
+  bool shared = false;
+  for (struct TagData *cur = m_next; cur != 0; cur = cur->next) 
+    {
+      if (cur->count > 1)
+        {
+          shared = true;
+          break;
+        }
+    }
+  if (!shared)
+    {
+      return;
+    }
+  struct TagData *start = 0;
+  struct TagData **prevNext = &start;
+  for (struct TagData *cur = m_next; cur != 0; cur = cur->next) 
+    {
+      struct TagData *copy = AllocData ();
+      copy->tid = cur->tid;
+      copy->count = 1;
+      copy->next = 0;
+      memcpy (copy->data, cur->data, PACKET_TAG_MAX_SIZE);
+      *prevNext = copy;
+      prevNext = &copy->next;
+    }
+  RemoveAll ();
+  m_next = start;
+}
+
 const struct PacketTagList::TagData *
 PacketTagList::Head (void) const
 {
@@ -55,17 +55,60 @@ public:
   bool Remove (Tag &tag);
   bool Peek (Tag &tag) const;
   inline void RemoveAll (void);
+  /**
+   * Make sure that the tags of this list are not shared with any
+   * other list.
+   */
+  void Unshare (void);
 
   const struct PacketTagList::TagData *Head (void) const;
 
+  /**
+   * The counters of the TagData free list of the calling thread.
+   */
+  struct FreeListStatistics
+  {
+    /// number of TagData handed out
+    uint64_t allocations;
+    /// number of TagData which had to be allocated with new
+    uint64_t misses;
+    /// number of TagData given back
+    uint64_t releases;
+    /// number of TagData deleted because the free list was full
+    uint64_t overflows;
+    /// number of TagData currently in the free list
+    uint32_t size;
+  };
+  /**
+   * \param maxSize the maximum number of unused TagData kept by each
+   *        thread for reuse. The default is 1000.
+   */
+  static void SetMaxFreeListSize (uint32_t maxSize);
+  /**
+   * \returns the allocation statistics of the calling thread.
+   */
+  static struct FreeListStatistics GetFreeListStatistics (void);
+
 private:
 
   bool Remove (TypeId tid);
-  struct PacketTagList::TagData *AllocData (void) const;
-  void FreeData (struct TagData *data) const;
-
+  static struct PacketTagList::TagData *AllocData (void);
+  static void FreeData (struct TagData *data);
+
+#ifdef NS3_MULTITHREADING
+  // delete the free list of a thread when it exits
+  static void RegisterFreeList (void);
+  static void CreateFreeListKey (void);
+  static void ThreadExit (void *freeList);
+
+  static __thread struct PacketTagList::TagData *g_free;
+  static __thread struct FreeListStatistics g_stats;
+  static __thread bool g_freeListRegistered;
+#else
   static struct PacketTagList::TagData *g_free;
-  static uint32_t g_nfree;
+  static struct FreeListStatistics g_stats;
+#endif
+  static uint32_t g_maxNFree;
 
   struct TagData *m_next;
 };
@@ -24,12 +24,19 @@
 #include "ns3/test.h"
 #include <string>
 #include <stdarg.h>
+#include <algorithm>
 
 NS_LOG_COMPONENT_DEFINE ("Packet");
 
 namespace ns3 {
 
+// the multithreaded simulator keeps the uids unique across threads by
+// putting the system id of the thread in the upper 32 bits.
+#ifdef NS3_MULTITHREADING
+__thread uint32_t Packet::m_globalUid = 0;
+#else
 uint32_t Packet::m_globalUid = 0;
+#endif
 
 TypeId 
 ByteTagIterator::Item::GetTypeId (void) const
@@ -126,6 +133,18 @@ Packet::Copy (void) const
   return Ptr<Packet> (new Packet (*this), false);
 }
 
+Ptr<Packet>
+Packet::DeepCopy (void) const
+{
+  NS_LOG_FUNCTION (this);
+  Ptr<Packet> copy = Copy ();
+  copy->m_buffer.Unshare ();
+  copy->m_byteTagList.Unshare ();
+  copy->m_packetTagList.Unshare ();
+  copy->m_metadata.Unshare ();
+  return copy;
+}
+
 Packet::Packet ()
   : m_buffer (),
     m_byteTagList (),
@@ -559,6 +578,22 @@ Packet::EnablePrinting (void)
   PacketMetadata::Enable ();
 }
 
+void
+Packet::EnablePrinting (TypeId tid)
+{
+  NS_LOG_FUNCTION (tid.GetName ());
+  // the TcpRfc793 bug which disables EnablePrinting (void) comes from
+  // the metadata of the TCP headers: leave them printed as payload.
+  TypeId tcpHeader;
+  if (TypeId::LookupByNameFailSafe ("ns3::TcpHeader", &tcpHeader)
+      && (tid == tcpHeader || tid.IsChildOf (tcpHeader)))
+    {
+      NS_LOG_WARN ("The metadata of " << tid.GetName () << " stays disabled");
+      return;
+    }
+  PacketMetadata::Enable (tid);
+}
+
 void
 Packet::EnableChecking (void)
 {
@@ -1298,6 +1333,34 @@ PacketTest::DoRun (void)
     NS_TEST_EXPECT_MSG_EQ (p.PeekPacketTag (b), false, "trivial");
   }
 
+  {
+    // the TagData of removed packet tags are reused
+    PacketTagList::SetMaxFreeListSize (1000);
+    Packet p;
+    ATestTag<10> a;
+    ATestTag<11> b;
+    p.AddPacketTag (a);
+    p.AddPacketTag (b);
+    p.RemoveAllPacketTags ();
+    struct PacketTagList::FreeListStatistics before = PacketTagList::GetFreeListStatistics ();
+    NS_TEST_EXPECT_MSG_EQ ((before.size >= 2), true, "The TagData were not recycled");
+    p.AddPacketTag (a);
+    p.AddPacketTag (b);
+    Packet copy = p;
+    copy.RemovePacketTag (b);
+    NS_TEST_EXPECT_MSG_EQ (p.PeekPacketTag (b), true, "Copy on write broken by the free list");
+    NS_TEST_EXPECT_MSG_EQ (copy.PeekPacketTag (a), true, "Copy on write broken by the free list");
+    struct PacketTagList::FreeListStatistics after = PacketTagList::GetFreeListStatistics ();
+    NS_TEST_EXPECT_MSG_EQ (after.allocations - before.allocations, 3, "Unexpected number of allocations");
+    NS_TEST_EXPECT_MSG_EQ (after.misses - before.misses, 3 - std::min<uint64_t> (before.size, 3),
+                           "The free list was not used");
+    p.RemoveAllPacketTags ();
+    copy.RemoveAllPacketTags ();
+    PacketTagList::SetMaxFreeListSize (0);
+    NS_TEST_EXPECT_MSG_EQ (PacketTagList::GetFreeListStatistics ().size, 0, "The free list was not trimmed");
+    PacketTagList::SetMaxFreeListSize (1000);
+  }
+
   {
     // bug 572
     Ptr<Packet> tmp = Create<Packet> (1000);
@@ -373,6 +373,16 @@ public:
    */
   Ptr<Packet> Copy (void) const;
 
+  /**
+   * \returns a copy of the packet which does not share any data
+   * with the original packet.
+   *
+   * The internal datasets of the packets are reference-counted without
+   * any locking: a packet which is handed over to another thread must
+   * not share them with the packets which stay in this thread.
+   */
+  Ptr<Packet> DeepCopy (void) const;
+
   /**
    * A packet is allocated a new uid when it is created
    * empty or with zero-filled payload.
@@ -420,6 +430,18 @@ public:
    * simulation setup and before any packet is created.
    */
   static void EnablePrinting (void);
+  /**
+   * \param tid the type of a header or trailer
+   *
+   * Keep the metadata of the headers and trailers of type tid, so that
+   * the Print methods describe them.  When only a few types are
+   * enabled with this method, the other headers and trailers are
+   * printed as payload and do not grow the metadata of the packets.  Like
+   * EnablePrinting, this method must be invoked before any packet is
+   * created.  It does nothing for the TcpHeader type, which is
+   * disabled like EnablePrinting.
+   */
+  static void EnablePrinting (TypeId tid);
   /**
    * The packet metadata is also used to perform extensive
    * sanity checks at runtime when performing operations on a 
@@ -566,7 +588,11 @@ private:
   /* Please see comments above about nix-vector */
   Ptr<NixVector> m_nixVector;
 
+#ifdef NS3_MULTITHREADING
+  static __thread uint32_t m_globalUid;
+#else
   static uint32_t m_globalUid;
+#endif
 };
 
 std::ostream& operator<< (std::ostream& os, const Packet &packet);
@@ -21,9 +21,11 @@
 #include <stdlib.h>
 #include <sstream>
 #include <cstring>
+#include <algorithm>
 
 #include "ns3/test.h"
 #include "ns3/pcap-file.h"
+#include "ns3/packet.h"
 
 using namespace ns3;
 
@@ -1115,6 +1117,135 @@ DiffTestCase::DoRun (void)
   return GetErrorStatus();
 }
 
+// ===========================================================================
+// Test case to make sure that the files written through the write buffer
+// are identical to the files written record by record.
+// ===========================================================================
+class WriteBufferTestCase : public TestCase
+{
+public:
+  WriteBufferTestCase ();
+
+private:
+  virtual bool DoRun (void);
+  uint64_t WriteFile (std::string filename, uint32_t size, bool background);
+};
+
+WriteBufferTestCase::WriteBufferTestCase ()
+  : TestCase ("Check that PcapFile::SetWriteBuffer does not change the files")
+{
+}
+
+uint64_t
+WriteBufferTestCase::WriteFile (std::string filename, uint32_t size, bool background)
+{
+  uint64_t length = 24;
+  PcapFile f;
+  f.Open (filename, std::ios::out);
+  f.Init (1, 64);
+  f.SetWriteBuffer (size, background);
+  uint8_t data[1000];
+  for (uint32_t i = 0; i < sizeof (data); ++i)
+    {
+      data[i] = i & 0xff;
+    }
+  // the records of more than 64 bytes are truncated, and the records of
+  // more than 100 bytes do not fit in the smallest blocks.
+  for (uint32_t i = 0; i < 1000; ++i)
+    {
+      uint32_t totalLen = (i * 37) % sizeof (data);
+      f.Write (i, i * 7, data, totalLen);
+      length += 16 + std::min (totalLen, (uint32_t)64);
+    }
+  f.Close ();
+  return length;
+}
+
+bool
+WriteBufferTestCase::DoRun (void)
+{
+  std::string reference = GetTempDir () + "write-buffer-reference.pcap";
+  WriteFile (reference, 0, false);
+
+  uint32_t sizes[] = {60, 100, 4096, 1 << 20};
+  for (uint32_t i = 0; i < sizeof (sizes) / sizeof (sizes[0]); ++i)
+    {
+      for (uint32_t background = 0; background < 2; ++background)
+        {
+          std::string filename = GetTempDir () + "write-buffer.pcap";
+          uint64_t length = WriteFile (filename, sizes[i], background);
+          uint32_t sec (0), usec (0);
+          bool diff = PcapFile::Diff (reference, filename, sec, usec);
+          NS_TEST_EXPECT_MSG_EQ (diff, false, "Block size " << sizes[i] << ", background " << background
+                                 << ": different from " << sec << "." << usec << " seconds");
+          NS_TEST_EXPECT_MSG_EQ (CheckFileLength (filename, length), true, "Block size " << sizes[i]
+                                 << ", background " << background << ": unexpected file length");
+          remove (filename.c_str ());
+        }
+    }
+  remove (reference.c_str ());
+  return GetErrorStatus ();
+}
+
+// ===========================================================================
+// Test case to make sure that only the snap length of a large packet is
+// written, with its zero area.
+// ===========================================================================
+class SnapLenTestCase : public TestCase
+{
+public:
+  SnapLenTestCase ();
+
+private:
+  virtual bool DoRun (void);
+};
+
+SnapLenTestCase::SnapLenTestCase ()
+  : TestCase ("Check that PcapFile writes the snap length of a large packet")
+{
+}
+
+bool
+SnapLenTestCase::DoRun (void)
+{
+  std::string filename = GetTempDir () + "snap-len.pcap";
+  uint8_t payload[] = {0x01, 0x02, 0x03};
+  Ptr<Packet> p = Create<Packet> (payload, sizeof (payload));
+  // the 100000 bytes of the zero area are not stored by the buffer.
+  p->AddAtEnd (Create<Packet> (100000));
+
+  for (uint32_t size = 0; size <= 4096; size += 4096)
+    {
+      PcapFile f;
+      f.Open (filename, std::ios::out);
+      f.Init (1, 96);
+      f.SetWriteBuffer (size);
+      f.Write (1, 2, p);
+      f.Close ();
+      NS_TEST_EXPECT_MSG_EQ (CheckFileLength (filename, 24 + 16 + 96), true, "Unexpected file length with block size " << size);
+
+      f.Open (filename, std::ios::in);
+      uint8_t data[200];
+      memset (data, 0xff, sizeof (data));
+      uint32_t tsSec, tsUsec, inclLen, origLen, readLen;
+      f.Read (data, sizeof (data), tsSec, tsUsec, inclLen, origLen, readLen);
+      NS_TEST_EXPECT_MSG_EQ (f.Fail (), false, "Read must not fail");
+      NS_TEST_EXPECT_MSG_EQ (inclLen, 96, "Included length is the snap length");
+      NS_TEST_EXPECT_MSG_EQ (origLen, 100003, "Original length is the packet size");
+      NS_TEST_EXPECT_MSG_EQ (readLen, 96, "Read length is the snap length");
+      NS_TEST_EXPECT_MSG_EQ (memcmp (data, payload, sizeof (payload)), 0, "Payload is written");
+      uint32_t zeroes = 0;
+      for (uint32_t i = sizeof (payload); i < 96; ++i)
+        {
+          zeroes += data[i] == 0;
+        }
+      NS_TEST_EXPECT_MSG_EQ (zeroes, 96 - sizeof (payload), "Zero area is written as zeroes");
+      f.Close ();
+    }
+  remove (filename.c_str ());
+  return GetErrorStatus ();
+}
+
 class PcapFileTestSuite : public TestSuite
 {
 public:
@@ -1131,6 +1262,8 @@ PcapFileTestSuite::PcapFileTestSuite ()
   AddTestCase (new RecordHeaderTestCase);
   AddTestCase (new ReadFileTestCase);
   AddTestCase (new DiffTestCase);
+  AddTestCase (new WriteBufferTestCase);
+  AddTestCase (new SnapLenTestCase);
 }
 
 PcapFileTestSuite pcapFileTestSuite;
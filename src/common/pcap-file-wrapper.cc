@@ -18,6 +18,7 @@
 
 #include "ns3/log.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
 
 #include "buffer.h"
 #include "header.h"
@@ -40,6 +41,18 @@ PcapFileWrapper::GetTypeId (void)
                    UintegerValue (PcapFile::SNAPLEN_DEFAULT),
                    MakeUintegerAccessor (&PcapFileWrapper::m_snapLen),
                    MakeUintegerChecker<uint32_t> (0, PcapFile::SNAPLEN_DEFAULT))
+    .AddAttribute ("WriteBufferSize",
+                   "Size of the blocks in which the records are collected before "
+                   "being written to the file.  Zero writes every record directly.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&PcapFileWrapper::m_writeBufferSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("BackgroundFlush",
+                   "Write the full blocks to the file from a separate thread "
+                   "(only used if WriteBufferSize is not zero).",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&PcapFileWrapper::m_backgroundFlush),
+                   MakeBooleanChecker ())
     ;
   return tid;
 }
@@ -99,6 +112,10 @@ PcapFileWrapper::Init (uint32_t dataLinkType, uint32_t snapLen, int32_t tzCorrec
     {
       m_file.Init (dataLinkType, m_snapLen, tzCorrection);
     } 
+  if (m_writeBufferSize > 0)
+    {
+      m_file.SetWriteBuffer (m_writeBufferSize, m_backgroundFlush);
+    }
 }
 
 void
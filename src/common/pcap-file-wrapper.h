@@ -98,6 +98,9 @@ public:
    * time zone from UTC/GMT.  For example, Pacific Standard Time in the US is
    * GMT-8, so one would enter -8 for that correction.  Defaults to 0 (UTC).
    *
+   * If the "WriteBufferSize" Attribute is not zero, the records are then
+   * collected in blocks of that size, see PcapFile::SetWriteBuffer.
+   *
    * \warning Calling this method on an existing file will result in the loss
    * any existing data.
    */
@@ -197,6 +200,8 @@ public:
 private:
   PcapFile m_file;
   uint32_t m_snapLen;
+  uint32_t m_writeBufferSize;
+  bool m_backgroundFlush;
 };
 
 } //namespace ns3
@@ -20,13 +20,21 @@
 
 #include <iostream>
 #include <cstring>
+#include <vector>
+#include <deque>
 #include "ns3/assert.h"
 #include "ns3/packet.h"
 #include "ns3/fatal-error.h"
 #include "ns3/fatal-impl.h"
 #include "ns3/header.h"
 #include "ns3/buffer.h"
+#include "ns3/core-config.h"
 #include "pcap-file.h"
+#ifdef HAVE_PTHREAD_H
+#include "ns3/system-thread.h"
+#include "ns3/system-mutex.h"
+#include "ns3/system-condition.h"
+#endif
 //
 // This file is used as part of the ns-3 test framework, so please refrain from 
 // adding any ns-3 specific constructs such as Packet to this file.
@@ -43,23 +51,294 @@ const uint16_t VERSION_MAJOR = 2;             /**< Major version of supported pc
 const uint16_t VERSION_MINOR = 4;             /**< Minor version of supported pcap file format */
 const int32_t  SIGFIGS_DEFAULT = 0;           /**< Significant figures for timestamps (libpcap doesn't even bother) */
 
+const uint32_t RECORD_HEADER_SIZE = 16;       /**< Size of a record header in the file */
+const uint32_t MAX_WRITER_BLOCKS = 4;         /**< Maximum number of blocks of a background writer */
+
+/**
+ * Copies the records into blocks of memory and writes each block to
+ * the file with a single call, possibly from a separate thread.  The
+ * blocks handed to the thread are kept in m_full; once written, they
+ * are recycled through m_free.
+ *
+ * The writer is also a stream buffer, so that the fatal error handler
+ * can flush it in place of the file: the thread is stopped and joined,
+ * and all the records written, before the file itself is flushed.
+ */
+class PcapFile::Writer : public std::streambuf
+{
+public:
+  Writer (std::fstream *file, uint32_t blockSize, bool background);
+  ~Writer ();
+
+  /**
+   * \param size number of bytes needed
+   * \return the address of \p size bytes of the current block, or zero
+   *         if \p size is larger than a block, in which case all the
+   *         previous records have been written to the file.
+   */
+  uint8_t *Reserve (uint32_t size);
+  /**
+   * Write all the records reserved so far to the file.
+   */
+  void Sync (void);
+  /**
+   * \return the stream to register with the fatal error handler
+   */
+  std::ostream *GetFatalStream (void);
+
+protected:
+  virtual int sync (void);
+
+private:
+  struct Block
+  {
+    uint8_t *data;
+    uint32_t size;
+  };
+
+  void Submit (void);
+  void Stop (void);
+#ifdef HAVE_PTHREAD_H
+  void DoRun (void);
+  void Wait (SystemCondition &condition);
+  void Notify (SystemCondition &condition);
+#endif
+
+  std::fstream *m_file;
+  uint32_t m_blockSize;
+  Block m_current;
+  bool m_background;
+  std::ostream m_fatalStream;
+#ifdef HAVE_PTHREAD_H
+  std::deque<Block> m_full;
+  std::vector<Block> m_free;
+  uint32_t m_nBlocks;
+  bool m_writing;
+  bool m_stop;
+  Ptr<SystemThread> m_thread;
+  SystemMutex m_mutex;
+  SystemCondition m_filled;   // the thread waits on it for m_full or m_stop
+  SystemCondition m_written;  // the simulation waits on it for m_free or !m_writing
+#endif
+};
+
+PcapFile::Writer::Writer (std::fstream *file, uint32_t blockSize, bool background)
+  : m_file (file),
+    m_blockSize (blockSize),
+    m_background (background),
+    m_fatalStream (this)
+{
+  m_current.data = new uint8_t [m_blockSize];
+  m_current.size = 0;
+#ifdef HAVE_PTHREAD_H
+  m_nBlocks = 1;
+  m_writing = false;
+  m_stop = false;
+  if (m_background)
+    {
+      m_thread = Create<SystemThread> (MakeCallback (&PcapFile::Writer::DoRun, this));
+      m_thread->Start ();
+    }
+#else
+  m_background = false;
+#endif
+}
+
+PcapFile::Writer::~Writer ()
+{
+  Sync ();
+  Stop ();
+  delete [] m_current.data;
+}
+
+std::ostream *
+PcapFile::Writer::GetFatalStream (void)
+{
+  return &m_fatalStream;
+}
+
+int
+PcapFile::Writer::sync (void)
+{
+  // the fatal error handler may run in the middle of a simulation: no
+  // record may still be in the hands of the thread when the file is
+  // flushed.
+  Stop ();
+  Submit ();
+  m_file->flush ();
+  return 0;
+}
+
+uint8_t *
+PcapFile::Writer::Reserve (uint32_t size)
+{
+  if (m_blockSize - m_current.size < size)
+    {
+      if (size > m_blockSize)
+        {
+          Sync ();
+          return 0;
+        }
+      Submit ();
+    }
+  uint8_t *start = m_current.data + m_current.size;
+  m_current.size += size;
+  return start;
+}
+
+void
+PcapFile::Writer::Submit (void)
+{
+  if (m_current.size == 0)
+    {
+      return;
+    }
+#ifdef HAVE_PTHREAD_H
+  if (m_background)
+    {
+      m_mutex.Lock ();
+      m_full.push_back (m_current);
+      Notify (m_filled);
+      while (m_free.empty () && m_nBlocks == MAX_WRITER_BLOCKS)
+        {
+          Wait (m_written);
+        }
+      if (m_free.empty ())
+        {
+          m_current.data = new uint8_t [m_blockSize];
+          m_nBlocks++;
+        }
+      else
+        {
+          m_current = m_free.back ();
+          m_free.pop_back ();
+        }
+      m_mutex.Unlock ();
+      m_current.size = 0;
+      return;
+    }
+#endif
+  m_file->write ((const char *)m_current.data, m_current.size);
+  m_current.size = 0;
+}
+
+void
+PcapFile::Writer::Sync (void)
+{
+  Submit ();
+#ifdef HAVE_PTHREAD_H
+  if (m_background)
+    {
+      m_mutex.Lock ();
+      while (!m_full.empty () || m_writing)
+        {
+          Wait (m_written);
+        }
+      m_mutex.Unlock ();
+    }
+#endif
+}
+
+// Joins the thread once it has written all the full blocks; the writes
+// are synchronous from then on.
+void
+PcapFile::Writer::Stop (void)
+{
+#ifdef HAVE_PTHREAD_H
+  if (!m_background)
+    {
+      return;
+    }
+  m_mutex.Lock ();
+  m_stop = true;
+  Notify (m_filled);
+  m_mutex.Unlock ();
+  m_thread->Join ();
+  m_thread = 0;
+  m_background = false;
+  for (std::vector<Block>::iterator i = m_free.begin (); i != m_free.end (); ++i)
+    {
+      delete [] i->data;
+    }
+  m_free.clear ();
+#endif
+}
+
+#ifdef HAVE_PTHREAD_H
+// Called with m_mutex held.  SystemCondition::Wait would miss a
+// notification sent between the unlock and the wait, so the condition is
+// cleared under the mutex instead, and TimedWait returns at once if it
+// was set since.  The caller checks its state again on a timeout.
+void
+PcapFile::Writer::Wait (SystemCondition &condition)
+{
+  condition.SetCondition (false);
+  m_mutex.Unlock ();
+  condition.TimedWait (1000000000);
+  m_mutex.Lock ();
+}
+
+// Called with m_mutex held.
+void
+PcapFile::Writer::Notify (SystemCondition &condition)
+{
+  condition.SetCondition (true);
+  condition.Broadcast ();
+}
+
+void
+PcapFile::Writer::DoRun (void)
+{
+  m_mutex.Lock ();
+  while (true)
+    {
+      while (m_full.empty () && !m_stop)
+        {
+          Wait (m_filled);
+        }
+      if (m_full.empty ())
+        {
+          break;
+        }
+      Block block = m_full.front ();
+      m_full.pop_front ();
+      m_writing = true;
+      m_mutex.Unlock ();
+
+      m_file->write ((const char *)block.data, block.size);
+
+      m_mutex.Lock ();
+      m_writing = false;
+      m_free.push_back (block);
+      Notify (m_written);
+    }
+  m_mutex.Unlock ();
+}
+#endif /* HAVE_PTHREAD_H */
+
 PcapFile::PcapFile ()
   : m_file (),
-    m_swapMode (false)
+    m_swapMode (false),
+    m_writer (0)
 {
   FatalImpl::RegisterStream (&m_file);
 }
 
 PcapFile::~PcapFile ()
 {
-  FatalImpl::UnregisterStream (&m_file);
   Close ();
+  FatalImpl::UnregisterStream (&m_file);
 }
 
 
 bool 
 PcapFile::Fail (void) const
 {
+  if (m_writer != 0)
+    {
+      // the pending blocks may still set the fail bit.
+      m_writer->Sync ();
+    }
   return m_file.fail ();
 }
 bool 
@@ -77,9 +356,35 @@ PcapFile::Clear (void)
 void
 PcapFile::Close (void)
 {
+  DeleteWriter ();
   m_file.close ();
 }
 
+void
+PcapFile::SetWriteBuffer (uint32_t size, bool background)
+{
+  DeleteWriter ();
+  if (size > 0)
+    {
+      m_writer = new Writer (&m_file, size, background);
+      // on a fatal error, the writer flushes its records and the file
+      FatalImpl::UnregisterStream (&m_file);
+      FatalImpl::RegisterStream (m_writer->GetFatalStream ());
+    }
+}
+
+void
+PcapFile::DeleteWriter (void)
+{
+  if (m_writer != 0)
+    {
+      FatalImpl::UnregisterStream (m_writer->GetFatalStream ());
+      FatalImpl::RegisterStream (&m_file);
+      delete m_writer;
+      m_writer = 0;
+    }
+}
+
 uint32_t
 PcapFile::GetMagic (void)
 {
@@ -373,17 +678,64 @@ PcapFile::WritePacketHeader (uint32_t tsSec, uint32_t tsUsec, uint32_t totalLen)
   return inclLen;
 }
 
+uint8_t *
+PcapFile::ReserveRecord (uint32_t tsSec, uint32_t tsUsec, uint32_t totalLen, uint32_t &inclLen)
+{
+  if (m_writer == 0)
+    {
+      return 0;
+    }
+
+  inclLen = totalLen > m_fileHeader.m_snapLen ? m_fileHeader.m_snapLen : totalLen;
+  uint8_t *buffer = m_writer->Reserve (RECORD_HEADER_SIZE + inclLen);
+  if (buffer == 0)
+    {
+      return 0;
+    }
+
+  PcapRecordHeader header;
+  header.m_tsSec = tsSec;
+  header.m_tsUsec = tsUsec;
+  header.m_inclLen = inclLen;
+  header.m_origLen = totalLen;
+
+  if (m_swapMode)
+    {
+      Swap (&header, &header);
+    }
+
+  memcpy (buffer, &header.m_tsSec, sizeof(header.m_tsSec));
+  memcpy (buffer + 4, &header.m_tsUsec, sizeof(header.m_tsUsec));
+  memcpy (buffer + 8, &header.m_inclLen, sizeof(header.m_inclLen));
+  memcpy (buffer + 12, &header.m_origLen, sizeof(header.m_origLen));
+  return buffer + RECORD_HEADER_SIZE;
+}
+
 void
 PcapFile::Write (uint32_t tsSec, uint32_t tsUsec, uint8_t const * const data, uint32_t totalLen)
 {
-  uint32_t inclLen = WritePacketHeader (tsSec, tsUsec, totalLen);
+  uint32_t inclLen;
+  uint8_t *buffer = ReserveRecord (tsSec, tsUsec, totalLen, inclLen);
+  if (buffer != 0)
+    {
+      memcpy (buffer, data, inclLen);
+      return;
+    }
+  inclLen = WritePacketHeader (tsSec, tsUsec, totalLen);
   m_file.write ((const char *)data, inclLen);
 }
 
 void 
 PcapFile::Write (uint32_t tsSec, uint32_t tsUsec, Ptr<const Packet> p)
 {
-  uint32_t inclLen = WritePacketHeader (tsSec, tsUsec, p->GetSize ());
+  uint32_t inclLen;
+  uint8_t *buffer = ReserveRecord (tsSec, tsUsec, p->GetSize (), inclLen);
+  if (buffer != 0)
+    {
+      p->CopyData (buffer, inclLen);
+      return;
+    }
+  inclLen = WritePacketHeader (tsSec, tsUsec, p->GetSize ());
   p->CopyData (&m_file, inclLen);
 }
 
@@ -392,11 +744,22 @@ PcapFile::Write (uint32_t tsSec, uint32_t tsUsec, Header &header, Ptr<const Pack
 {
   uint32_t headerSize = header.GetSerializedSize ();
   uint32_t totalSize = headerSize + p->GetSize ();
-  uint32_t inclLen = WritePacketHeader (tsSec, tsUsec, totalSize);
 
   Buffer headerBuffer;
   headerBuffer.AddAtStart (headerSize);
   header.Serialize (headerBuffer.Begin ());
+
+  uint32_t inclLen;
+  uint8_t *buffer = ReserveRecord (tsSec, tsUsec, totalSize, inclLen);
+  if (buffer != 0)
+    {
+      uint32_t toCopy = std::min (headerSize, inclLen);
+      headerBuffer.CopyData (buffer, toCopy);
+      p->CopyData (buffer + toCopy, inclLen - toCopy);
+      return;
+    }
+
+  inclLen = WritePacketHeader (tsSec, tsUsec, totalSize);
   uint32_t toCopy = std::min (headerSize, inclLen);
   headerBuffer.CopyData (&m_file, toCopy);
   inclLen -= toCopy;
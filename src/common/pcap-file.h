@@ -147,6 +147,26 @@ public:
    */
   void Write (uint32_t tsSec, uint32_t tsUsec, Header &header, Ptr<const Packet> p);
 
+  /**
+   * \brief Collect the records written to the file in memory blocks
+   *
+   * By default, every record is handed to the underlying iostream field by
+   * field.  Once this method has been called, the records are copied in
+   * blocks of \p size bytes which are written to the file with a single
+   * call each.  If \p background is true, and if threads are available,
+   * the full blocks are written by a separate thread while the caller
+   * fills the next one.  A record larger than a block is written directly,
+   * after the pending blocks.
+   *
+   * The records become visible in the file when a block is full, when
+   * Fail is called, and when the file is closed.  This method must be
+   * called after Init; a size of zero restores the unbuffered behavior.
+   *
+   * \param size       Size of a block, in bytes
+   * \param background Write the full blocks from a separate thread
+   */
+  void SetWriteBuffer (uint32_t size, bool background = false);
+
 
   /**
    * \brief Read next packet from file
@@ -284,12 +304,17 @@ private:
 
   void WriteFileHeader (void);
   uint32_t WritePacketHeader (uint32_t tsSec, uint32_t tsUsec, uint32_t totalLen);
+  uint8_t *ReserveRecord (uint32_t tsSec, uint32_t tsUsec, uint32_t totalLen, uint32_t &inclLen);
   void ReadAndVerifyFileHeader (void);
+  void DeleteWriter (void);
+
+  class Writer;
 
   std::string    m_filename;
   std::fstream   m_file;
   PcapFileHeader m_fileHeader;
   bool m_swapMode;
+  Writer *m_writer;
 };
 
 }//namespace ns3
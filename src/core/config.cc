@@ -33,6 +33,8 @@
 #include "callback.h"
 
 #include <sstream>
+#include <algorithm>
+#include <map>
 
 NS_LOG_COMPONENT_DEFINE ("Config");
 
@@ -132,81 +134,101 @@ MatchContainer::DisconnectWithoutContext (std::string name, const CallbackBase &
 
 } // namespace Config
 
+/**
+ * Match the indexes of a vector against one element of a path.  The
+ * element is parsed once, when the matcher is created, into a sorted list
+ * of disjoint ranges of indexes.
+ */
 class ArrayMatcher
 {
 public:
   ArrayMatcher (std::string element);
-  bool Matches (uint32_t i) const;
+  /**
+   * \param n the size of the vector
+   * \param indexes [out] the indexes smaller than n which match, in
+   *        increasing order
+   */
+  void GetIndexes (uint32_t n, std::vector<uint32_t> *indexes) const;
 private:
+  typedef std::vector<std::pair<uint32_t, uint32_t> > Ranges;
+  void Parse (std::string element, Ranges *ranges) const;
   bool StringToUint32 (std::string str, uint32_t *value) const;
   std::string m_element;
+  Ranges m_ranges;
 };
 
 
 ArrayMatcher::ArrayMatcher (std::string element)
   : m_element (element)
-{}
-bool 
-ArrayMatcher::Matches (uint32_t i) const
 {
-  if (m_element == "*")
+  Ranges ranges;
+  Parse (element, &ranges);
+  std::sort (ranges.begin (), ranges.end ());
+  for (Ranges::const_iterator i = ranges.begin (); i != ranges.end (); i++)
     {
-      NS_LOG_DEBUG ("Array "<<i<<" matches *");
-      return true;
+      if (!m_ranges.empty () && 
+          (m_ranges.back ().second == 0xffffffff || i->first <= m_ranges.back ().second + 1))
+        {
+          m_ranges.back ().second = std::max (m_ranges.back ().second, i->second);
+        }
+      else
+        {
+          m_ranges.push_back (*i);
+        }
+    }
+}
+void
+ArrayMatcher::Parse (std::string element, Ranges *ranges) const
+{
+  if (element == "*")
+    {
+      ranges->push_back (std::make_pair (0, 0xffffffff));
+      return;
     }
   std::string::size_type tmp;
-  tmp = m_element.find ("|");
+  tmp = element.find ("|");
   if (tmp != std::string::npos)
     {
-      std::string left = m_element.substr (0, tmp-0);
-      std::string right = m_element.substr (tmp+1, m_element.size () - (tmp + 1));
-      ArrayMatcher matcher = ArrayMatcher (left);
-      if (matcher.Matches (i))
-	{
-	  NS_LOG_DEBUG ("Array "<<i<<" matches "<<left);
-	  return true;
-	}
-      matcher = ArrayMatcher (right);
-      if (matcher.Matches (i))
-	{
-	  NS_LOG_DEBUG ("Array "<<i<<" matches "<<right);
-	  return true;
-	}
-      NS_LOG_DEBUG ("Array "<<i<<" does not match "<<m_element);
-      return false;
+      Parse (element.substr (0, tmp-0), ranges);
+      Parse (element.substr (tmp+1, element.size () - (tmp + 1)), ranges);
+      return;
     }
-  std::string::size_type leftBracket = m_element.find ("[");
-  std::string::size_type rightBracket = m_element.find ("]");
-  std::string::size_type dash = m_element.find ("-");
-  if (leftBracket == 0 && rightBracket == m_element.size () - 1 &&
+  std::string::size_type leftBracket = element.find ("[");
+  std::string::size_type rightBracket = element.find ("]");
+  std::string::size_type dash = element.find ("-");
+  if (leftBracket == 0 && rightBracket == element.size () - 1 &&
       dash > leftBracket && dash < rightBracket)
     {
-      std::string lowerBound = m_element.substr (leftBracket + 1, dash - (leftBracket + 1));
-      std::string upperBound = m_element.substr (dash + 1, rightBracket - (dash + 1));
+      std::string lowerBound = element.substr (leftBracket + 1, dash - (leftBracket + 1));
+      std::string upperBound = element.substr (dash + 1, rightBracket - (dash + 1));
       uint32_t min;
       uint32_t max;
       if (StringToUint32 (lowerBound, &min) && 
 	  StringToUint32 (upperBound, &max) &&
-	  i >= min && i <= max)
+          min <= max)
         {
-	  NS_LOG_DEBUG ("Array "<<i<<" matches "<<m_element);
-          return true;
+          ranges->push_back (std::make_pair (min, max));
         }
-      else
-	{
-	  NS_LOG_DEBUG ("Array "<<i<<" does not "<<m_element);
-	  return false;
-	}
+      return;
     }
   uint32_t value;
-  if (StringToUint32 (m_element, &value) &&
-      i == value)
+  if (StringToUint32 (element, &value))
     {
-      NS_LOG_DEBUG ("Array "<<i<<" matches "<<m_element);
-      return true;
+      ranges->push_back (std::make_pair (value, value));
     }
-  NS_LOG_DEBUG ("Array "<<i<<" does not match "<<m_element);
-  return false;
+}
+void
+ArrayMatcher::GetIndexes (uint32_t n, std::vector<uint32_t> *indexes) const
+{
+  for (Ranges::const_iterator j = m_ranges.begin (); j != m_ranges.end () && j->first < n; j++)
+    {
+      uint32_t last = std::min (j->second, n - 1);
+      for (uint32_t i = j->first; i <= last; i++)
+        {
+          indexes->push_back (i);
+        }
+    }
+  NS_LOG_DEBUG ("Array "<<m_element<<" matches "<<indexes->size ()<<" of "<<n<<" objects");
 }
 
 bool
@@ -229,7 +251,8 @@ public:
 private:
   void Canonicalize (void);
   void DoResolve (std::string path, Ptr<Object> root);
-  void DoArrayResolve (std::string path, const ObjectVectorValue &vector);
+  void DoArrayResolve (std::string path, Ptr<Object> root, Ptr<const AttributeAccessor> accessor);
+  void DoArrayResolveOne (std::string path, uint32_t i, Ptr<Object> object);
   void DoResolveOne (Ptr<Object> object);
   std::string GetResolvedPath (void) const;
   virtual void DoOne (Ptr<Object> object, std::string path) = 0;
@@ -413,10 +436,8 @@ Resolver::DoResolve (std::string path, Ptr<Object> root)
       if (vectorChecker != 0)
 	{
 	  NS_LOG_DEBUG ("GetAttribute(vector)="<<item<<" on path="<<GetResolvedPath ());
-	  ObjectVectorValue vector;
-          root->GetAttribute (item, vector);
 	  m_workStack.push_back (item);
-	  DoArrayResolve (pathLeft, vector);
+	  DoArrayResolve (pathLeft, root, info.accessor);
 	  m_workStack.pop_back ();
 	}
       // this could be anything else and we don't know what to do with it.
@@ -425,7 +446,7 @@ Resolver::DoResolve (std::string path, Ptr<Object> root)
 }
 
 void 
-Resolver::DoArrayResolve (std::string path, const ObjectVectorValue &vector)
+Resolver::DoArrayResolve (std::string path, Ptr<Object> root, Ptr<const AttributeAccessor> accessor)
 {
   NS_ASSERT (path != "");
   std::string::size_type tmp;
@@ -440,19 +461,43 @@ Resolver::DoArrayResolve (std::string path, const ObjectVectorValue &vector)
   std::string pathLeft = path.substr (next, path.size ()-next);
 
   ArrayMatcher matcher = ArrayMatcher (item);
-  for (uint32_t i = 0; i < vector.GetN (); i++)
+  std::vector<uint32_t> indexes;
+  //
+  // Fetch the matching objects alone rather than a copy of the whole vector
+  // so that resolving a path such as /NodeList/3/DeviceList/0 does not cost
+  // more with a large number of nodes.
+  //
+  const ObjectVectorAccessor *vectorAccessor = 
+    dynamic_cast<const ObjectVectorAccessor *> (PeekPointer (accessor));
+  uint32_t n;
+  if (vectorAccessor != 0 && vectorAccessor->GetN (PeekPointer (root), &n))
     {
-      if (matcher.Matches (i))
-	{
-	  std::ostringstream oss;
-	  oss << i;
-	  m_workStack.push_back (oss.str ());
-	  DoResolve (pathLeft, vector.Get (i));
-	  m_workStack.pop_back ();
-	}
+      matcher.GetIndexes (n, &indexes);
+      for (std::vector<uint32_t>::const_iterator i = indexes.begin (); i != indexes.end (); i++)
+        {
+          DoArrayResolveOne (pathLeft, *i, vectorAccessor->Get (PeekPointer (root), *i));
+        }
+      return;
+    }
+  ObjectVectorValue vector;
+  accessor->Get (PeekPointer (root), vector);
+  matcher.GetIndexes (vector.GetN (), &indexes);
+  for (std::vector<uint32_t>::const_iterator i = indexes.begin (); i != indexes.end (); i++)
+    {
+      DoArrayResolveOne (pathLeft, *i, vector.Get (*i));
     }
 }
 
+void
+Resolver::DoArrayResolveOne (std::string path, uint32_t i, Ptr<Object> object)
+{
+  std::ostringstream oss;
+  oss << i;
+  m_workStack.push_back (oss.str ());
+  DoResolve (path, object);
+  m_workStack.pop_back ();
+}
+
 
 class ConfigImpl 
 {
@@ -462,6 +507,7 @@ public:
   void Connect (std::string path, const CallbackBase &cb);
   void DisconnectWithoutContext (std::string path, const CallbackBase &cb);
   void Disconnect (std::string path, const CallbackBase &cb);
+  void ConnectMany (const std::vector<std::string> &paths, const CallbackBase &cb);
   Config::MatchContainer LookupMatches (std::string path);
 
   void RegisterRootNamespaceObject (Ptr<Object> obj);
@@ -526,6 +572,33 @@ ConfigImpl::Disconnect (std::string path, const CallbackBase &cb)
   Config::MatchContainer container = LookupMatches (root);
   container.Disconnect (leaf, cb);
 }
+void 
+ConfigImpl::ConnectMany (const std::vector<std::string> &paths, const CallbackBase &cb)
+{
+  std::map<std::string, std::vector<std::string> > leaves;
+  std::vector<std::string> roots;
+  for (std::vector<std::string>::const_iterator i = paths.begin (); i != paths.end (); i++)
+    {
+      std::string root, leaf;
+      ParsePath (*i, &root, &leaf);
+      std::vector<std::string> &rootLeaves = leaves[root];
+      if (rootLeaves.empty ())
+        {
+          roots.push_back (root);
+        }
+      rootLeaves.push_back (leaf);
+    }
+  // connect in the order of the paths, root by root.
+  for (std::vector<std::string>::const_iterator i = roots.begin (); i != roots.end (); i++)
+    {
+      Config::MatchContainer container = LookupMatches (*i);
+      const std::vector<std::string> &rootLeaves = leaves[*i];
+      for (std::vector<std::string>::const_iterator j = rootLeaves.begin (); j != rootLeaves.end (); j++)
+        {
+          container.Connect (*j, cb);
+        }
+    }
+}
 
 Config::MatchContainer 
 ConfigImpl::LookupMatches (std::string path)
@@ -629,6 +702,11 @@ Disconnect (std::string path, const CallbackBase &cb)
 {
   Singleton<ConfigImpl>::Get ()->Disconnect (path, cb);
 }
+void 
+ConnectMany (const std::vector<std::string> &paths, const CallbackBase &cb)
+{
+  Singleton<ConfigImpl>::Get ()->ConnectMany (paths, cb);
+}
 Config::MatchContainer LookupMatches (std::string path)
 {
   return Singleton<ConfigImpl>::Get ()->LookupMatches (path);
@@ -1223,6 +1301,69 @@ ObjectVectorTraceConfigTestCase::DoRun (void)
   return GetErrorStatus ();
 }
 
+// ===========================================================================
+// Test for the index patterns and for Config::ConnectMany
+// ===========================================================================
+class ConnectManyConfigTestCase : public TestCase
+{
+public:
+  ConnectManyConfigTestCase ();
+  virtual ~ConnectManyConfigTestCase () {}
+
+  void Trace (std::string path, int16_t oldValue, int16_t newValue) {m_paths.push_back (path);}
+
+private:
+  virtual bool DoRun (void);
+
+  std::vector<std::string> m_paths;
+};
+
+ConnectManyConfigTestCase::ConnectManyConfigTestCase ()
+  : TestCase ("Check ability to connect many paths at once")
+{
+}
+
+bool
+ConnectManyConfigTestCase::DoRun (void)
+{
+  Ptr<ConfigTestObject> root = CreateObject<ConfigTestObject> ();
+  Config::RegisterRootNamespaceObject (root);
+
+  std::vector<Ptr<ConfigTestObject> > nodes;
+  for (uint32_t i = 0; i < 6; i++)
+    {
+      nodes.push_back (CreateObject<ConfigTestObject> ());
+      root->AddNodeA (nodes.back ());
+    }
+
+  //
+  // The overlapping patterns must match each index once, and the indexes past
+  // the end of the vector must be ignored.
+  //
+  std::vector<std::string> paths;
+  paths.push_back ("/NodesA/[0-2]|1|2/Source");
+  paths.push_back ("/NodesA/5|[4-100]/Source");
+  paths.push_back ("/NodesA/2/Source");
+  Config::ConnectMany (paths, MakeCallback (&ConnectManyConfigTestCase::Trace, this));
+
+  for (uint32_t i = 0; i < nodes.size (); i++)
+    {
+      m_paths.clear ();
+      nodes[i]->SetAttribute ("Source", IntegerValue (i + 1));
+      std::ostringstream oss;
+      oss << "/NodesA/" << i << "/Source";
+      uint32_t expected = (i == 2) ? 2 : (i == 3) ? 0 : 1;
+      NS_TEST_ASSERT_MSG_EQ (m_paths.size (), expected, "Unexpected number of calls for " << oss.str ());
+      for (uint32_t j = 0; j < m_paths.size (); j++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (m_paths[j], oss.str (), "Unexpected context");
+        }
+    }
+
+  Config::UnregisterRootNamespaceObject (root);
+  return GetErrorStatus ();
+}
+
 // ===========================================================================
 // The Test Suite that glues all of the Test Cases together.
 // ===========================================================================
@@ -1238,6 +1379,7 @@ ConfigTestSuite::ConfigTestSuite ()
   AddTestCase (new RootNamespaceConfigTestCase);
   AddTestCase (new UnderRootNamespaceConfigTestCase);
   AddTestCase (new ObjectVectorConfigTestCase);
+  AddTestCase (new ConnectManyConfigTestCase);
 }
 
 ConfigTestSuite configTestSuite;
@@ -110,6 +110,17 @@ void Connect (std::string path, const CallbackBase &cb);
  * This function undoes the work of Config::ConnectWithContext.
  */
 void Disconnect (std::string path, const CallbackBase &cb);
+/**
+ * \param paths the paths to match trace sources.
+ * \param cb the callback to connect to the matching trace sources.
+ *
+ * This function is equivalent to calling Config::Connect on each
+ * path but the objects named by the part of the paths before the
+ * trace source names are looked up only once for all the paths which
+ * share it.  Use it to connect the same callback to many trace sources,
+ * for example to several trace sources of each device of a topology.
+ */
+void ConnectMany (const std::vector<std::string> &paths, const CallbackBase &cb);
 
 /**
  * \brief hold a set of objects which match a specific search string.
@@ -0,0 +1,193 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "test.h"
+#include "log.h"
+#include <sstream>
+#ifdef NS3_MULTITHREADING
+#include "system-thread.h"
+#endif
+
+#ifdef NS3_LOG_ENABLE
+
+NS_LOG_COMPONENT_DEFINE ("LogTestSuite");
+
+using namespace ns3;
+
+namespace {
+
+struct LogTestValue
+{
+};
+
+std::ostream &
+operator << (std::ostream &os, const LogTestValue &value)
+{
+  return os << "value";
+}
+
+} // anonymous namespace
+
+class RingBufferLogTestCase : public TestCase
+{
+public:
+  RingBufferLogTestCase ();
+  virtual ~RingBufferLogTestCase () {}
+
+private:
+  virtual bool DoRun (void);
+  virtual void DoTeardown (void);
+};
+
+RingBufferLogTestCase::RingBufferLogTestCase ()
+  : TestCase ("Check that the messages logged to the ring buffer are printed back")
+{
+}
+
+bool
+RingBufferLogTestCase::DoRun (void)
+{
+  std::string filename = GetTempDir () + "log-test-suite.bin";
+  LogComponentEnable ("LogTestSuite", (enum LogLevel)(LOG_LEVEL_ALL | LOG_PREFIX_FUNC));
+  LogEnableRingBuffer (4096);
+
+  std::string x = "x";
+  NS_LOG_FUNCTION (this << 3 << x);
+  NS_LOG_INFO ("a=" << 1 << " b=" << 2.5 << " c=" << 'z' << " s=" << std::string ("str") << " t=" << true);
+  NS_LOG_DEBUG ("hex " << std::hex << 255 << " " << LogTestValue ());
+  NS_LOG_LOGIC (-7 << " " << 42u);
+
+  NS_TEST_EXPECT_MSG_EQ (LogWriteRingBuffer (filename), true, "Could not write " << filename);
+  std::ostringstream expected;
+  expected << "LogTestSuite:DoRun(" << (const void *)this << ", 3, x)" << std::endl
+           << "LogTestSuite:DoRun(): a=1 b=2.5 c=z s=str t=1" << std::endl
+           << "LogTestSuite:DoRun(): hex ff value" << std::endl
+           << "LogTestSuite:DoRun(): -7 42" << std::endl;
+  std::ostringstream printed;
+  NS_TEST_EXPECT_MSG_EQ (LogPrintRingBuffer (filename, printed), true, "Could not read " << filename);
+  NS_TEST_EXPECT_MSG_EQ (printed.str (), expected.str (), "Unexpected messages");
+
+  //
+  // A small buffer keeps only the last messages.
+  //
+  LogEnableRingBuffer (256);
+  for (uint32_t i = 0; i < 100; ++i)
+    {
+      NS_LOG_INFO (i);
+    }
+  DoTeardown ();
+  NS_TEST_EXPECT_MSG_EQ (LogWriteRingBuffer (filename), true, "Could not write " << filename);
+  printed.str ("");
+  NS_TEST_EXPECT_MSG_EQ (LogPrintRingBuffer (filename, printed), true, "Could not read " << filename);
+  std::istringstream lines (printed.str ());
+  std::string line;
+  uint32_t n = 0;
+  uint32_t last = 0;
+  while (std::getline (lines, line))
+    {
+      NS_TEST_EXPECT_MSG_EQ (line.substr (0, 22), "LogTestSuite:DoRun(): ", "Unexpected message " << line);
+      uint32_t value;
+      std::istringstream (line.substr (22)) >> value;
+      NS_TEST_EXPECT_MSG_EQ ((n == 0 || value == last + 1), true, "Unexpected message " << line);
+      last = value;
+      n++;
+    }
+  NS_TEST_EXPECT_MSG_EQ (last, 99, "The last message was not kept");
+  NS_TEST_EXPECT_MSG_EQ ((n > 0 && n < 100), true, "Unexpected number of messages kept: " << n);
+
+  return GetErrorStatus ();
+}
+
+// the later suites must not log to the ring buffer, even if this one
+// failed
+void
+RingBufferLogTestCase::DoTeardown (void)
+{
+  LogDisableRingBuffer ();
+  LogComponentDisable ("LogTestSuite", LOG_LEVEL_ALL);
+}
+
+#ifdef NS3_MULTITHREADING
+class ThreadExitLogTestCase : public TestCase
+{
+public:
+  ThreadExitLogTestCase ();
+  virtual ~ThreadExitLogTestCase () {}
+
+private:
+  virtual bool DoRun (void);
+  virtual void DoTeardown (void);
+  void LogInThread (void);
+};
+
+ThreadExitLogTestCase::ThreadExitLogTestCase ()
+  : TestCase ("Check that the messages of the threads which have exited are written")
+{
+}
+
+void
+ThreadExitLogTestCase::LogInThread (void)
+{
+  NS_LOG_INFO ("in a thread");
+}
+
+bool
+ThreadExitLogTestCase::DoRun (void)
+{
+  std::string filename = GetTempDir () + "log-test-suite.bin";
+  LogComponentEnable ("LogTestSuite", (enum LogLevel)(LOG_LEVEL_ALL | LOG_PREFIX_FUNC));
+  LogEnableRingBuffer (4096);
+
+  // the buffer of the thread is deleted when it exits
+  Ptr<SystemThread> thread = Create<SystemThread> (MakeCallback (&ThreadExitLogTestCase::LogInThread, this));
+  thread->Start ();
+  thread->Join ();
+  DoTeardown ();
+
+  NS_TEST_EXPECT_MSG_EQ (LogWriteRingBuffer (filename), true, "Could not write " << filename);
+  std::ostringstream printed;
+  NS_TEST_EXPECT_MSG_EQ (LogPrintRingBuffer (filename, printed), true, "Could not read " << filename);
+  NS_TEST_EXPECT_MSG_EQ (printed.str (), "LogTestSuite:LogInThread(): in a thread\n", "Unexpected messages");
+
+  return GetErrorStatus ();
+}
+
+void
+ThreadExitLogTestCase::DoTeardown (void)
+{
+  LogDisableRingBuffer ();
+  LogComponentDisable ("LogTestSuite", LOG_LEVEL_ALL);
+}
+#endif /* NS3_MULTITHREADING */
+
+class LogTestSuite : public TestSuite
+{
+public:
+  LogTestSuite ();
+};
+
+LogTestSuite::LogTestSuite ()
+  : TestSuite ("log", UNIT)
+{
+  AddTestCase (new RingBufferLogTestCase);
+#ifdef NS3_MULTITHREADING
+  AddTestCase (new ThreadExitLogTestCase);
+#endif
+}
+
+LogTestSuite logTestSuite;
+
+#endif /* NS3_LOG_ENABLE */
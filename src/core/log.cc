@@ -18,15 +18,56 @@
  * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
  */
 #include "log.h"
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <vector>
+#include <cstring>
+
+namespace {
+
+/* The log ring buffer files start with a uint32_t magic number and a
+ * uint32_t version number, followed by the names of the components and
+ * functions: a uint32_t count and, for each name, its uint32_t length
+ * and its characters.  Then come the threads: a uint32_t count and, for
+ * each thread, its uint32_t number of records and the records, oldest
+ * first.  A record is its uint32_t length, followed by the uint8_t flags
+ * below, the int32_t level, the uint32_t indexes of the component and
+ * function names, and the values of the message.  A value is a one byte
+ * tag followed by:
+ *   - 'i', 'u', 'f', 'p': an int64_t, uint64_t, double or pointer stored
+ *     as a uint64_t
+ *   - 'c', 'b': a char or a bool stored as one byte
+ *   - 's': a uint32_t length and the characters of a string
+ *   - ',': nothing, it separates the parameters of a function
+ * The integers are in the byte order of the host which wrote the file.
+ */
+const uint32_t LOG_FILE_MAGIC = 0x6e736c67;
+const uint32_t LOG_FILE_VERSION = 1;
+
+// the parameters of a function logged by NS_LOG_FUNCTION
+const uint8_t LOG_RECORD_PARAMETERS = 1;
+// the message is prefixed with the names of the component and function
+const uint8_t LOG_RECORD_PREFIX_FUNC = 2;
+// the first value is the time and node prefix
+const uint8_t LOG_RECORD_PREFIX = 4;
+
+} // anonymous namespace
 
 #ifdef NS3_LOG_ENABLE
 
 #include <list>
+#include <map>
 #include <utility>
 #include <iostream>
+#include <sstream>
 #include "assert.h"
 #include "ns3/core-config.h"
 #include "fatal-error.h"
+#ifdef NS3_MULTITHREADING
+#include "system-mutex.h"
+#include <pthread.h>
+#endif
 
 #ifdef HAVE_STDLIB_H
 #include <stdlib.h>
@@ -36,6 +77,7 @@ namespace ns3 {
 
 LogTimePrinter g_logTimePrinter = 0;
 LogNodePrinter g_logNodePrinter = 0;
+bool g_logRingBufferEnabled = false;
 
 typedef std::list<std::pair <std::string, LogComponent *> > ComponentList;
 typedef std::list<std::pair <std::string, LogComponent *> >::iterator ComponentListI;
@@ -222,13 +264,6 @@ LogComponent::EnvVarCheck (char const * name)
 }
 
 
-bool 
-LogComponent::IsEnabled (enum LogLevel level) const
-{
-  //  LogComponentEnableEnvVar ();
-  return (level & m_levels) ? 1 : 0;
-}
-
 bool
 LogComponent::IsNoneEnabled (void) const
 {
@@ -380,6 +415,579 @@ ParameterLogger::ParameterLogger (std::ostream &os)
     m_os (os)
 {}
 
+/* The records are kept in a circular array of bytes, each one as its
+ * uint32_t length followed by its bytes.  Only the thread which owns
+ * the buffer adds records to it, without any lock: m_start and m_used
+ * are published with release stores once a record is complete.  The
+ * buffer is resized or its records are extracted by another thread only
+ * when its owner does not log, as documented by LogEnableRingBuffer and
+ * LogWriteRingBuffer.
+ */
+class LogRingBuffer
+{
+public:
+  LogRingBuffer (uint32_t size);
+  void Resize (uint32_t size);
+  void Add (const std::string &record);
+  void Extract (std::vector<std::string> *records);
+
+  std::string m_record;
+  std::ostringstream m_format;
+  bool m_busy;
+private:
+  void Write (uint32_t offset, const void *data, uint32_t size);
+  void Read (uint32_t offset, void *data, uint32_t size) const;
+
+  std::vector<uint8_t> m_data;
+  uint32_t m_start;
+  uint32_t m_used;
+};
+
+LogRingBuffer::LogRingBuffer (uint32_t size)
+  : m_busy (false),
+    m_data (size),
+    m_start (0),
+    m_used (0)
+{}
+
+void
+LogRingBuffer::Resize (uint32_t size)
+{
+  m_data.resize (size);
+  __atomic_store_n (&m_start, 0, __ATOMIC_RELEASE);
+  __atomic_store_n (&m_used, 0, __ATOMIC_RELEASE);
+}
+
+void
+LogRingBuffer::Write (uint32_t offset, const void *data, uint32_t size)
+{
+  uint32_t first = std::min (size, (uint32_t)m_data.size () - offset);
+  memcpy (&m_data[offset], data, first);
+  memcpy (&m_data[0], (const uint8_t *)data + first, size - first);
+}
+
+void
+LogRingBuffer::Read (uint32_t offset, void *data, uint32_t size) const
+{
+  uint32_t first = std::min (size, (uint32_t)m_data.size () - offset);
+  memcpy (data, &m_data[offset], first);
+  memcpy ((uint8_t *)data + first, &m_data[0], size - first);
+}
+
+void
+LogRingBuffer::Add (const std::string &record)
+{
+  uint32_t capacity = m_data.size ();
+  uint32_t length = record.size ();
+  if (4 + length > capacity)
+    {
+      return;
+    }
+  uint32_t start = m_start;
+  uint32_t used = m_used;
+  while (used + 4 + length > capacity)
+    {
+      // drop the oldest record
+      uint32_t oldest;
+      Read (start, &oldest, 4);
+      start = (start + 4 + oldest) % capacity;
+      used -= 4 + oldest;
+    }
+  uint32_t end = (start + used) % capacity;
+  Write (end, &length, 4);
+  Write ((end + 4) % capacity, record.data (), length);
+  __atomic_store_n (&m_start, start, __ATOMIC_RELEASE);
+  __atomic_store_n (&m_used, used + 4 + length, __ATOMIC_RELEASE);
+}
+
+void
+LogRingBuffer::Extract (std::vector<std::string> *records)
+{
+  uint32_t capacity = m_data.size ();
+  uint32_t start = __atomic_load_n (&m_start, __ATOMIC_ACQUIRE);
+  uint32_t used = __atomic_load_n (&m_used, __ATOMIC_ACQUIRE);
+  while (used > 0)
+    {
+      uint32_t length;
+      Read (start, &length, 4);
+      std::string record (length, 0);
+      if (length > 0)
+        {
+          Read ((start + 4) % capacity, &record[0], length);
+        }
+      records->push_back (record);
+      start = (start + 4 + length) % capacity;
+      used -= 4 + length;
+    }
+  __atomic_store_n (&m_start, 0, __ATOMIC_RELEASE);
+  __atomic_store_n (&m_used, 0, __ATOMIC_RELEASE);
+}
+
+namespace {
+
+struct LogRingBufferRegistry
+{
+  LogRingBufferRegistry ()
+    : size (1 << 20)
+  {}
+  // the buffer of the main thread is never deleted since the static
+  // destructors log too.  The buffers of the other threads are deleted
+  // when they exit, and their records are kept in retired.
+  std::vector<LogRingBuffer *> buffers;
+  std::vector<std::vector<std::string> > retired;
+  uint32_t size;
+#ifdef NS3_MULTITHREADING
+  SystemMutex mutex;
+#endif
+};
+
+LogRingBufferRegistry &
+GetRingBufferRegistry (void)
+{
+  static LogRingBufferRegistry registry;
+  return registry;
+}
+
+#ifdef NS3_MULTITHREADING
+__thread LogRingBuffer *g_logRingBuffer = 0;
+pthread_key_t g_logRingBufferKey;
+pthread_once_t g_logRingBufferKeyOnce = PTHREAD_ONCE_INIT;
+
+void
+ThreadExit (void *value)
+{
+  LogRingBuffer *buffer = static_cast<LogRingBuffer *> (value);
+  LogRingBufferRegistry &registry = GetRingBufferRegistry ();
+  {
+    CriticalSection cs (registry.mutex);
+    registry.buffers.erase (std::find (registry.buffers.begin (), registry.buffers.end (), buffer));
+    std::vector<std::string> records;
+    buffer->Extract (&records);
+    if (!records.empty ())
+      {
+        registry.retired.push_back (records);
+      }
+  }
+  // the mutex logs to the buffer until it is unlocked
+  g_logRingBuffer = 0;
+  delete buffer;
+}
+
+void
+CreateRingBufferKey (void)
+{
+  pthread_key_create (&g_logRingBufferKey, &ThreadExit);
+}
+#else
+LogRingBuffer *g_logRingBuffer = 0;
+#endif
+
+LogRingBuffer *
+GetRingBuffer (void)
+{
+  if (g_logRingBuffer == 0)
+    {
+      // the buffer is set before the registry is locked because the
+      // mutex logs too.
+      LogRingBufferRegistry &registry = GetRingBufferRegistry ();
+      LogRingBuffer *buffer = new LogRingBuffer (registry.size);
+      g_logRingBuffer = buffer;
+#ifdef NS3_MULTITHREADING
+      // the buffer of a thread is deleted when the thread exits
+      pthread_once (&g_logRingBufferKeyOnce, &CreateRingBufferKey);
+      pthread_setspecific (g_logRingBufferKey, buffer);
+      CriticalSection cs (registry.mutex);
+#endif
+      registry.buffers.push_back (buffer);
+    }
+  return g_logRingBuffer;
+}
+
+void
+AppendString (std::string *record, const char *value, uint32_t length)
+{
+  record->push_back ('s');
+  record->append ((const char *)&length, 4);
+  record->append (value, length);
+}
+
+std::string &
+GetExitFilename (void)
+{
+  static std::string filename;
+  return filename;
+}
+
+void
+WriteRingBufferAtExit (void)
+{
+  LogWriteRingBuffer (GetExitFilename ());
+}
+
+} // anonymous namespace
+
+static class RingBufferEnvironment
+{
+public:
+  RingBufferEnvironment ();
+} g_ringBufferEnvironment;
+
+RingBufferEnvironment::RingBufferEnvironment ()
+{
+#ifdef HAVE_GETENV
+  char *envVar = getenv ("NS_LOG_RING");
+  if (envVar == 0 || *envVar == 0)
+    {
+      return;
+    }
+  std::string env = envVar;
+  uint32_t bytes = 1 << 20;
+  std::string::size_type comma = env.find (",");
+  if (comma != std::string::npos)
+    {
+      std::istringstream iss (env.substr (comma + 1));
+      iss >> bytes;
+      env = env.substr (0, comma);
+    }
+  GetExitFilename () = env;
+  LogEnableRingBuffer (bytes);
+  // the file is written before the registry and the filename are
+  // destroyed since they were created first.
+  atexit (&WriteRingBufferAtExit);
+#endif
+}
+
+void
+LogEnableRingBuffer (uint32_t bytes)
+{
+  LogRingBufferRegistry &registry = GetRingBufferRegistry ();
+#ifdef NS3_MULTITHREADING
+  CriticalSection cs (registry.mutex);
+#endif
+  registry.size = bytes;
+  registry.retired.clear ();
+  for (std::vector<LogRingBuffer *>::const_iterator i = registry.buffers.begin ();
+       i != registry.buffers.end (); ++i)
+    {
+      (*i)->Resize (bytes);
+    }
+  g_logRingBufferEnabled = true;
+}
+
+void
+LogDisableRingBuffer (void)
+{
+  g_logRingBufferEnabled = false;
+}
+
+bool
+LogWriteRingBuffer (std::string filename)
+{
+  LogRingBufferRegistry &registry = GetRingBufferRegistry ();
+  std::vector<std::vector<std::string> > threads;
+  {
+#ifdef NS3_MULTITHREADING
+    CriticalSection cs (registry.mutex);
+#endif
+    // the threads which have exited first
+    threads.swap (registry.retired);
+    for (uint32_t i = 0; i < registry.buffers.size (); ++i)
+      {
+        threads.push_back (std::vector<std::string> ());
+        registry.buffers[i]->Extract (&threads.back ());
+      }
+  }
+
+  // replace the pointers to the names by their index in the file
+  std::map<const char *, uint32_t> indexes;
+  std::vector<const char *> names;
+  std::string body;
+  uint32_t nThreads = threads.size ();
+  body.append ((const char *)&nThreads, 4);
+  for (std::vector<std::vector<std::string> >::const_iterator i = threads.begin ();
+       i != threads.end (); ++i)
+    {
+      uint32_t nRecords = i->size ();
+      body.append ((const char *)&nRecords, 4);
+      for (std::vector<std::string>::const_iterator j = i->begin (); j != i->end (); ++j)
+        {
+          uint32_t length = j->size () - 2 * sizeof (const char *) + 8;
+          body.append ((const char *)&length, 4);
+          body.append (*j, 0, 5);
+          for (uint32_t k = 0; k < 2; ++k)
+            {
+              const char *name;
+              memcpy (&name, j->data () + 5 + k * sizeof (name), sizeof (name));
+              std::map<const char *, uint32_t>::const_iterator found = indexes.find (name);
+              uint32_t index;
+              if (found == indexes.end ())
+                {
+                  index = names.size ();
+                  indexes[name] = index;
+                  names.push_back (name);
+                }
+              else
+                {
+                  index = found->second;
+                }
+              body.append ((const char *)&index, 4);
+            }
+          body.append (*j, 5 + 2 * sizeof (const char *), std::string::npos);
+        }
+    }
+
+  std::ofstream file (filename.c_str (), std::ios::out | std::ios::binary);
+  file.write ((const char *)&LOG_FILE_MAGIC, 4);
+  file.write ((const char *)&LOG_FILE_VERSION, 4);
+  uint32_t nNames = names.size ();
+  file.write ((const char *)&nNames, 4);
+  for (std::vector<const char *>::const_iterator i = names.begin (); i != names.end (); ++i)
+    {
+      uint32_t length = strlen (*i);
+      file.write ((const char *)&length, 4);
+      file.write (*i, length);
+    }
+  file.write (body.data (), body.size ());
+  file.close ();
+  return !file.fail ();
+}
+
+LogRecord::LogRecord (const LogComponent &component, enum LogLevel level, 
+                      const char *function, bool parameters)
+  : m_buffer (GetRingBuffer ()),
+    m_parameters (parameters),
+    m_formatting (false),
+    m_values (0)
+{
+  if (m_buffer->m_busy)
+    {
+      // the output operator of a value of a message logs a message
+      m_record = new std::string ();
+      m_format = new std::ostringstream ();
+    }
+  else
+    {
+      m_buffer->m_busy = true;
+      m_record = &m_buffer->m_record;
+      m_format = &m_buffer->m_format;
+      m_record->clear ();
+    }
+  LogTimePrinter timePrinter = component.IsEnabled (LOG_PREFIX_TIME) ? g_logTimePrinter : 0;
+  LogNodePrinter nodePrinter = component.IsEnabled (LOG_PREFIX_NODE) ? g_logNodePrinter : 0;
+  uint8_t flags = 0;
+  if (parameters)
+    {
+      flags |= LOG_RECORD_PARAMETERS;
+    }
+  if (component.IsEnabled (LOG_PREFIX_FUNC))
+    {
+      flags |= LOG_RECORD_PREFIX_FUNC;
+    }
+  if (timePrinter != 0 || nodePrinter != 0)
+    {
+      flags |= LOG_RECORD_PREFIX;
+    }
+  int32_t levelValue = level;
+  const char *name = component.Name ();
+  m_record->push_back (flags);
+  m_record->append ((const char *)&levelValue, 4);
+  m_record->append ((const char *)&name, sizeof (name));
+  m_record->append ((const char *)&function, sizeof (function));
+  if (flags & LOG_RECORD_PREFIX)
+    {
+      std::ostream &os = Format ();
+      if (timePrinter != 0)
+        {
+          (*timePrinter) (os);
+          os << " ";
+        }
+      if (nodePrinter != 0)
+        {
+          (*nodePrinter) (os);
+          os << " ";
+        }
+      FlushFormat ();
+    }
+}
+
+LogRecord::~LogRecord ()
+{
+  FlushFormat ();
+  m_buffer->Add (*m_record);
+  if (m_record == &m_buffer->m_record)
+    {
+      m_buffer->m_busy = false;
+    }
+  else
+    {
+      delete m_record;
+      delete m_format;
+    }
+}
+
+void
+LogRecord::StartValue (void)
+{
+  if (m_parameters)
+    {
+      // each parameter is formatted on its own
+      FlushFormat ();
+      if (m_values > 0)
+        {
+          m_record->push_back (',');
+        }
+    }
+  m_values++;
+}
+
+std::ostream &
+LogRecord::Format (void)
+{
+  if (!m_formatting)
+    {
+      m_format->str ("");
+      m_format->clear ();
+      m_format->flags (std::ios_base::skipws | std::ios_base::dec);
+      m_format->precision (6);
+      m_format->width (0);
+      m_format->fill (' ');
+      m_formatting = true;
+    }
+  return *m_format;
+}
+
+void
+LogRecord::FlushFormat (void)
+{
+  if (m_formatting)
+    {
+      std::string value = m_format->str ();
+      AppendString (m_record, value.data (), value.size ());
+      m_formatting = false;
+    }
+}
+
+void
+LogRecord::Append (uint8_t tag, const void *data, uint32_t size)
+{
+  m_record->push_back (tag);
+  m_record->append ((const char *)data, size);
+}
+
+#define LOG_RECORD_OUTPUT(type, tag, storage)                   \
+  LogRecord &                                                   \
+  LogRecord::operator<< (type value)                            \
+  {                                                             \
+    StartValue ();                                              \
+    if (m_formatting)                                           \
+      {                                                         \
+        Format () << value;                                     \
+      }                                                         \
+    else                                                        \
+      {                                                         \
+        storage v = value;                                      \
+        Append (tag, &v, sizeof (v));                           \
+      }                                                         \
+    return *this;                                               \
+  }
+
+LOG_RECORD_OUTPUT (bool, 'b', bool)
+LOG_RECORD_OUTPUT (char, 'c', char)
+LOG_RECORD_OUTPUT (signed char, 'c', char)
+LOG_RECORD_OUTPUT (unsigned char, 'c', char)
+LOG_RECORD_OUTPUT (short, 'i', int64_t)
+LOG_RECORD_OUTPUT (unsigned short, 'u', uint64_t)
+LOG_RECORD_OUTPUT (int, 'i', int64_t)
+LOG_RECORD_OUTPUT (unsigned int, 'u', uint64_t)
+LOG_RECORD_OUTPUT (long, 'i', int64_t)
+LOG_RECORD_OUTPUT (unsigned long, 'u', uint64_t)
+LOG_RECORD_OUTPUT (long long, 'i', int64_t)
+LOG_RECORD_OUTPUT (unsigned long long, 'u', uint64_t)
+LOG_RECORD_OUTPUT (float, 'f', double)
+LOG_RECORD_OUTPUT (double, 'f', double)
+
+#undef LOG_RECORD_OUTPUT
+
+LogRecord &
+LogRecord::operator<< (const void *value)
+{
+  StartValue ();
+  if (m_formatting)
+    {
+      Format () << value;
+    }
+  else
+    {
+      uint64_t v = (uintptr_t)value;
+      Append ('p', &v, sizeof (v));
+    }
+  return *this;
+}
+
+LogRecord &
+LogRecord::OutputPointer (const void *value, PointerKind<1>)
+{
+  return *this << value;
+}
+
+LogRecord &
+LogRecord::operator<< (const char *value)
+{
+  StartValue ();
+  if (m_formatting)
+    {
+      Format () << value;
+    }
+  else if (value != 0)
+    {
+      AppendString (m_record, value, strlen (value));
+    }
+  return *this;
+}
+
+LogRecord &
+LogRecord::operator<< (char *value)
+{
+  return *this << (const char *)value;
+}
+
+LogRecord &
+LogRecord::operator<< (const std::string &value)
+{
+  StartValue ();
+  if (m_formatting)
+    {
+      Format () << value;
+    }
+  else
+    {
+      AppendString (m_record, value.data (), value.size ());
+    }
+  return *this;
+}
+
+LogRecord &
+LogRecord::operator<< (std::string &value)
+{
+  return *this << (const std::string &)value;
+}
+
+LogRecord &
+LogRecord::operator<< (std::ostream &(*manipulator) (std::ostream &))
+{
+  StartValue ();
+  Format () << manipulator;
+  return *this;
+}
+
+LogRecord &
+LogRecord::operator<< (std::ios_base &(*manipulator) (std::ios_base &))
+{
+  StartValue ();
+  Format () << manipulator;
+  return *this;
+}
+
 } // namespace ns3
 
 #else // NS3_LOG_ENABLE
@@ -412,4 +1020,222 @@ LogComponentDisableAll (enum LogLevel level)
 
 } // namespace ns3
 
-#endif
+#endif // NS3_LOG_ENABLE
+
+namespace ns3 {
+
+namespace {
+
+class LogFileReader
+{
+public:
+  LogFileReader (const std::string &data)
+    : m_data (data),
+      m_offset (0)
+  {}
+  bool Read (void *value, uint32_t size)
+  {
+    if (size > m_data.size () - m_offset)
+      {
+        return false;
+      }
+    memcpy (value, m_data.data () + m_offset, size);
+    m_offset += size;
+    return true;
+  }
+  bool ReadString (std::string *value)
+  {
+    uint32_t length;
+    if (!Read (&length, 4) || length > m_data.size () - m_offset)
+      {
+        return false;
+      }
+    value->assign (m_data, m_offset, length);
+    m_offset += length;
+    return true;
+  }
+  bool IsEmpty (void) const
+  {
+    return m_offset == m_data.size ();
+  }
+private:
+  const std::string &m_data;
+  uint32_t m_offset;
+};
+
+bool
+PrintLogValue (LogFileReader &reader, std::ostream &os)
+{
+  uint8_t tag;
+  if (!reader.Read (&tag, 1))
+    {
+      return false;
+    }
+  switch (tag)
+    {
+    case 'i':
+      {
+        int64_t v;
+        if (!reader.Read (&v, 8))
+          {
+            return false;
+          }
+        os << v;
+      } break;
+    case 'u':
+      {
+        uint64_t v;
+        if (!reader.Read (&v, 8))
+          {
+            return false;
+          }
+        os << v;
+      } break;
+    case 'f':
+      {
+        double v;
+        if (!reader.Read (&v, 8))
+          {
+            return false;
+          }
+        os << v;
+      } break;
+    case 'p':
+      {
+        uint64_t v;
+        if (!reader.Read (&v, 8))
+          {
+            return false;
+          }
+        os << (const void *)(uintptr_t)v;
+      } break;
+    case 'c':
+      {
+        char v;
+        if (!reader.Read (&v, 1))
+          {
+            return false;
+          }
+        os << v;
+      } break;
+    case 'b':
+      {
+        bool v;
+        if (!reader.Read (&v, 1))
+          {
+            return false;
+          }
+        os << v;
+      } break;
+    case 's':
+      {
+        std::string v;
+        if (!reader.ReadString (&v))
+          {
+            return false;
+          }
+        os << v;
+      } break;
+    case ',':
+      os << ", ";
+      break;
+    default:
+      return false;
+    }
+  return true;
+}
+
+bool
+PrintLogRecord (const std::string &record, const std::vector<std::string> &names, 
+                std::ostream &os)
+{
+  LogFileReader reader (record);
+  uint8_t flags;
+  int32_t level;
+  uint32_t name;
+  uint32_t function;
+  if (!reader.Read (&flags, 1) || !reader.Read (&level, 4)
+      || !reader.Read (&name, 4) || !reader.Read (&function, 4)
+      || name >= names.size () || function >= names.size ())
+    {
+      return false;
+    }
+  if ((flags & LOG_RECORD_PREFIX) && !PrintLogValue (reader, os))
+    {
+      return false;
+    }
+  if (flags & LOG_RECORD_PARAMETERS)
+    {
+      os << names[name] << ":" << names[function] << "(";
+    }
+  else if (flags & LOG_RECORD_PREFIX_FUNC)
+    {
+      os << names[name] << ":" << names[function] << "(): ";
+    }
+  while (!reader.IsEmpty ())
+    {
+      if (!PrintLogValue (reader, os))
+        {
+          return false;
+        }
+    }
+  if (flags & LOG_RECORD_PARAMETERS)
+    {
+      os << ")";
+    }
+  os << std::endl;
+  return true;
+}
+
+} // anonymous namespace
+
+bool
+LogPrintRingBuffer (std::string filename, std::ostream &os)
+{
+  std::ifstream file (filename.c_str (), std::ios::in | std::ios::binary);
+  std::string data ((std::istreambuf_iterator<char> (file)), std::istreambuf_iterator<char> ());
+  LogFileReader reader (data);
+  uint32_t magic;
+  uint32_t version;
+  uint32_t nNames;
+  if (!reader.Read (&magic, 4) || magic != LOG_FILE_MAGIC
+      || !reader.Read (&version, 4) || version != LOG_FILE_VERSION
+      || !reader.Read (&nNames, 4))
+    {
+      return false;
+    }
+  std::vector<std::string> names;
+  for (uint32_t i = 0; i < nNames; ++i)
+    {
+      std::string name;
+      if (!reader.ReadString (&name))
+        {
+          return false;
+        }
+      names.push_back (name);
+    }
+  uint32_t nThreads;
+  if (!reader.Read (&nThreads, 4))
+    {
+      return false;
+    }
+  for (uint32_t i = 0; i < nThreads; ++i)
+    {
+      uint32_t nRecords;
+      if (!reader.Read (&nRecords, 4))
+        {
+          return false;
+        }
+      for (uint32_t j = 0; j < nRecords; ++j)
+        {
+          std::string record;
+          if (!reader.ReadString (&record) || !PrintLogRecord (record, names, os))
+            {
+              return false;
+            }
+        }
+    }
+  return reader.IsEmpty ();
+}
+
+} // namespace ns3
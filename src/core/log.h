@@ -101,6 +101,18 @@ void LogComponentDisable (char const *name, enum LogLevel level);
  */
 void LogComponentDisableAll (enum LogLevel level);
 
+/**
+ * \param filename the name of a file written by ns3::LogWriteRingBuffer
+ * \param os the stream to print the messages to
+ * \returns false if the file could not be read entirely.
+ * \ingroup logging
+ *
+ * Print the messages kept in a log ring buffer file the way they would
+ * have been printed on std::clog.  The messages of each thread are
+ * printed in order, one thread after the other.
+ */
+bool LogPrintRingBuffer (std::string filename, std::ostream &os);
+
 
 } // namespace ns3
 
@@ -133,6 +145,18 @@ void LogComponentDisableAll (enum LogLevel level);
  * for 'Component2'.  The wildcard can be used here as well.  For example
  * NS_LOG='*=level_all|prefix' would enable all log levels and prefix all
  * prints with the component and function names.
+ *
+ * The messages are written to std::clog as they are logged.  Writing them
+ * to a ring buffer instead, with ns3::LogEnableRingBuffer or the
+ * NS_LOG_RING environment variable, keeps only the last messages of each
+ * thread and defers the formatting of the numbers, strings and pointers
+ * they contain until the buffer is printed with the print-log program.
+ * NS_LOG_RING=file keeps the last megabyte of messages of each thread and
+ * writes them to file when the program exits; NS_LOG_RING=file,bytes sets
+ * the size of the buffers.
+ *
+ * The logging macros are compiled out of the optimized builds, and out of
+ * the debug builds configured with --disable-logging.
  */
 
 /**
@@ -203,6 +227,12 @@ void LogComponentDisableAll (enum LogLevel level);
     {                                                           \
       if (g_log.IsEnabled (level))                              \
         {                                                       \
+          if (ns3::LogRingBufferIsEnabled ())                   \
+            {                                                   \
+              ns3::LogRecord (g_log, level, __FUNCTION__, false) \
+                << msg;                                         \
+              break;                                            \
+            }                                                   \
           NS_LOG_APPEND_TIME_PREFIX;                            \
           NS_LOG_APPEND_NODE_PREFIX;                            \
           NS_LOG_APPEND_CONTEXT;                                \
@@ -258,6 +288,12 @@ void LogComponentDisableAll (enum LogLevel level);
     {                                                           \
       if (g_log.IsEnabled (ns3::LOG_FUNCTION))                  \
         {                                                       \
+          if (ns3::LogRingBufferIsEnabled ())                   \
+            {                                                   \
+              ns3::LogRecord (g_log, ns3::LOG_FUNCTION,         \
+                              __FUNCTION__, true);              \
+              break;                                            \
+            }                                                   \
           NS_LOG_APPEND_TIME_PREFIX;                            \
           NS_LOG_APPEND_NODE_PREFIX;                            \
           NS_LOG_APPEND_CONTEXT;                                \
@@ -289,6 +325,13 @@ void LogComponentDisableAll (enum LogLevel level);
     {                                                           \
       if (g_log.IsEnabled (ns3::LOG_FUNCTION))                  \
         {                                                       \
+          if (ns3::LogRingBufferIsEnabled ())                   \
+            {                                                   \
+              ns3::LogRecord (g_log, ns3::LOG_FUNCTION,         \
+                              __FUNCTION__, true)               \
+                << parameters;                                  \
+              break;                                            \
+            }                                                   \
           NS_LOG_APPEND_TIME_PREFIX;                            \
           NS_LOG_APPEND_NODE_PREFIX;                            \
           NS_LOG_APPEND_CONTEXT;                                \
@@ -359,6 +402,174 @@ private:
   char const *m_name;
 };
 
+/**
+ * \ingroup logging
+ * \param bytes the size of the ring buffer of each thread
+ *
+ * Send the log messages to a ring buffer per thread instead of std::clog.
+ * When a buffer is full, the oldest messages are dropped.  The messages
+ * are kept in a binary form until ns3::LogWriteRingBuffer is called.
+ *
+ * The context added by NS_LOG_APPEND_CONTEXT is not recorded in the
+ * buffers: use the LOG_PREFIX_TIME and LOG_PREFIX_NODE prefixes instead.
+ *
+ * The threads add their messages without any lock, so this function
+ * must not be called while other threads log, e.g., during
+ * Simulator::Run with a multithreaded simulator.
+ */
+void LogEnableRingBuffer (uint32_t bytes);
+/**
+ * \ingroup logging
+ *
+ * Send the log messages to std::clog again.  The messages already in the
+ * ring buffers are kept.
+ */
+void LogDisableRingBuffer (void);
+/**
+ * \ingroup logging
+ * \param filename the file to write
+ * \returns false if the file could not be written.
+ *
+ * Write the messages kept in the ring buffers of all the threads to a
+ * file, for ns3::LogPrintRingBuffer or the print-log program, and empty
+ * the buffers.  The messages of the threads which have exited are
+ * written too.  Like ns3::LogEnableRingBuffer, this function must not
+ * be called while other threads log.
+ */
+bool LogWriteRingBuffer (std::string filename);
+
+extern bool g_logRingBufferEnabled;
+
+inline bool
+LogRingBufferIsEnabled (void)
+{
+  return g_logRingBufferEnabled;
+}
+
+class LogRingBuffer;
+
+/**
+ * \ingroup logging
+ *
+ * Build one record of a log ring buffer.  The integers, floating point
+ * numbers, characters, strings and pointers are stored in binary form;
+ * the other values are formatted with their output operator.  After a
+ * stream manipulator, or a value which has to be formatted, the rest of
+ * the message is formatted too so that the manipulators apply to it.
+ * The record is added to the ring buffer of the calling thread when it
+ * is destroyed.
+ */
+class LogRecord
+{
+public:
+  /**
+   * \param component the log component of the message
+   * \param level the level of the message
+   * \param function the name of the function which logs the message
+   * \param parameters true if the values are the parameters of a function
+   *        logged by NS_LOG_FUNCTION
+   */
+  LogRecord (const LogComponent &component, enum LogLevel level, 
+             const char *function, bool parameters);
+  ~LogRecord ();
+
+  LogRecord &operator<< (bool value);
+  LogRecord &operator<< (char value);
+  LogRecord &operator<< (signed char value);
+  LogRecord &operator<< (unsigned char value);
+  LogRecord &operator<< (short value);
+  LogRecord &operator<< (unsigned short value);
+  LogRecord &operator<< (int value);
+  LogRecord &operator<< (unsigned int value);
+  LogRecord &operator<< (long value);
+  LogRecord &operator<< (unsigned long value);
+  LogRecord &operator<< (long long value);
+  LogRecord &operator<< (unsigned long long value);
+  LogRecord &operator<< (float value);
+  LogRecord &operator<< (double value);
+  LogRecord &operator<< (const char *value);
+  LogRecord &operator<< (char *value);
+  LogRecord &operator<< (const std::string &value);
+  LogRecord &operator<< (std::string &value);
+  LogRecord &operator<< (const void *value);
+  LogRecord &operator<< (std::ostream &(*manipulator) (std::ostream &));
+  LogRecord &operator<< (std::ios_base &(*manipulator) (std::ios_base &));
+  template <typename T>
+  LogRecord &operator<< (T *value);
+  template <typename T>
+  LogRecord &operator<< (const T &value);
+  // for the types whose output operator takes a non-const reference
+  template <typename T>
+  LogRecord &operator<< (T &value);
+
+private:
+  LogRecord (const LogRecord &o);
+  LogRecord &operator = (const LogRecord &o);
+
+  template <int N>
+  struct PointerKind {};
+  // only the pointers to objects convert to void pointers
+  static char IsObjectPointer (const volatile void *);
+  static long IsObjectPointer (...);
+  LogRecord &OutputPointer (const void *value, PointerKind<1>);
+  template <typename T>
+  LogRecord &OutputPointer (T *value, PointerKind<0>);
+
+  void StartValue (void);
+  std::ostream &Format (void);
+  void FlushFormat (void);
+  void Append (uint8_t tag, const void *data, uint32_t size);
+
+  LogRingBuffer *m_buffer;
+  // the record and the formatting stream of the buffer, or private ones
+  // if the buffer is in use by the message which logs this one.
+  std::string *m_record;
+  std::ostringstream *m_format;
+  bool m_parameters;
+  bool m_formatting;
+  uint32_t m_values;
+};
+
+template <typename T>
+LogRecord &
+LogRecord::operator<< (T *value)
+{
+  return OutputPointer (value, PointerKind<sizeof (IsObjectPointer (value)) == 1> ());
+}
+
+template <typename T>
+LogRecord &
+LogRecord::OutputPointer (T *value, PointerKind<0>)
+{
+  StartValue ();
+  Format () << value;
+  return *this;
+}
+
+template <typename T>
+LogRecord &
+LogRecord::operator<< (const T &value)
+{
+  StartValue ();
+  Format () << value;
+  return *this;
+}
+
+template <typename T>
+LogRecord &
+LogRecord::operator<< (T &value)
+{
+  StartValue ();
+  Format () << value;
+  return *this;
+}
+
+inline bool 
+LogComponent::IsEnabled (enum LogLevel level) const
+{
+  return (level & m_levels) ? 1 : 0;
+}
+
 class ParameterLogger : public std::ostream
 {
   int m_itemNumber;
@@ -406,6 +617,10 @@ public:
 #define LogSetNodePrinter(printer)
 #define LogGetNodePrinter
 
+#define LogEnableRingBuffer(bytes)
+#define LogDisableRingBuffer()
+#define LogWriteRingBuffer(filename) (false)
+
 #endif /* LOG_ENABLE */
 
 #endif // __LOG_H__
@@ -23,6 +23,9 @@
 #include "rng-stream.h"
 #include "global-value.h"
 #include "integer.h"
+#ifdef NS3_MULTITHREADING
+#include "system-mutex.h"
+#endif
 using namespace std;
 
 namespace
@@ -339,6 +342,12 @@ double RngStream::nextSeed[6] =
 //
 RngStream::RngStream ()
 {
+#ifdef NS3_MULTITHREADING
+  // the threads of the multithreaded simulator can create streams
+  // concurrently.
+  static SystemMutex mutex;
+  CriticalSection cs (mutex);
+#endif
   uint32_t run = EnsureGlobalInitialized ();
   
   anti = false;
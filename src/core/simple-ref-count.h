@@ -79,7 +79,11 @@ public:
    */
   inline void Ref (void) const
   {
+#ifdef NS3_MULTITHREADING
+    __sync_add_and_fetch (&m_count, 1);
+#else
     m_count++;
+#endif
   }
   /**
    * Decrement the reference count. This method should not be called
@@ -89,8 +93,12 @@ public:
    */
   inline void Unref (void) const
   {
+#ifdef NS3_MULTITHREADING
+    if (__sync_sub_and_fetch (&m_count, 1) == 0)
+#else
     m_count--;
     if (m_count == 0)
+#endif
       {
         DELETER::Delete (static_cast<T*> (const_cast<SimpleRefCount *> (this)));
       }
@@ -108,7 +116,9 @@ public:
   static void Cleanup (void) {}
 private:
   // Note we make this mutable so that the const methods can still
-  // change it.
+  // change it.  When ns-3 is built with --enable-multithreading, it
+  // is updated atomically because the objects can be shared by the
+  // threads of the multithreaded simulator.
   mutable uint32_t m_count;
 };
 
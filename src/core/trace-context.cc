@@ -0,0 +1,107 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#include <vector>
+#include "trace-context.h"
+#include "assert.h"
+#ifdef NS3_MULTITHREADING
+#include "system-mutex.h"
+#endif
+
+namespace ns3 {
+
+namespace {
+
+struct TraceContextRegistry
+{
+  typedef std::map<std::string, uint32_t> Map;
+
+  TraceContextRegistry ()
+  {
+    Map::iterator i = paths.insert (std::make_pair (std::string (), 0)).first;
+    ids.push_back (&*i);
+  }
+
+  // the nodes of a std::map do not move, so the handles can keep pointers
+  // to them.
+  Map paths;
+  std::vector<const Map::value_type *> ids;
+#ifdef NS3_MULTITHREADING
+  // the threads of the multithreaded simulator can connect sinks
+  // concurrently.
+  SystemMutex mutex;
+#endif
+};
+
+TraceContextRegistry &
+GetRegistry (void)
+{
+  static TraceContextRegistry registry;
+  return registry;
+}
+
+} // anonymous namespace
+
+TraceContext::TraceContext ()
+  : m_entry (Intern (std::string ()))
+{}
+TraceContext::TraceContext (std::string path)
+  : m_entry (Intern (path))
+{}
+TraceContext::TraceContext (const char *path)
+  : m_entry (Intern (std::string (path)))
+{}
+TraceContext::TraceContext (const Registry::value_type *entry)
+  : m_entry (entry)
+{}
+
+const TraceContext::Registry::value_type *
+TraceContext::Intern (const std::string &path)
+{
+  TraceContextRegistry &registry = GetRegistry ();
+#ifdef NS3_MULTITHREADING
+  CriticalSection cs (registry.mutex);
+#endif
+  std::pair<Registry::iterator, bool> result =
+    registry.paths.insert (std::make_pair (path, registry.ids.size ()));
+  if (result.second)
+    {
+      registry.ids.push_back (&*result.first);
+    }
+  return &*result.first;
+}
+
+TraceContext
+TraceContext::LookupId (uint32_t id)
+{
+  TraceContextRegistry &registry = GetRegistry ();
+#ifdef NS3_MULTITHREADING
+  CriticalSection cs (registry.mutex);
+#endif
+  NS_ASSERT_MSG (id < registry.ids.size (), "Unknown trace context id " << id);
+  return TraceContext (registry.ids[id]);
+}
+
+uint32_t
+TraceContext::GetN (void)
+{
+  TraceContextRegistry &registry = GetRegistry ();
+#ifdef NS3_MULTITHREADING
+  CriticalSection cs (registry.mutex);
+#endif
+  return registry.ids.size ();
+}
+
+} // namespace ns3
@@ -0,0 +1,132 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef TRACE_CONTEXT_H
+#define TRACE_CONTEXT_H
+
+#include <string>
+#include <map>
+#include <ostream>
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \brief handle on an interned trace context
+ * \ingroup tracing
+ *
+ * The trace paths are interned once, when the sinks are connected, and
+ * each path is given a small integer id.  A TraceContext only holds a
+ * pointer to the interned path, so it is as cheap to copy as an integer
+ * and the path is only read back when the sink prints it.
+ *
+ * A sink which takes a TraceContext instead of a std::string as its
+ * first argument receives the handle of the path given to
+ * TracedCallback::Connect:
+ * \code
+ * void MySink (TraceContext context, Ptr<const Packet> p);
+ * Config::Connect ("/NodeList/0/DeviceList/0/Mac/MacRx", MakeCallback (&MySink));
+ * \endcode
+ *
+ * The interned paths are never released.
+ */
+class TraceContext
+{
+public:
+  /**
+   * Create the handle of the empty path, whose id is zero.
+   */
+  TraceContext ();
+  /**
+   * \param path the path to intern
+   */
+  TraceContext (std::string path);
+  /**
+   * \param path the path to intern
+   */
+  TraceContext (const char *path);
+
+  /**
+   * \returns the id of the path: two handles have the same id if and only
+   *          if they refer to the same path.
+   */
+  uint32_t GetId (void) const;
+  /**
+   * \returns the interned path.
+   */
+  const std::string &GetPath (void) const;
+
+  /**
+   * \param id an id returned by TraceContext::GetId
+   * \returns the handle which has this id.
+   */
+  static TraceContext LookupId (uint32_t id);
+  /**
+   * \returns the number of paths interned so far, the empty path
+   *          included: the valid ids are smaller than this number.
+   */
+  static uint32_t GetN (void);
+
+private:
+  typedef std::map<std::string, uint32_t> Registry;
+  explicit TraceContext (const Registry::value_type *entry);
+  static const Registry::value_type *Intern (const std::string &path);
+
+  const Registry::value_type *m_entry;
+};
+
+bool operator == (const TraceContext &a, const TraceContext &b);
+bool operator != (const TraceContext &a, const TraceContext &b);
+bool operator < (const TraceContext &a, const TraceContext &b);
+std::ostream &operator << (std::ostream &os, const TraceContext &context);
+
+} // namespace ns3
+
+namespace ns3 {
+
+inline uint32_t
+TraceContext::GetId (void) const
+{
+  return m_entry->second;
+}
+inline const std::string &
+TraceContext::GetPath (void) const
+{
+  return m_entry->first;
+}
+inline bool
+operator == (const TraceContext &a, const TraceContext &b)
+{
+  return a.GetId () == b.GetId ();
+}
+inline bool
+operator != (const TraceContext &a, const TraceContext &b)
+{
+  return a.GetId () != b.GetId ();
+}
+inline bool
+operator < (const TraceContext &a, const TraceContext &b)
+{
+  return a.GetId () < b.GetId ();
+}
+inline std::ostream &
+operator << (std::ostream &os, const TraceContext &context)
+{
+  return os << context.GetPath ();
+}
+
+} // namespace ns3
+
+#endif /* TRACE_CONTEXT_H */
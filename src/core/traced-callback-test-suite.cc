@@ -110,6 +110,82 @@ BasicTracedCallbackTestCase::DoRun (void)
   return GetErrorStatus ();
 }
 
+class ContextTracedCallbackTestCase : public TestCase
+{
+public:
+  ContextTracedCallbackTestCase ();
+  virtual ~ContextTracedCallbackTestCase () {}
+
+private:
+  virtual bool DoRun (void);
+
+  void CbString (std::string context, uint8_t a);
+  void CbContext (TraceContext context, uint8_t a);
+
+  std::string m_string;
+  TraceContext m_context;
+  uint32_t m_calls;
+};
+
+ContextTracedCallbackTestCase::ContextTracedCallbackTestCase ()
+  : TestCase ("Check TracedCallback operation with a context")
+{
+}
+
+void
+ContextTracedCallbackTestCase::CbString (std::string context, uint8_t a)
+{
+  m_string = context;
+  m_calls++;
+}
+
+void
+ContextTracedCallbackTestCase::CbContext (TraceContext context, uint8_t a)
+{
+  m_context = context;
+  m_calls++;
+}
+
+bool
+ContextTracedCallbackTestCase::DoRun (void)
+{
+  TraceContext one ("/NodeList/1/Trace");
+  TraceContext two ("/NodeList/2/Trace");
+  NS_TEST_ASSERT_MSG_EQ ((one != two), true, "Different paths share an id");
+  NS_TEST_ASSERT_MSG_EQ (TraceContext ("/NodeList/1/Trace").GetId (), one.GetId (), "Path interned twice");
+  NS_TEST_ASSERT_MSG_EQ (TraceContext::LookupId (two.GetId ()).GetPath (), "/NodeList/2/Trace", "Wrong path for id");
+  NS_TEST_ASSERT_MSG_EQ (TraceContext ().GetId (), 0, "Empty path should have id zero");
+
+  //
+  // A sink which takes a std::string gets the path, and a sink which takes a
+  // TraceContext gets the handle of the path.
+  //
+  TracedCallback<uint8_t> trace;
+  trace.Connect (MakeCallback (&ContextTracedCallbackTestCase::CbString, this), "/NodeList/1/Trace");
+  trace.Connect (MakeCallback (&ContextTracedCallbackTestCase::CbContext, this), "/NodeList/2/Trace");
+  m_calls = 0;
+  trace (1);
+  NS_TEST_ASSERT_MSG_EQ (m_calls, 2, "Callbacks not called");
+  NS_TEST_ASSERT_MSG_EQ (m_string, "/NodeList/1/Trace", "Wrong string context");
+  NS_TEST_ASSERT_MSG_EQ (m_context.GetId (), two.GetId (), "Wrong context handle");
+
+  //
+  // Disconnecting with another path does nothing, and disconnecting with the
+  // same path removes the sink.
+  //
+  trace.Disconnect (MakeCallback (&ContextTracedCallbackTestCase::CbContext, this), "/NodeList/1/Trace");
+  m_calls = 0;
+  trace (1);
+  NS_TEST_ASSERT_MSG_EQ (m_calls, 2, "Callback unexpectedly disconnected");
+  trace.Disconnect (MakeCallback (&ContextTracedCallbackTestCase::CbContext, this), "/NodeList/2/Trace");
+  trace.Disconnect (MakeCallback (&ContextTracedCallbackTestCase::CbString, this), "/NodeList/1/Trace");
+  m_calls = 0;
+  trace (1);
+  NS_TEST_ASSERT_MSG_EQ (m_calls, 0, "Callbacks unexpectedly called");
+
+  return GetErrorStatus ();
+}
+
 class TracedCallbackTestSuite : public TestSuite
 {
 public:
@@ -120,6 +196,7 @@ TracedCallbackTestSuite::TracedCallbackTestSuite ()
   : TestSuite ("traced-callback", UNIT)
 {
   AddTestCase (new BasicTracedCallbackTestCase);
+  AddTestCase (new ContextTracedCallbackTestCase);
 }
 
 TracedCallbackTestSuite tracedCallbackTestSuite;
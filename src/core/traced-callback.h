@@ -23,6 +23,7 @@
 
 #include <list>
 #include "callback.h"
+#include "trace-context.h"
 
 namespace ns3 {
 
@@ -59,6 +60,11 @@ public:
    * of ns3::Callback. This method also will make sure that the
    * input path specified by the user will be give back to the
    * user's callback as its first argument. 
+   *
+   * If the first argument of the callback is a ns3::TraceContext
+   * rather than a std::string, the path is interned here and the
+   * callback receives its handle, so that no string is copied when
+   * the trace source fires.
    */
   void Connect (const CallbackBase & callback, std::string path);
   /**
@@ -124,6 +130,13 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::Connect (const CallbackBase & callback, std::string path)
 {
+  Callback<void,TraceContext,T1,T2,T3,T4,T5,T6,T7,T8> contextCb;
+  if (callback.GetImpl () != 0 && contextCb.CheckType (callback))
+    {
+      contextCb.Assign (callback);
+      m_callbackList.push_back (contextCb.Bind (TraceContext (path)));
+      return;
+    }
   Callback<void,std::string,T1,T2,T3,T4,T5,T6,T7,T8> cb;
   cb.Assign (callback);
   Callback<void,T1,T2,T3,T4,T5,T6,T7,T8> realCb = cb.Bind (path);
@@ -156,6 +169,13 @@ template<typename T1, typename T2,
 void 
 TracedCallback<T1,T2,T3,T4,T5,T6,T7,T8>::Disconnect (const CallbackBase & callback, std::string path)
 {
+  Callback<void,TraceContext,T1,T2,T3,T4,T5,T6,T7,T8> contextCb;
+  if (callback.GetImpl () != 0 && contextCb.CheckType (callback))
+    {
+      contextCb.Assign (callback);
+      DisconnectWithoutContext (contextCb.Bind (TraceContext (path)));
+      return;
+    }
   Callback<void,std::string,T1,T2,T3,T4,T5,T6,T7,T8> cb;
   cb.Assign (callback);
   Callback<void,T1,T2,T3,T4,T5,T6,T7,T8> realCb = cb.Bind (path);
@@ -21,6 +21,7 @@
 #include "singleton.h"
 #include "trace-source-accessor.h"
 #include <vector>
+#include <map>
 #include <sstream>
 
 /*********************************************************************
@@ -102,6 +103,9 @@ private:
   struct IidManager::IidInformation *LookupInformation (uint16_t uid) const;
 
   std::vector<struct IidInformation> m_information;
+  // index of m_information by name, for the lookups done by the config
+  // paths.
+  std::map<std::string, uint16_t> m_namesIndex;
 };
 
 IidManager::IidManager ()
@@ -110,15 +114,10 @@ IidManager::IidManager ()
 uint16_t 
 IidManager::AllocateUid (std::string name)
 {
-  uint16_t j = 1;
-  for (Iterator i = m_information.begin (); i != m_information.end (); i++)
+  if (m_namesIndex.find (name) != m_namesIndex.end ())
     {
-      if (i->name == name)
-        {
-          NS_FATAL_ERROR ("Trying to allocate twice the same uid: " << name);
-          return 0;
-        }
-      j++;
+      NS_FATAL_ERROR ("Trying to allocate twice the same uid: " << name);
+      return 0;
     }
   struct IidInformation information;
   information.name = name;
@@ -129,6 +128,7 @@ IidManager::AllocateUid (std::string name)
   m_information.push_back (information);
   uint32_t uid = m_information.size ();
   NS_ASSERT (uid <= 0xffff);
+  m_namesIndex[name] = uid;
   return uid;
 }
 
@@ -174,17 +174,12 @@ IidManager::AddConstructor (uint16_t uid, ns3::Callback<ns3::ObjectBase *> callb
 uint16_t 
 IidManager::GetUid (std::string name) const
 {
-  uint32_t j = 1;
-  for (Iterator i = m_information.begin (); i != m_information.end (); i++)
+  std::map<std::string, uint16_t>::const_iterator i = m_namesIndex.find (name);
+  if (i == m_namesIndex.end ())
     {
-      if (i->name == name)
-        {
-          NS_ASSERT (j <= 0xffff);
-          return j;
-        }
-      j++;
+      return 0;
     }
-  return 0;
+  return i->second;
 }
 std::string 
 IidManager::GetName (uint16_t uid) const
@@ -20,6 +20,7 @@
 #include "point-to-point-net-device.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/packet.h"
+#include "ns3/node.h"
 #include "ns3/simulator.h"
 #include "ns3/log.h"
 
@@ -93,9 +94,17 @@ PointToPointChannel::TransmitStart(
 
   uint32_t wire = src == m_link[0].m_src ? 0 : 1;
 
-  Simulator::ScheduleWithContext (m_link[wire].m_dst->GetNode ()->GetId (),
+  Ptr<Node> dstNode = m_link[wire].m_dst->GetNode ();
+  Ptr<Packet> rx = p;
+  if (dstNode->GetSystemId () != src->GetNode ()->GetSystemId ())
+    {
+      // the receiver might be run by another thread of the
+      // multithreaded simulator.
+      rx = p->DeepCopy ();
+    }
+  Simulator::ScheduleWithContext (dstNode->GetId (),
                                   txTime + m_delay, &PointToPointNetDevice::Receive,
-                                  m_link[wire].m_dst, p);
+                                  m_link[wire].m_dst, rx);
 
   // Call the tx anim callback on the net device
   m_txrxPointToPoint (p, src, m_link[wire].m_dst, txTime, txTime + m_delay);
@@ -25,6 +25,8 @@
 #include "ns3/trace-source-accessor.h"
 #include "ns3/uinteger.h"
 #include "ns3/pointer.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/node.h"
 #include "point-to-point-net-device.h"
 #include "point-to-point-channel.h"
 #include "ppp-header.h"
@@ -177,6 +179,34 @@ PointToPointNetDevice::ProcessHeader(Ptr<Packet> p, uint16_t& param)
   return true;
 }
 
+  bool
+PointToPointNetDevice::MarkEcn (Ptr<Packet> p)
+{
+  NS_LOG_FUNCTION (p);
+  PppHeader ppp;
+  p->PeekHeader (ppp);
+  if (ppp.GetProtocol () != EtherToPpp (0x0800))
+    {
+      return false;
+    }
+  p->RemoveHeader (ppp);
+  Ipv4Header ipHeader;
+  p->RemoveHeader (ipHeader);
+  bool marked = false;
+  if (ipHeader.GetEcn () != Ipv4Header::ECN_NotECT)
+    {
+      ipHeader.SetEcn (Ipv4Header::ECN_CE);
+      marked = true;
+    }
+  if (Node::ChecksumEnabled ())
+    {
+      ipHeader.EnableChecksum ();
+    }
+  p->AddHeader (ipHeader);
+  p->AddHeader (ppp);
+  return marked;
+}
+
   void 
 PointToPointNetDevice::DoDispose()
 {
@@ -291,6 +321,7 @@ PointToPointNetDevice::SetQueue (Ptr<Queue> q)
 {
   NS_LOG_FUNCTION (this << q);
   m_queue = q;
+  m_queue->SetMarkCallback (MakeCallback (&PointToPointNetDevice::MarkEcn));
 }
 
   void
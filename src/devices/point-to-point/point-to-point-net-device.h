@@ -209,6 +209,15 @@ private:
    */
   bool ProcessHeader(Ptr<Packet> p, uint16_t& param);
 
+  /**
+   * Set the ECN Congestion Experienced codepoint of a queued frame.  This
+   * is installed as the mark callback of the transmit queue.
+   * \param p a frame carrying a PPP header
+   * \return true if the frame holds an ECN-capable IPv4 packet, which is
+   * now marked; false otherwise
+   */
+  static bool MarkEcn (Ptr<Packet> p);
+
   /**
    * Start Sending a Packet Down the Wire.
    *
@@ -64,20 +64,16 @@ PointToPointRemoteChannel::TransmitStart (
 
   IsInitialized ();
 
+#ifdef NS3_MPI
   uint32_t wire = src == GetSource (0) ? 0 : 1;
   Ptr<PointToPointNetDevice> dst = GetDestination (wire);
 
   // Calculate the rxTime (absolute)
-  std::cout << "FODEU" << std::endl;
-  exit(-1);
-  /*
   Time rxTime = Simulator::Now () + txTime + GetDelay ();
-#ifdef NS3_MPI
   MpiInterface::SendPacket (p, rxTime, dst->GetNode ()->GetId (), dst->GetIfIndex ());
 #else
   NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
 #endif
-  */
   return true;
 }
 
@@ -32,12 +32,28 @@ namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (WifiMacQueue);
 
+WifiMacQueue::Item::Item ()
+{}
+
 WifiMacQueue::Item::Item (Ptr<const Packet> packet, 
                           const WifiMacHeader &hdr, 
                           Time tstamp)
   : packet (packet), hdr (hdr), tstamp (tstamp)
 {}
 
+struct WifiMacQueue::IsExpired
+{
+  IsExpired (Time now, Time maxDelay)
+    : now (now), maxDelay (maxDelay)
+  {}
+  bool operator () (const struct Item &item) const
+  {
+    return item.tstamp + maxDelay <= now;
+  }
+  Time now;
+  Time maxDelay;
+};
+
 TypeId 
 WifiMacQueue::GetTypeId (void)
 {
@@ -57,7 +73,6 @@ WifiMacQueue::GetTypeId (void)
 }
 
 WifiMacQueue::WifiMacQueue ()
-  : m_size (0)
 {}
 
 WifiMacQueue::~WifiMacQueue ()
@@ -93,49 +108,33 @@ void
 WifiMacQueue::Enqueue (Ptr<const Packet> packet, const WifiMacHeader &hdr)
 {
   Cleanup ();
-  if (m_size == m_maxSize) 
+  if (m_queue.GetNPackets () == m_maxSize) 
     {
       return;
     }
   Time now = Simulator::Now ();
-  m_queue.push_back (Item (packet, hdr, now));
-  m_size++;
+  m_queue.PushBack (Item (packet, hdr, now));
 }
 
 void
 WifiMacQueue::Cleanup (void)
 {
-  if (m_queue.empty ()) 
+  if (m_queue.IsEmpty ()) 
     {
       return;
     }
 
-  Time now = Simulator::Now ();
-  uint32_t n = 0;
-  for (PacketQueueI i = m_queue.begin (); i != m_queue.end ();) 
-    {
-      if (i->tstamp + m_maxDelay > now) 
-        {
-          i++;
-        }
-      else
-        {
-          i = m_queue.erase (i);
-          n++;
-        }
-    }
-  m_size -= n;
+  m_queue.RemoveIf (IsExpired (Simulator::Now (), m_maxDelay));
 }
 
 Ptr<const Packet>
 WifiMacQueue::Dequeue (WifiMacHeader *hdr)
 {
   Cleanup ();
-  if (!m_queue.empty ()) 
+  if (!m_queue.IsEmpty ()) 
     {
-      Item i = m_queue.front ();
-      m_queue.pop_front ();
-      m_size--;
+      Item i = m_queue.Front ();
+      m_queue.PopFront ();
       *hdr = i.hdr;
       return i.packet;
     }
@@ -146,9 +145,9 @@ Ptr<const Packet>
 WifiMacQueue::Peek (WifiMacHeader *hdr)
 {
   Cleanup ();
-  if (!m_queue.empty ()) 
+  if (!m_queue.IsEmpty ()) 
     {
-      Item i = m_queue.front ();
+      const Item &i = m_queue.Front ();
       *hdr = i.hdr;
       return i.packet;
     }
@@ -161,21 +160,20 @@ WifiMacQueue::DequeueByTidAndAddress (WifiMacHeader *hdr, uint8_t tid,
 {
   Cleanup ();
   Ptr<const Packet> packet = 0;
-  if (!m_queue.empty ())
+  if (!m_queue.IsEmpty ())
     {
-      PacketQueueI it;
       NS_ASSERT (type <= 4);
-      for (it = m_queue.begin (); it != m_queue.end (); ++it)
+      for (uint32_t i = 0; i < m_queue.GetNPackets (); ++i)
         {
-          if (it->hdr.IsQosData ())
+          const Item &it = m_queue.Get (i);
+          if (it.hdr.IsQosData ())
             {
               if (GetAddressForPacket (type, it) == dest &&
-                  it->hdr.GetQosTid () == tid)
+                  it.hdr.GetQosTid () == tid)
                 {
-                  packet = it->packet;
-                  *hdr = it->hdr;
-                  m_queue.erase (it);
-                  m_size--;
+                  packet = it.packet;
+                  *hdr = it.hdr;
+                  m_queue.Remove (i);
                   break;
                 }
             }
@@ -189,19 +187,19 @@ WifiMacQueue::PeekByTidAndAddress (WifiMacHeader *hdr, uint8_t tid,
                                    WifiMacHeader::AddressType type, Mac48Address dest)
 {
   Cleanup ();
-  if (!m_queue.empty ())
+  if (!m_queue.IsEmpty ())
     {
-      PacketQueueI it;
       NS_ASSERT (type <= 4);
-      for (it = m_queue.begin (); it != m_queue.end (); ++it)
+      for (uint32_t i = 0; i < m_queue.GetNPackets (); ++i)
         {
-          if (it->hdr.IsQosData ())
+          const Item &it = m_queue.Get (i);
+          if (it.hdr.IsQosData ())
             {
               if (GetAddressForPacket (type, it) == dest &&
-                  it->hdr.GetQosTid () == tid)
+                  it.hdr.GetQosTid () == tid)
                 {
-                  *hdr = it->hdr;
-                  return it->packet;
+                  *hdr = it.hdr;
+                  return it.packet;
                 }
             }
         }
@@ -213,36 +211,35 @@ bool
 WifiMacQueue::IsEmpty (void)
 {
   Cleanup ();
-  return m_queue.empty ();
+  return m_queue.IsEmpty ();
 }
 
 uint32_t
 WifiMacQueue::GetSize (void)
 {
-  return m_size;
+  return m_queue.GetNPackets ();
 }
 
 void
 WifiMacQueue::Flush (void)
 {
-  m_queue.erase (m_queue.begin (), m_queue.end ());
-  m_size = 0;
+  m_queue.Clear ();
 }
 
 Mac48Address
-WifiMacQueue::GetAddressForPacket (enum WifiMacHeader::AddressType type, PacketQueueI it)
+WifiMacQueue::GetAddressForPacket (enum WifiMacHeader::AddressType type, const struct Item &it)
 {
   if (type == WifiMacHeader::ADDR1)
     {
-      return it->hdr.GetAddr1 ();
+      return it.hdr.GetAddr1 ();
     }
   if (type == WifiMacHeader::ADDR2)
     {
-      return it->hdr.GetAddr2 ();
+      return it.hdr.GetAddr2 ();
     }
   if (type == WifiMacHeader::ADDR3)
     {
-      return it->hdr.GetAddr3 ();
+      return it.hdr.GetAddr3 ();
     }
   return 0;
 }
@@ -250,13 +247,11 @@ WifiMacQueue::GetAddressForPacket (enum WifiMacHeader::AddressType type, PacketQ
 bool
 WifiMacQueue::Remove (Ptr<const Packet> packet)
 {
-  PacketQueueI it = m_queue.begin ();
-  for (; it != m_queue.end (); it++)
+  for (uint32_t i = 0; i < m_queue.GetNPackets (); i++)
     {
-      if (it->packet == packet)
+      if (m_queue.Get (i).packet == packet)
         {
-          m_queue.erase (it);
-          m_size--;
+          m_queue.Remove (i);
           return true;
         }
     }
@@ -267,13 +262,12 @@ void
 WifiMacQueue::PushFront (Ptr<const Packet> packet, const WifiMacHeader &hdr)
 {
   Cleanup ();
-  if (m_size == m_maxSize)
+  if (m_queue.GetNPackets () == m_maxSize)
     {
       return;
     }
   Time now = Simulator::Now ();
-  m_queue.push_front (Item (packet, hdr, now));
-  m_size++;
+  m_queue.PushFront (Item (packet, hdr, now));
 }
 
 uint32_t
@@ -282,15 +276,15 @@ WifiMacQueue::GetNPacketsByTidAndAddress (uint8_t tid, WifiMacHeader::AddressTyp
 {
   Cleanup ();
   uint32_t nPackets = 0;
-  if (!m_queue.empty ())
+  if (!m_queue.IsEmpty ())
     {
-      PacketQueueI it;
       NS_ASSERT (type <= 4);
-      for (it = m_queue.begin (); it != m_queue.end (); it++)
+      for (uint32_t i = 0; i < m_queue.GetNPackets (); i++)
         {
+          const Item &it = m_queue.Get (i);
           if (GetAddressForPacket (type, it) == addr)
             {
-              if (it->hdr.IsQosData () && it->hdr.GetQosTid () == tid)
+              if (it.hdr.IsQosData () && it.hdr.GetQosTid () == tid)
                 {
                   nPackets++;
                 }
@@ -306,16 +300,16 @@ WifiMacQueue::DequeueFirstAvailable (WifiMacHeader *hdr, Time &timestamp,
 {
   Cleanup ();
   Ptr<const Packet> packet = 0;
-  for (PacketQueueI it = m_queue.begin (); it != m_queue.end (); it++)
+  for (uint32_t i = 0; i < m_queue.GetNPackets (); i++)
     {
-      if (!it->hdr.IsQosData () ||
-          !blockedPackets->IsBlocked (it->hdr.GetAddr1 (), it->hdr.GetQosTid ()))
+      const Item &it = m_queue.Get (i);
+      if (!it.hdr.IsQosData () ||
+          !blockedPackets->IsBlocked (it.hdr.GetAddr1 (), it.hdr.GetQosTid ()))
         {
-          *hdr = it->hdr;
-          timestamp = it->tstamp;
-          packet = it->packet;
-          m_queue.erase (it);
-          m_size--;
+          *hdr = it.hdr;
+          timestamp = it.tstamp;
+          packet = it.packet;
+          m_queue.Remove (i);
           return packet;
         }
     }
@@ -327,14 +321,15 @@ WifiMacQueue::PeekFirstAvailable (WifiMacHeader *hdr, Time &timestamp,
                                   const QosBlockedDestinations *blockedPackets)
 {
   Cleanup ();
-  for (PacketQueueI it = m_queue.begin (); it != m_queue.end (); it++)
+  for (uint32_t i = 0; i < m_queue.GetNPackets (); i++)
     {
-      if (!it->hdr.IsQosData () ||
-          !blockedPackets->IsBlocked (it->hdr.GetAddr1 (), it->hdr.GetQosTid ()))
+      const Item &it = m_queue.Get (i);
+      if (!it.hdr.IsQosData () ||
+          !blockedPackets->IsBlocked (it.hdr.GetAddr1 (), it.hdr.GetQosTid ()))
         {
-          *hdr = it->hdr;
-          timestamp = it->tstamp;
-          return it->packet;
+          *hdr = it.hdr;
+          timestamp = it.tstamp;
+          return it.packet;
         }
     }
   return 0;
@@ -22,11 +22,11 @@
 #ifndef WIFI_MAC_QUEUE_H
 #define WIFI_MAC_QUEUE_H
 
-#include <list>
 #include <utility>
 #include "ns3/packet.h"
 #include "ns3/nstime.h"
 #include "ns3/object.h"
+#include "ns3/packet-ring-buffer.h"
 #include "wifi-mac-header.h"
 
 namespace ns3 {
@@ -122,15 +122,15 @@ public:
   uint32_t GetSize (void);
 private:
   struct Item;
-  
-  typedef std::list<struct Item> PacketQueue;
-  typedef std::list<struct Item>::reverse_iterator PacketQueueRI;
-  typedef std::list<struct Item>::iterator PacketQueueI;
-  
+  struct IsExpired;
+
+  typedef PacketRingBuffer<struct Item> PacketQueue;
+
   void Cleanup (void);
-  Mac48Address GetAddressForPacket (enum WifiMacHeader::AddressType type, PacketQueueI);
-  
+  Mac48Address GetAddressForPacket (enum WifiMacHeader::AddressType type, const struct Item &item);
+
   struct Item {
+    Item ();
     Item (Ptr<const Packet> packet, 
           const WifiMacHeader &hdr, 
           Time tstamp);
@@ -141,7 +141,6 @@ private:
 
   PacketQueue m_queue;
   WifiMacParameters *m_parameters;
-  uint32_t m_size;
   uint32_t m_maxSize;
   Time m_maxDelay;
 };
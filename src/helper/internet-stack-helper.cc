@@ -620,7 +620,7 @@ Ipv4L3ProtocolDropSinkWithoutContext (
 static void
 Ipv4L3ProtocolDropSinkWithContext (
   Ptr<OutputStreamWrapper> stream,
-  std::string context,
+  TraceContext context,
   Ipv4Header const &header, 
   Ptr<const Packet> packet,
   Ipv4L3Protocol::DropReason reason, 
@@ -815,7 +815,7 @@ Ipv6L3ProtocolDropSinkWithoutContext (
 static void
 Ipv6L3ProtocolDropSinkWithContext (
   Ptr<OutputStreamWrapper> stream,
-  std::string context,
+  TraceContext context,
   Ipv6Header const &header, 
   Ptr<const Packet> packet,
   Ipv6L3Protocol::DropReason reason, 
@@ -28,6 +28,8 @@
 #include "ns3/names.h"
 #include "ns3/net-device.h"
 #include "ns3/pcap-file-wrapper.h"
+#include "ns3/pointer.h"
+#include "ns3/queue.h"
 
 #include "trace-helper.h"
 
@@ -307,7 +309,7 @@ AsciiTraceHelper::DefaultEnqueueSinkWithoutContext (Ptr<OutputStreamWrapper> str
 }
 
 void
-AsciiTraceHelper::DefaultEnqueueSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, Ptr<const Packet> p)
+AsciiTraceHelper::DefaultEnqueueSinkWithContext (Ptr<OutputStreamWrapper> stream, TraceContext context, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
   *stream->GetStream () << "+ " << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
@@ -333,7 +335,7 @@ AsciiTraceHelper::DefaultDropSinkWithoutContext (Ptr<OutputStreamWrapper> stream
 }
 
 void
-AsciiTraceHelper::DefaultDropSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, Ptr<const Packet> p)
+AsciiTraceHelper::DefaultDropSinkWithContext (Ptr<OutputStreamWrapper> stream, TraceContext context, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
   *stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
@@ -360,7 +362,7 @@ AsciiTraceHelper::DefaultDequeueSinkWithoutContext (Ptr<OutputStreamWrapper> str
 }
 
 void
-AsciiTraceHelper::DefaultDequeueSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, Ptr<const Packet> p)
+AsciiTraceHelper::DefaultDequeueSinkWithContext (Ptr<OutputStreamWrapper> stream, TraceContext context, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
   *stream->GetStream () << "- " << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
@@ -384,12 +386,126 @@ AsciiTraceHelper::DefaultReceiveSinkWithoutContext (Ptr<OutputStreamWrapper> str
 }
 
 void
-AsciiTraceHelper::DefaultReceiveSinkWithContext (Ptr<OutputStreamWrapper> stream, std::string context, Ptr<const Packet> p)
+AsciiTraceHelper::DefaultReceiveSinkWithContext (Ptr<OutputStreamWrapper> stream, TraceContext context, Ptr<const Packet> p)
 {
   NS_LOG_FUNCTION (stream << p);
   *stream->GetStream () << "r " << Simulator::Now ().GetSeconds () << " " << context << " " << *p << std::endl;
 }
 
+BinaryTraceSink::BinaryTraceSink (Ptr<BinaryTraceFile> file, std::string context, uint32_t node, uint32_t device,
+                                  enum BinaryTraceFile::EventType event)
+  : m_file (file),
+    m_context (file->AddContext (context)),
+    m_node (node),
+    m_device (device),
+    m_event (event)
+{
+}
+
+BinaryTraceHelper::BinaryTraceHelper ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+BinaryTraceHelper::~BinaryTraceHelper ()
+{
+  NS_LOG_FUNCTION_NOARGS ();
+}
+
+Ptr<BinaryTraceFile>
+BinaryTraceHelper::CreateFile (std::string filename, uint32_t packetBytes)
+{
+  NS_LOG_FUNCTION (filename << packetBytes);
+
+  //
+  // As with the ascii trace files, the file is kept alive by the sinks
+  // bound to it, and closed when the last of them is destroyed.
+  //
+  Ptr<BinaryTraceFile> file = Create<BinaryTraceFile> (filename, packetBytes);
+  NS_ABORT_MSG_IF (file->Fail (), "Unable to Open " << filename);
+  return file;
+}
+
+bool
+BinaryTraceHelper::HookDefaultSink (
+  Ptr<Object> object, 
+  std::string traceName, 
+  Ptr<BinaryTraceFile> file,
+  enum BinaryTraceFile::EventType event, 
+  std::string context, 
+  Ptr<NetDevice> device)
+{
+  NS_LOG_FUNCTION (object << traceName << file << event << context << device);
+  Ptr<BinaryTraceSink> sink = Create<BinaryTraceSink> (file, context, device->GetNode ()->GetId (),
+                                                       device->GetIfIndex (), event);
+  return object->TraceConnectWithoutContext (traceName, MakeBoundCallback (&DefaultSink, sink));
+}
+
+void
+BinaryTraceHelper::Enable (Ptr<BinaryTraceFile> file, Ptr<NetDevice> nd)
+{
+  NS_LOG_FUNCTION (file << nd);
+  std::ostringstream oss;
+  oss << "/NodeList/" << nd->GetNode ()->GetId () << "/DeviceList/" << nd->GetIfIndex ()
+      << "/$" << nd->GetInstanceTypeId ().GetName () << "/";
+  std::string path = oss.str ();
+
+  HookDefaultSink (nd, "MacRx", file, BinaryTraceFile::RECEIVE, path + "MacRx", nd);
+  HookDefaultSink (nd, "PhyRxDrop", file, BinaryTraceFile::DROP, path + "PhyRxDrop", nd);
+
+  PointerValue ptr;
+  if (nd->GetAttributeFailSafe ("TxQueue", ptr))
+    {
+      Ptr<Queue> queue = ptr.Get<Queue> ();
+      if (queue != 0)
+        {
+          HookDefaultSink (queue, "Enqueue", file, BinaryTraceFile::ENQUEUE, path + "TxQueue/Enqueue", nd);
+          HookDefaultSink (queue, "Dequeue", file, BinaryTraceFile::DEQUEUE, path + "TxQueue/Dequeue", nd);
+          HookDefaultSink (queue, "Drop", file, BinaryTraceFile::DROP, path + "TxQueue/Drop", nd);
+        }
+    }
+}
+
+void
+BinaryTraceHelper::Enable (Ptr<BinaryTraceFile> file, NetDeviceContainer d)
+{
+  for (NetDeviceContainer::Iterator i = d.Begin (); i != d.End (); ++i)
+    {
+      Enable (file, *i);
+    }
+}
+
+void
+BinaryTraceHelper::Enable (Ptr<BinaryTraceFile> file, NodeContainer n)
+{
+  for (NodeContainer::Iterator i = n.Begin (); i != n.End (); ++i)
+    {
+      Ptr<Node> node = *i;
+      for (uint32_t j = 0; j < node->GetNDevices (); ++j)
+        {
+          Enable (file, node->GetDevice (j));
+        }
+    }
+}
+
+void
+BinaryTraceHelper::EnableAll (Ptr<BinaryTraceFile> file)
+{
+  Enable (file, NodeContainer::GetGlobal ());
+}
+
+//
+// The default binary trace sink.  Unlike the ascii sinks, it does not
+// format the packet: the columns which do not depend on the packet come
+// from the sink object bound to the callback.
+//
+void
+BinaryTraceHelper::DefaultSink (Ptr<BinaryTraceSink> sink, Ptr<const Packet> p)
+{
+  NS_LOG_FUNCTION (sink << p);
+  sink->m_file->Write (Simulator::Now (), sink->m_context, sink->m_node, sink->m_device, sink->m_event, p);
+}
+
 void 
 PcapHelperForDevice::EnablePcap (std::string prefix, Ptr<NetDevice> nd, bool promiscuous, bool explicitFilename)
 {
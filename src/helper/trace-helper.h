@@ -25,8 +25,10 @@
 #include "ns3/ipv6-interface-container.h"
 #include "ns3/node-container.h"
 #include "ns3/simulator.h"
+#include "ns3/trace-context.h"
 #include "ns3/pcap-file-wrapper.h"
 #include "ns3/output-stream-wrapper.h"
+#include "ns3/binary-trace-file.h"
 #include "ns3/ipv4.h"
 #include "ns3/ipv6.h"
 
@@ -220,16 +222,16 @@ public:
                                           std::string context, std::string traceName, Ptr<OutputStreamWrapper> stream);
 
   static void DefaultEnqueueSinkWithoutContext (Ptr<OutputStreamWrapper> file, Ptr<const Packet> p);
-  static void DefaultEnqueueSinkWithContext (Ptr<OutputStreamWrapper> file, std::string context, Ptr<const Packet> p);
+  static void DefaultEnqueueSinkWithContext (Ptr<OutputStreamWrapper> file, TraceContext context, Ptr<const Packet> p);
 
   static void DefaultDropSinkWithoutContext (Ptr<OutputStreamWrapper> file, Ptr<const Packet> p);
-  static void DefaultDropSinkWithContext (Ptr<OutputStreamWrapper> file, std::string context, Ptr<const Packet> p);
+  static void DefaultDropSinkWithContext (Ptr<OutputStreamWrapper> file, TraceContext context, Ptr<const Packet> p);
 
   static void DefaultDequeueSinkWithoutContext (Ptr<OutputStreamWrapper> file, Ptr<const Packet> p);
-  static void DefaultDequeueSinkWithContext (Ptr<OutputStreamWrapper> file, std::string context, Ptr<const Packet> p);
+  static void DefaultDequeueSinkWithContext (Ptr<OutputStreamWrapper> file, TraceContext context, Ptr<const Packet> p);
 
   static void DefaultReceiveSinkWithoutContext (Ptr<OutputStreamWrapper> file, Ptr<const Packet> p);
-  static void DefaultReceiveSinkWithContext (Ptr<OutputStreamWrapper> file, std::string context, Ptr<const Packet> p);
+  static void DefaultReceiveSinkWithContext (Ptr<OutputStreamWrapper> file, TraceContext context, Ptr<const Packet> p);
 };
 
 template <typename T> void
@@ -320,6 +322,99 @@ AsciiTraceHelper::HookDefaultReceiveSinkWithContext (
                  << tracename << "\"");
 }
 
+/**
+ * \brief Where the default binary trace sink records an event.
+ *
+ * The sinks of BinaryTraceHelper are bound to one of these objects, which
+ * holds the file and the columns which do not depend on the packet.
+ */
+class BinaryTraceSink : public SimpleRefCount<BinaryTraceSink>
+{
+public:
+  BinaryTraceSink (Ptr<BinaryTraceFile> file, std::string context, uint32_t node, uint32_t device,
+                   enum BinaryTraceFile::EventType event);
+
+  Ptr<BinaryTraceFile> m_file;
+  uint32_t m_context;
+  uint32_t m_node;
+  uint32_t m_device;
+  enum BinaryTraceFile::EventType m_event;
+};
+
+/**
+ * \brief Manage binary trace files for devices
+ *
+ * The binary trace files record the same enqueue, dequeue, drop and
+ * receive events as the ascii trace files, without formatting the
+ * packets: see BinaryTraceFile for the content of the records, and
+ * BinaryTraceReader to read them back or convert them to the ascii
+ * format.
+ */
+class BinaryTraceHelper
+{
+public:
+  /**
+   * @brief Create a binary trace helper.
+   */
+  BinaryTraceHelper ();
+
+  /**
+   * @brief Destroy a binary trace helper.
+   */
+  ~BinaryTraceHelper ();
+
+  /**
+   * @brief Create a binary trace file.
+   *
+   * \param filename name of the file
+   * \param packetBytes number of bytes of each packet to record, usually
+   *        enough to hold the headers of interest.
+   */
+  Ptr<BinaryTraceFile> CreateFile (std::string filename, uint32_t packetBytes = 0);
+
+  /**
+   * @brief Hook a trace source to the default binary trace sink.
+   *
+   * \param object object which holds the trace source
+   * \param traceName name of the trace source
+   * \param file file which records the events
+   * \param event type of the events reported by the trace source
+   * \param context context string recorded with the events
+   * \param device device which reports the events
+   * \return false if the object has no such trace source.
+   */
+  bool HookDefaultSink (Ptr<Object> object, std::string traceName, Ptr<BinaryTraceFile> file,
+                        enum BinaryTraceFile::EventType event, std::string context, Ptr<NetDevice> device);
+
+  /**
+   * @brief Record the events of a device.
+   *
+   * The "MacRx" and "PhyRxDrop" trace sources of the device and the
+   * "Enqueue", "Dequeue" and "Drop" trace sources of the queue held by its
+   * "TxQueue" attribute are hooked, if they exist.  The context of the
+   * events is the configuration path of the trace source, as in the ascii
+   * traces written through an OutputStreamWrapper.
+   */
+  void Enable (Ptr<BinaryTraceFile> file, Ptr<NetDevice> nd);
+
+  /**
+   * @brief Record the events of a set of devices.
+   */
+  void Enable (Ptr<BinaryTraceFile> file, NetDeviceContainer d);
+
+  /**
+   * @brief Record the events of all the devices of a set of nodes.
+   */
+  void Enable (Ptr<BinaryTraceFile> file, NodeContainer n);
+
+  /**
+   * @brief Record the events of all the devices of all the nodes.
+   */
+  void EnableAll (Ptr<BinaryTraceFile> file);
+
+  static void DefaultSink (Ptr<BinaryTraceSink> sink, Ptr<const Packet> p);
+};
+
 /**
  * \brief Base class providing common user-level pcap operations for helpers
  * representing net devices.
@@ -41,7 +41,7 @@ namespace ns3 {
 static void 
 AsciiPhyTransmitSinkWithContext (
   Ptr<OutputStreamWrapper> stream, 
-  std::string context, 
+  TraceContext context, 
   Ptr<const Packet> p,
   WifiMode mode, 
   WifiPreamble preamble,
@@ -66,7 +66,7 @@ AsciiPhyTransmitSinkWithoutContext (
 static void 
 AsciiPhyReceiveSinkWithContext (
   Ptr<OutputStreamWrapper> stream,
-  std::string context,
+  TraceContext context,
   Ptr<const Packet> p, 
   double snr, 
   WifiMode mode,
@@ -262,7 +262,6 @@ PcapSniffTxEvent (
       }
     case PcapHelper::DLT_IEEE802_11_RADIO:
       {
-        Ptr<Packet> p = packet->Copy ();
         RadiotapHeader header;
         uint8_t frameFlags = RadiotapHeader::FRAME_FLAG_NONE;
         header.SetTsft (Simulator::Now ().GetMicroSeconds ());
@@ -289,8 +288,9 @@ PcapSniffTxEvent (
               RadiotapHeader::CHANNEL_FLAG_SPECTRUM_5GHZ | RadiotapHeader::CHANNEL_FLAG_OFDM);
           }
 
-        p->AddHeader (header);
-        file->Write (Simulator::Now (), p);
+        // the header is written in front of the packet, without the deep
+        // copy of the packet that AddHeader would trigger.
+        file->Write (Simulator::Now (), header, packet);
         return;
       }
     default:
@@ -323,7 +323,6 @@ PcapSniffRxEvent (
       }
     case PcapHelper::DLT_IEEE802_11_RADIO:
       {
-        Ptr<Packet> p = packet->Copy ();
         RadiotapHeader header;
         uint8_t frameFlags = RadiotapHeader::FRAME_FLAG_NONE;
         header.SetTsft (Simulator::Now ().GetMicroSeconds ());
@@ -353,8 +352,9 @@ PcapSniffRxEvent (
         header.SetAntennaSignalPower (signalDbm);
         header.SetAntennaNoisePower (noiseDbm);
 
-        p->AddHeader (header);
-        file->Write (Simulator::Now (), p);
+        // the header is written in front of the packet, without the deep
+        // copy of the packet that AddHeader would trigger.
+        file->Write (Simulator::Now (), header, packet);
         return;
       }
     default:
@@ -0,0 +1,283 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+/**
+ * This is the test code for ipv4-end-point-demux.cc and
+ * ipv6-end-point-demux.cc.
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+
+#include "ipv4-end-point-demux.h"
+#include "ipv4-end-point.h"
+#include "ipv4-interface.h"
+#include "ipv6-end-point-demux.h"
+#include "ipv6-end-point.h"
+#include "ipv6-interface.h"
+#include "loopback-net-device.h"
+
+namespace ns3 {
+
+class Ipv4EndPointDemuxLookupTestCase : public TestCase
+{
+public:
+  Ipv4EndPointDemuxLookupTestCase ();
+private:
+  virtual bool DoRun (void);
+};
+
+Ipv4EndPointDemuxLookupTestCase::Ipv4EndPointDemuxLookupTestCase ()
+  : TestCase ("Check the precedence of IPv4 endpoint lookups")
+{
+}
+bool
+Ipv4EndPointDemuxLookupTestCase::DoRun (void)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<LoopbackNetDevice> device = CreateObject<LoopbackNetDevice> ();
+  node->AddDevice (device);
+  Ptr<Ipv4Interface> interface = CreateObject<Ipv4Interface> ();
+  interface->SetDevice (device);
+  interface->SetNode (node);
+  interface->AddAddress (Ipv4InterfaceAddress ("10.1.1.1", "255.255.255.0"));
+
+  Ipv4EndPointDemux demux;
+  Ipv4Address local ("10.1.1.1");
+  Ipv4Address peer ("10.1.1.2");
+  Ipv4EndPoint *wildcard = demux.Allocate (80);
+  Ipv4EndPoint *bound = demux.Allocate (local, 80);
+  Ipv4EndPoint *connected = demux.Allocate (local, 80, peer, 1234);
+  NS_TEST_ASSERT_MSG_EQ ((wildcard != 0 && bound != 0 && connected != 0), true, "Could not allocate the endpoints");
+  NS_TEST_ASSERT_MSG_EQ ((demux.Allocate (local, 80) == 0), true, "Allocated the same local address and port twice");
+
+  // the most exact match hides the others
+  Ipv4EndPointDemux::EndPoints found = demux.Lookup (local, 80, peer, 1234, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "Wrong number of exact matches");
+  NS_TEST_ASSERT_MSG_EQ (found.front (), connected, "The four-tuple did not match the connected endpoint");
+  found = demux.Lookup (local, 80, Ipv4Address ("10.1.1.3"), 1234, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "Wrong number of local matches");
+  NS_TEST_ASSERT_MSG_EQ (found.front (), bound, "Another peer did not match the bound endpoint");
+  found = demux.Lookup (Ipv4Address ("10.2.2.2"), 80, peer, 1234, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "Wrong number of wildcard matches");
+  NS_TEST_ASSERT_MSG_EQ (found.front (), wildcard, "Another address did not match the wildcard endpoint");
+  found = demux.Lookup (local, 81, peer, 1234, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.empty (), true, "Another port matched");
+  NS_TEST_ASSERT_MSG_EQ (demux.SimpleLookup (local, 80, peer, 1234), connected, "Wrong simple exact match");
+
+  // only the wildcard endpoint gets limited broadcasts, and both the
+  // wildcard and bound endpoints get the broadcasts on their subnet, in
+  // the order of their allocation
+  found = demux.Lookup (Ipv4Address::GetBroadcast (), 80, Ipv4Address ("10.1.1.3"), 1234, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "Wrong number of broadcast matches");
+  NS_TEST_ASSERT_MSG_EQ (found.front (), wildcard, "The broadcast did not match the wildcard endpoint");
+  found = demux.Lookup (Ipv4Address ("10.1.1.255"), 80, Ipv4Address ("10.1.1.3"), 1234, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 2, "Wrong number of subnet-directed broadcast matches");
+  NS_TEST_ASSERT_MSG_EQ (found.front (), wildcard, "The subnet-directed broadcast did not match the wildcard endpoint");
+  NS_TEST_ASSERT_MSG_EQ (found.back (), bound, "The subnet-directed broadcast did not match the bound endpoint");
+
+  demux.DeAllocate (connected);
+  found = demux.Lookup (local, 80, peer, 1234, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "Wrong number of matches after deallocation");
+  NS_TEST_ASSERT_MSG_EQ (found.front (), bound, "The deallocated endpoint still matched");
+  demux.DeAllocate (bound);
+  demux.DeAllocate (wildcard);
+  NS_TEST_ASSERT_MSG_EQ (demux.LookupPortLocal (80), false, "The port is still in use");
+
+  Simulator::Destroy ();
+  return GetErrorStatus ();
+}
+
+class Ipv4EndPointDemuxChangeTestCase : public TestCase
+{
+public:
+  Ipv4EndPointDemuxChangeTestCase ();
+private:
+  virtual bool DoRun (void);
+};
+
+Ipv4EndPointDemuxChangeTestCase::Ipv4EndPointDemuxChangeTestCase ()
+  : TestCase ("Check that IPv4 endpoints are hashed again when they change")
+{
+}
+bool
+Ipv4EndPointDemuxChangeTestCase::DoRun (void)
+{
+  Ptr<Node> node = CreateObject<Node> ();
+  Ptr<LoopbackNetDevice> device = CreateObject<LoopbackNetDevice> ();
+  node->AddDevice (device);
+  Ptr<Ipv4Interface> interface = CreateObject<Ipv4Interface> ();
+  interface->SetDevice (device);
+  interface->SetNode (node);
+  interface->AddAddress (Ipv4InterfaceAddress ("10.1.1.1", "255.255.255.0"));
+
+  Ipv4EndPointDemux demux;
+  Ipv4Address local ("10.1.1.1");
+  Ipv4Address peer ("10.1.1.2");
+  Ipv4EndPoint *endPoint = demux.Allocate (90);
+  NS_TEST_ASSERT_MSG_EQ (demux.LookupLocal (Ipv4Address::GetAny (), 90), true, "The endpoint was not hashed");
+
+  // as a socket does on Bind
+  endPoint->SetLocalAddress (local);
+  NS_TEST_ASSERT_MSG_EQ (demux.LookupLocal (Ipv4Address::GetAny (), 90), false, "The old address is still hashed");
+  NS_TEST_ASSERT_MSG_EQ (demux.LookupLocal (local, 90), true, "The new address is not hashed");
+  Ipv4EndPointDemux::EndPoints found = demux.Lookup (local, 90, peer, 5000, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "The bound endpoint did not match");
+
+  // as a socket does on Connect
+  endPoint->SetPeer (peer, 5000);
+  found = demux.Lookup (local, 90, peer, 5000, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "The connected endpoint did not match");
+  NS_TEST_ASSERT_MSG_EQ (found.front (), endPoint, "The wrong endpoint matched");
+  NS_TEST_ASSERT_MSG_EQ (demux.SimpleLookup (local, 90, peer, 5000), endPoint, "Wrong simple exact match");
+  found = demux.Lookup (local, 90, peer, 5001, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.empty (), true, "The connected endpoint matched another peer");
+  NS_TEST_ASSERT_MSG_EQ ((demux.Allocate (local, 90, peer, 5000) == 0), true, "Allocated the four-tuple twice");
+
+  demux.DeAllocate (endPoint);
+  NS_TEST_ASSERT_MSG_EQ (demux.LookupPortLocal (90), false, "The port is still in use");
+  NS_TEST_ASSERT_MSG_EQ (demux.LookupLocal (local, 90), false, "The address is still in use");
+
+  Simulator::Destroy ();
+  return GetErrorStatus ();
+}
+
+class Ipv4EndPointDemuxEphemeralTestCase : public TestCase
+{
+public:
+  Ipv4EndPointDemuxEphemeralTestCase ();
+private:
+  virtual bool DoRun (void);
+};
+
+Ipv4EndPointDemuxEphemeralTestCase::Ipv4EndPointDemuxEphemeralTestCase ()
+  : TestCase ("Check the allocation of ephemeral ports")
+{
+}
+bool
+Ipv4EndPointDemuxEphemeralTestCase::DoRun (void)
+{
+  Ipv4EndPointDemux demux;
+  // ports bound explicitly are skipped, ports outside of the range are
+  // not taken from it
+  demux.Allocate (49200);
+  demux.Allocate (80);
+
+  Ipv4EndPoint *endPoint = demux.Allocate ();
+  NS_TEST_ASSERT_MSG_EQ (endPoint->GetLocalPort (), 49153, "Wrong first ephemeral port");
+  for (uint32_t port = 49154; port <= 65534; port++)
+    {
+      endPoint = demux.Allocate ();
+      NS_TEST_ASSERT_MSG_EQ ((endPoint != 0), true, "Ran out of ephemeral ports at " << port);
+      uint16_t expected = (port >= 49200) ? port + 1 : port;
+      if (port == 65534)
+        {
+          // past the last port, the allocation wraps around
+          expected = 49152;
+        }
+      NS_TEST_ASSERT_MSG_EQ (endPoint->GetLocalPort (), expected, "Wrong ephemeral port");
+    }
+  NS_TEST_ASSERT_MSG_EQ ((demux.Allocate () == 0), true, "Allocated more ephemeral ports than there are");
+  NS_TEST_ASSERT_MSG_EQ ((demux.Allocate (Ipv4Address ("10.1.1.1")) == 0), true, "Allocated more ephemeral ports than there are");
+
+  // a released port is the only free one
+  Ipv4EndPointDemux::EndPoints all = demux.GetAllEndPoints ();
+  for (Ipv4EndPointDemux::EndPointsI i = all.begin (); i != all.end (); i++)
+    {
+      if ((*i)->GetLocalPort () == 60000)
+        {
+          demux.DeAllocate (*i);
+        }
+    }
+  endPoint = demux.Allocate ();
+  NS_TEST_ASSERT_MSG_EQ ((endPoint != 0), true, "The released port was not reused");
+  NS_TEST_ASSERT_MSG_EQ (endPoint->GetLocalPort (), 60000, "Wrong reused port");
+  NS_TEST_ASSERT_MSG_EQ ((demux.Allocate () == 0), true, "Allocated more ephemeral ports than there are");
+  return GetErrorStatus ();
+}
+
+class Ipv6EndPointDemuxTestCase : public TestCase
+{
+public:
+  Ipv6EndPointDemuxTestCase ();
+private:
+  virtual bool DoRun (void);
+};
+
+Ipv6EndPointDemuxTestCase::Ipv6EndPointDemuxTestCase ()
+  : TestCase ("Check the IPv6 endpoint lookups")
+{
+}
+bool
+Ipv6EndPointDemuxTestCase::DoRun (void)
+{
+  Ipv6EndPointDemux demux;
+  Ipv6Address any = Ipv6Address::GetAny ();
+  Ipv6Address local ("2001:1::1");
+  Ipv6Address peer ("2001:1::2");
+  Ptr<Ipv6Interface> interface;
+  Ipv6EndPoint *wildcard = demux.Allocate (80);
+  Ipv6EndPoint *bound = demux.Allocate (local, 80);
+  Ipv6EndPoint *connected = demux.Allocate (local, 80, peer, 1234);
+  NS_TEST_ASSERT_MSG_EQ ((wildcard != 0 && bound != 0 && connected != 0), true, "Could not allocate the endpoints");
+
+  Ipv6EndPointDemux::EndPoints found = demux.Lookup (local, 80, peer, 1234, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "Wrong number of exact matches");
+  NS_TEST_ASSERT_MSG_EQ (found.front (), connected, "The four-tuple did not match the connected endpoint");
+  found = demux.Lookup (local, 80, Ipv6Address ("2001:1::3"), 1234, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "Wrong number of local matches");
+  NS_TEST_ASSERT_MSG_EQ (found.front (), bound, "Another peer did not match the bound endpoint");
+  found = demux.Lookup (Ipv6Address ("2001:2::1"), 80, peer, 1234, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "Wrong number of wildcard matches");
+  NS_TEST_ASSERT_MSG_EQ (found.front (), wildcard, "Another address did not match the wildcard endpoint");
+
+  // the endpoints are hashed again when their addresses or port change
+  Ipv6EndPoint *endPoint = demux.Allocate ();
+  uint16_t port = endPoint->GetLocalPort ();
+  NS_TEST_ASSERT_MSG_EQ (port, 49153, "Wrong first ephemeral port");
+  endPoint->SetLocalPort (90);
+  NS_TEST_ASSERT_MSG_EQ (demux.LookupPortLocal (port), false, "The old port is still hashed");
+  NS_TEST_ASSERT_MSG_EQ (demux.LookupPortLocal (90), true, "The new port is not hashed");
+  NS_TEST_ASSERT_MSG_EQ (demux.Allocate ()->GetLocalPort (), port, "The old port was not released");
+  endPoint->SetLocalAddress (local);
+  NS_TEST_ASSERT_MSG_EQ (demux.LookupLocal (any, 90), false, "The old address is still hashed");
+  NS_TEST_ASSERT_MSG_EQ (demux.LookupLocal (local, 90), true, "The new address is not hashed");
+  endPoint->SetPeer (peer, 5000);
+  found = demux.Lookup (local, 90, peer, 5000, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.size (), 1, "The connected endpoint did not match");
+  NS_TEST_ASSERT_MSG_EQ (found.front (), endPoint, "The wrong endpoint matched");
+  found = demux.Lookup (local, 90, peer, 5001, interface);
+  NS_TEST_ASSERT_MSG_EQ (found.empty (), true, "The connected endpoint matched another peer");
+
+  demux.DeAllocate (endPoint);
+  NS_TEST_ASSERT_MSG_EQ (demux.LookupPortLocal (90), false, "The port is still in use");
+  return GetErrorStatus ();
+}
+
+static class EndPointDemuxTestSuite : public TestSuite
+{
+public:
+  EndPointDemuxTestSuite ()
+    : TestSuite ("end-point-demux", UNIT)
+  {
+    AddTestCase (new Ipv4EndPointDemuxLookupTestCase ());
+    AddTestCase (new Ipv4EndPointDemuxChangeTestCase ());
+    AddTestCase (new Ipv4EndPointDemuxEphemeralTestCase ());
+    AddTestCase (new Ipv6EndPointDemuxTestCase ());
+  }
+} g_endPointDemuxTestSuite;
+
+} // namespace ns3
@@ -0,0 +1,113 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ephemeral-ports.h"
+#include <string.h>
+
+namespace ns3 {
+
+static const uint16_t FIRST_PORT = 49152;
+static const uint16_t LAST_PORT = 65534;
+
+EphemeralPorts::EphemeralPorts ()
+{
+  memset (m_used, 0, sizeof (m_used));
+  memset (m_full, 0, sizeof (m_full));
+  // The bit past LAST_PORT is never free
+  m_used[511] = 1u << 31;
+}
+
+void
+EphemeralPorts::Use (uint16_t port)
+{
+  if (port < FIRST_PORT || port > LAST_PORT)
+    {
+      return;
+    }
+  uint32_t index = port - FIRST_PORT;
+  m_used[index / 32] |= 1u << (index % 32);
+  if (m_used[index / 32] == 0xffffffff)
+    {
+      m_full[index / 1024] |= 1u << ((index / 32) % 32);
+    }
+}
+
+void
+EphemeralPorts::Release (uint16_t port)
+{
+  if (port < FIRST_PORT || port > LAST_PORT)
+    {
+      return;
+    }
+  uint32_t index = port - FIRST_PORT;
+  m_used[index / 32] &= ~(1u << (index % 32));
+  m_full[index / 1024] &= ~(1u << ((index / 32) % 32));
+}
+
+uint16_t
+EphemeralPorts::GetFree (void) const
+{
+  int32_t index = Find (1);
+  if (index < 0 && (m_used[0] & 1) == 0)
+    { // FIRST_PORT comes last
+      index = 0;
+    }
+  return (index < 0) ? 0 : FIRST_PORT + index;
+}
+
+// Index of the first free port at or above first, or -1
+int32_t
+EphemeralPorts::Find (uint32_t first) const
+{
+  for (uint32_t group = first / 1024; group < 16; group++)
+    {
+      uint32_t words = ~m_full[group];
+      if (group == first / 1024)
+        {
+          words &= ~0u << ((first / 32) % 32);
+        }
+      while (words != 0)
+        {
+          uint32_t word = group * 32 + LowestBit (words);
+          uint32_t ports = ~m_used[word];
+          if (word == first / 32)
+            {
+              ports &= ~0u << (first % 32);
+            }
+          if (ports != 0)
+            {
+              return word * 32 + LowestBit (ports);
+            }
+          // Only the word of first may have no free port left once masked
+          words &= words - 1;
+        }
+    }
+  return -1;
+}
+
+uint32_t
+EphemeralPorts::LowestBit (uint32_t word)
+{
+  uint32_t bit = 0;
+  while ((word & 1) == 0)
+    {
+      word >>= 1;
+      bit++;
+    }
+  return bit;
+}
+
+} // namespace ns3
@@ -0,0 +1,61 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef EPHEMERAL_PORTS_H
+#define EPHEMERAL_PORTS_H
+
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \brief The ephemeral ports in use in an endpoint demux
+ *
+ * One bit per port from 49152 to 65534, and one bit per full word of
+ * those, so that the first free port is found in a bounded number of
+ * steps however many ports are in use. Ports are handed out from 49153
+ * upward, then 49152, as the demuxes always did.
+ */
+class EphemeralPorts
+{
+public:
+  EphemeralPorts ();
+
+  /**
+   * \param port a port which the first endpoint just took; ignored
+   *        outside of the ephemeral range
+   */
+  void Use (uint16_t port);
+  /**
+   * \param port a port which the last endpoint just released
+   */
+  void Release (uint16_t port);
+  /**
+   * \return the first free ephemeral port, or 0 if all are in use
+   */
+  uint16_t GetFree (void) const;
+
+private:
+  int32_t Find (uint32_t first) const;
+  static uint32_t LowestBit (uint32_t word);
+
+  uint32_t m_used[512]; //< one bit per port, set if in use
+  uint32_t m_full[16];  //< one bit per word of m_used, set if all its ports are in use
+};
+
+} // namespace ns3
+
+#endif /* EPHEMERAL_PORTS_H */
@@ -26,8 +26,51 @@ namespace ns3{
 
 NS_LOG_COMPONENT_DEFINE ("Ipv4EndPointDemux");
 
+Ipv4EndPointDemux::Tuple::Tuple ()
+  : localPort (0),
+    peerPort (0)
+{
+}
+
+Ipv4EndPointDemux::Tuple::Tuple (Ipv4Address localAddress, uint16_t localPort,
+                                 Ipv4Address peerAddress, uint16_t peerPort)
+  : localAddress (localAddress),
+    localPort (localPort),
+    peerAddress (peerAddress),
+    peerPort (peerPort)
+{
+}
+
+bool
+Ipv4EndPointDemux::Tuple::operator == (const Tuple &other) const
+{
+  return localPort == other.localPort && peerPort == other.peerPort &&
+    localAddress == other.localAddress && peerAddress == other.peerAddress;
+}
+
+size_t
+Ipv4EndPointDemux::TupleHash::operator () (const Tuple &tuple) const
+{
+  size_t hash = tuple.localAddress.Get ();
+  hash = hash * 1000003 ^ tuple.localPort;
+  hash = hash * 1000003 ^ tuple.peerAddress.Get ();
+  hash = hash * 1000003 ^ tuple.peerPort;
+  return hash;
+}
+
+Ipv4EndPointDemux::AllocationOrder::AllocationOrder (const Positions &positions)
+  : positions (positions)
+{
+}
+
+bool
+Ipv4EndPointDemux::AllocationOrder::operator () (Ipv4EndPoint *a, Ipv4EndPoint *b) const
+{
+  return positions.find (a)->second.order < positions.find (b)->second.order;
+}
+
 Ipv4EndPointDemux::Ipv4EndPointDemux ()
-  : m_ephemeral (49152)
+  : m_nextOrder (0)
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
@@ -47,29 +90,14 @@ bool
 Ipv4EndPointDemux::LookupPortLocal (uint16_t port)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
-    {
-      if ((*i)->GetLocalPort  () == port) 
-        {
-          return true;
-        }
-    }
-  return false;
+  return m_ports.find (port) != m_ports.end ();
 }
 
 bool
 Ipv4EndPointDemux::LookupLocal (Ipv4Address addr, uint16_t port)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
-    {
-      if ((*i)->GetLocalPort () == port &&
-          (*i)->GetLocalAddress () == addr) 
-        {
-          return true;
-        }
-    }
-  return false;
+  return m_locals.find (Tuple (addr, port, Ipv4Address::GetAny (), 0)) != m_locals.end ();
 }
 
 Ipv4EndPoint *
@@ -83,9 +111,7 @@ Ipv4EndPointDemux::Allocate (void)
       return 0;
     }
   Ipv4EndPoint *endPoint = new Ipv4EndPoint (Ipv4Address::GetAny (), port);
-  m_endPoints.push_back (endPoint);
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
-  return endPoint;
+  return Insert (endPoint);
 }
 
 Ipv4EndPoint *
@@ -99,9 +125,7 @@ Ipv4EndPointDemux::Allocate (Ipv4Address address)
       return 0;
     }
   Ipv4EndPoint *endPoint = new Ipv4EndPoint (address, port);
-  m_endPoints.push_back (endPoint);
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
-  return endPoint;
+  return Insert (endPoint);
 }
 
 Ipv4EndPoint *
@@ -122,9 +146,7 @@ Ipv4EndPointDemux::Allocate (Ipv4Address address, uint16_t port)
       return 0;
     }
   Ipv4EndPoint *endPoint = new Ipv4EndPoint (address, port);
-  m_endPoints.push_back (endPoint);
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
-  return endPoint;
+  return Insert (endPoint);
 }
 
 Ipv4EndPoint *
@@ -132,40 +154,112 @@ Ipv4EndPointDemux::Allocate (Ipv4Address localAddress, uint16_t localPort,
 			     Ipv4Address peerAddress, uint16_t peerPort)
 {
   NS_LOG_FUNCTION (this << localAddress << localPort << peerAddress << peerPort);
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  if (m_tuples.find (Tuple (localAddress, localPort, peerAddress, peerPort)) != m_tuples.end ())
     {
-      if ((*i)->GetLocalPort () == localPort &&
-          (*i)->GetLocalAddress () == localAddress &&
-          (*i)->GetPeerPort () == peerPort &&
-          (*i)->GetPeerAddress () == peerAddress) 
-        {
-          NS_LOG_WARN ("No way we can allocate this end-point.");
-          /* no way we can allocate this end-point. */
-          return 0;
-        }
+      NS_LOG_WARN ("No way we can allocate this end-point.");
+      /* no way we can allocate this end-point. */
+      return 0;
     }
   Ipv4EndPoint *endPoint = new Ipv4EndPoint (localAddress, localPort);
   endPoint->SetPeer (peerAddress, peerPort);
-  m_endPoints.push_back (endPoint);
-
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
-
-  return endPoint;
+  return Insert (endPoint);
 }
 
 void 
 Ipv4EndPointDemux::DeAllocate (Ipv4EndPoint *endPoint)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  Positions::iterator i = m_positions.find (endPoint);
+  if (i != m_positions.end ())
+    {
+      Unindex (i->second);
+      m_endPoints.erase (i->second.all);
+      m_positions.erase (i);
+      delete endPoint;
+    }
+}
+
+Ipv4EndPoint *
+Ipv4EndPointDemux::Insert (Ipv4EndPoint *endPoint)
+{
+  Position position;
+  position.order = m_nextOrder++;
+  position.all = m_endPoints.insert (m_endPoints.end (), endPoint);
+  Index (endPoint, m_positions.insert (std::make_pair (endPoint, position)).first->second);
+  endPoint->SetChangeCallback (MakeCallback (&Ipv4EndPointDemux::Update, this));
+  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
+  return endPoint;
+}
+
+void
+Ipv4EndPointDemux::Index (Ipv4EndPoint *endPoint, Position &position)
+{
+  position.tuple = Tuple (endPoint->GetLocalAddress (), endPoint->GetLocalPort (),
+                          endPoint->GetPeerAddress (), endPoint->GetPeerPort ());
+  EndPoints &port = m_ports[position.tuple.localPort];
+  if (port.empty ())
+    {
+      m_ephemeral.Use (position.tuple.localPort);
+    }
+  position.port = InsertInOrder (port, endPoint, position.order);
+  EndPoints &full = m_tuples[position.tuple];
+  position.full = InsertInOrder (full, endPoint, position.order);
+  m_locals[Tuple (position.tuple.localAddress, position.tuple.localPort, Ipv4Address::GetAny (), 0)]++;
+}
+
+// The lists of the indexes keep the endpoints in allocation order, like
+// m_endPoints, even when an endpoint is hashed again after a change, so
+// that the lookups return them in the same order as a scan of the list.
+Ipv4EndPointDemux::EndPointsI
+Ipv4EndPointDemux::InsertInOrder (EndPoints &endPoints, Ipv4EndPoint *endPoint, uint64_t order)
+{
+  EndPointsI i = endPoints.end ();
+  while (i != endPoints.begin ())
     {
-      if (*i == endPoint)
+      EndPointsI previous = i;
+      previous--;
+      if (m_positions.find (*previous)->second.order < order)
         {
-          delete endPoint;
-          m_endPoints.erase (i);
           break;
         }
+      i = previous;
     }
+  return endPoints.insert (i, endPoint);
+}
+
+void
+Ipv4EndPointDemux::Unindex (Position &position)
+{
+  PortIndex::iterator port = m_ports.find (position.tuple.localPort);
+  port->second.erase (position.port);
+  if (port->second.empty ())
+    {
+      m_ports.erase (port);
+      m_ephemeral.Release (position.tuple.localPort);
+    }
+  TupleIndex::iterator full = m_tuples.find (position.tuple);
+  full->second.erase (position.full);
+  if (full->second.empty ())
+    {
+      m_tuples.erase (full);
+    }
+  LocalIndex::iterator local = m_locals.find (Tuple (position.tuple.localAddress, position.tuple.localPort,
+                                                     Ipv4Address::GetAny (), 0));
+  if (--local->second == 0)
+    {
+      m_locals.erase (local);
+    }
+}
+
+// The addresses of an endpoint changed, hash it again
+void
+Ipv4EndPointDemux::Update (Ipv4EndPoint *endPoint)
+{
+  NS_LOG_FUNCTION (this << endPoint);
+  Positions::iterator i = m_positions.find (endPoint);
+  NS_ASSERT (i != m_positions.end ());
+  Unindex (i->second);
+  Index (endPoint, i->second);
 }
 
 /*
@@ -175,17 +269,36 @@ Ipv4EndPointDemux::EndPoints
 Ipv4EndPointDemux::GetAllEndPoints (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  EndPoints ret;
+  return m_endPoints;
+}
 
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++)
-   {
+// Append the endpoints hashed with exactly this tuple which accept
+// packets from the incoming interface
+void
+Ipv4EndPointDemux::AddMatches (EndPoints &matches, Ipv4Address localAddress, uint16_t localPort,
+                               Ipv4Address peerAddress, uint16_t peerPort,
+                               Ptr<Ipv4Interface> incomingInterface)
+{
+  TupleIndex::iterator full = m_tuples.find (Tuple (localAddress, localPort, peerAddress, peerPort));
+  if (full == m_tuples.end ())
+    {
+      return;
+    }
+  for (EndPointsI i = full->second.begin (); i != full->second.end (); i++)
+    {
       Ipv4EndPoint* endP = *i;
-      ret.push_back(endP);
+      if (endP->GetBoundNetDevice () && endP->GetBoundNetDevice () != incomingInterface->GetDevice ())
+        {
+          NS_LOG_LOGIC ("Skipping endpoint " << &endP
+                        << " because endpoint is bound to specific device and"
+                        << endP->GetBoundNetDevice ()
+                        << " does not match packet device " << incomingInterface->GetDevice ());
+          continue;
+        }
+      matches.push_back (endP);
     }
-  return ret;
 }
 
-
 /*
  * If we have an exact match, we return it.
  * Otherwise, if we find a generic match, we return it.
@@ -196,115 +309,50 @@ Ipv4EndPointDemux::Lookup (Ipv4Address daddr, uint16_t dport,
                            Ipv4Address saddr, uint16_t sport,
                            Ptr<Ipv4Interface> incomingInterface)
 {
-  NS_LOG_FUNCTION_NOARGS ();
-  EndPoints retval1; // Matches exact on local port, wildcards on others
-  EndPoints retval2; // Matches exact on local port/adder, wildcards on others
-  EndPoints retval3; // Matches all but local address
-  EndPoints retval4; // Exact match on all 4
-  
   NS_LOG_FUNCTION (this << daddr << dport << saddr << sport << incomingInterface);
   NS_LOG_DEBUG ("Looking up endpoint for destination address " << daddr);
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
-    {
-      Ipv4EndPoint* endP = *i;
-      NS_LOG_DEBUG ("Looking at endpoint dport=" << endP->GetLocalPort ()
-                    << " daddr=" << endP->GetLocalAddress ()
-                    << " sport=" << endP->GetPeerPort ()
-                    << " saddr=" << endP->GetPeerAddress ());
-      if (endP->GetLocalPort () != dport) 
-        {
-          NS_LOG_LOGIC ("Skipping endpoint " << &endP
-                        << " because endpoint dport "
-                        << endP->GetLocalPort ()
-                        << " does not match packet dport " << dport);
-          continue;
-        }
-      if (endP->GetBoundNetDevice ())
-        {
-          if (endP->GetBoundNetDevice () != incomingInterface->GetDevice ())
-            {
-              NS_LOG_LOGIC ("Skipping endpoint " << &endP
-                            << " because endpoint is bound to specific device and"
-                            << endP->GetBoundNetDevice ()
-                            << " does not match packet device " << incomingInterface->GetDevice ());
-              continue;
-            }
-        }
-      bool subnetDirected = false;
-      Ipv4Address incomingInterfaceAddr = daddr;  // may be a broadcast
-      for (uint32_t i = 0; i < incomingInterface->GetNAddresses (); i++)
-        {
-          Ipv4InterfaceAddress addr = incomingInterface->GetAddress (i);
-          if (addr.GetLocal ().CombineMask (addr.GetMask ()) == daddr.CombineMask (addr.GetMask ()) &&
-            daddr.IsSubnetDirectedBroadcast (addr.GetMask ()))
-            {
-              subnetDirected = true;
-              incomingInterfaceAddr = addr.GetLocal ();
-            }
-        }
-      bool isBroadcast = (daddr.IsBroadcast () || subnetDirected == true);
-      NS_LOG_DEBUG ("dest addr " << daddr << " broadcast? " << isBroadcast);
-      bool localAddressMatchesWildCard = 
-        endP->GetLocalAddress() == Ipv4Address::GetAny();
-      bool localAddressMatchesExact = endP->GetLocalAddress () == daddr;
-
-      if (isBroadcast)
-        {
-          NS_LOG_DEBUG("Found bcast, localaddr " << endP->GetLocalAddress());
-        }
 
-      if (isBroadcast && (endP->GetLocalAddress() != Ipv4Address::GetAny()))
+  bool subnetDirected = false;
+  Ipv4Address incomingInterfaceAddr = daddr;  // may be a broadcast
+  for (uint32_t i = 0; i < incomingInterface->GetNAddresses (); i++)
+    {
+      Ipv4InterfaceAddress addr = incomingInterface->GetAddress (i);
+      if (addr.GetLocal ().CombineMask (addr.GetMask ()) == daddr.CombineMask (addr.GetMask ()) &&
+        daddr.IsSubnetDirectedBroadcast (addr.GetMask ()))
         {
-          localAddressMatchesExact = (endP->GetLocalAddress () ==
-                                      incomingInterfaceAddr);
-        }
-      // if no match here, keep looking
-      if (!(localAddressMatchesExact || localAddressMatchesWildCard))
-        continue; 
-      bool remotePeerMatchesExact = endP->GetPeerPort () == sport;
-      bool remotePeerMatchesWildCard = endP->GetPeerPort() == 0;
-      bool remoteAddressMatchesExact = endP->GetPeerAddress () == saddr;
-      bool remoteAddressMatchesWildCard = endP->GetPeerAddress () ==
-        Ipv4Address::GetAny();
-      // If remote does not match either with exact or wildcard,
-      // skip this one
-      if (!(remotePeerMatchesExact || remotePeerMatchesWildCard))
-        continue;
-      if (!(remoteAddressMatchesExact || remoteAddressMatchesWildCard))
-        continue;
-      
-      // Now figure out which return list to add this one to
-      if (localAddressMatchesWildCard &&
-          remotePeerMatchesWildCard &&
-          remoteAddressMatchesWildCard)
-        { // Only local port matches exactly
-          retval1.push_back(endP);
-        }
-      if ((localAddressMatchesExact || (isBroadcast && localAddressMatchesWildCard))&&
-          remotePeerMatchesWildCard &&
-           remoteAddressMatchesWildCard)
-        { // Only local port and local address matches exactly
-          retval2.push_back(endP);
-        }
-      if (localAddressMatchesWildCard &&
-          remotePeerMatchesExact &&
-          remoteAddressMatchesExact)
-        { // All but local address
-          retval3.push_back(endP);
-        }
-      if (localAddressMatchesExact &&
-          remotePeerMatchesExact &&
-          remoteAddressMatchesExact)
-        { // All 4 match
-          retval4.push_back(endP);
+          subnetDirected = true;
+          incomingInterfaceAddr = addr.GetLocal ();
         }
     }
+  bool isBroadcast = (daddr.IsBroadcast () || subnetDirected == true);
+  NS_LOG_DEBUG ("dest addr " << daddr << " broadcast? " << isBroadcast);
+  // The local address an endpoint must be bound to, to match exactly
+  Ipv4Address localAddr = isBroadcast ? incomingInterfaceAddr : daddr;
+  Ipv4Address any = Ipv4Address::GetAny ();
 
   // Here we find the most exact match
-  if (!retval4.empty()) return retval4;
-  if (!retval3.empty()) return retval3;
-  if (!retval2.empty()) return retval2;
-  return retval1;  // might be empty if no matches
+  EndPoints retval;
+  AddMatches (retval, localAddr, dport, saddr, sport, incomingInterface); // Exact match on all 4
+  if (retval.empty ())
+    { // Matches all but local address
+      AddMatches (retval, any, dport, saddr, sport, incomingInterface);
+    }
+  if (retval.empty ())
+    { // Matches exact on local port/adder, wildcards on others
+      AddMatches (retval, localAddr, dport, any, 0, incomingInterface);
+      if (isBroadcast && localAddr != any)
+        { // the wildcard endpoints get the broadcasts too, in the order
+          // in which all the endpoints were allocated
+          EndPoints wildcards;
+          AddMatches (wildcards, any, dport, any, 0, incomingInterface);
+          retval.merge (wildcards, AllocationOrder (m_positions));
+        }
+    }
+  if (retval.empty ())
+    { // Matches exact on local port, wildcards on others
+      AddMatches (retval, any, dport, any, 0, incomingInterface);
+    }
+  return retval;  // might be empty if no matches
 }
 
 Ipv4EndPoint *
@@ -315,21 +363,21 @@ Ipv4EndPointDemux::SimpleLookup (Ipv4Address daddr,
 {
   // this code is a copy/paste version of an old BSD ip stack lookup
   // function.
+  TupleIndex::iterator full = m_tuples.find (Tuple (daddr, dport, saddr, sport));
+  if (full != m_tuples.end ())
+    {
+      /* this is an exact match. */
+      return full->second.front ();
+    }
+  PortIndex::iterator port = m_ports.find (dport);
+  if (port == m_ports.end ())
+    {
+      return 0;
+    }
   uint32_t genericity = 3;
   Ipv4EndPoint *generic = 0;
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  for (EndPointsI i = port->second.begin (); i != port->second.end (); i++) 
     {
-      if ((*i)->GetLocalPort () != dport) 
-        {
-          continue;
-        }
-      if ((*i)->GetLocalAddress () == daddr &&
-          (*i)->GetPeerPort () == sport &&
-          (*i)->GetPeerAddress () == saddr) 
-        {
-          /* this is an exact match. */
-          return *i;
-        }
       uint32_t tmp = 0;
       if ((*i)->GetLocalAddress () == Ipv4Address::GetAny ()) 
         {
@@ -352,20 +400,7 @@ uint16_t
 Ipv4EndPointDemux::AllocateEphemeralPort (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  uint16_t port = m_ephemeral;
-  do 
-    {
-      port++;
-      if (port == 65535) 
-        {
-          port = 49152;
-        }
-      if (!LookupPortLocal (port)) 
-        {
-          return port;
-        }
-  } while (port != m_ephemeral);
-  return 0;
+  return m_ephemeral.GetFree ();
 }
 
 } //namespace ns3
@@ -23,8 +23,11 @@
 
 #include <stdint.h>
 #include <list>
+#include <map>
 #include "ns3/ipv4-address.h"
+#include "ns3/sgi-hashmap.h"
 #include "ipv4-interface.h"
+#include "ephemeral-ports.h"
 
 namespace ns3 {
 
@@ -38,6 +41,11 @@ class Ipv4EndPoint;
  * of endpoints, and has APIs to add and find endpoints in this demux.  This
  * code is shared in common to TCP and UDP protocols in ns3.  This demux
  * sits between ns3's layer four and the socket layer
+ *
+ * The endpoints are also hashed by local port, by local address and port,
+ * and by four-tuple, so that a lookup costs the same with one endpoint or
+ * with thousands of connections. The endpoints tell the demux when their
+ * addresses change, to be hashed again.
  */
 
 class Ipv4EndPointDemux {
@@ -76,8 +84,59 @@ public:
  private:
   uint16_t AllocateEphemeralPort (void);
 
-  uint16_t m_ephemeral;
+  // The addresses and ports an endpoint is hashed with
+  struct Tuple
+  {
+    Tuple ();
+    Tuple (Ipv4Address localAddress, uint16_t localPort,
+           Ipv4Address peerAddress, uint16_t peerPort);
+    bool operator == (const Tuple &other) const;
+    Ipv4Address localAddress;
+    uint16_t localPort;
+    Ipv4Address peerAddress;
+    uint16_t peerPort;
+  };
+  struct TupleHash
+  {
+    size_t operator () (const Tuple &tuple) const;
+  };
+  // Where an endpoint is in the lists, to remove it without a search
+  struct Position
+  {
+    Tuple tuple;
+    uint64_t order;   // rank of the allocation of the endpoint
+    EndPointsI all;
+    EndPointsI port;
+    EndPointsI full;
+  };
+  typedef sgi::hash_map<uint16_t, EndPoints> PortIndex;
+  typedef sgi::hash_map<Tuple, uint32_t, TupleHash> LocalIndex;
+  typedef sgi::hash_map<Tuple, EndPoints, TupleHash> TupleIndex;
+  typedef std::map<Ipv4EndPoint *, Position> Positions;
+  // Orders the endpoints as they were allocated
+  struct AllocationOrder
+  {
+    AllocationOrder (const Positions &positions);
+    bool operator () (Ipv4EndPoint *a, Ipv4EndPoint *b) const;
+    const Positions &positions;
+  };
+
+  Ipv4EndPoint *Insert (Ipv4EndPoint *endPoint);
+  void Index (Ipv4EndPoint *endPoint, Position &position);
+  void Unindex (Position &position);
+  EndPointsI InsertInOrder (EndPoints &endPoints, Ipv4EndPoint *endPoint, uint64_t order);
+  void Update (Ipv4EndPoint *endPoint);
+  void AddMatches (EndPoints &matches, Ipv4Address localAddress, uint16_t localPort,
+                   Ipv4Address peerAddress, uint16_t peerPort,
+                   Ptr<Ipv4Interface> incomingInterface);
+
+  EphemeralPorts m_ephemeral;
   EndPoints m_endPoints;
+  PortIndex m_ports;       // endpoints by local port
+  LocalIndex m_locals;     // number of endpoints by local address and port
+  TupleIndex m_tuples;     // endpoints by four-tuple
+  Positions m_positions;
+  uint64_t m_nextOrder;
 };
 
 } // namespace ns3
@@ -51,6 +51,10 @@ void
 Ipv4EndPoint::SetLocalAddress (Ipv4Address address)
 {
   m_localAddr = address;
+  if (!m_changeCallback.IsNull ())
+    {
+      m_changeCallback (this);
+    }
 }
 
 uint16_t 
@@ -73,6 +77,10 @@ Ipv4EndPoint::SetPeer (Ipv4Address address, uint16_t port)
 {
   m_peerAddr = address;
   m_peerPort = port;
+  if (!m_changeCallback.IsNull ())
+    {
+      m_changeCallback (this);
+    }
 }
 
 void
@@ -105,6 +113,12 @@ Ipv4EndPoint::SetDestroyCallback (Callback<void> callback)
   m_destroyCallback = callback;
 }
 
+void
+Ipv4EndPoint::SetChangeCallback (Callback<void,Ipv4EndPoint *> callback)
+{
+  m_changeCallback = callback;
+}
+
 void 
 Ipv4EndPoint::ForwardUp (Ptr<Packet> p, const Ipv4Header& header, uint16_t sport,
                          Ptr<Ipv4Interface> incomingInterface)
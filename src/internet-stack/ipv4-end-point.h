@@ -64,6 +64,9 @@ public:
   void SetRxCallback (Callback<void,Ptr<Packet>, Ipv4Header, uint16_t, Ptr<Ipv4Interface> > callback);
   void SetIcmpCallback (Callback<void,Ipv4Address,uint8_t,uint8_t,uint8_t,uint32_t> callback);
   void SetDestroyCallback (Callback<void> callback);
+  // Called from Ipv4EndPointDemux to be told when the addresses or ports
+  // change, so that it can index the endpoint again.
+  void SetChangeCallback (Callback<void,Ipv4EndPoint *> callback);
 
   // Called from an L4Protocol implementation to notify an endpoint of a
   // packet reception.
@@ -89,6 +92,7 @@ private:
   Callback<void,Ptr<Packet>, Ipv4Header, uint16_t, Ptr<Ipv4Interface> > m_rxCallback;
   Callback<void,Ipv4Address,uint8_t,uint8_t,uint8_t,uint32_t> m_icmpCallback;
   Callback<void> m_destroyCallback;
+  Callback<void,Ipv4EndPoint *> m_changeCallback;
 };
 
 }; // namespace ns3
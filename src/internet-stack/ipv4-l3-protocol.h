@@ -224,6 +224,7 @@ private:
             uint8_t protocol,
             uint16_t payloadSize,
             uint8_t ttl,
+            uint8_t tos,
             bool mayFragment);
 
   void
@@ -27,8 +27,37 @@ namespace ns3
 
 NS_LOG_COMPONENT_DEFINE ("Ipv6EndPointDemux");
 
+Ipv6EndPointDemux::Tuple::Tuple ()
+  : localPort (0),
+  peerPort (0)
+{
+}
+
+Ipv6EndPointDemux::Tuple::Tuple (Ipv6Address localAddress, uint16_t localPort, Ipv6Address peerAddress, uint16_t peerPort)
+  : localAddress (localAddress),
+  localPort (localPort),
+  peerAddress (peerAddress),
+  peerPort (peerPort)
+{
+}
+
+bool Ipv6EndPointDemux::Tuple::operator == (const Tuple &other) const
+{
+  return localPort == other.localPort && peerPort == other.peerPort &&
+         localAddress == other.localAddress && peerAddress == other.peerAddress;
+}
+
+size_t Ipv6EndPointDemux::TupleHash::operator () (const Tuple &tuple) const
+{
+  Ipv6AddressHash addressHash;
+  size_t hash = addressHash (tuple.localAddress);
+  hash = hash * 1000003 ^ tuple.localPort;
+  hash = hash * 1000003 ^ addressHash (tuple.peerAddress);
+  hash = hash * 1000003 ^ tuple.peerPort;
+  return hash;
+}
+
 Ipv6EndPointDemux::Ipv6EndPointDemux ()
-  : m_ephemeral (49152)
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
@@ -47,28 +76,13 @@ Ipv6EndPointDemux::~Ipv6EndPointDemux ()
 bool Ipv6EndPointDemux::LookupPortLocal (uint16_t port)
 {
   NS_LOG_FUNCTION (this << port);
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
-    {
-      if ((*i)->GetLocalPort  () == port) 
-        {
-          return true;
-        }
-    }
-  return false;
+  return m_ports.find (port) != m_ports.end ();
 }
 
 bool Ipv6EndPointDemux::LookupLocal (Ipv6Address addr, uint16_t port)
 {
   NS_LOG_FUNCTION (this << addr << port);
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
-    {
-      if ((*i)->GetLocalPort () == port &&
-          (*i)->GetLocalAddress () == addr) 
-        {
-          return true;
-        }
-    }
-  return false;
+  return m_locals.find (Tuple (addr, port, Ipv6Address::GetAny (), 0)) != m_locals.end ();
 }
 
 Ipv6EndPoint* Ipv6EndPointDemux::Allocate ()
@@ -81,9 +95,7 @@ Ipv6EndPoint* Ipv6EndPointDemux::Allocate ()
       return 0;
     }
   Ipv6EndPoint *endPoint = new Ipv6EndPoint (Ipv6Address::GetAny (), port);
-  m_endPoints.push_back (endPoint);
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
-  return endPoint;
+  return Insert (endPoint);
 }
 
 Ipv6EndPoint* Ipv6EndPointDemux::Allocate (Ipv6Address address)
@@ -96,9 +108,7 @@ Ipv6EndPoint* Ipv6EndPointDemux::Allocate (Ipv6Address address)
       return 0;
     }
   Ipv6EndPoint *endPoint = new Ipv6EndPoint (address, port);
-  m_endPoints.push_back (endPoint);
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
-  return endPoint;
+  return Insert (endPoint);
 }
 
 Ipv6EndPoint* Ipv6EndPointDemux::Allocate (uint16_t port)
@@ -117,47 +127,101 @@ Ipv6EndPoint* Ipv6EndPointDemux::Allocate (Ipv6Address address, uint16_t port)
       return 0;
     }
   Ipv6EndPoint *endPoint = new Ipv6EndPoint (address, port);
-  m_endPoints.push_back (endPoint);
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
-  return endPoint;
+  return Insert (endPoint);
 }
 
 Ipv6EndPoint* Ipv6EndPointDemux::Allocate (Ipv6Address localAddress, uint16_t localPort,
                                            Ipv6Address peerAddress, uint16_t peerPort)
 {
   NS_LOG_FUNCTION (this << localAddress << localPort << peerAddress << peerPort);
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  if (m_tuples.find (Tuple (localAddress, localPort, peerAddress, peerPort)) != m_tuples.end ())
     {
-      if ((*i)->GetLocalPort () == localPort &&
-          (*i)->GetLocalAddress () == localAddress &&
-          (*i)->GetPeerPort () == peerPort &&
-          (*i)->GetPeerAddress () == peerAddress) 
-        {
-          NS_LOG_WARN ("No way we can allocate this end-point.");
-          /* no way we can allocate this end-point. */
-          return 0;
-        }
+      NS_LOG_WARN ("No way we can allocate this end-point.");
+      /* no way we can allocate this end-point. */
+      return 0;
     }
   Ipv6EndPoint *endPoint = new Ipv6EndPoint (localAddress, localPort);
   endPoint->SetPeer (peerAddress, peerPort);
-  m_endPoints.push_back (endPoint);
+  return Insert (endPoint);
+}
 
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
+void Ipv6EndPointDemux::DeAllocate (Ipv6EndPoint *endPoint)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  Positions::iterator i = m_positions.find (endPoint);
+  if (i != m_positions.end ())
+    {
+      Unindex (i->second);
+      m_endPoints.erase (i->second.all);
+      m_positions.erase (i);
+      delete endPoint;
+    }
+}
 
+Ipv6EndPoint* Ipv6EndPointDemux::Insert (Ipv6EndPoint *endPoint)
+{
+  Position position;
+  position.all = m_endPoints.insert (m_endPoints.end (), endPoint);
+  Index (endPoint, m_positions.insert (std::make_pair (endPoint, position)).first->second);
+  endPoint->SetChangeCallback (MakeCallback (&Ipv6EndPointDemux::Update, this));
+  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
   return endPoint;
 }
 
-void Ipv6EndPointDemux::DeAllocate (Ipv6EndPoint *endPoint)
+void Ipv6EndPointDemux::Index (Ipv6EndPoint *endPoint, Position &position)
 {
-  NS_LOG_FUNCTION_NOARGS ();
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  position.tuple = Tuple (endPoint->GetLocalAddress (), endPoint->GetLocalPort (),
+                          endPoint->GetPeerAddress (), endPoint->GetPeerPort ());
+  EndPoints &port = m_ports[position.tuple.localPort];
+  if (port.empty ())
     {
-      if (*i == endPoint)
-        {
-          delete endPoint;
-          m_endPoints.erase (i);
-          break;
-        }
+      m_ephemeral.Use (position.tuple.localPort);
+    }
+  position.port = port.insert (port.end (), endPoint);
+  EndPoints &full = m_tuples[position.tuple];
+  position.full = full.insert (full.end (), endPoint);
+  m_locals[Tuple (position.tuple.localAddress, position.tuple.localPort, Ipv6Address::GetAny (), 0)]++;
+}
+
+void Ipv6EndPointDemux::Unindex (Position &position)
+{
+  PortIndex::iterator port = m_ports.find (position.tuple.localPort);
+  port->second.erase (position.port);
+  if (port->second.empty ())
+    {
+      m_ports.erase (port);
+      m_ephemeral.Release (position.tuple.localPort);
+    }
+  TupleIndex::iterator full = m_tuples.find (position.tuple);
+  full->second.erase (position.full);
+  if (full->second.empty ())
+    {
+      m_tuples.erase (full);
+    }
+  LocalIndex::iterator local = m_locals.find (Tuple (position.tuple.localAddress, position.tuple.localPort,
+                                                     Ipv6Address::GetAny (), 0));
+  if (--local->second == 0)
+    {
+      m_locals.erase (local);
+    }
+}
+
+void Ipv6EndPointDemux::Update (Ipv6EndPoint *endPoint)
+{
+  NS_LOG_FUNCTION (this << endPoint);
+  Positions::iterator i = m_positions.find (endPoint);
+  NS_ASSERT (i != m_positions.end ());
+  Unindex (i->second);
+  Index (endPoint, i->second);
+}
+
+void Ipv6EndPointDemux::AddMatches (EndPoints &matches, Ipv6Address localAddress, uint16_t localPort,
+                                    Ipv6Address peerAddress, uint16_t peerPort)
+{
+  TupleIndex::iterator full = m_tuples.find (Tuple (localAddress, localPort, peerAddress, peerPort));
+  if (full != m_tuples.end ())
+    {
+      matches.insert (matches.end (), full->second.begin (), full->second.end ());
     }
 }
 
@@ -171,106 +235,50 @@ Ipv6EndPointDemux::EndPoints Ipv6EndPointDemux::Lookup (Ipv6Address daddr, uint1
                                                         Ptr<Ipv6Interface> incomingInterface)
 {
   NS_LOG_FUNCTION (this << daddr << dport << saddr << sport << incomingInterface);
-
-  EndPoints retval1; /* Matches exact on local port, wildcards on others */
-  EndPoints retval2; /* Matches exact on local port/adder, wildcards on others */
-  EndPoints retval3; /* Matches all but local address */
-  EndPoints retval4; /* Exact match on all 4 */
-
   NS_LOG_DEBUG ("Looking up endpoint for destination address " << daddr);
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
-    {
-      Ipv6EndPoint* endP = *i;
-      NS_LOG_DEBUG ("Looking at endpoint dport=" << endP->GetLocalPort ()
-                    << " daddr=" << endP->GetLocalAddress ()
-                    << " sport=" << endP->GetPeerPort ()
-                    << " saddr=" << endP->GetPeerAddress ());
-      if (endP->GetLocalPort () != dport) 
-        {
-          NS_LOG_LOGIC ("Skipping endpoint " << &endP
-                        << " because endpoint dport "
-                        << endP->GetLocalPort ()
-                        << " does not match packet dport " << dport);
-          continue;
-        }
 
-      /*    Ipv6Address incomingInterfaceAddr = incomingInterface->GetAddress (); */
-      NS_LOG_DEBUG ("dest addr " << daddr);
-
-      bool localAddressMatchesWildCard = endP->GetLocalAddress () == Ipv6Address::GetAny ();
-      bool localAddressMatchesExact = endP->GetLocalAddress () == daddr;
-      bool localAddressMatchesAllRouters = endP->GetLocalAddress () == Ipv6Address::GetAllRoutersMulticast ();
-
-      /* if no match here, keep looking */
-      if (!(localAddressMatchesExact || localAddressMatchesWildCard))
-        continue; 
-      bool remotePeerMatchesExact = endP->GetPeerPort () == sport;
-      bool remotePeerMatchesWildCard = endP->GetPeerPort () == 0;
-      bool remoteAddressMatchesExact = endP->GetPeerAddress () == saddr;
-      bool remoteAddressMatchesWildCard = endP->GetPeerAddress () == Ipv6Address::GetAny ();
-
-      /* If remote does not match either with exact or wildcard,i
-         skip this one */
-      if (!(remotePeerMatchesExact || remotePeerMatchesWildCard))
-        continue;
-      if (!(remoteAddressMatchesExact || remoteAddressMatchesWildCard))
-        continue;
-
-      /* Now figure out which return list to add this one to */
-      if (localAddressMatchesWildCard &&
-          remotePeerMatchesWildCard && 
-          remoteAddressMatchesWildCard)
-        { /* Only local port matches exactly */
-          retval1.push_back (endP);
-        }
-      if ((localAddressMatchesExact || (localAddressMatchesAllRouters))&&
-          remotePeerMatchesWildCard &&
-          remoteAddressMatchesWildCard)
-        { /* Only local port and local address matches exactly */
-          retval2.push_back (endP);
-        }
-      if (localAddressMatchesWildCard &&
-          remotePeerMatchesExact &&
-          remoteAddressMatchesExact)
-        { /* All but local address */
-          retval3.push_back (endP);
-        }
-      if (localAddressMatchesExact &&
-          remotePeerMatchesExact &&
-          remoteAddressMatchesExact)
-        { /* All 4 match */
-          retval4.push_back (endP);
-        }
-    }
+  Ipv6Address any = Ipv6Address::GetAny ();
+  EndPoints retval;
 
   /* Here we find the most exact match */
-  if (!retval4.empty ()) return retval4;
-  if (!retval3.empty ()) return retval3;
-  if (!retval2.empty ()) return retval2;
-  return retval1;  /* might be empty if no matches */
+  AddMatches (retval, daddr, dport, saddr, sport); /* Exact match on all 4 */
+  if (retval.empty ())
+    { /* Matches all but local address */
+      AddMatches (retval, any, dport, saddr, sport);
+    }
+  if (retval.empty ())
+    { /* Matches exact on local port/adder, wildcards on others */
+      AddMatches (retval, daddr, dport, any, 0);
+    }
+  if (retval.empty ())
+    { /* Matches exact on local port, wildcards on others */
+      AddMatches (retval, any, dport, any, 0);
+    }
+  return retval;  /* might be empty if no matches */
 }
 
 Ipv6EndPoint* Ipv6EndPointDemux::SimpleLookup (Ipv6Address dst, uint16_t dport, Ipv6Address src, uint16_t sport)
 {
+  TupleIndex::iterator full = m_tuples.find (Tuple (dst, dport, src, sport));
+  if (full != m_tuples.end ())
+    {
+      /* this is an exact match. */
+      return full->second.front ();
+    }
+
+  PortIndex::iterator port = m_ports.find (dport);
+  if (port == m_ports.end ())
+    {
+      return 0;
+    }
+
   uint32_t genericity = 3;
   Ipv6EndPoint *generic = 0;
 
-  for (EndPointsI i = m_endPoints.begin () ; i != m_endPoints.end () ; i++)
+  for (EndPointsI i = port->second.begin () ; i != port->second.end () ; i++)
     {
       uint32_t tmp = 0;
 
-      if ((*i)->GetLocalPort () != dport)
-        {
-          continue;
-        }
-
-      if ((*i)->GetLocalAddress () == dst && (*i)->GetPeerPort () == sport &&
-          (*i)->GetPeerAddress () == src)
-        {
-          /* this is an exact match. */
-          return *i;
-        }
-
       if ((*i)->GetLocalAddress () == Ipv6Address::GetAny ())
         {
           tmp ++;
@@ -293,20 +301,7 @@ Ipv6EndPoint* Ipv6EndPointDemux::SimpleLookup (Ipv6Address dst, uint16_t dport,
 uint16_t Ipv6EndPointDemux::AllocateEphemeralPort ()
 {
   NS_LOG_FUNCTION_NOARGS ();
-  uint16_t port = m_ephemeral;
-  do 
-    {
-      port++;
-      if (port == 65535) 
-        {
-          port = 49152;
-        }
-      if (!LookupPortLocal (port)) 
-        {
-          return port;
-        }
-    } while (port != m_ephemeral);
-  return 0;
+  return m_ephemeral.GetFree ();
 }
 
 Ipv6EndPointDemux::EndPoints Ipv6EndPointDemux::GetEndPoints () const
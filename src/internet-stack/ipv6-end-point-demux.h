@@ -23,8 +23,11 @@
 
 #include <stdint.h>
 #include <list>
+#include <map>
 #include "ns3/ipv6-address.h"
+#include "ns3/sgi-hashmap.h"
 #include "ipv6-interface.h"
+#include "ephemeral-ports.h"
 
 namespace ns3
 {
@@ -34,6 +37,9 @@ class Ipv6EndPoint;
 /**
  * \class Ipv6EndPointDemux
  * \brief Demultiplexor for end points.
+ *
+ * The end points are hashed by local port, by local address and port,
+ * and by four-tuple, so lookups do not scan every end point.
  */
 class Ipv6EndPointDemux
 {
@@ -145,14 +151,108 @@ private:
   uint16_t AllocateEphemeralPort ();
 
   /**
-   * \brief The ephemeral port.
+   * \brief The addresses and ports an end point is hashed with.
+   */
+  struct Tuple
+  {
+    Tuple ();
+    Tuple (Ipv6Address localAddress, uint16_t localPort, Ipv6Address peerAddress, uint16_t peerPort);
+    bool operator == (const Tuple &other) const;
+    Ipv6Address localAddress;
+    uint16_t localPort;
+    Ipv6Address peerAddress;
+    uint16_t peerPort;
+  };
+
+  /**
+   * \brief Hash function for Tuple.
+   */
+  struct TupleHash
+  {
+    size_t operator () (const Tuple &tuple) const;
+  };
+
+  /**
+   * \brief Where an end point is in the lists, to remove it without a search.
+   */
+  struct Position
+  {
+    Tuple tuple;
+    EndPointsI all;
+    EndPointsI port;
+    EndPointsI full;
+  };
+
+  typedef sgi::hash_map<uint16_t, EndPoints> PortIndex;
+  typedef sgi::hash_map<Tuple, uint32_t, TupleHash> LocalIndex;
+  typedef sgi::hash_map<Tuple, EndPoints, TupleHash> TupleIndex;
+  typedef std::map<Ipv6EndPoint *, Position> Positions;
+
+  /**
+   * \brief Add a new end point to the list and the indexes.
+   * \param endPoint the end point
+   * \return the end point
+   */
+  Ipv6EndPoint *Insert (Ipv6EndPoint *endPoint);
+
+  /**
+   * \brief Hash an end point with its current addresses and ports.
+   * \param endPoint the end point
+   * \param position where to record its place in the indexes
+   */
+  void Index (Ipv6EndPoint *endPoint, Position &position);
+
+  /**
+   * \brief Remove an end point from the indexes.
+   * \param position its place in the indexes
+   */
+  void Unindex (Position &position);
+
+  /**
+   * \brief Hash an end point again after its addresses or ports changed.
+   * \param endPoint the end point
+   */
+  void Update (Ipv6EndPoint *endPoint);
+
+  /**
+   * \brief Append the end points hashed with exactly this four-tuple.
+   * \param matches list to append to
+   * \param localAddress local address
+   * \param localPort local port
+   * \param peerAddress peer address
+   * \param peerPort peer port
    */
-  uint16_t m_ephemeral;
+  void AddMatches (EndPoints &matches, Ipv6Address localAddress, uint16_t localPort, Ipv6Address peerAddress, uint16_t peerPort);
+
+  /**
+   * \brief The ephemeral ports in use.
+   */
+  EphemeralPorts m_ephemeral;
 
   /**
    * \brief A list of IPv6 end points.
    */
   EndPoints m_endPoints;
+
+  /**
+   * \brief End points by local port.
+   */
+  PortIndex m_ports;
+
+  /**
+   * \brief Number of end points by local address and port.
+   */
+  LocalIndex m_locals;
+
+  /**
+   * \brief End points by four-tuple.
+   */
+  TupleIndex m_tuples;
+
+  /**
+   * \brief Place of each end point in the indexes.
+   */
+  Positions m_positions;
 };
 
 } /* namespace ns3 */
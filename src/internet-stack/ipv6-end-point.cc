@@ -53,6 +53,10 @@ Ipv6Address Ipv6EndPoint::GetLocalAddress ()
 void Ipv6EndPoint::SetLocalAddress (Ipv6Address addr)
 {
   m_localAddr = addr;
+  if (!m_changeCallback.IsNull ())
+    {
+      m_changeCallback (this);
+    }
 }
 
 uint16_t Ipv6EndPoint::GetLocalPort ()
@@ -63,6 +67,10 @@ uint16_t Ipv6EndPoint::GetLocalPort ()
 void Ipv6EndPoint::SetLocalPort (uint16_t port)
 {
   m_localPort = port;
+  if (!m_changeCallback.IsNull ())
+    {
+      m_changeCallback (this);
+    }
 }
 
 Ipv6Address Ipv6EndPoint::GetPeerAddress ()
@@ -79,6 +87,10 @@ void Ipv6EndPoint::SetPeer (Ipv6Address addr, uint16_t port)
 {
   m_peerAddr = addr;
   m_peerPort = port;
+  if (!m_changeCallback.IsNull ())
+    {
+      m_changeCallback (this);
+    }
 }
 
 void Ipv6EndPoint::SetRxCallback (Callback<void, Ptr<Packet>, Ipv6Address, uint16_t> callback)
@@ -96,6 +108,11 @@ void Ipv6EndPoint::SetDestroyCallback (Callback<void> callback)
   m_destroyCallback = callback;
 }
 
+void Ipv6EndPoint::SetChangeCallback (Callback<void, Ipv6EndPoint *> callback)
+{
+  m_changeCallback = callback;
+}
+
 void Ipv6EndPoint::ForwardUp (Ptr<Packet> p, Ipv6Address addr, uint16_t port)
 {
   if (!m_rxCallback.IsNull ())
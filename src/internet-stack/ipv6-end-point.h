@@ -112,6 +112,14 @@ class Ipv6EndPoint
      */
     void SetDestroyCallback (Callback<void> callback);
 
+    /**
+     * \brief Set the callback invoked when the addresses or ports change.
+     *
+     * Used by Ipv6EndPointDemux to hash the end point again.
+     * \param callback callback function
+     */
+    void SetChangeCallback (Callback<void, Ipv6EndPoint *> callback);
+
     /**
      * \brief Forward the packet to the upper level.
      * \param p the packet
@@ -186,6 +194,11 @@ class Ipv6EndPoint
      * \brief The destroy callback.
      */
     Callback<void> m_destroyCallback;
+
+    /**
+     * \brief The change callback.
+     */
+    Callback<void, Ipv6EndPoint *> m_changeCallback;
 };
 
 } /* namespace ns3 */
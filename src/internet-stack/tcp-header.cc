@@ -66,10 +66,6 @@ void TcpHeader::SetAckNumber (SequenceNumber32 ackNumber)
 {
   m_ackNumber = ackNumber;
 }
-void TcpHeader::SetLength (uint8_t length)
-{
-  m_length = length;
-}
 void TcpHeader::SetFlags (uint8_t flags)
 {
   m_flags = flags;
@@ -126,6 +122,69 @@ TcpHeader::InitializeChecksum (Ipv4Address source,
   m_protocol = protocol;
 }
 
+bool
+TcpHeader::AppendOption (Ptr<const TcpOption> option)
+{
+  uint32_t size = CalculateOptionsSize () + option->GetSerializedSize ();
+  TcpOptionList::iterator replaced = m_options.end ();
+  for (TcpOptionList::iterator i = m_options.begin (); i != m_options.end (); ++i)
+    {
+      if ((*i)->GetKind () == option->GetKind ())
+        {
+          replaced = i;
+          size -= (*i)->GetSerializedSize ();
+          break;
+        }
+    }
+  if (size > 40)
+    { // The data offset field cannot describe more than 60 bytes of header
+      return false;
+    }
+  if (replaced != m_options.end ())
+    {
+      m_options.erase (replaced);
+    }
+  m_options.push_back (option);
+  m_length = 5 + (size + 3) / 4;
+  return true;
+}
+
+Ptr<const TcpOption>
+TcpHeader::GetOption (uint8_t kind) const
+{
+  for (TcpOptionList::const_iterator i = m_options.begin (); i != m_options.end (); ++i)
+    {
+      if ((*i)->GetKind () == kind)
+        {
+          return *i;
+        }
+    }
+  return 0;
+}
+
+bool
+TcpHeader::HasOption (uint8_t kind) const
+{
+  return GetOption (kind) != 0;
+}
+
+const TcpHeader::TcpOptionList&
+TcpHeader::GetOptionList (void) const
+{
+  return m_options;
+}
+
+uint32_t
+TcpHeader::CalculateOptionsSize (void) const
+{
+  uint32_t size = 0;
+  for (TcpOptionList::const_iterator i = m_options.begin (); i != m_options.end (); ++i)
+    {
+      size += (*i)->GetSerializedSize ();
+    }
+  return size;
+}
+
 uint16_t
 TcpHeader::CalculateHeaderChecksum (uint16_t size) const
 {
@@ -195,9 +254,30 @@ void TcpHeader::Print (std::ostream &os)  const
     {
       os<<" URG ";
     }
+    if((m_flags & ECE) != 0)
+    {
+      os<<" ECE ";
+    }
+    if((m_flags & CWR) != 0)
+    {
+      os<<" CWR ";
+    }
     os<<"]";
   }
   os<<" Seq="<<m_sequenceNumber<<" Ack="<<m_ackNumber<<" Win="<<m_windowSize;
+  if (!m_options.empty ())
+    {
+      os << " Options={";
+      for (TcpOptionList::const_iterator i = m_options.begin (); i != m_options.end (); ++i)
+        {
+          if (i != m_options.begin ())
+            {
+              os << " ";
+            }
+          (*i)->Print (os);
+        }
+      os << "}";
+    }
 }
 uint32_t TcpHeader::GetSerializedSize (void)  const
 {
@@ -215,6 +295,20 @@ void TcpHeader::Serialize (Buffer::Iterator start)  const
   i.WriteHtonU16 (0);
   i.WriteHtonU16 (m_urgentPointer);
 
+  uint32_t optionLen = 4 * m_length - 20;
+  for (TcpOptionList::const_iterator j = m_options.begin (); j != m_options.end (); ++j)
+    {
+      uint32_t size = (*j)->GetSerializedSize ();
+      (*j)->Serialize (i);
+      i.Next (size);
+      optionLen -= size;
+    }
+  // Pad with END octets up to the data offset
+  for (; optionLen > 0; optionLen--)
+    {
+      i.WriteU8 (TcpOption::END);
+    }
+
   if(m_calcChecksum)
   {
     uint16_t headerChecksum = CalculateHeaderChecksum (start.GetSize ());
@@ -234,12 +328,43 @@ uint32_t TcpHeader::Deserialize (Buffer::Iterator start)
   m_sequenceNumber = i.ReadNtohU32 ();
   m_ackNumber = i.ReadNtohU32 ();
   uint16_t field = i.ReadNtohU16 ();
-  m_flags = field & 0x3F;
+  m_flags = field & 0xFF;
   m_length = field>>12;
   m_windowSize = i.ReadNtohU16 ();
   i.Next (2);
   m_urgentPointer = i.ReadNtohU16 ();
 
+  m_options.clear ();
+  uint32_t optionLen = (m_length > 5) ? 4 * m_length - 20 : 0;
+  while (optionLen > 0)
+    {
+      uint8_t kind = i.ReadU8 ();
+      if (kind == TcpOption::END)
+        {
+          break;
+        }
+      if (kind == TcpOption::NOP)
+        {
+          optionLen--;
+          continue;
+        }
+      // All other kinds have a length octet which counts the kind and itself
+      uint8_t size = (optionLen >= 2) ? i.ReadU8 () : 0;
+      if (size < 2 || size > optionLen)
+        { // Malformed option list: ignore the rest of it
+          break;
+        }
+      i.Prev (2);
+      Ptr<TcpOption> option = TcpOption::CreateOption (kind);
+      if (option->Deserialize (i) != size)
+        {
+          break;
+        }
+      m_options.push_back (option);
+      i.Next (size);
+      optionLen -= size;
+    }
+
   if(m_calcChecksum)
     {
       uint16_t headerChecksum = CalculateHeaderChecksum (start.GetSize ());
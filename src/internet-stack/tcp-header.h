@@ -22,11 +22,13 @@
 #define TCP_HEADER_H
 
 #include <stdint.h>
+#include <list>
 #include "ns3/header.h"
 #include "ns3/buffer.h"
 #include "ns3/tcp-socket-factory.h"
 #include "ns3/ipv4-address.h"
 #include "ns3/sequence-number.h"
+#include "tcp-option.h"
 
 namespace ns3 {
 
@@ -37,6 +39,8 @@ namespace ns3 {
  * This class has fields corresponding to those in a network TCP header
  * (port numbers, sequence and acknowledgement numbers, flags, etc) as well
  * as methods for serialization to and deserialization from a byte buffer.
+ * The options follow the fixed part of the header; the header length is
+ * derived from them and padded to a multiple of 4 bytes.
  */
 
 class TcpHeader : public Header 
@@ -66,10 +70,6 @@ public:
    * \param ackNumber the ACK number for this TcpHeader
    */
   void SetAckNumber (SequenceNumber32 ackNumber);
-  /**
-   * \param length the length of this TcpHeader
-   */
-  void SetLength (uint8_t length);
   /**
    * \param flags the flags for this TcpHeader
    */
@@ -117,6 +117,29 @@ public:
    */
   uint16_t GetUrgentPointer () const;
 
+  typedef std::list<Ptr<const TcpOption> > TcpOptionList;
+
+  /**
+   * \brief Append an option, replacing any option of the same kind
+   * \param option the option to append
+   * \returns false if the options would not fit in the 40 bytes available
+   */
+  bool AppendOption (Ptr<const TcpOption> option);
+  /**
+   * \param kind the kind of the option, see TcpOption::Kind
+   * \returns the option of this kind, or 0 if the header has none
+   */
+  Ptr<const TcpOption> GetOption (uint8_t kind) const;
+  /**
+   * \param kind the kind of the option, see TcpOption::Kind
+   * \returns true if the header carries an option of this kind
+   */
+  bool HasOption (uint8_t kind) const;
+  /**
+   * \returns the options of this TcpHeader, in wire order
+   */
+  const TcpOptionList& GetOptionList (void) const;
+
   /**
    * \param source the ip source to use in the underlying
    *        ip packet.
@@ -133,7 +156,7 @@ public:
                            uint8_t protocol);
 
   typedef enum { NONE = 0, FIN = 1, SYN = 2, RST = 4, PSH = 8, ACK = 16, 
-    URG = 32} Flags_t;
+    URG = 32, ECE = 64, CWR = 128} Flags_t;
 
   static TypeId GetTypeId (void);
   virtual TypeId GetInstanceTypeId (void) const;
@@ -150,14 +173,16 @@ public:
 
 private:
   uint16_t CalculateHeaderChecksum (uint16_t size) const;
+  uint32_t CalculateOptionsSize (void) const;
   uint16_t m_sourcePort;
   uint16_t m_destinationPort;
   SequenceNumber32 m_sequenceNumber;
   SequenceNumber32 m_ackNumber;
-  uint8_t m_length; // really a uint4_t
-  uint8_t m_flags;      // really a uint6_t
+  uint8_t m_length; // really a uint4_t, 5 plus the padded options
+  uint8_t m_flags;      // the 6 RFC 793 flags plus ECE and CWR (RFC 3168)
   uint16_t m_windowSize;
   uint16_t m_urgentPointer;
+  TcpOptionList m_options;
 
   Ipv4Address m_source;
   Ipv4Address m_destination;
@@ -0,0 +1,446 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "tcp-option.h"
+#include "ns3/log.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("TcpOption");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (TcpOption);
+NS_OBJECT_ENSURE_REGISTERED (TcpOptionWinScale);
+NS_OBJECT_ENSURE_REGISTERED (TcpOptionTS);
+NS_OBJECT_ENSURE_REGISTERED (TcpOptionSackPermitted);
+NS_OBJECT_ENSURE_REGISTERED (TcpOptionSack);
+NS_OBJECT_ENSURE_REGISTERED (TcpOptionUnknown);
+
+TypeId
+TcpOption::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpOption")
+    .SetParent<Object> ()
+  ;
+  return tid;
+}
+
+TcpOption::TcpOption ()
+{
+}
+
+TcpOption::~TcpOption ()
+{
+}
+
+Ptr<TcpOption>
+TcpOption::CreateOption (uint8_t kind)
+{
+  switch (kind)
+    {
+    case WINSCALE:
+      return CreateObject<TcpOptionWinScale> ();
+    case TS:
+      return CreateObject<TcpOptionTS> ();
+    case SACKPERMITTED:
+      return CreateObject<TcpOptionSackPermitted> ();
+    case SACK:
+      return CreateObject<TcpOptionSack> ();
+    default:
+      return CreateObject<TcpOptionUnknown> ();
+    }
+}
+
+TypeId
+TcpOptionWinScale::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpOptionWinScale")
+    .SetParent<TcpOption> ()
+    .AddConstructor<TcpOptionWinScale> ()
+  ;
+  return tid;
+}
+
+TcpOptionWinScale::TcpOptionWinScale ()
+  : m_scale (0)
+{
+}
+
+TcpOptionWinScale::~TcpOptionWinScale ()
+{
+}
+
+uint8_t
+TcpOptionWinScale::GetKind (void) const
+{
+  return TcpOption::WINSCALE;
+}
+
+void
+TcpOptionWinScale::Print (std::ostream &os) const
+{
+  os << "WS=" << (uint32_t) m_scale;
+}
+
+uint32_t
+TcpOptionWinScale::GetSerializedSize (void) const
+{
+  return 3;
+}
+
+void
+TcpOptionWinScale::Serialize (Buffer::Iterator start) const
+{
+  Buffer::Iterator i = start;
+  i.WriteU8 (GetKind ());
+  i.WriteU8 (3);
+  i.WriteU8 (m_scale);
+}
+
+uint32_t
+TcpOptionWinScale::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  i.ReadU8 ();
+  if (i.ReadU8 () != 3)
+    {
+      return 0;
+    }
+  // RFC 1323, sec. 2.3: a shift count above 14 is taken as 14
+  m_scale = std::min (i.ReadU8 (), (uint8_t) 14);
+  return 3;
+}
+
+uint8_t
+TcpOptionWinScale::GetScale (void) const
+{
+  return m_scale;
+}
+
+void
+TcpOptionWinScale::SetScale (uint8_t scale)
+{
+  NS_ASSERT (scale <= 14);
+  m_scale = scale;
+}
+
+TypeId
+TcpOptionTS::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpOptionTS")
+    .SetParent<TcpOption> ()
+    .AddConstructor<TcpOptionTS> ()
+  ;
+  return tid;
+}
+
+TcpOptionTS::TcpOptionTS ()
+  : m_timestamp (0),
+    m_echo (0)
+{
+}
+
+TcpOptionTS::~TcpOptionTS ()
+{
+}
+
+uint8_t
+TcpOptionTS::GetKind (void) const
+{
+  return TcpOption::TS;
+}
+
+void
+TcpOptionTS::Print (std::ostream &os) const
+{
+  os << "TS=" << m_timestamp << "/" << m_echo;
+}
+
+uint32_t
+TcpOptionTS::GetSerializedSize (void) const
+{
+  return 10;
+}
+
+void
+TcpOptionTS::Serialize (Buffer::Iterator start) const
+{
+  Buffer::Iterator i = start;
+  i.WriteU8 (GetKind ());
+  i.WriteU8 (10);
+  i.WriteHtonU32 (m_timestamp);
+  i.WriteHtonU32 (m_echo);
+}
+
+uint32_t
+TcpOptionTS::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  i.ReadU8 ();
+  if (i.ReadU8 () != 10)
+    {
+      return 0;
+    }
+  m_timestamp = i.ReadNtohU32 ();
+  m_echo = i.ReadNtohU32 ();
+  return 10;
+}
+
+uint32_t
+TcpOptionTS::GetTimestamp (void) const
+{
+  return m_timestamp;
+}
+
+uint32_t
+TcpOptionTS::GetEcho (void) const
+{
+  return m_echo;
+}
+
+void
+TcpOptionTS::SetTimestamp (uint32_t ts)
+{
+  m_timestamp = ts;
+}
+
+void
+TcpOptionTS::SetEcho (uint32_t ts)
+{
+  m_echo = ts;
+}
+
+TypeId
+TcpOptionSackPermitted::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpOptionSackPermitted")
+    .SetParent<TcpOption> ()
+    .AddConstructor<TcpOptionSackPermitted> ()
+  ;
+  return tid;
+}
+
+TcpOptionSackPermitted::TcpOptionSackPermitted ()
+{
+}
+
+TcpOptionSackPermitted::~TcpOptionSackPermitted ()
+{
+}
+
+uint8_t
+TcpOptionSackPermitted::GetKind (void) const
+{
+  return TcpOption::SACKPERMITTED;
+}
+
+void
+TcpOptionSackPermitted::Print (std::ostream &os) const
+{
+  os << "SACK_PERM";
+}
+
+uint32_t
+TcpOptionSackPermitted::GetSerializedSize (void) const
+{
+  return 2;
+}
+
+void
+TcpOptionSackPermitted::Serialize (Buffer::Iterator start) const
+{
+  Buffer::Iterator i = start;
+  i.WriteU8 (GetKind ());
+  i.WriteU8 (2);
+}
+
+uint32_t
+TcpOptionSackPermitted::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  i.ReadU8 ();
+  if (i.ReadU8 () != 2)
+    {
+      return 0;
+    }
+  return 2;
+}
+
+TypeId
+TcpOptionSack::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpOptionSack")
+    .SetParent<TcpOption> ()
+    .AddConstructor<TcpOptionSack> ()
+  ;
+  return tid;
+}
+
+TcpOptionSack::TcpOptionSack ()
+{
+}
+
+TcpOptionSack::~TcpOptionSack ()
+{
+}
+
+uint8_t
+TcpOptionSack::GetKind (void) const
+{
+  return TcpOption::SACK;
+}
+
+void
+TcpOptionSack::Print (std::ostream &os) const
+{
+  os << "SACK";
+  for (SackList::const_iterator i = m_sackList.begin (); i != m_sackList.end (); ++i)
+    {
+      os << " [" << i->first << ";" << i->second << ")";
+    }
+}
+
+uint32_t
+TcpOptionSack::GetSerializedSize (void) const
+{
+  return 2 + 8 * m_sackList.size ();
+}
+
+void
+TcpOptionSack::Serialize (Buffer::Iterator start) const
+{
+  Buffer::Iterator i = start;
+  i.WriteU8 (GetKind ());
+  i.WriteU8 (GetSerializedSize ());
+  for (SackList::const_iterator j = m_sackList.begin (); j != m_sackList.end (); ++j)
+    {
+      i.WriteHtonU32 (j->first.GetValue ());
+      i.WriteHtonU32 (j->second.GetValue ());
+    }
+}
+
+uint32_t
+TcpOptionSack::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  i.ReadU8 ();
+  uint8_t size = i.ReadU8 ();
+  if (size < 10 || (size - 2) % 8 != 0)
+    {
+      return 0;
+    }
+  m_sackList.clear ();
+  for (uint8_t n = (size - 2) / 8; n > 0; n--)
+    {
+      SequenceNumber32 left (i.ReadNtohU32 ());
+      SequenceNumber32 right (i.ReadNtohU32 ());
+      m_sackList.push_back (SackBlock (left, right));
+    }
+  return size;
+}
+
+void
+TcpOptionSack::AddSackBlock (SackBlock block)
+{
+  m_sackList.push_back (block);
+}
+
+uint32_t
+TcpOptionSack::GetNumSackBlocks (void) const
+{
+  return m_sackList.size ();
+}
+
+void
+TcpOptionSack::ClearSackList (void)
+{
+  m_sackList.clear ();
+}
+
+TcpOptionSack::SackList
+TcpOptionSack::GetSackList (void) const
+{
+  return m_sackList;
+}
+
+TypeId
+TcpOptionUnknown::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpOptionUnknown")
+    .SetParent<TcpOption> ()
+    .AddConstructor<TcpOptionUnknown> ()
+  ;
+  return tid;
+}
+
+TcpOptionUnknown::TcpOptionUnknown ()
+  : m_kind (0)
+{
+}
+
+TcpOptionUnknown::~TcpOptionUnknown ()
+{
+}
+
+uint8_t
+TcpOptionUnknown::GetKind (void) const
+{
+  return m_kind;
+}
+
+void
+TcpOptionUnknown::Print (std::ostream &os) const
+{
+  os << "kind " << (uint32_t) m_kind << " len " << GetSerializedSize ();
+}
+
+uint32_t
+TcpOptionUnknown::GetSerializedSize (void) const
+{
+  return 2 + m_content.size ();
+}
+
+void
+TcpOptionUnknown::Serialize (Buffer::Iterator start) const
+{
+  Buffer::Iterator i = start;
+  i.WriteU8 (m_kind);
+  i.WriteU8 (GetSerializedSize ());
+  for (std::vector<uint8_t>::const_iterator j = m_content.begin (); j != m_content.end (); ++j)
+    {
+      i.WriteU8 (*j);
+    }
+}
+
+uint32_t
+TcpOptionUnknown::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  m_kind = i.ReadU8 ();
+  uint8_t size = i.ReadU8 ();
+  if (size < 2)
+    {
+      return 0;
+    }
+  m_content.resize (size - 2);
+  for (uint8_t n = 0; n < size - 2; n++)
+    {
+      m_content[n] = i.ReadU8 ();
+    }
+  return size;
+}
+
+} // namespace ns3
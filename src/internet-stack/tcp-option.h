@@ -0,0 +1,218 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TCP_OPTION_H
+#define TCP_OPTION_H
+
+#include <stdint.h>
+#include <list>
+#include <vector>
+#include <utility>
+#include "ns3/object.h"
+#include "ns3/buffer.h"
+#include "ns3/sequence-number.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup tcp
+ * \brief Base class for the options carried in a TcpHeader
+ *
+ * Each option knows how to write itself after its kind and length
+ * octets and how to read itself back. TcpHeader deals with the option
+ * list, the END and NOP kinds and the padding to a multiple of 4 bytes.
+ */
+class TcpOption : public Object
+{
+public:
+  static TypeId GetTypeId (void);
+
+  TcpOption ();
+  virtual ~TcpOption ();
+
+  /**
+   * The option kinds known to this implementation
+   */
+  enum Kind
+  {
+    END = 0,           //!< End of option list (RFC 793)
+    NOP = 1,           //!< No operation (RFC 793)
+    MSS = 2,           //!< Maximum segment size (RFC 793)
+    WINSCALE = 3,      //!< Window scale (RFC 1323)
+    SACKPERMITTED = 4, //!< SACK permitted (RFC 2018)
+    SACK = 5,          //!< SACK blocks (RFC 2018)
+    TS = 8             //!< Timestamps (RFC 1323)
+  };
+
+  /**
+   * \return the kind octet of this option
+   */
+  virtual uint8_t GetKind (void) const = 0;
+  virtual void Print (std::ostream &os) const = 0;
+  /**
+   * \return the number of bytes written by Serialize, kind and length included
+   */
+  virtual uint32_t GetSerializedSize (void) const = 0;
+  virtual void Serialize (Buffer::Iterator start) const = 0;
+  /**
+   * \param start an iterator on the kind octet of the option
+   * \return the number of bytes read, or 0 if the option is malformed
+   */
+  virtual uint32_t Deserialize (Buffer::Iterator start) = 0;
+
+  /**
+   * \param kind the kind octet read from the wire
+   * \return a new option of the matching class, TcpOptionUnknown for
+   *         the kinds this implementation does not handle
+   */
+  static Ptr<TcpOption> CreateOption (uint8_t kind);
+};
+
+/**
+ * \ingroup tcp
+ * \brief Window scale option (RFC 1323, sec. 2)
+ */
+class TcpOptionWinScale : public TcpOption
+{
+public:
+  static TypeId GetTypeId (void);
+
+  TcpOptionWinScale ();
+  virtual ~TcpOptionWinScale ();
+
+  virtual uint8_t GetKind (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+  /**
+   * \return the shift count, at most 14
+   */
+  uint8_t GetScale (void) const;
+  void SetScale (uint8_t scale);
+
+private:
+  uint8_t m_scale;
+};
+
+/**
+ * \ingroup tcp
+ * \brief Timestamps option (RFC 1323, sec. 3)
+ */
+class TcpOptionTS : public TcpOption
+{
+public:
+  static TypeId GetTypeId (void);
+
+  TcpOptionTS ();
+  virtual ~TcpOptionTS ();
+
+  virtual uint8_t GetKind (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+  uint32_t GetTimestamp (void) const;
+  uint32_t GetEcho (void) const;
+  void SetTimestamp (uint32_t ts);
+  void SetEcho (uint32_t ts);
+
+private:
+  uint32_t m_timestamp; //< TSval
+  uint32_t m_echo;      //< TSecr
+};
+
+/**
+ * \ingroup tcp
+ * \brief SACK-permitted option, only sent in SYN segments (RFC 2018, sec. 2)
+ */
+class TcpOptionSackPermitted : public TcpOption
+{
+public:
+  static TypeId GetTypeId (void);
+
+  TcpOptionSackPermitted ();
+  virtual ~TcpOptionSackPermitted ();
+
+  virtual uint8_t GetKind (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+};
+
+/**
+ * \ingroup tcp
+ * \brief SACK option (RFC 2018, sec. 3)
+ *
+ * Each block is the pair of the first sequence number of a run of
+ * received bytes and of the sequence number just past it.
+ */
+class TcpOptionSack : public TcpOption
+{
+public:
+  typedef std::pair<SequenceNumber32, SequenceNumber32> SackBlock;
+  typedef std::list<SackBlock> SackList;
+
+  static TypeId GetTypeId (void);
+
+  TcpOptionSack ();
+  virtual ~TcpOptionSack ();
+
+  virtual uint8_t GetKind (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+  void AddSackBlock (SackBlock block);
+  uint32_t GetNumSackBlocks (void) const;
+  void ClearSackList (void);
+  SackList GetSackList (void) const;
+
+private:
+  SackList m_sackList;
+};
+
+/**
+ * \ingroup tcp
+ * \brief An option of a kind not handled here, kept as raw bytes so that
+ *        the header can be printed and serialized again
+ */
+class TcpOptionUnknown : public TcpOption
+{
+public:
+  static TypeId GetTypeId (void);
+
+  TcpOptionUnknown ();
+  virtual ~TcpOptionUnknown ();
+
+  virtual uint8_t GetKind (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+  uint8_t m_kind;
+  std::vector<uint8_t> m_content; //< the bytes after the length octet
+};
+
+} // namespace ns3
+
+#endif /* TCP_OPTION_H */
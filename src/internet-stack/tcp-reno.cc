@@ -151,6 +151,20 @@ TcpReno::DupAck (const TcpHeader& t, uint32_t count)
     };
 }
 
+/** ECN echo: halve cwnd and ssthresh as for a loss, without retransmitting (RFC3168, sec.6.1.2) */
+void
+TcpReno::EceReceived (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_inFastRec)
+    { // The window is already being reduced for this congestion event
+      return;
+    }
+  m_ssThresh = std::max (2 * m_segmentSize, m_cWnd.Get () / 2);
+  m_cWnd = m_ssThresh;
+  NS_LOG_INFO ("ECN echo. Reset cwnd to " << m_cWnd << ", ssthresh to " << m_ssThresh);
+}
+
 // Retransmit timeout
 void TcpReno::Retransmit (void)
 {
@@ -35,7 +35,7 @@ namespace ns3 {
  * initialized below is insignificant.
  */
 TcpRxBuffer::TcpRxBuffer (uint32_t n)
-  : m_nextRxSeq(n), m_gotFin(false), m_size(0), m_maxBuffer(32768), m_availBytes(0)
+  : m_nextRxSeq(n), m_lastRxSeq(n), m_gotFin(false), m_size(0), m_maxBuffer(32768), m_availBytes(0)
 {
 }
 
@@ -139,29 +139,35 @@ TcpRxBuffer::Add (Ptr<Packet> p, TcpHeader const& tcph)
       if (maxSeq < tailSeq) tailSeq = maxSeq;
       if (tailSeq < headSeq) headSeq = tailSeq;
     }
-  // Remove overlapped bytes from packet
-  BufIterator i = m_data.begin ();
-  while (i != m_data.end () && i->first <= tailSeq)
+  if (headSeq >= tailSeq)
     {
-      SequenceNumber32 lastByteSeq = i->first + SequenceNumber32 (i->second->GetSize ());
-      if (lastByteSeq > headSeq)
-        {
-          if (i->first > headSeq && lastByteSeq < tailSeq)
-            { // Rare case: Existing packet is embedded fully in the new packet
-              m_size -= i->second->GetSize();
-              m_data.erase (i++);
-              continue;
-            }
-          if (i->first <= headSeq)
-            { // Incoming head is overlapped
-              headSeq = lastByteSeq;
-            }
-          if (lastByteSeq >= tailSeq)
-            { // Incoming tail is overlapped
-              tailSeq = i->first;
-            }
+      NS_LOG_LOGIC ("Nothing to buffer");
+      return false; // Nothing to buffer anyway
+    }
+  // Find the block which holds the incoming head or ends right before it
+  BufIterator left = m_data.end ();
+  BufIterator i = m_data.upper_bound (headSeq);
+  if (i != m_data.begin ())
+    {
+      BufIterator prev = i;
+      --prev;
+      if (prev->second.m_end >= headSeq)
+        { // Incoming head is overlapped, or adjacent to this block
+          left = prev;
+          if (headSeq < prev->second.m_end) headSeq = prev->second.m_end;
         }
-      ++i;
+    }
+  // Remove the blocks embedded in the packet, stop at the one which overlaps its tail
+  while (i != m_data.end () && i->first < tailSeq)
+    {
+      if (i->second.m_end > tailSeq)
+        { // Incoming tail is overlapped
+          tailSeq = i->first;
+          break;
+        }
+      // Rare case: Existing block is embedded fully in the new packet
+      m_size -= i->second.m_end - i->first;
+      m_data.erase (i++);
     }
   // We now know how much we are going to store, trim the packet
   if (headSeq >= tailSeq)
@@ -169,31 +175,60 @@ TcpRxBuffer::Add (Ptr<Packet> p, TcpHeader const& tcph)
       NS_LOG_LOGIC ("Nothing to buffer");
       return false; // Nothing to buffer anyway
     }
-  else
+  uint32_t start = headSeq - tcph.GetSequenceNumber ();
+  uint32_t length = tailSeq - headSeq;
+  p = p->CreateFragment (start, length);
+  NS_ASSERT (length == p->GetSize ());
+  BufIterator right = (i != m_data.end () && i->first == tailSeq) ? i : m_data.end ();
+
+  // Insert packet into buffer, merging the blocks it makes contiguous
+  BufIterator block;
+  if (left != m_data.end () && right != m_data.end ())
+    { // The packet fills a hole: move the packets of the smaller block
+      std::deque<Ptr<Packet> > &leftPackets = left->second.m_packets;
+      std::deque<Ptr<Packet> > &rightPackets = right->second.m_packets;
+      if (leftPackets.size () < rightPackets.size ())
+        {
+          rightPackets.push_front (p);
+          rightPackets.insert (rightPackets.begin (), leftPackets.begin (), leftPackets.end ());
+          leftPackets.swap (rightPackets);
+        }
+      else
+        {
+          leftPackets.push_back (p);
+          leftPackets.insert (leftPackets.end (), rightPackets.begin (), rightPackets.end ());
+        }
+      left->second.m_end = right->second.m_end;
+      m_data.erase (right);
+      block = left;
+    }
+  else if (left != m_data.end ())
     {
-      uint32_t start = headSeq - tcph.GetSequenceNumber ();
-      uint32_t length = tailSeq - headSeq;
-      p = p->CreateFragment (start, length);
-      NS_ASSERT (length == p->GetSize ());
-    }
-  // Insert packet into buffer
-  NS_ASSERT (m_data.find (headSeq) == m_data.end ()); // Shouldn't be there yet
-  m_data [ headSeq ] = p;
-  NS_LOG_LOGIC ("Buffered packet of seqno=" << headSeq << " len=" << p->GetSize ());
-  // Update variables
-  m_size += p->GetSize ();      // Occupancy
-  for (BufIterator i = m_data.begin (); i != m_data.end (); ++i)
+      left->second.m_packets.push_back (p);
+      left->second.m_end = tailSeq;
+      block = left;
+    }
+  else
     {
-      if (i->first < m_nextRxSeq)
+      block = m_data.insert (i, std::make_pair (headSeq, Block ()));
+      block->second.m_end = tailSeq;
+      if (right != m_data.end ())
         {
-          continue;
+          block->second.m_packets.swap (right->second.m_packets);
+          block->second.m_end = right->second.m_end;
+          m_data.erase (right);
         }
-      else if (i->first > m_nextRxSeq)
-        {
-          break;
-        };
-      m_nextRxSeq = i->first + SequenceNumber32 (i->second->GetSize ());
-      m_availBytes += i->second->GetSize ();
+      block->second.m_packets.push_front (p);
+    }
+  NS_LOG_LOGIC ("Buffered packet of seqno=" << headSeq << " len=" << p->GetSize ()
+                << " in block [" << block->first << ":" << block->second.m_end << ")");
+  // Update variables
+  m_size += p->GetSize ();      // Occupancy
+  m_lastRxSeq = headSeq;
+  if (block->first <= m_nextRxSeq && m_nextRxSeq < block->second.m_end)
+    { // The data is contiguous to the bytes available to read
+      m_availBytes += block->second.m_end - m_nextRxSeq;
+      m_nextRxSeq = block->second.m_end;
     }
   NS_LOG_LOGIC ("Updated buffer occupancy=" << m_size << " nextRxSeq=" << m_nextRxSeq);
   if (m_gotFin && m_nextRxSeq == m_finSeq)
@@ -212,43 +247,77 @@ TcpRxBuffer::Extract (uint32_t maxSize)
   NS_LOG_LOGIC ("Requested to extract " << extractSize << " bytes from TcpRxBuffer of size=" << m_size);
   if (extractSize == 0) return 0;  // No contiguous block to return
   NS_ASSERT (m_data.size ()); // At least we have something to extract
-  Ptr<Packet> outPkt = Create<Packet> (); // The packet that contains all the data to return
-  BufIterator i;
-  while (extractSize)
+  BufIterator i = m_data.begin ();
+  NS_ASSERT (i->first <= m_nextRxSeq); // in-sequence data expected
+  std::deque<Ptr<Packet> > &packets = i->second.m_packets;
+  Ptr<Packet> outPkt = 0; // The packet that contains all the data to return
+  uint32_t remaining = extractSize;
+  while (remaining)
     { // Check the buffered data for delivery
-      i = m_data.begin ();
-      NS_ASSERT (i->first <= m_nextRxSeq); // in-sequence data expected
+      Ptr<Packet> head = packets.front ();
       // Check if we send the whole pkt or just a partial
-      uint32_t pktSize = i->second->GetSize ();
-      if (pktSize <= extractSize)
+      uint32_t pktSize = head->GetSize ();
+      Ptr<Packet> data;
+      if (pktSize <= remaining)
         { // Whole packet is extracted
-          //std::cout << "[tcp-tx-buffer] whole" << std::endl;
-          outPkt->AddAtEnd (i->second);
-          //std::cout << "[tcp-tx-buffer] END whole" << std::endl;
-          m_data.erase (i);
-          m_size -= pktSize;
-          m_availBytes -= pktSize;
-          extractSize -= pktSize;
+          data = head;
+          packets.pop_front ();
         }
       else
         { // Partial is extracted and done
-          //std::cout << "[tcp-tx-buffer] partial" << std::endl;
-          outPkt->AddAtEnd (i->second->CreateFragment (0, extractSize));
-          m_data[i->first + SequenceNumber32 (extractSize)] = i->second->CreateFragment (extractSize, pktSize - extractSize);
-          m_data.erase (i);
-          m_size -= extractSize;
-          m_availBytes -= extractSize;
-          extractSize = 0;
+          data = head->CreateFragment (0, remaining);
+          packets.front () = head->CreateFragment (remaining, pktSize - remaining);
+        }
+      remaining -= data->GetSize ();
+      if (outPkt == 0)
+        { // The packets of the buffer are fragments which belong to it alone
+          outPkt = data;
+        }
+      else
+        {
+          outPkt->AddAtEnd (data);
         }
     }
-  if (outPkt->GetSize () == 0)
+  m_size -= extractSize;
+  m_availBytes -= extractSize;
+  if (packets.empty ())
     {
-      NS_LOG_LOGIC ("Nothing extracted.");
-      return 0;
+      m_data.erase (i);
+    }
+  else
+    { // The head block now starts after the extracted data
+      BufIterator head = m_data.insert (i, std::make_pair (i->first + SequenceNumber32 (extractSize), Block ()));
+      head->second.m_end = i->second.m_end;
+      head->second.m_packets.swap (packets);
+      m_data.erase (i);
     }
   NS_LOG_LOGIC ("Extracted " << outPkt->GetSize( ) << " bytes, bufsize=" << m_size
-                << ", num pkts in buffer=" << m_data.size ());
+                << ", num blocks in buffer=" << m_data.size ());
   return outPkt;
 }
 
+TcpRxBuffer::SackList
+TcpRxBuffer::GetSackList (void) const
+{
+  SackList list;
+  std::map<SequenceNumber32, Block>::const_iterator i = m_data.begin ();
+  if (i != m_data.end () && i->first <= m_nextRxSeq)
+    { // Skip the data available to read
+      ++i;
+    }
+  for (; i != m_data.end (); ++i)
+    {
+      SackBlock block = std::make_pair (i->first, i->second.m_end);
+      if (i->first <= m_lastRxSeq && m_lastRxSeq < i->second.m_end)
+        {
+          list.push_front (block);
+        }
+      else
+        {
+          list.push_back (block);
+        }
+    }
+  return list;
+}
+
 } //namepsace ns3
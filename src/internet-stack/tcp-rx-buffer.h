@@ -22,6 +22,7 @@
 #define __TCP_RX_BUFFER_H__
 
 #include <map>
+#include <deque>
 #include "ns3/sequence-number.h"
 #include "ns3/ptr.h"
 #include "ns3/tcp-header.h"
@@ -34,6 +35,14 @@ class Packet;
  *
  * \brief class for the reordering buffer that keeps the data from lower layer, i.e.
  *        TcpL4Protocol, sent to the application
+ *
+ * The data is kept as a set of disjoint blocks of contiguous bytes,
+ * indexed by the sequence number of their first byte. A segment which
+ * fills the gap between two blocks merges them, so that the cost of Add
+ * does not depend on the number of segments buffered but on the number
+ * of holes in the sequence space. The first block holds the bytes which
+ * can be read by the application; the following ones are the blocks
+ * that the receiver can report in SACK options.
  */
 class TcpRxBuffer
 {
@@ -41,6 +50,10 @@ public:
   TcpRxBuffer (uint32_t n = 0);
   virtual ~TcpRxBuffer ();
 
+  /// A block of received data, as carried by the SACK option
+  typedef TcpOptionSack::SackBlock SackBlock;
+  typedef TcpOptionSack::SackList SackList;
+
   // Accessors
   SequenceNumber32 NextRxSequence (void) const;
   SequenceNumber32 MaxRxSequence (void) const;
@@ -67,18 +80,38 @@ public:
   /**
    * Extract data from the head of the buffer as indicated by nextRxSeq.
    * The extracted data is going to be forwarded to the application.
+   * When it is held by a single buffered packet, this packet is returned
+   * without copying its data.
    */
   Ptr<Packet> Extract (uint32_t maxSize);
+
+  /**
+   * \returns the blocks of data received beyond the first missing byte,
+   *          the block which holds the most recently received data first,
+   *          as RFC 2018 orders SACK blocks, then in increasing order
+   *          of sequence numbers.
+   */
+  SackList GetSackList (void) const;
 public:
-  typedef std::map<SequenceNumber32, Ptr<Packet> >::iterator BufIterator;
+  /**
+   * A block of contiguous data, whose first byte is the key of the block
+   * in m_data.
+   */
+  struct Block
+  {
+    SequenceNumber32 m_end;            //< Seqnum following the last byte of the block
+    std::deque<Ptr<Packet> > m_packets; //< Data of the block, in order
+  };
+  typedef std::map<SequenceNumber32, Block>::iterator BufIterator;
   SequenceNumber32 m_nextRxSeq;   //< Seqnum of the first missing byte in data (RCV.NXT)
   SequenceNumber32 m_finSeq;      //< Seqnum of the FIN packet
+  SequenceNumber32 m_lastRxSeq;   //< Seqnum of the first byte of the last data added
   bool m_gotFin;                //< Did I received FIN packet?
   uint32_t m_size;              //< Number of total data bytes in the buffer, not necessarily contiguous
   uint32_t m_maxBuffer;         //< Upper bound of the number of data bytes in buffer (RCV.WND)
   uint32_t m_availBytes;        //< Number of bytes available to read, i.e. contiguous block at head
-  std::map<SequenceNumber32, Ptr<Packet> > m_data;
-                                //< Corresponding data (may be null)
+  std::map<SequenceNumber32, Block> m_data;
+                                //< Blocks of contiguous data
 };
 
 }//namepsace ns3
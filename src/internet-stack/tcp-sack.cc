@@ -0,0 +1,346 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#define NS_LOG_APPEND_CONTEXT \
+  if (m_node) { std::clog << Simulator::Now ().GetSeconds () << " [node " << m_node->GetId () << "] "; }
+
+#include "tcp-sack.h"
+#include "tcp-header.h"
+#include "tcp-option.h"
+#include "ns3/log.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/node.h"
+#include <algorithm>
+
+NS_LOG_COMPONENT_DEFINE ("TcpSack");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (TcpSack);
+
+TypeId
+TcpSack::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpSack")
+    .SetParent<TcpNewReno> ()
+    .AddConstructor<TcpSack> ()
+  ;
+  return tid;
+}
+
+TcpSack::TcpSack (void)
+  : m_sacked (0),
+    m_highRxt (0),
+    m_sackDupAcks (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+TcpSack::TcpSack (const TcpSack& sock)
+  : TcpNewReno (sock),
+    m_sacked (0),
+    m_highRxt (0),
+    m_sackDupAcks (0)
+{
+  NS_LOG_FUNCTION (this);
+  NS_LOG_LOGIC ("Invoked the copy constructor");
+}
+
+TcpSack::~TcpSack (void)
+{
+}
+
+Ptr<TcpSocketBase>
+TcpSack::Fork (void)
+{
+  return CopyObject<TcpSack> (this);
+}
+
+/** Record the SACK blocks of an ACK before the usual processing, so that
+    the dupack and new ACK handlers see an up to date scoreboard. Only the
+    ACKs which SACK new data count as duplicates (RFC6675 sec.2), not the
+    window updates nor the data segments of the peer. */
+void
+TcpSack::ReceivedAck (Ptr<Packet> packet, const TcpHeader& tcpHeader)
+{
+  NS_LOG_FUNCTION (this << tcpHeader);
+
+  if (m_sackEnabled && (tcpHeader.GetFlags () & TcpHeader::ACK))
+    {
+      SequenceNumber32 highAck = std::max (tcpHeader.GetAckNumber (), m_txBuffer.HeadSequence ());
+      DiscardScoreboardUpTo (highAck);
+      uint32_t sacked = m_sacked;
+      Ptr<const TcpOptionSack> sack = DynamicCast<const TcpOptionSack> (tcpHeader.GetOption (TcpOption::SACK));
+      if (sack != 0)
+        {
+          TcpOptionSack::SackList blocks = sack->GetSackList ();
+          for (TcpOptionSack::SackList::const_iterator i = blocks.begin (); i != blocks.end (); ++i)
+            { // Ignore what is cumulatively acked (D-SACK) or was never sent
+              UpdateScoreboard (std::max (i->first, highAck), std::min (i->second, m_highTxMark));
+            }
+        }
+      if (tcpHeader.GetAckNumber () > m_txBuffer.HeadSequence ())
+        {
+          m_sackDupAcks = 0;
+        }
+      else if (m_sacked > sacked)
+        {
+          m_sackDupAcks++;
+        }
+    }
+  TcpNewReno::ReceivedAck (packet, tcpHeader);
+}
+
+/** New ACK (up to seqnum seq) received. A partial ACK keeps the recovery
+    going (RFC3517 sec.5 step C), a full ACK ends it. */
+void
+TcpSack::NewAck (const SequenceNumber32& seq)
+{
+  NS_LOG_FUNCTION (this << seq);
+
+  if (m_sackEnabled && m_inFastRec && seq < m_recover)
+    { // Partial ACK: no window change, repair the next holes
+      NS_LOG_INFO ("Partial ACK in SACK recovery: cwnd " << m_cWnd << " pipe " << Pipe ());
+      TcpSocketBase::NewAck (seq);
+      SendDuringRecovery ();
+      return;
+    }
+  else if (m_sackEnabled && m_inFastRec)
+    { // Full ACK
+      m_cWnd = m_ssThresh;
+      m_inFastRec = false;
+      NS_LOG_INFO ("Received full ACK. Leaving SACK recovery with cwnd set to " << m_cWnd);
+    }
+  TcpNewReno::NewAck (seq);
+}
+
+/** Enter loss recovery upon triple dupack or when the scoreboard shows a
+    loss (RFC3517 sec.5), then send as the pipe allows on each dupack */
+void
+TcpSack::DupAck (const TcpHeader& t, uint32_t count)
+{
+  if (!m_sackEnabled)
+    {
+      TcpNewReno::DupAck (t, count);
+      return;
+    }
+  uint32_t sackedBelow;
+  if (!m_inFastRec && (m_sackDupAcks >= 3 || LostEdge (sackedBelow) > m_txBuffer.HeadSequence ()))
+    {
+      m_ssThresh = std::max (2 * m_segmentSize, BytesInFlight () / 2);
+      m_cWnd = m_ssThresh;
+      m_recover = m_highTxMark;
+      m_inFastRec = true;
+      NS_LOG_INFO ("Loss detected after " << m_sackDupAcks << " dupacks. Enter SACK recovery. Reset cwnd to " <<
+                   m_cWnd << ", ssthresh to " << m_ssThresh << " at recovery point " << m_recover);
+      // Retransmit the first segment presumed lost, whatever the pipe
+      SequenceNumber32 head = m_txBuffer.HeadSequence ();
+      uint32_t size = m_segmentSize;
+      if (!m_scoreboard.empty ())
+        {
+          size = std::min<uint32_t> (size, m_scoreboard.begin ()->first - head);
+        }
+      m_highRxt = head + SequenceNumber32 (RetransmitSegment (head, size));
+      SendDuringRecovery ();
+    }
+  else if (m_inFastRec)
+    {
+      SendDuringRecovery ();
+    }
+}
+
+/** Retransmit timeout: the receiver may have discarded the data it SACKed
+    (RFC2018 sec.8), so forget the scoreboard and go back to slow start */
+void
+TcpSack::Retransmit (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_scoreboard.clear ();
+  m_sacked = 0;
+  m_sackDupAcks = 0;
+  // the next recovery looks for holes from the first unacked byte
+  m_highRxt = m_txBuffer.HeadSequence ();
+  TcpNewReno::Retransmit ();
+}
+
+/** During recovery, new data is sent once no hole is left to repair, as
+    long as cwnd exceeds the pipe (RFC3517 sec.5 step C, NextSeg ()) */
+uint32_t
+TcpSack::AvailableWindow (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_sackEnabled || !m_inFastRec)
+    {
+      return TcpNewReno::AvailableWindow ();
+    }
+  SequenceNumber32 seq;
+  uint32_t size;
+  if (NextLostSegment (seq, size))
+    {
+      return 0;
+    }
+  uint32_t pipe = Pipe ();
+  uint32_t unack = UnAckDataCount ();
+  uint32_t cwndRoom = (m_cWnd.Get () > pipe) ? m_cWnd.Get () - pipe : 0;
+  uint32_t rwndRoom = (m_rxWindowSize > unack) ? m_rxWindowSize - unack : 0;
+  NS_LOG_LOGIC ("Pipe=" << pipe << ", cwnd=" << m_cWnd << ", UnAckCount=" << unack);
+  return std::min (cwndRoom, rwndRoom);
+}
+
+void
+TcpSack::SendDuringRecovery (void)
+{
+  SequenceNumber32 seq;
+  uint32_t size;
+  while (m_cWnd.Get () >= Pipe () + m_segmentSize && NextLostSegment (seq, size))
+    {
+      uint32_t sent = RetransmitSegment (seq, size);
+      if (sent == 0)
+        {
+          break;
+        }
+      m_highRxt = seq + SequenceNumber32 (sent);
+    }
+  SendPendingData (m_connected);
+}
+
+void
+TcpSack::UpdateScoreboard (SequenceNumber32 head, SequenceNumber32 tail)
+{
+  if (head >= tail)
+    {
+      return;
+    }
+  // Merge with the ranges it overlaps or touches
+  Scoreboard::iterator i = m_scoreboard.upper_bound (head);
+  if (i != m_scoreboard.begin ())
+    {
+      Scoreboard::iterator prev = i;
+      --prev;
+      if (prev->second >= head)
+        {
+          head = prev->first;
+          tail = std::max (tail, prev->second);
+          m_sacked -= prev->second - prev->first;
+          m_scoreboard.erase (prev);
+        }
+    }
+  while (i != m_scoreboard.end () && i->first <= tail)
+    {
+      tail = std::max (tail, i->second);
+      m_sacked -= i->second - i->first;
+      m_scoreboard.erase (i++);
+    }
+  m_scoreboard[head] = tail;
+  m_sacked += tail - head;
+}
+
+void
+TcpSack::DiscardScoreboardUpTo (SequenceNumber32 seq)
+{
+  while (!m_scoreboard.empty () && m_scoreboard.begin ()->first < seq)
+    {
+      Scoreboard::iterator i = m_scoreboard.begin ();
+      SequenceNumber32 tail = i->second;
+      m_sacked -= tail - i->first;
+      m_scoreboard.erase (i);
+      if (tail > seq)
+        {
+          m_scoreboard[seq] = tail;
+          m_sacked += tail - seq;
+          break;
+        }
+    }
+}
+
+/* RFC3517 IsLost (): an unSACKed byte is lost when three discontiguous
+   ranges, or three segments worth of bytes, are SACKed above it. Walking
+   the scoreboard down from the top, the first range for which this holds
+   bounds the lost bytes: all the unSACKed bytes below it are lost. */
+SequenceNumber32
+TcpSack::LostEdge (uint32_t& sackedBelow) const
+{
+  uint32_t sackedAbove = 0;
+  uint32_t ranges = 0;
+  for (Scoreboard::const_reverse_iterator i = m_scoreboard.rbegin (); i != m_scoreboard.rend (); ++i)
+    {
+      sackedAbove += i->second - i->first;
+      if (++ranges >= 3 || sackedAbove >= 3 * m_segmentSize)
+        {
+          sackedBelow = m_sacked - sackedAbove;
+          return i->first;
+        }
+    }
+  sackedBelow = 0;
+  return m_txBuffer.HeadSequence ();
+}
+
+/* RFC3517 SetPipe (): the bytes between the highest ACK and the highest
+   data sent which are neither SACKed nor lost, plus those which were
+   retransmitted and not SACKed since. */
+uint32_t
+TcpSack::Pipe (void) const
+{
+  SequenceNumber32 highAck = m_txBuffer.HeadSequence ();
+  uint32_t sackedBelow;
+  SequenceNumber32 lostEdge = LostEdge (sackedBelow);
+  uint32_t pipe = (m_highTxMark - highAck) - m_sacked;
+  pipe -= (lostEdge - highAck) - sackedBelow;
+  if (m_highRxt > highAck)
+    {
+      SequenceNumber32 highRxt = std::min (m_highRxt, m_highTxMark);
+      uint32_t retransmitted = highRxt - highAck;
+      for (Scoreboard::const_iterator i = m_scoreboard.begin ();
+           i != m_scoreboard.end () && i->first < highRxt; ++i)
+        {
+          retransmitted -= std::min (i->second, highRxt) - i->first;
+        }
+      pipe += retransmitted;
+    }
+  return pipe;
+}
+
+/* RFC3517 NextSeg () rule 1: the first unSACKed byte above the highest
+   retransmission which is lost, and the size of the segment to send
+   from there, which stops at the next SACKed range. */
+bool
+TcpSack::NextLostSegment (SequenceNumber32& seq, uint32_t& size) const
+{
+  uint32_t sackedBelow;
+  SequenceNumber32 lostEdge = LostEdge (sackedBelow);
+  SequenceNumber32 next = std::max (m_highRxt, m_txBuffer.HeadSequence ());
+  Scoreboard::const_iterator i = m_scoreboard.upper_bound (next);
+  if (i != m_scoreboard.begin ())
+    { // Skip the SACKed range next is in, if any
+      Scoreboard::const_iterator prev = i;
+      --prev;
+      next = std::max (next, prev->second);
+    }
+  if (next >= lostEdge)
+    {
+      return false;
+    }
+  seq = next;
+  size = m_segmentSize;
+  if (i != m_scoreboard.end ())
+    {
+      size = std::min<uint32_t> (size, i->first - next);
+    }
+  return true;
+}
+
+} // namespace ns3
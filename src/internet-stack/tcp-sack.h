@@ -0,0 +1,75 @@
+/* -*-  Mode: C++; c-file-style: "gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TCP_SACK_H
+#define TCP_SACK_H
+
+#include <map>
+#include "tcp-newreno.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup socket
+ * \ingroup tcp
+ *
+ * \brief An implementation of a stream socket using TCP.
+ *
+ * This class contains the SACK-based loss recovery of RFC3517 on top of
+ * the NewReno congestion control. The scoreboard holds the ranges which
+ * the receiver reported in SACK options, and the number of bytes in the
+ * network ("pipe") is derived from it, so that several holes can be
+ * repaired within one round-trip time. SACK must be negotiated on the
+ * connection, see the UseSack attribute of TcpSocketBase; without it,
+ * this class behaves as TcpNewReno.
+ */
+class TcpSack : public TcpNewReno
+{
+public:
+  static TypeId GetTypeId (void);
+  /**
+   * Create an unbound tcp socket.
+   */
+  TcpSack (void);
+  TcpSack (const TcpSack& sock);
+  virtual ~TcpSack (void);
+
+protected:
+  virtual Ptr<TcpSocketBase> Fork (void); // Call CopyObject<TcpSack> to clone me
+  virtual void ReceivedAck (Ptr<Packet>, const TcpHeader&); // Update the scoreboard, then process the ACK
+  virtual void NewAck (SequenceNumber32 const& seq); // Exit recovery on a full ACK, or repair more holes
+  virtual void DupAck (const TcpHeader& t, uint32_t count); // Enter recovery, or send as pipe allows
+  virtual void Retransmit (void); // Forget the scoreboard upon retransmit timeout
+  virtual uint32_t AvailableWindow (void); // During recovery, cwnd minus pipe
+
+private:
+  void UpdateScoreboard (SequenceNumber32 head, SequenceNumber32 tail); // Record a SACK block
+  void DiscardScoreboardUpTo (SequenceNumber32 seq); // Forget the ranges below the highest ACK
+  SequenceNumber32 LostEdge (uint32_t& sackedBelow) const; // Unsacked bytes below it are lost
+  uint32_t Pipe (void) const; // RFC3517 SetPipe (): estimate of the bytes in the network
+  bool NextLostSegment (SequenceNumber32& seq, uint32_t& size) const; // RFC3517 NextSeg () rule 1
+  void SendDuringRecovery (void); // Retransmit lost data, then new data, while pipe allows
+
+  typedef std::map<SequenceNumber32, SequenceNumber32> Scoreboard;
+  Scoreboard       m_scoreboard; //< SACKed ranges above the highest ACK: first byte to end
+  uint32_t         m_sacked;     //< Number of bytes in the scoreboard
+  SequenceNumber32 m_highRxt;    //< Highest seqno retransmitted during this recovery
+  uint32_t         m_sackDupAcks; //< ACKs of the head which SACKed new data
+};
+
+} // namespace ns3
+
+#endif /* TCP_SACK_H */
@@ -33,6 +33,7 @@
 #include "ns3/simulator.h"
 #include "ns3/packet.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
 #include "ns3/trace-source-accessor.h"
 #include "tcp-socket-base.h"
 #include "tcp-l4-protocol.h"
@@ -66,7 +67,26 @@ TcpSocketBase::GetTypeId (void)
                    UintegerValue (0),
                    MakeUintegerAccessor (&TcpSocketBase::m_fixedTcpWindowSize),
                    MakeUintegerChecker<uint16_t> ())
-
+    .AddAttribute ("UseEcn",
+                   "Negotiate Explicit Congestion Notification (RFC 3168) on new connections",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TcpSocketBase::m_useEcn),
+                   MakeBooleanChecker ())
+    .AddAttribute ("UseSack",
+                   "Negotiate selective acknowledgements (RFC 2018) on new connections",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TcpSocketBase::m_useSack),
+                   MakeBooleanChecker ())
+    .AddAttribute ("UseWindowScaling",
+                   "Negotiate window scaling (RFC 1323) on new connections",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TcpSocketBase::m_useWinScale),
+                   MakeBooleanChecker ())
+    .AddAttribute ("UseTimestamps",
+                   "Negotiate timestamps (RFC 1323) on new connections, and measure the RTT with them",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TcpSocketBase::m_useTimestamps),
+                   MakeBooleanChecker ())
   ;
   return tid;
 }
@@ -92,7 +112,17 @@ TcpSocketBase::TcpSocketBase (void)
     m_segmentSize (0),          // For attribute initialization consistency (quiet valgrind)
     m_rxWindowSize (0),
     m_ngwa_bandwidth (0),
-    m_ngwa_avgbandwidth (0)
+    m_ngwa_avgbandwidth (0),
+    m_ecnEnabled (false),
+    m_ecnEcho (false),
+    m_ecnCwr (false),
+    m_ecnRecover (0),
+    m_sackEnabled (false),
+    m_winScaleEnabled (false),
+    m_sndWindShift (0),
+    m_rcvWindShift (0),
+    m_timestampEnabled (false),
+    m_timestampToEcho (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -122,7 +152,24 @@ TcpSocketBase::TcpSocketBase (const TcpSocketBase& sock)
     m_shutdownRecv (sock.m_shutdownRecv),
     m_connected (sock.m_connected),
     m_segmentSize (sock.m_segmentSize),
-    m_rxWindowSize (sock.m_rxWindowSize)
+    m_rxWindowSize (sock.m_rxWindowSize),
+    m_ngwa_bandwidth (0),
+    m_ngwa_avgbandwidth (0),
+    m_fixedTcpWindowSize (sock.m_fixedTcpWindowSize),
+    m_useEcn (sock.m_useEcn),
+    m_ecnEnabled (false),
+    m_ecnEcho (false),
+    m_ecnCwr (false),
+    m_ecnRecover (0),
+    m_useSack (sock.m_useSack),
+    m_sackEnabled (false),
+    m_useWinScale (sock.m_useWinScale),
+    m_winScaleEnabled (false),
+    m_sndWindShift (0),
+    m_rcvWindShift (0),
+    m_useTimestamps (sock.m_useTimestamps),
+    m_timestampEnabled (false),
+    m_timestampToEcho (0)
 {
   NS_LOG_FUNCTION (this);
   NS_LOG_LOGIC ("Invoked the copy constructor");
@@ -482,7 +529,7 @@ TcpSocketBase::DoConnect (void)
   // A new connection is allowed only if this socket does not have a connection
   if (m_state == CLOSED || m_state == LISTEN || m_state == SYN_SENT || m_state == LAST_ACK || m_state == CLOSE_WAIT)
     { // send a SYN packet and change state into SYN_SENT
-      SendEmptyPacket (TcpHeader::SYN);
+      SendEmptyPacket (m_useEcn ? TcpHeader::SYN | TcpHeader::ECE | TcpHeader::CWR : TcpHeader::SYN);
       NS_LOG_INFO (TcpStateName[m_state] << " -> SYN_SENT");
       m_state = SYN_SENT;
     }
@@ -608,6 +655,32 @@ TcpSocketBase::ForwardUp (Ptr<Packet> packet, Ipv4Header header, uint16_t port,
       m_persistEvent.Cancel ();
     }
   m_rxWindowSize = tcpHeader.GetWindowSize ();
+  if (m_winScaleEnabled && !(tcpHeader.GetFlags () & TcpHeader::SYN))
+    { // The window of a SYN is never scaled (RFC 1323, sec. 2.2)
+      m_rxWindowSize <<= m_sndWindShift;
+    }
+
+  // Remember the timestamp to echo in TSecr (RFC 1323, sec. 3.4)
+  if (m_timestampEnabled && tcpHeader.HasOption (TcpOption::TS)
+      && tcpHeader.GetSequenceNumber () <= m_rxBuffer.NextRxSequence ())
+    {
+      m_timestampToEcho = DynamicCast<const TcpOptionTS> (tcpHeader.GetOption (TcpOption::TS))->GetTimestamp ();
+    }
+
+  // ECN receiver side (RFC 3168, sec. 6.1.3): echo a CE mark in ECE until
+  // the peer says it has reduced its window with CWR
+  if (m_ecnEnabled)
+    {
+      if (tcpHeader.GetFlags () & TcpHeader::CWR)
+        {
+          m_ecnEcho = false;
+        }
+      if (header.GetEcn () == Ipv4Header::ECN_CE)
+        {
+          NS_LOG_LOGIC (this << " Received CE, echo ECE to the sender");
+          m_ecnEcho = true;
+        }
+    }
 
   // Discard out of range packets
   if (OutOfRange (tcpHeader.GetSequenceNumber ()))
@@ -634,7 +707,7 @@ TcpSocketBase::ForwardUp (Ptr<Packet> packet, Ipv4Header header, uint16_t port,
       break;
     case CLOSED:
       // Send RST if the incoming packet is not a RST
-      if ((tcpHeader.GetFlags () & ~(TcpHeader::PSH | TcpHeader::URG)) != TcpHeader::RST)
+      if ((tcpHeader.GetFlags () & ~(TcpHeader::PSH | TcpHeader::URG | TcpHeader::CWR | TcpHeader::ECE)) != TcpHeader::RST)
         {
           SendRST ();
         }
@@ -668,8 +741,9 @@ TcpSocketBase::ProcessEstablished (Ptr<Packet> packet, const TcpHeader& tcpHeade
 {
   NS_LOG_FUNCTION (this << tcpHeader);
 
-  // Extract the flags. PSH and URG are not honoured.
-  uint8_t tcpflags = tcpHeader.GetFlags () & ~(TcpHeader::PSH | TcpHeader::URG);
+  // Extract the flags. PSH and URG are not honoured, ECE and CWR are
+  // handled in ForwardUp () and ReceivedAck ().
+  uint8_t tcpflags = tcpHeader.GetFlags () & ~(TcpHeader::PSH | TcpHeader::URG | TcpHeader::CWR | TcpHeader::ECE);
 
   // Different flags are different events
   if (tcpflags == TcpHeader::ACK)
@@ -713,6 +787,17 @@ TcpSocketBase::ReceivedAck (Ptr<Packet> packet, const TcpHeader& tcpHeader)
 {
   NS_LOG_FUNCTION (this << tcpHeader);
 
+  // ECN sender side: react to ECE at most once per window of data
+  if (m_ecnEnabled && (tcpHeader.GetFlags () & TcpHeader::ECE)
+      && (tcpHeader.GetFlags () & TcpHeader::ACK)
+      && tcpHeader.GetAckNumber () > m_ecnRecover)
+    {
+      NS_LOG_LOGIC (this << " Received ECE, reducing the congestion window");
+      m_ecnRecover = m_highTxMark;
+      m_ecnCwr = true;
+      EceReceived ();
+    }
+
   // Received ACK. Compare the ACK number against highest unacked seqno
   if (0 == (tcpHeader.GetFlags () & TcpHeader::ACK))
     { // Ignore if no ACK flag
@@ -757,8 +842,9 @@ TcpSocketBase::ProcessListen (Ptr<Packet> packet, const TcpHeader& tcpHeader,
 {
   NS_LOG_FUNCTION (this << tcpHeader);
 
-  // Extract the flags. PSH and URG are not honoured.
-  uint8_t tcpflags = tcpHeader.GetFlags () & ~(TcpHeader::PSH | TcpHeader::URG);
+  // Extract the flags. PSH and URG are not honoured, ECE and CWR are
+  // handled in ForwardUp () and ReceivedAck ().
+  uint8_t tcpflags = tcpHeader.GetFlags () & ~(TcpHeader::PSH | TcpHeader::URG | TcpHeader::CWR | TcpHeader::ECE);
 
   // Fork a socket if received a SYN. Do nothing otherwise.
   // C.f.: the LISTEN part in tcp_v4_do_rcv() in tcp_ipv4.c in Linux kernel
@@ -780,8 +866,9 @@ TcpSocketBase::ProcessSynSent (Ptr<Packet> packet, const TcpHeader& tcpHeader)
 {
   NS_LOG_FUNCTION (this << tcpHeader);
 
-  // Extract the flags. PSH and URG are not honoured.
-  uint8_t tcpflags = tcpHeader.GetFlags () & ~(TcpHeader::PSH | TcpHeader::URG);
+  // Extract the flags. PSH and URG are not honoured, ECE and CWR are
+  // handled in ForwardUp () and ReceivedAck ().
+  uint8_t tcpflags = tcpHeader.GetFlags () & ~(TcpHeader::PSH | TcpHeader::URG | TcpHeader::CWR | TcpHeader::ECE);
 
   if (tcpflags == 0)
     { // Bare data, accept it and move to ESTABLISHED state. This is not a normal behaviour. Remove this?
@@ -800,6 +887,7 @@ TcpSocketBase::ProcessSynSent (Ptr<Packet> packet, const TcpHeader& tcpHeader)
       NS_LOG_INFO ("SYN_SENT -> SYN_RCVD");
       m_state = SYN_RCVD;
       m_rxBuffer.SetNextRxSequence (tcpHeader.GetSequenceNumber () + SequenceNumber32 (1));
+      NegotiateOptions (tcpHeader);
       SendEmptyPacket (TcpHeader::SYN | TcpHeader::ACK);
     }
   else if (tcpflags == (TcpHeader::SYN | TcpHeader::ACK)
@@ -812,6 +900,11 @@ TcpSocketBase::ProcessSynSent (Ptr<Packet> packet, const TcpHeader& tcpHeader)
       m_rxBuffer.SetNextRxSequence (tcpHeader.GetSequenceNumber () + SequenceNumber32 (1));
       m_highTxMark = ++m_nextTxSequence;
       m_txBuffer.SetHeadSequence (m_nextTxSequence);
+      // An ECN-setup SYN+ACK has ECE set and CWR clear (RFC 3168, sec. 6.1.1)
+      m_ecnEnabled = m_useEcn
+        && (tcpHeader.GetFlags () & (TcpHeader::ECE | TcpHeader::CWR)) == TcpHeader::ECE;
+      m_ecnRecover = m_highTxMark;
+      NegotiateOptions (tcpHeader);
       SendEmptyPacket (TcpHeader::ACK);
       if (GetTxAvailable () > 0)
         {
@@ -838,8 +931,9 @@ TcpSocketBase::ProcessSynRcvd (Ptr<Packet> packet, const TcpHeader& tcpHeader,
 {
   NS_LOG_FUNCTION (this << tcpHeader);
 
-  // Extract the flags. PSH and URG are not honoured.
-  uint8_t tcpflags = tcpHeader.GetFlags () & ~(TcpHeader::PSH | TcpHeader::URG);
+  // Extract the flags. PSH and URG are not honoured, ECE and CWR are
+  // handled in ForwardUp () and ReceivedAck ().
+  uint8_t tcpflags = tcpHeader.GetFlags () & ~(TcpHeader::PSH | TcpHeader::URG | TcpHeader::CWR | TcpHeader::ECE);
 
   if (tcpflags == 0 ||
       (tcpflags == TcpHeader::ACK
@@ -863,7 +957,8 @@ TcpSocketBase::ProcessSynRcvd (Ptr<Packet> packet, const TcpHeader& tcpHeader,
   else if (tcpflags == TcpHeader::SYN)
     { // Probably the peer lost my SYN+ACK
       m_rxBuffer.SetNextRxSequence (tcpHeader.GetSequenceNumber () + SequenceNumber32 (1));
-      SendEmptyPacket (TcpHeader::SYN | TcpHeader::ACK);
+      SendEmptyPacket (m_ecnEnabled ? TcpHeader::SYN | TcpHeader::ACK | TcpHeader::ECE
+                       : TcpHeader::SYN | TcpHeader::ACK);
     }
   else if (tcpflags == (TcpHeader::FIN | TcpHeader::ACK))
     {
@@ -894,8 +989,9 @@ TcpSocketBase::ProcessWait (Ptr<Packet> packet, const TcpHeader& tcpHeader)
 {
   NS_LOG_FUNCTION (this << tcpHeader);
 
-  // Extract the flags. PSH and URG are not honoured.
-  uint8_t tcpflags = tcpHeader.GetFlags () & ~(TcpHeader::PSH | TcpHeader::URG);
+  // Extract the flags. PSH and URG are not honoured, ECE and CWR are
+  // handled in ForwardUp () and ReceivedAck ().
+  uint8_t tcpflags = tcpHeader.GetFlags () & ~(TcpHeader::PSH | TcpHeader::URG | TcpHeader::CWR | TcpHeader::ECE);
 
   if (packet->GetSize () > 0)
     { // Bare data, accept it
@@ -968,8 +1064,9 @@ TcpSocketBase::ProcessClosing (Ptr<Packet> packet, const TcpHeader& tcpHeader)
 {
   NS_LOG_FUNCTION (this << tcpHeader);
 
-  // Extract the flags. PSH and URG are not honoured.
-  uint8_t tcpflags = tcpHeader.GetFlags () & ~(TcpHeader::PSH | TcpHeader::URG);
+  // Extract the flags. PSH and URG are not honoured, ECE and CWR are
+  // handled in ForwardUp () and ReceivedAck ().
+  uint8_t tcpflags = tcpHeader.GetFlags () & ~(TcpHeader::PSH | TcpHeader::URG | TcpHeader::CWR | TcpHeader::ECE);
 
   if (tcpflags == TcpHeader::ACK)
     {
@@ -1004,8 +1101,9 @@ TcpSocketBase::ProcessLastAck (Ptr<Packet> packet, const TcpHeader& tcpHeader)
 {
   NS_LOG_FUNCTION (this << tcpHeader);
 
-  // Extract the flags. PSH and URG are not honoured.
-  uint8_t tcpflags = tcpHeader.GetFlags () & ~(TcpHeader::PSH | TcpHeader::URG);
+  // Extract the flags. PSH and URG are not honoured, ECE and CWR are
+  // handled in ForwardUp () and ReceivedAck ().
+  uint8_t tcpflags = tcpHeader.GetFlags () & ~(TcpHeader::PSH | TcpHeader::URG | TcpHeader::CWR | TcpHeader::ECE);
 
   if (tcpflags == 0)
     {
@@ -1146,12 +1244,18 @@ TcpSocketBase::SendEmptyPacket (uint8_t flags)
       ++s;
     }
 
+  if (m_ecnEcho && (flags & TcpHeader::ACK) && !(flags & TcpHeader::SYN))
+    {
+      flags |= TcpHeader::ECE;
+    }
+
   header.SetFlags (flags);
   header.SetSequenceNumber (s);
   header.SetAckNumber (m_rxBuffer.NextRxSequence ());
   header.SetSourcePort (m_endPoint->GetLocalPort ());
   header.SetDestinationPort (m_endPoint->GetPeerPort ());
-  header.SetWindowSize (AdvertisedWindowSize ());
+  header.SetWindowSize (AdvertisedWindowSize (header.GetFlags ()));
+  AddOptions (header);
   m_tcp->SendPacket (p, header, m_endPoint->GetLocalAddress (), m_endPoint->GetPeerAddress (), m_boundnetdevice);
   Time rto = m_rtt->RetransmitTimeout ();
   bool hasSyn = flags & TcpHeader::SYN;
@@ -1250,7 +1354,13 @@ TcpSocketBase::CompleteFork (Ptr<Packet> p, const TcpHeader& h,
   SetupCallback ();
   // Set the sequence number and send SYN+ACK
   m_rxBuffer.SetNextRxSequence (h.GetSequenceNumber () + SequenceNumber32 (1));
-  SendEmptyPacket (TcpHeader::SYN | TcpHeader::ACK);
+  // An ECN-setup SYN has both ECE and CWR set (RFC 3168, sec. 6.1.1)
+  m_ecnEnabled = m_useEcn
+    && (h.GetFlags () & (TcpHeader::ECE | TcpHeader::CWR)) == (TcpHeader::ECE | TcpHeader::CWR);
+  m_ecnRecover = m_nextTxSequence + SequenceNumber32 (1);
+  NegotiateOptions (h);
+  SendEmptyPacket (m_ecnEnabled ? TcpHeader::SYN | TcpHeader::ACK | TcpHeader::ECE
+                   : TcpHeader::SYN | TcpHeader::ACK);
 }
 
 void
@@ -1320,6 +1430,22 @@ TcpSocketBase::SendPendingData (bool withAck)
       if (withAck)
         {
           flags |= TcpHeader::ACK;
+          if (m_ecnEcho)
+            {
+              flags |= TcpHeader::ECE;
+            }
+        }
+      if (m_ecnEnabled)
+        { // New data is ECN-capable, and the first one after a window
+          // reduction tells the receiver to stop echoing ECE
+          if (m_ecnCwr)
+            {
+              flags |= TcpHeader::CWR;
+              m_ecnCwr = false;
+            }
+          SocketIpTosTag tosTag;
+          tosTag.SetTos (Ipv4Header::ECN_ECT0);
+          p->AddPacketTag (tosTag);
         }
       TcpHeader header;
       header.SetFlags (flags);
@@ -1327,7 +1453,8 @@ TcpSocketBase::SendPendingData (bool withAck)
       header.SetAckNumber (m_rxBuffer.NextRxSequence ());
       header.SetSourcePort (m_endPoint->GetLocalPort ());
       header.SetDestinationPort (m_endPoint->GetPeerPort ());
-      header.SetWindowSize (AdvertisedWindowSize ());
+      header.SetWindowSize (AdvertisedWindowSize (header.GetFlags ()));
+      AddOptions (header);
       if (m_retxEvent.IsExpired () )
         { // Schedule retransmit
           Time rto = m_rtt->RetransmitTimeout ();
@@ -1339,7 +1466,10 @@ TcpSocketBase::SendPendingData (bool withAck)
       NS_LOG_LOGIC ("Send packet via TcpL4Protocol with flags 0x" << std::hex << static_cast<uint32_t> (flags) << std::dec);
       m_tcp->SendPacket (p, header, m_endPoint->GetLocalAddress (),
                          m_endPoint->GetPeerAddress (), m_boundnetdevice);
-      m_rtt->SentSeq (m_nextTxSequence, sz);       // notify the RTT
+      if (!m_timestampEnabled)
+        {
+          m_rtt->SentSeq (m_nextTxSequence, sz);  // notify the RTT
+        }
       // Notify the application of the data being sent
       Simulator::ScheduleNow (&TcpSocketBase::NotifyDataSent, this, sz);
       nPacketsSent++;                             // Count sent this loop
@@ -1351,6 +1481,93 @@ TcpSocketBase::SendPendingData (bool withAck)
   return (nPacketsSent > 0);
 }
 
+/** Add the TCP options in use to an outgoing segment. A SYN offers the
+    options we would like to use, a SYN+ACK accepts those which the peer
+    offered (RFC 1323, sec. 1.3; RFC 2018, sec. 2) */
+void
+TcpSocketBase::AddOptions (TcpHeader& tcpHeader)
+{
+  uint8_t flags = tcpHeader.GetFlags ();
+  bool isSyn = flags & TcpHeader::SYN;
+  bool isSynAck = isSyn && (flags & TcpHeader::ACK);
+  if (isSyn)
+    {
+      if (isSynAck ? m_winScaleEnabled : (m_useWinScale && CanScaleWindow ()))
+        {
+          Ptr<TcpOptionWinScale> option = CreateObject<TcpOptionWinScale> ();
+          option->SetScale (CalculateWScale ());
+          tcpHeader.AppendOption (option);
+        }
+      if (isSynAck ? m_sackEnabled : m_useSack)
+        {
+          tcpHeader.AppendOption (CreateObject<TcpOptionSackPermitted> ());
+        }
+    }
+  if ((isSyn && !isSynAck) ? m_useTimestamps : m_timestampEnabled)
+    {
+      Ptr<TcpOptionTS> option = CreateObject<TcpOptionTS> ();
+      option->SetTimestamp (Simulator::Now ().GetMilliSeconds ());
+      option->SetEcho (m_timestampToEcho);
+      tcpHeader.AppendOption (option);
+    }
+  if (m_sackEnabled && !isSyn && (flags & TcpHeader::ACK))
+    { // Report the data received beyond RCV.NXT in as many blocks as fit
+      // next to the other options (RFC 2018, sec. 3 and 4)
+      TcpRxBuffer::SackList sacks = m_rxBuffer.GetSackList ();
+      if (!sacks.empty ())
+        {
+          Ptr<TcpOptionSack> option = CreateObject<TcpOptionSack> ();
+          uint32_t room = 60 - tcpHeader.GetSerializedSize ();
+          for (TcpRxBuffer::SackList::const_iterator i = sacks.begin ();
+               i != sacks.end () && option->GetSerializedSize () + 8 <= room; ++i)
+            {
+              option->AddSackBlock (*i);
+            }
+          tcpHeader.AppendOption (option);
+        }
+    }
+}
+
+/** Called with the SYN or SYN+ACK of the peer */
+void
+TcpSocketBase::NegotiateOptions (const TcpHeader& synHeader)
+{
+  NS_LOG_FUNCTION (this << synHeader);
+  m_winScaleEnabled = m_useWinScale && CanScaleWindow ()
+    && synHeader.HasOption (TcpOption::WINSCALE);
+  if (m_winScaleEnabled)
+    {
+      m_sndWindShift = DynamicCast<const TcpOptionWinScale> (synHeader.GetOption (TcpOption::WINSCALE))->GetScale ();
+      m_rcvWindShift = CalculateWScale ();
+      NS_LOG_LOGIC (this << " Window scaling: send shift " << (uint32_t) m_sndWindShift <<
+                    " receive shift " << (uint32_t) m_rcvWindShift);
+    }
+  m_timestampEnabled = m_useTimestamps && synHeader.HasOption (TcpOption::TS);
+  if (m_timestampEnabled)
+    {
+      m_timestampToEcho = DynamicCast<const TcpOptionTS> (synHeader.GetOption (TcpOption::TS))->GetTimestamp ();
+    }
+  m_sackEnabled = m_useSack && synHeader.HasOption (TcpOption::SACKPERMITTED);
+}
+
+bool
+TcpSocketBase::CanScaleWindow (void) const
+{
+  return Node::GlobalFixedTcpWindowSize () == 0 && Node::UseNGWA () == 0;
+}
+
+uint8_t
+TcpSocketBase::CalculateWScale (void) const
+{
+  uint32_t space = m_rxBuffer.MaxBufferSize ();
+  uint8_t scale = 0;
+  while (scale < 14 && (space >> scale) > 0xffff)
+    {
+      scale++;
+    }
+  return scale;
+}
+
 uint32_t
 TcpSocketBase::UnAckDataCount ()
 {
@@ -1477,7 +1694,7 @@ TcpSocketBase::DoNGWAModeWindowSize (int mode)
 }
 
 uint16_t
-TcpSocketBase::AdvertisedWindowSize ()
+TcpSocketBase::AdvertisedWindowSize (uint8_t flags)
 {
   if (Node::GlobalFixedTcpWindowSize () != 0)
     {
@@ -1487,7 +1704,12 @@ TcpSocketBase::AdvertisedWindowSize ()
     }
 
   uint32_t max = 0xffff;
-  uint16_t awnd = std::min (m_rxBuffer.MaxBufferSize () - m_rxBuffer.Size (), max);
+  uint32_t space = m_rxBuffer.MaxBufferSize () - m_rxBuffer.Size ();
+  if (m_winScaleEnabled && !(flags & TcpHeader::SYN))
+    { // The window of every segment but the SYNs is scaled (RFC 1323, sec. 2.2)
+      space >>= m_rcvWindShift;
+    }
+  uint16_t awnd = std::min (space, max);
 
   if (m_ngwa_bandwidth != 0)
     {
@@ -1561,9 +1783,21 @@ TcpSocketBase::ReceivedData (Ptr<Packet> p, const TcpHeader& tcpHeader)
 void
 TcpSocketBase::EstimateRtt (const TcpHeader& tcpHeader)
 {
-  // Use m_rtt for the estimation. Note, RTT of duplicated acknowledgement
-  // (which should be ignored) is handled by m_rtt. Once timestamp option
-  // is implemented, this function would be more elaborated.
+  // With timestamps, every ACK of new data gives a sample, retransmitted
+  // or not (RFC 1323, sec. 4). Otherwise use m_rtt for the estimation. Note,
+  // RTT of duplicated acknowledgement (which should be ignored) is handled
+  // by m_rtt.
+  if (m_timestampEnabled && tcpHeader.HasOption (TcpOption::TS))
+    {
+      if (tcpHeader.GetAckNumber () > m_txBuffer.HeadSequence ())
+        {
+          Ptr<const TcpOptionTS> ts = DynamicCast<const TcpOptionTS> (tcpHeader.GetOption (TcpOption::TS));
+          uint32_t now = Simulator::Now ().GetMilliSeconds ();
+          m_rtt->Measurement (MilliSeconds (now - ts->GetEcho ()));
+          m_rtt->ResetMultiplier ();
+        }
+      return;
+    }
   m_rtt->AckSeq (tcpHeader.GetAckNumber () );
 };
 
@@ -1672,7 +1906,8 @@ TcpSocketBase::PersistTimeout ()
   tcpHeader.SetAckNumber (m_rxBuffer.NextRxSequence ());
   tcpHeader.SetSourcePort (m_endPoint->GetLocalPort ());
   tcpHeader.SetDestinationPort (m_endPoint->GetPeerPort ());
-  tcpHeader.SetWindowSize (AdvertisedWindowSize ());
+  tcpHeader.SetWindowSize (AdvertisedWindowSize (tcpHeader.GetFlags ()));
+  AddOptions (tcpHeader);
 
   m_tcp->SendPacket (p, tcpHeader, m_endPoint->GetLocalAddress (),
                      m_endPoint->GetPeerAddress (), m_boundnetdevice);
@@ -1695,13 +1930,12 @@ void
 TcpSocketBase::DoRetransmit ()
 {
   NS_LOG_FUNCTION (this);
-  uint8_t flags = TcpHeader::ACK;
   // Retransmit SYN packet
   if (m_state == SYN_SENT)
     {
       if (m_cnCount > 0)
         {
-          SendEmptyPacket (TcpHeader::SYN);
+          SendEmptyPacket (m_useEcn ? TcpHeader::SYN | TcpHeader::ECE | TcpHeader::CWR : TcpHeader::SYN);
         }
       else
         {
@@ -1718,15 +1952,26 @@ TcpSocketBase::DoRetransmit ()
         }
       return;
     }
-  // Retransmit a data packet: Extract data
-  Ptr<Packet> p = m_txBuffer.CopyFromSequence (m_segmentSize, m_txBuffer.HeadSequence ());
+  // Retransmit a data packet
+  RetransmitSegment (m_txBuffer.HeadSequence (), m_segmentSize);
+}
+
+// Resend up to maxSize bytes of data from seq, which is already sent.
+// Also used by the SACK recovery to repair holes above the highest ACK.
+uint32_t
+TcpSocketBase::RetransmitSegment (SequenceNumber32 seq, uint32_t maxSize)
+{
+  NS_LOG_FUNCTION (this << seq << maxSize);
+  uint8_t flags = TcpHeader::ACK;
+  Ptr<Packet> p = m_txBuffer.CopyFromSequence (maxSize, seq);
+  uint32_t sz = p->GetSize (); // Size of packet
   // Close-on-Empty check
-  if (m_closeOnEmpty && m_txBuffer.Size () == p->GetSize ())
+  if (m_closeOnEmpty && m_txBuffer.SizeFromSequence (seq) == sz)
     {
       flags |= TcpHeader::FIN;
     }
   // Reset transmission timeout
-  NS_LOG_LOGIC ("TcpSocketBase " << this << " retxing seq " << m_txBuffer.HeadSequence ());
+  NS_LOG_LOGIC ("TcpSocketBase " << this << " retxing seq " << seq);
   if (m_retxEvent.IsExpired ())
     {
       Time rto = m_rtt->RetransmitTimeout ();
@@ -1735,18 +1980,34 @@ TcpSocketBase::DoRetransmit ()
                     (Simulator::Now () + rto).GetSeconds ());
       m_retxEvent = Simulator::Schedule (rto, &TcpSocketBase::ReTxTimeout, this);
     }
-  m_rtt->SentSeq (m_txBuffer.HeadSequence (), p->GetSize ());
+  if (!m_timestampEnabled)
+    {
+      m_rtt->SentSeq (seq, sz);
+    }
   // And send the packet
   TcpHeader tcpHeader;
-  tcpHeader.SetSequenceNumber (m_txBuffer.HeadSequence ());
+  tcpHeader.SetSequenceNumber (seq);
   tcpHeader.SetAckNumber (m_rxBuffer.NextRxSequence ());
   tcpHeader.SetSourcePort (m_endPoint->GetLocalPort ());
   tcpHeader.SetDestinationPort (m_endPoint->GetPeerPort ());
+  if (m_ecnEcho)
+    {
+      flags |= TcpHeader::ECE;
+    }
   tcpHeader.SetFlags (flags);
-  tcpHeader.SetWindowSize (AdvertisedWindowSize ());
+  tcpHeader.SetWindowSize (AdvertisedWindowSize (tcpHeader.GetFlags ()));
+  AddOptions (tcpHeader);
 
+  // Retransmissions are not ECN-capable (RFC 3168, sec. 6.1.5)
   m_tcp->SendPacket (p, tcpHeader, m_endPoint->GetLocalAddress (),
                      m_endPoint->GetPeerAddress (), m_boundnetdevice);
+  return sz;
+}
+
+void
+TcpSocketBase::EceReceived (void)
+{ // Without a congestion window there is nothing to reduce
+  NS_LOG_FUNCTION (this);
 }
 
 void
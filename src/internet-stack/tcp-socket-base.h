@@ -146,6 +146,7 @@ protected:
   void ForwardUp (Ptr<Packet> packet, Ipv4Header header, uint16_t port, Ptr<Ipv4Interface> incomingInterface); //Get a pkt from L3
   bool SendPendingData (bool withAck = false); // Send as much as the window allows
   void SendEmptyPacket (uint8_t flags); // Send a empty packet that carries a flag, e.g. ACK
+  uint32_t RetransmitSegment (SequenceNumber32 seq, uint32_t maxSize); // Resend up to maxSize bytes from seq, return the size sent
   void SendRST (void); // Send reset and tear down this socket
   bool OutOfRange (SequenceNumber32 s) const; // Check if a sequence number is within rx window
 
@@ -167,6 +168,12 @@ protected:
   void ProcessClosing (Ptr<Packet>, const TcpHeader&); // Received a packet upon CLOSING
   void ProcessLastAck (Ptr<Packet>, const TcpHeader&); // Received a packet upon LAST_ACK
 
+  // TCP options: window scaling, timestamps (RFC 1323) and SACK (RFC 2018)
+  void AddOptions (TcpHeader& tcpHeader); // Add the options negotiated, or offered in a SYN, to an outgoing segment
+  void NegotiateOptions (const TcpHeader& synHeader); // Enable the options we offer that the peer's SYN offers too
+  bool CanScaleWindow (void) const; // Window scaling is not used with the fixed and NGWA windows
+  uint8_t CalculateWScale (void) const; // Smallest shift which makes the Rx buffer fit in the window field
+
   // Window management
   virtual uint32_t UnAckDataCount (void);       // Return count of number of unacked bytes
   virtual uint32_t BytesInFlight (void);        // Return total bytes in flight
@@ -177,7 +184,7 @@ protected:
   uint32_t DoNGWAModeWindowSize (int mode); // do general action for modes
   void NGWA_filter_bandwidth (uint32_t w); // apply low-pass filter in ngwa
 
-  virtual uint16_t AdvertisedWindowSize (void); // The amount of Rx window announced to the peer
+  virtual uint16_t AdvertisedWindowSize (uint8_t flags); // The amount of Rx window announced to the peer in a segment with these flags
 
   // Manage data tx/rx
   virtual Ptr<TcpSocketBase> Fork (void) = 0; // Call CopyObject<> to clone me
@@ -192,6 +199,7 @@ protected:
   virtual void LastAckTimeout (void); // Timeout at LAST_ACK, close the connection
   virtual void PersistTimeout (void); // Send 1 byte probe to get an updated window size
   virtual void DoRetransmit (void); // Retransmit the oldest packet
+  virtual void EceReceived (void); // Peer echoed a CE mark: reduce cwnd as for a loss, once per window
 
 protected:
   // Counters and events
@@ -244,6 +252,24 @@ protected:
 
   TracedValue<uint32_t>  m_allowedWnd;         //< the effective window used by transmitter
   uint16_t m_fixedTcpWindowSize; // to be compatible with ns-2 and run RED tests
+
+  // Explicit Congestion Notification (RFC 3168)
+  bool             m_useEcn;      //< Ask for ECN on connection setup
+  bool             m_ecnEnabled;  //< ECN negotiated with the peer
+  bool             m_ecnEcho;     //< Received CE, set ECE until the peer sends CWR
+  bool             m_ecnCwr;      //< Window reduced, set CWR on the next new data
+  SequenceNumber32 m_ecnRecover;  //< Ignore ECE until this seqno is acked
+
+  // TCP options
+  bool     m_useSack;          //< Offer SACK on connection setup
+  bool     m_sackEnabled;      //< SACK negotiated with the peer
+  bool     m_useWinScale;      //< Offer window scaling on connection setup
+  bool     m_winScaleEnabled;  //< Window scaling negotiated with the peer
+  uint8_t  m_sndWindShift;     //< Shift applied to the windows received from the peer
+  uint8_t  m_rcvWindShift;     //< Shift applied to the windows advertised to the peer
+  bool     m_useTimestamps;    //< Offer timestamps on connection setup
+  bool     m_timestampEnabled; //< Timestamps negotiated with the peer
+  uint32_t m_timestampToEcho;  //< Peer timestamp to echo in TSecr
 };
 
 } // namespace ns3
@@ -33,7 +33,12 @@
 #include "ns3/node.h"
 #include "ns3/inet-socket-address.h"
 #include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/type-id.h"
+#include "ns3/error-model.h"
+#include "ns3/ipv4-header.h"
 #include "ns3/log.h"
+#include "ns3/random-variable.h"
 
 #include "ipv4-end-point.h"
 #include "arp-l3-protocol.h"
@@ -41,13 +46,160 @@
 #include "icmpv4-l4-protocol.h"
 #include "udp-l4-protocol.h"
 #include "tcp-l4-protocol.h"
+#include "tcp-tx-buffer.h"
+#include "tcp-rx-buffer.h"
+#include "tcp-option.h"
+#include "tcp-sack.h"
 
 #include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <string.h>
 
 NS_LOG_COMPONENT_DEFINE("TcpTestSuite");
 
 namespace ns3 {
 
+// Drops or marks Congestion Experienced the first transmission of some
+// data segments, counted in the order in which the device receives them,
+// and records which segments were retransmitted and which options and
+// ECN bits they carried.
+class TcpSegmentInspector : public ErrorModel
+{
+public:
+  TcpSegmentInspector ();
+  void DropNewSegment (uint32_t index);
+  void MarkNewSegment (uint32_t index);
+
+  uint32_t m_dropped;          // data segments dropped
+  uint32_t m_retransmitted;    // data segments received more than once
+  uint32_t m_withSack;         // segments carrying SACK blocks
+  uint32_t m_withoutTimestamp; // segments without the timestamps option
+  uint32_t m_marked;           // data segments marked CE
+  uint32_t m_withEct;          // new data segments sent ECN-capable
+  uint32_t m_withoutEct;       // new data segments not ECN-capable
+  uint32_t m_withEce;          // segments other than SYNs with ECE set
+  uint32_t m_withCwr;          // segments other than SYNs with CWR set
+  uint8_t m_synFlags;          // flags of the last SYN
+  uint8_t m_synAckFlags;       // flags of the last SYN+ACK
+private:
+  virtual bool DoCorrupt (Ptr<Packet> p);
+  virtual void DoReset (void);
+
+  uint32_t m_newSegments;
+  std::set<uint32_t> m_toDrop;
+  std::set<uint32_t> m_toMark;
+  std::set<SequenceNumber32> m_seen;
+};
+
+TcpSegmentInspector::TcpSegmentInspector ()
+  : m_dropped (0),
+    m_retransmitted (0),
+    m_withSack (0),
+    m_withoutTimestamp (0),
+    m_marked (0),
+    m_withEct (0),
+    m_withoutEct (0),
+    m_withEce (0),
+    m_withCwr (0),
+    m_synFlags (0),
+    m_synAckFlags (0),
+    m_newSegments (0)
+{
+}
+
+void
+TcpSegmentInspector::DropNewSegment (uint32_t index)
+{
+  m_toDrop.insert (index);
+}
+
+void
+TcpSegmentInspector::MarkNewSegment (uint32_t index)
+{
+  m_toMark.insert (index);
+}
+
+bool
+TcpSegmentInspector::DoCorrupt (Ptr<Packet> p)
+{
+  Ipv4Header ipHeader;
+  TcpHeader tcpHeader;
+  if (p->GetSize () < ipHeader.GetSerializedSize () + tcpHeader.GetSerializedSize ())
+    {
+      return false; // ARP
+    }
+  Ptr<Packet> copy = p->Copy ();
+  copy->RemoveHeader (ipHeader);
+  if (ipHeader.GetProtocol () != TcpL4Protocol::PROT_NUMBER)
+    {
+      return false;
+    }
+  copy->RemoveHeader (tcpHeader);
+  if (!tcpHeader.HasOption (TcpOption::TS))
+    {
+      m_withoutTimestamp++;
+    }
+  if (tcpHeader.HasOption (TcpOption::SACK))
+    {
+      m_withSack++;
+    }
+  uint8_t flags = tcpHeader.GetFlags ();
+  if ((flags & (TcpHeader::SYN | TcpHeader::ACK)) == TcpHeader::SYN)
+    {
+      m_synFlags = flags;
+    }
+  else if (flags & TcpHeader::SYN)
+    {
+      m_synAckFlags = flags;
+    }
+  else
+    {
+      m_withEce += (flags & TcpHeader::ECE) ? 1 : 0;
+      m_withCwr += (flags & TcpHeader::CWR) ? 1 : 0;
+    }
+  if (copy->GetSize () == 0)
+    {
+      return false;
+    }
+  if (!m_seen.insert (tcpHeader.GetSequenceNumber ()).second)
+    {
+      m_retransmitted++;
+      return false;
+    }
+  uint32_t index = m_newSegments++;
+  if (m_toDrop.erase (index) > 0)
+    {
+      m_dropped++;
+      return true;
+    }
+  if (ipHeader.GetEcn () == Ipv4Header::ECN_NotECT)
+    {
+      m_withoutEct++;
+      return false;
+    }
+  m_withEct++;
+  if (m_toMark.erase (index) > 0)
+    {
+      // as a router would, in the packet handed up to IP
+      p->RemoveHeader (ipHeader);
+      ipHeader.SetEcn (Ipv4Header::ECN_CE);
+      if (Node::ChecksumEnabled ())
+        {
+          ipHeader.EnableChecksum ();
+        }
+      p->AddHeader (ipHeader);
+      m_marked++;
+    }
+  return false;
+}
+
+void
+TcpSegmentInspector::DoReset (void)
+{
+}
+
 class TcpTestCase : public TestCase
 {
 public:
@@ -55,14 +207,13 @@ public:
                uint32_t sourceWriteSize,
                uint32_t sourceReadSize,
                uint32_t serverWriteSize,
-               uint32_t serverReadSize);
+               uint32_t serverReadSize,
+               bool useSack = false);
 private:
   virtual bool DoRun (void);
   virtual void DoTeardown (void);
   void SetupDefaultSim (void);
 
-  Ptr<Node> CreateInternetNode (void);
-  Ptr<SimpleNetDevice> AddSimpleNetDevice (Ptr<Node> node, const char* ipaddr, const char* netmask);
   void ServerHandleConnectionCreated (Ptr<Socket> s, const Address & addr);
   void ServerHandleRecv (Ptr<Socket> sock);
   void ServerHandleSend (Ptr<Socket> sock, uint32_t available);
@@ -81,6 +232,9 @@ private:
   uint8_t *m_sourceTxPayload;
   uint8_t *m_sourceRxPayload;
   uint8_t* m_serverRxPayload;
+  bool m_useSack;
+  Ptr<TcpSegmentInspector> m_serverInspector;
+  Ptr<TcpSegmentInspector> m_sourceInspector;
 };
 
 static std::string Name (std::string str, uint32_t totalStreamSize,
@@ -109,8 +263,10 @@ TcpTestCase::TcpTestCase (uint32_t totalStreamSize,
                           uint32_t sourceWriteSize,
                           uint32_t sourceReadSize,
                           uint32_t serverWriteSize,
-                          uint32_t serverReadSize)
-  : TestCase (Name ("Send string data from client to server and back", 
+                          uint32_t serverReadSize,
+                          bool useSack)
+  : TestCase (Name (useSack ? "Send string data with SACK over a lossy link" :
+                    "Send string data from client to server and back", 
                     totalStreamSize, 
                     sourceWriteSize,
                     serverReadSize,
@@ -120,7 +276,8 @@ TcpTestCase::TcpTestCase (uint32_t totalStreamSize,
     m_sourceWriteSize (sourceWriteSize),
     m_sourceReadSize (sourceReadSize),
     m_serverWriteSize (serverWriteSize),
-    m_serverReadSize (serverReadSize)
+    m_serverReadSize (serverReadSize),
+    m_useSack (useSack)
 {}
 
 bool
@@ -152,6 +309,20 @@ TcpTestCase::DoRun (void)
                          "Server received expected data buffers");
   NS_TEST_EXPECT_MSG_EQ (memcmp (m_sourceTxPayload, m_sourceRxPayload, m_totalBytes), 0, 
                          "Source received back expected data buffers");
+  if (m_useSack)
+    {
+      // Each hole is repaired once, and no SACKed segment is sent again
+      NS_TEST_EXPECT_MSG_EQ (m_serverInspector->m_dropped, 4, "Segments to the server were not dropped");
+      NS_TEST_EXPECT_MSG_EQ (m_sourceInspector->m_dropped, 4, "Segments to the source were not dropped");
+      NS_TEST_EXPECT_MSG_EQ (m_serverInspector->m_retransmitted, 4, "Wrong number of retransmissions");
+      NS_TEST_EXPECT_MSG_EQ (m_sourceInspector->m_retransmitted, 4, "Wrong number of retransmissions");
+      NS_TEST_EXPECT_MSG_EQ ((m_serverInspector->m_withSack > 0), true, "The source sent no SACK blocks");
+      NS_TEST_EXPECT_MSG_EQ ((m_sourceInspector->m_withSack > 0), true, "The server sent no SACK blocks");
+      NS_TEST_EXPECT_MSG_EQ (m_serverInspector->m_withoutTimestamp, 0, "Segments without timestamps");
+      NS_TEST_EXPECT_MSG_EQ (m_sourceInspector->m_withoutTimestamp, 0, "Segments without timestamps");
+    }
+  m_serverInspector = 0;
+  m_sourceInspector = 0;
 
   return false;
 }
@@ -250,8 +421,8 @@ TcpTestCase::SourceHandleRecv (Ptr<Socket> sock)
     }
 }
 
-Ptr<Node>
-TcpTestCase::CreateInternetNode ()
+static Ptr<Node>
+CreateInternetNode (void)
 {
   Ptr<Node> node = CreateObject<Node> ();
   //ARP
@@ -277,8 +448,8 @@ TcpTestCase::CreateInternetNode ()
   return node;
 }
 
-Ptr<SimpleNetDevice>
-TcpTestCase::AddSimpleNetDevice (Ptr<Node> node, const char* ipaddr, const char* netmask)
+static Ptr<SimpleNetDevice>
+AddSimpleNetDevice (Ptr<Node> node, const char* ipaddr, const char* netmask)
 {
   Ptr<SimpleNetDevice> dev = CreateObject<SimpleNetDevice> ();
   dev->SetAddress (Mac48Address::ConvertFrom (Mac48Address::Allocate ()));
@@ -309,8 +480,36 @@ TcpTestCase::SetupDefaultSim (void)
   Ptr<SocketFactory> sockFactory0 = node0->GetObject<TcpSocketFactory> ();
   Ptr<SocketFactory> sockFactory1 = node1->GetObject<TcpSocketFactory> ();
 
+  if (m_useSack)
+    {
+      node0->GetObject<TcpL4Protocol> ()->SetAttribute ("SocketType", TypeIdValue (TcpSack::GetTypeId ()));
+      node1->GetObject<TcpL4Protocol> ()->SetAttribute ("SocketType", TypeIdValue (TcpSack::GetTypeId ()));
+      // A few holes within one window, in each direction
+      m_serverInspector = CreateObject<TcpSegmentInspector> ();
+      m_sourceInspector = CreateObject<TcpSegmentInspector> ();
+      for (uint32_t i = 30; i < 38; i += 2)
+        {
+          m_serverInspector->DropNewSegment (i);
+          m_sourceInspector->DropNewSegment (i);
+        }
+      dev0->SetReceiveErrorModel (m_serverInspector);
+      dev1->SetReceiveErrorModel (m_sourceInspector);
+    }
+
   Ptr<Socket> server = sockFactory0->CreateSocket();
   Ptr<Socket> source = sockFactory1->CreateSocket();
+  if (m_useSack)
+    {
+      // The accepted socket inherits the attributes of the listening one
+      Ptr<Socket> sockets[] = { server, source };
+      for (uint32_t i = 0; i < 2; i++)
+        {
+          sockets[i]->SetAttribute ("UseSack", BooleanValue (true));
+          sockets[i]->SetAttribute ("UseTimestamps", BooleanValue (true));
+          sockets[i]->SetAttribute ("UseWindowScaling", BooleanValue (true));
+          sockets[i]->SetAttribute ("RcvBufSize", UintegerValue (1 << 18));
+        }
+    }
 
   uint16_t port = 50000;
   InetSocketAddress serverlocaladdr (Ipv4Address::GetAny(), port);
@@ -327,6 +526,424 @@ TcpTestCase::SetupDefaultSim (void)
   source->Connect(serverremoteaddr);
 }
 
+// Sends a bulk transfer from the source to the server, with some
+// segments to the server marked Congestion Experienced when ECN is in
+// use, and checks the negotiation and the reaction of the source.
+class TcpEcnTestCase : public TestCase
+{
+public:
+  TcpEcnTestCase (bool sourceUsesEcn, bool serverUsesEcn);
+private:
+  virtual bool DoRun (void);
+  virtual void DoTeardown (void);
+  void ServerHandleConnectionCreated (Ptr<Socket> s, const Address & addr);
+  void ServerHandleRecv (Ptr<Socket> sock);
+  void SourceHandleSend (Ptr<Socket> sock, uint32_t available);
+  void CwndChange (uint32_t oldCwnd, uint32_t newCwnd);
+
+  bool m_sourceUsesEcn;
+  bool m_serverUsesEcn;
+  uint32_t m_totalBytes;
+  uint32_t m_currentSourceTxBytes;
+  uint32_t m_currentServerRxBytes;
+  uint32_t m_cwndReductions;
+};
+
+static std::string EcnName (bool sourceUsesEcn, bool serverUsesEcn)
+{
+  std::ostringstream oss;
+  oss << "Negotiate ECN and react to congestion marks source=" << (sourceUsesEcn ? "ecn" : "noecn")
+      << " server=" << (serverUsesEcn ? "ecn" : "noecn");
+  return oss.str ();
+}
+
+TcpEcnTestCase::TcpEcnTestCase (bool sourceUsesEcn, bool serverUsesEcn)
+  : TestCase (EcnName (sourceUsesEcn, serverUsesEcn)),
+    m_sourceUsesEcn (sourceUsesEcn),
+    m_serverUsesEcn (serverUsesEcn),
+    m_totalBytes (200000)
+{
+}
+
+bool
+TcpEcnTestCase::DoRun (void)
+{
+  m_currentSourceTxBytes = 0;
+  m_currentServerRxBytes = 0;
+  m_cwndReductions = 0;
+
+  Ptr<Node> node0 = CreateInternetNode ();
+  Ptr<Node> node1 = CreateInternetNode ();
+  Ptr<SimpleNetDevice> dev0 = AddSimpleNetDevice (node0, "192.168.1.1", "255.255.255.0");
+  Ptr<SimpleNetDevice> dev1 = AddSimpleNetDevice (node1, "192.168.1.2", "255.255.255.0");
+  Ptr<SimpleChannel> channel = CreateObject<SimpleChannel> ();
+  dev0->SetChannel (channel);
+  dev1->SetChannel (channel);
+
+  // Two congestion events: three segments sent back to back, then one
+  // much later
+  Ptr<TcpSegmentInspector> serverInspector = CreateObject<TcpSegmentInspector> ();
+  Ptr<TcpSegmentInspector> sourceInspector = CreateObject<TcpSegmentInspector> ();
+  serverInspector->MarkNewSegment (40);
+  serverInspector->MarkNewSegment (41);
+  serverInspector->MarkNewSegment (42);
+  serverInspector->MarkNewSegment (300);
+  dev0->SetReceiveErrorModel (serverInspector);
+  dev1->SetReceiveErrorModel (sourceInspector);
+
+  Ptr<Socket> server = node0->GetObject<TcpSocketFactory> ()->CreateSocket ();
+  Ptr<Socket> source = node1->GetObject<TcpSocketFactory> ()->CreateSocket ();
+  server->SetAttribute ("UseEcn", BooleanValue (m_serverUsesEcn));
+  source->SetAttribute ("UseEcn", BooleanValue (m_sourceUsesEcn));
+  source->TraceConnectWithoutContext ("CongestionWindow", MakeCallback (&TcpEcnTestCase::CwndChange, this));
+
+  uint16_t port = 50000;
+  server->Bind (InetSocketAddress (Ipv4Address::GetAny (), port));
+  server->Listen ();
+  server->SetAcceptCallback (MakeNullCallback<bool, Ptr< Socket >, const Address &> (),
+                             MakeCallback (&TcpEcnTestCase::ServerHandleConnectionCreated, this));
+  source->SetSendCallback (MakeCallback (&TcpEcnTestCase::SourceHandleSend, this));
+  source->Connect (InetSocketAddress (Ipv4Address ("192.168.1.1"), port));
+
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_currentServerRxBytes, m_totalBytes, "Server received all bytes");
+  NS_TEST_EXPECT_MSG_EQ (serverInspector->m_retransmitted, 0, "Marked segments were retransmitted");
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t)serverInspector->m_synFlags,
+                         (uint32_t)(m_sourceUsesEcn ? TcpHeader::SYN | TcpHeader::ECE | TcpHeader::CWR : TcpHeader::SYN),
+                         "Wrong SYN flags");
+  bool negotiated = m_sourceUsesEcn && m_serverUsesEcn;
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t)sourceInspector->m_synAckFlags,
+                         (uint32_t)(negotiated ? TcpHeader::SYN | TcpHeader::ACK | TcpHeader::ECE : TcpHeader::SYN | TcpHeader::ACK),
+                         "Wrong SYN+ACK flags");
+  if (negotiated)
+    {
+      NS_TEST_EXPECT_MSG_EQ (serverInspector->m_withoutEct, 0, "New data was not sent ECN-capable");
+      NS_TEST_EXPECT_MSG_EQ (serverInspector->m_marked, 4, "Wrong number of marked segments");
+      NS_TEST_EXPECT_MSG_EQ ((sourceInspector->m_withEce > 0), true, "The server did not echo the marks");
+      // one reduction and one CWR per window with marks, however many
+      // marks and echoes it had
+      NS_TEST_EXPECT_MSG_EQ (m_cwndReductions, 2, "Wrong number of congestion window reductions");
+      NS_TEST_EXPECT_MSG_EQ (serverInspector->m_withCwr, 2, "Wrong number of CWR segments");
+    }
+  else
+    {
+      NS_TEST_EXPECT_MSG_EQ (serverInspector->m_withEct, 0, "Data was sent ECN-capable without negotiation");
+      NS_TEST_EXPECT_MSG_EQ (serverInspector->m_marked, 0, "Segments were marked");
+      NS_TEST_EXPECT_MSG_EQ (sourceInspector->m_withEce, 0, "The server sent ECE");
+      NS_TEST_EXPECT_MSG_EQ (m_cwndReductions, 0, "The congestion window was reduced");
+      NS_TEST_EXPECT_MSG_EQ (serverInspector->m_withCwr, 0, "The source sent CWR");
+    }
+  return GetErrorStatus ();
+}
+
+void
+TcpEcnTestCase::DoTeardown (void)
+{
+  Simulator::Destroy ();
+}
+
+void
+TcpEcnTestCase::ServerHandleConnectionCreated (Ptr<Socket> s, const Address & addr)
+{
+  s->SetRecvCallback (MakeCallback (&TcpEcnTestCase::ServerHandleRecv, this));
+}
+
+void
+TcpEcnTestCase::ServerHandleRecv (Ptr<Socket> sock)
+{
+  Ptr<Packet> p;
+  while ((p = sock->Recv ()) != 0 && p->GetSize () > 0)
+    {
+      m_currentServerRxBytes += p->GetSize ();
+    }
+  if (m_currentServerRxBytes == m_totalBytes)
+    {
+      sock->Close ();
+    }
+}
+
+void
+TcpEcnTestCase::SourceHandleSend (Ptr<Socket> sock, uint32_t available)
+{
+  while (sock->GetTxAvailable () > 0 && m_currentSourceTxBytes < m_totalBytes)
+    {
+      uint32_t toSend = std::min (m_totalBytes - m_currentSourceTxBytes, sock->GetTxAvailable ());
+      int sent = sock->Send (Create<Packet> (toSend));
+      NS_TEST_EXPECT_MSG_EQ ((sent != -1), true, "Error during send ?");
+      m_currentSourceTxBytes += sent;
+    }
+  if (m_currentSourceTxBytes == m_totalBytes)
+    {
+      sock->Close ();
+    }
+}
+
+void
+TcpEcnTestCase::CwndChange (uint32_t oldCwnd, uint32_t newCwnd)
+{
+  if (newCwnd < oldCwnd)
+    {
+      m_cwndReductions++;
+    }
+}
+
+// Copies and discards data of a TcpTxBuffer made of packets of random
+// sizes, and checks the bytes against those written.
+class TcpTxBufferTestCase : public TestCase
+{
+public:
+  TcpTxBufferTestCase ();
+private:
+  virtual bool DoRun (void);
+};
+
+TcpTxBufferTestCase::TcpTxBufferTestCase ()
+  : TestCase ("TcpTxBuffer copies and discards")
+{
+}
+
+bool
+TcpTxBufferTestCase::DoRun (void)
+{
+  UniformVariable rng;
+  std::vector<uint8_t> stream (100000);
+  for (uint32_t i = 0; i < stream.size (); i++)
+    {
+      stream[i] = rng.GetInteger (0, 255);
+    }
+  TcpTxBuffer buffer (1000);
+  buffer.SetMaxBufferSize (20000);
+  uint32_t added = 0;
+  uint32_t head = 0;
+  while (head < stream.size ())
+    {
+      // the application fills the buffer with writes of random sizes
+      uint32_t size = std::min<uint32_t> (rng.GetInteger (1, 3000), stream.size () - added);
+      while (size > 0 && buffer.Add (Create<Packet> (&stream[added], size)))
+        {
+          added += size;
+          size = std::min<uint32_t> (rng.GetInteger (1, 3000), stream.size () - added);
+        }
+      NS_TEST_ASSERT_MSG_EQ (buffer.Size (), added - head, "Wrong size");
+
+      // segments are sent or retransmitted from anywhere in the buffer
+      for (uint32_t j = 0; j < 10; j++)
+        {
+          uint32_t offset = rng.GetInteger (0, added - head);
+          uint32_t numBytes = rng.GetInteger (0, 2000);
+          Ptr<Packet> p = buffer.CopyFromSequence (numBytes, SequenceNumber32 (1000 + head + offset));
+          uint32_t expected = std::min (numBytes, added - head - offset);
+          NS_TEST_ASSERT_MSG_EQ (p->GetSize (), expected, "Wrong segment size at offset " << offset);
+          std::vector<uint8_t> copy (expected + 1);
+          p->CopyData (&copy[0], expected);
+          NS_TEST_ASSERT_MSG_EQ (memcmp (&copy[0], &stream[head + offset], expected), 0,
+                                 "Wrong segment data at offset " << offset);
+        }
+
+      // and acknowledged up to a random sequence number
+      head += rng.GetInteger (0, added - head);
+      buffer.DiscardUpTo (SequenceNumber32 (1000 + head));
+      NS_TEST_ASSERT_MSG_EQ (buffer.HeadSequence (), SequenceNumber32 (1000 + head), "Wrong head");
+      NS_TEST_ASSERT_MSG_EQ (buffer.Size (), added - head, "Wrong size after a discard");
+      if (added == stream.size ())
+        {
+          head = added;
+          buffer.DiscardUpTo (SequenceNumber32 (1000 + head + 1)); // the FIN
+          NS_TEST_ASSERT_MSG_EQ (buffer.Size (), 0, "The buffer is not empty");
+          NS_TEST_ASSERT_MSG_EQ (buffer.HeadSequence (), SequenceNumber32 (1000 + head + 1), "Wrong head");
+        }
+    }
+  return GetErrorStatus ();
+}
+
+class TcpRxBufferTestCase : public TestCase
+{
+public:
+  TcpRxBufferTestCase ();
+private:
+  virtual bool DoRun (void);
+};
+
+TcpRxBufferTestCase::TcpRxBufferTestCase ()
+  : TestCase ("TcpRxBuffer reassembles and extracts")
+{
+}
+
+bool
+TcpRxBufferTestCase::DoRun (void)
+{
+  UniformVariable rng;
+  std::vector<uint8_t> stream (100000);
+  for (uint32_t i = 0; i < stream.size (); i++)
+    {
+      stream[i] = rng.GetInteger (0, 255);
+    }
+  std::vector<bool> received (stream.size (), false);
+  TcpRxBuffer buffer (1000);
+  buffer.SetMaxBufferSize (20000);
+  uint32_t read = 0;
+  uint32_t next = 0;
+  while (read < stream.size ())
+    {
+      // segments are lost, reordered and duplicated, but stay in the window
+      for (uint32_t j = 0; j < 10; j++)
+        {
+          uint32_t start = rng.GetInteger (0, 3) == 0 ? next : read + rng.GetInteger (0, 18500);
+          start = std::min<uint32_t> (start, stream.size () - 1);
+          uint32_t size = std::min<uint32_t> (rng.GetInteger (1, 1500), stream.size () - start);
+          TcpHeader header;
+          header.SetSequenceNumber (SequenceNumber32 (1000 + start));
+          buffer.Add (Create<Packet> (&stream[start], size), header);
+          std::fill (received.begin () + start, received.begin () + start + size, true);
+          while (next < stream.size () && received[next])
+            {
+              next++;
+            }
+        }
+      NS_TEST_ASSERT_MSG_EQ (buffer.NextRxSequence (), SequenceNumber32 (1000 + next), "Wrong next sequence");
+      NS_TEST_ASSERT_MSG_EQ (buffer.Available (), next - read, "Wrong available size");
+
+      // the blocks beyond the first missing byte are exactly the received ones
+      TcpRxBuffer::SackList sacks = buffer.GetSackList ();
+      uint32_t size = next - read;
+      uint32_t blocks = 0;
+      for (uint32_t i = next; i < stream.size (); i++)
+        {
+          if (received[i] && (i == 0 || !received[i - 1]))
+            {
+              blocks++;
+            }
+        }
+      NS_TEST_ASSERT_MSG_EQ (sacks.size (), blocks, "Wrong number of blocks");
+      for (TcpRxBuffer::SackList::const_iterator k = sacks.begin (); k != sacks.end (); ++k)
+        {
+          uint32_t first = k->first - SequenceNumber32 (1000);
+          uint32_t last = k->second - SequenceNumber32 (1000);
+          NS_TEST_ASSERT_MSG_EQ ((!received[first - 1] && received[first] && received[last - 1]), true,
+                                 "Wrong block [" << first << ":" << last << ")");
+          NS_TEST_ASSERT_MSG_EQ ((last == stream.size () || !received[last]), true,
+                                 "Wrong block end [" << first << ":" << last << ")");
+          size += last - first;
+        }
+      NS_TEST_ASSERT_MSG_EQ (buffer.Size (), size, "Wrong buffer size");
+
+      // and the application reads chunks of random sizes
+      uint32_t maxSize = rng.GetInteger (1, 10000);
+      Ptr<Packet> p = buffer.Extract (maxSize);
+      uint32_t expected = std::min (maxSize, next - read);
+      if (expected == 0)
+        {
+          NS_TEST_ASSERT_MSG_EQ (p, 0, "Extracted data beyond the first missing byte");
+          continue;
+        }
+      NS_TEST_ASSERT_MSG_EQ (p->GetSize (), expected, "Wrong extracted size at " << read);
+      std::vector<uint8_t> copy (expected);
+      p->CopyData (&copy[0], expected);
+      NS_TEST_ASSERT_MSG_EQ (memcmp (&copy[0], &stream[read], expected), 0,
+                             "Wrong extracted data at " << read);
+      read += expected;
+    }
+  NS_TEST_ASSERT_MSG_EQ (buffer.Size (), 0, "The buffer is not empty");
+  return GetErrorStatus ();
+}
+
+// Writes and reads back the options of a TcpHeader, and parses options
+// laid out as another implementation could send them.
+class TcpHeaderOptionsTestCase : public TestCase
+{
+public:
+  TcpHeaderOptionsTestCase ();
+private:
+  virtual bool DoRun (void);
+};
+
+TcpHeaderOptionsTestCase::TcpHeaderOptionsTestCase ()
+  : TestCase ("TcpHeader serializes and parses options")
+{
+}
+
+bool
+TcpHeaderOptionsTestCase::DoRun (void)
+{
+  TcpHeader header;
+  header.SetSequenceNumber (SequenceNumber32 (1000));
+  header.SetFlags (TcpHeader::ACK);
+  Ptr<TcpOptionTS> ts = CreateObject<TcpOptionTS> ();
+  ts->SetTimestamp (1234);
+  ts->SetEcho (5678);
+  NS_TEST_ASSERT_MSG_EQ (header.AppendOption (ts), true, "Could not add the timestamps");
+  Ptr<TcpOptionSack> sack = CreateObject<TcpOptionSack> ();
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      sack->AddSackBlock (TcpOptionSack::SackBlock (SequenceNumber32 (2000 + 1000 * i),
+                                                    SequenceNumber32 (2500 + 1000 * i)));
+    }
+  NS_TEST_ASSERT_MSG_EQ (header.AppendOption (sack), true, "Could not add the SACK blocks");
+  // Four blocks and the timestamps need 44 bytes: the three blocks stay
+  Ptr<TcpOptionSack> bigSack = CreateObject<TcpOptionSack> ();
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      bigSack->AddSackBlock (TcpOptionSack::SackBlock (SequenceNumber32 (i), SequenceNumber32 (i + 1)));
+    }
+  NS_TEST_ASSERT_MSG_EQ (header.AppendOption (bigSack), false, "Options beyond 40 bytes");
+  NS_TEST_ASSERT_MSG_EQ (header.GetLength (), 14, "Wrong header length");
+  NS_TEST_ASSERT_MSG_EQ (header.GetSerializedSize (), 56, "Wrong header size");
+
+  Ptr<Packet> p = Create<Packet> (100);
+  p->AddHeader (header);
+  TcpHeader parsed;
+  p->RemoveHeader (parsed);
+  NS_TEST_ASSERT_MSG_EQ (p->GetSize (), 100, "Wrong payload size");
+  NS_TEST_ASSERT_MSG_EQ (parsed.GetSequenceNumber (), SequenceNumber32 (1000), "Wrong sequence number");
+  NS_TEST_ASSERT_MSG_EQ (parsed.GetOptionList ().size (), 2, "Wrong number of options");
+  Ptr<const TcpOptionTS> parsedTs = DynamicCast<const TcpOptionTS> (parsed.GetOption (TcpOption::TS));
+  NS_TEST_ASSERT_MSG_NE (parsedTs, 0, "No timestamps");
+  NS_TEST_ASSERT_MSG_EQ (parsedTs->GetTimestamp (), 1234, "Wrong timestamp");
+  NS_TEST_ASSERT_MSG_EQ (parsedTs->GetEcho (), 5678, "Wrong echoed timestamp");
+  Ptr<const TcpOptionSack> parsedSack = DynamicCast<const TcpOptionSack> (parsed.GetOption (TcpOption::SACK));
+  NS_TEST_ASSERT_MSG_NE (parsedSack, 0, "No SACK blocks");
+  NS_TEST_ASSERT_MSG_EQ ((parsedSack->GetSackList () == sack->GetSackList ()), true, "Wrong SACK blocks");
+
+  // A SYN with options which are not a multiple of 4 bytes is padded
+  TcpHeader syn;
+  syn.SetFlags (TcpHeader::SYN);
+  Ptr<TcpOptionWinScale> ws = CreateObject<TcpOptionWinScale> ();
+  ws->SetScale (7);
+  syn.AppendOption (ws);
+  syn.AppendOption (CreateObject<TcpOptionSackPermitted> ());
+  NS_TEST_ASSERT_MSG_EQ (syn.GetSerializedSize (), 28, "Wrong padded header size");
+  p = Create<Packet> ();
+  p->AddHeader (syn);
+  p->RemoveHeader (parsed);
+  NS_TEST_ASSERT_MSG_EQ (p->GetSize (), 0, "Padding left in the payload");
+  NS_TEST_ASSERT_MSG_EQ (parsed.HasOption (TcpOption::SACKPERMITTED), true, "No SACK permitted");
+  Ptr<const TcpOptionWinScale> parsedWs = DynamicCast<const TcpOptionWinScale> (parsed.GetOption (TcpOption::WINSCALE));
+  NS_TEST_ASSERT_MSG_NE (parsedWs, 0, "No window scale");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) parsedWs->GetScale (), 7, "Wrong window scale");
+
+  // NOP, an unknown kind, then a window scale, as laid out by the sender
+  uint8_t raw[28] = { 0 };
+  raw[12] = 7 << 4; // data offset
+  uint8_t options[] = { TcpOption::NOP, 30, 4, 0xab, 0xcd, TcpOption::WINSCALE, 3, 20 };
+  memcpy (&raw[20], options, sizeof (options));
+  p = Create<Packet> (raw, sizeof (raw));
+  p->RemoveHeader (parsed);
+  NS_TEST_ASSERT_MSG_EQ (parsed.GetOptionList ().size (), 2, "Wrong number of options");
+  NS_TEST_ASSERT_MSG_EQ (parsed.HasOption (30), true, "Unknown option skipped");
+  parsedWs = DynamicCast<const TcpOptionWinScale> (parsed.GetOption (TcpOption::WINSCALE));
+  NS_TEST_ASSERT_MSG_NE (parsedWs, 0, "No window scale after an unknown option");
+  NS_TEST_ASSERT_MSG_EQ ((uint32_t) parsedWs->GetScale (), 14, "Window scale above 14");
+
+  // A zero length stops the parsing instead of looping
+  raw[22] = 0;
+  p = Create<Packet> (raw, sizeof (raw));
+  p->RemoveHeader (parsed);
+  NS_TEST_ASSERT_MSG_EQ (parsed.GetOptionList ().size (), 0, "Parsed a malformed option");
+  NS_TEST_ASSERT_MSG_EQ (parsed.GetLength (), 7, "Wrong header length");
+  return GetErrorStatus ();
+}
+
 static class TcpTestSuite : public TestSuite
 {
 public:
@@ -340,6 +957,13 @@ public:
       AddTestCase (new TcpTestCase (13, 200, 200, 200, 200));
       AddTestCase (new TcpTestCase (13, 1, 1, 1, 1));
       AddTestCase (new TcpTestCase (100000, 100, 50, 100, 20));
+      AddTestCase (new TcpTestCase (100000, 100, 50, 100, 20, true));
+      AddTestCase (new TcpEcnTestCase (true, true));
+      AddTestCase (new TcpEcnTestCase (true, false));
+      AddTestCase (new TcpEcnTestCase (false, true));
+      AddTestCase (new TcpHeaderOptionsTestCase);
+      AddTestCase (new TcpTxBufferTestCase);
+      AddTestCase (new TcpRxBufferTestCase);
     }
   
 } g_tcpTestSuite;
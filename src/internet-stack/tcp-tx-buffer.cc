@@ -38,7 +38,7 @@ namespace ns3 {
  * initialized below is insignificant.
  */
 TcpTxBuffer::TcpTxBuffer (uint32_t n)
-  : m_firstByteSeq(n), m_size (0), m_maxBuffer(32768), m_data (0)
+  : m_firstByteSeq(n), m_size (0), m_maxBuffer(32768), m_headOffset (0)
 {
 }
 
@@ -93,6 +93,7 @@ TcpTxBuffer::Add (Ptr<Packet> p)
       if (p->GetSize () > 0)
         {
           m_data.push_back (p);
+          m_offsets.push_back (m_headOffset + m_size);
           m_size += p->GetSize ();
           NS_LOG_LOGIC ("Updated size=" << m_size << ", lastSeq=" << m_firstByteSeq + SequenceNumber32 (m_size));
         }
@@ -128,55 +129,34 @@ TcpTxBuffer::CopyFromSequence (uint32_t numBytes, const SequenceNumber32& seq)
       return Create<Packet> (s);
     }
 
-  // Extract data from the buffer and return
-  uint32_t offset = seq - m_firstByteSeq;
-  uint32_t count = 0;      // Offset of the first byte of a packet in the buffer
-  uint32_t pktSize = 0;
-  bool beginFound = false;
-  int pktCount = 0;
-  Ptr<Packet> outPacket;
-  NS_LOG_LOGIC ("There are " << m_data.size () << " number of packets in buffer");
-  for (BufIterator i = m_data.begin (); i != m_data.end (); ++i)
+  // Find the last packet which starts at or before seq
+  uint64_t offset = m_headOffset + static_cast<uint32_t> (seq - m_firstByteSeq);
+  std::deque<uint64_t>::const_iterator start = std::upper_bound (m_offsets.begin (), m_offsets.end (), offset);
+  NS_ASSERT (start != m_offsets.begin ());
+  uint32_t i = start - m_offsets.begin () - 1;
+  uint32_t packetOffset = offset - m_offsets[i];
+  uint32_t fragmentLength = m_data[i]->GetSize () - packetOffset;
+  NS_LOG_LOGIC ("First byte found in packet #" << i << " of " << m_data.size () << " at stream offset " << m_offsets[i]
+                << ", packet len=" << m_data[i]->GetSize ());
+  if (fragmentLength >= s)
+    { // Data to be copied falls entirely in this packet
+      return m_data[i]->CreateFragment (packetOffset, s);
+    }
+  // This packet only fulfills part of the request: append the next ones
+  Ptr<Packet> outPacket = m_data[i]->CreateFragment (packetOffset, fragmentLength);
+  while (outPacket->GetSize () < s)
     {
-      pktCount++;
-      pktSize = (*i)->GetSize ();
-      if (!beginFound)
-        { // Look for first fragment
-          if (count + pktSize > offset)
-            {
-              NS_LOG_LOGIC ("First byte found in packet #" << pktCount << " at buffer offset " << count
-                            << ", packet len=" << pktSize);
-              beginFound = true;
-              uint32_t packetOffset = offset - count;
-              uint32_t fragmentLength = count + pktSize - offset;
-              if (fragmentLength >= s)
-                { // Data to be copied falls entirely in this packet
-                  return (*i)->CreateFragment (packetOffset, s);
-                }
-              else
-                { // This packet only fulfills part of the request
-                  outPacket = (*i)->CreateFragment (packetOffset, fragmentLength);
-                }
-              NS_LOG_LOGIC ("Output packet is now of size " << outPacket->GetSize ());
-            }
-        }
-      else if (count + pktSize >= offset + s)
+      i++;
+      uint32_t remaining = s - outPacket->GetSize ();
+      if (m_data[i]->GetSize () > remaining)
         { // Last packet fragment found
-          NS_LOG_LOGIC ("Last byte found in packet #" << pktCount << " at buffer offset " << count
-                        << ", packet len=" << pktSize);
-          uint32_t fragmentLength = offset + s - count;
-          Ptr<Packet> endFragment = (*i)->CreateFragment (0, fragmentLength);
-          outPacket->AddAtEnd (endFragment);
-          NS_LOG_LOGIC ("Output packet is now of size " << outPacket->GetSize ());
-          break;
+          outPacket->AddAtEnd (m_data[i]->CreateFragment (0, remaining));
         }
       else
         {
-          NS_LOG_LOGIC ("Appending to output the packet #" << pktCount << " of offset " << count << " len=" << pktSize);
-          outPacket->AddAtEnd (*i);
-          NS_LOG_LOGIC ("Output packet is now of size " << outPacket->GetSize ());
+          outPacket->AddAtEnd (m_data[i]);
         }
-      count += pktSize;
+      NS_LOG_LOGIC ("Output packet is now of size " << outPacket->GetSize ());
     }
   NS_ASSERT (outPacket->GetSize () == s);
   return outPacket;
@@ -198,31 +178,17 @@ TcpTxBuffer::DiscardUpTo (const SequenceNumber32& seq)
   // Cases do not need to scan the buffer
   if (m_firstByteSeq >= seq) return;
 
-  // Scan the buffer and discard packets
-  uint32_t offset = seq - m_firstByteSeq;  // Number of bytes to remove
-  uint32_t pktSize;
+  // Move the head, then drop the packets which are entirely behind it
+  uint32_t offset = std::min<uint32_t> (seq - m_firstByteSeq, m_size);
+  m_headOffset += offset;
+  m_size -= offset;
+  m_firstByteSeq += offset;
   NS_LOG_LOGIC ("Offset=" << offset);
-  BufIterator i = m_data.begin ();
-  while (i != m_data.end ())
+  while (!m_data.empty () && m_offsets.front () + m_data.front ()->GetSize () <= m_headOffset)
     {
-      if (offset > (*i)->GetSize ())
-        { // This packet is behind the seqnum. Remove this packet from the buffer
-          pktSize = (*i)->GetSize ();
-          m_size -= pktSize;
-          offset -= pktSize;
-          m_firstByteSeq += pktSize;
-          i = m_data.erase (i);
-          NS_LOG_LOGIC ("Removed one packet of size " << pktSize << ", offset=" << offset);
-        }
-      else if (offset > 0)
-        { // Part of the packet is behind the seqnum. Fragment
-          pktSize = (*i)->GetSize () - offset;
-          *i = (*i)->CreateFragment (offset, pktSize);
-          m_size -= offset;
-          m_firstByteSeq += offset;
-          NS_LOG_LOGIC ("Fragmented one packet by size " << offset << ", new size=" << pktSize);
-          break;
-        }
+      NS_LOG_LOGIC ("Removed one packet of size " << m_data.front ()->GetSize ());
+      m_data.pop_front ();
+      m_offsets.pop_front ();
     }
   // Catching the case of ACKing a FIN
   if (m_size == 0)
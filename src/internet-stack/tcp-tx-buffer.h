@@ -21,7 +21,7 @@
 #ifndef __TCP_TX_BUFFER_H__
 #define __TCP_TX_BUFFER_H__
 
-#include <list>
+#include <deque>
 #include "ns3/sequence-number.h"
 #include "ns3/ptr.h"
 
@@ -33,6 +33,13 @@ class Packet;
  *
  * \brief class for keeping the data sent by the application to the TCP socket, i.e.
  *        the sending buffer.
+ *
+ * The packets added by the application are kept whole, along with the
+ * offset of their first byte in the stream of bytes ever added to the
+ * buffer. CopyFromSequence finds the packet which holds a sequence number
+ * with a binary search on these offsets, and DiscardUpTo only drops the
+ * packets which are entirely acknowledged: the head packet is not
+ * fragmented.
  */
 class TcpTxBuffer
 {
@@ -104,12 +111,12 @@ public:
   void DiscardUpTo (const SequenceNumber32& seq);
 
 private:
-  typedef std::list<Ptr<Packet> >::iterator BufIterator;
-
   SequenceNumber32 m_firstByteSeq;   //< Sequence number of the first byte in data (SND.UNA)
   uint32_t m_size;                 //< Number of data bytes
   uint32_t m_maxBuffer;            //< Max number of data bytes in buffer (SND.WND)
-  std::list<Ptr<Packet> > m_data;  //< Corresponding data (may be null)
+  std::deque<Ptr<Packet> > m_data; //< Corresponding data (may be null)
+  std::deque<uint64_t> m_offsets;  //< Stream offset of the first byte of each packet of m_data
+  uint64_t m_headOffset;           //< Stream offset of m_firstByteSeq
 };
 
 } // namepsace ns3
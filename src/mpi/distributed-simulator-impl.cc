@@ -26,6 +26,7 @@
 #include "ns3/node-container.h"
 #include "ns3/ptr.h"
 #include "ns3/pointer.h"
+#include "ns3/enum.h"
 #include "ns3/assert.h"
 #include "ns3/log.h"
 
@@ -76,6 +77,12 @@ DistributedSimulatorImpl::GetTypeId (void)
   static TypeId tid = TypeId ("ns3::DistributedSimulatorImpl")
     .SetParent<Object> ()
     .AddConstructor<DistributedSimulatorImpl> ()
+    .AddAttribute ("SynchronizationMode",
+                   "The algorithm used to synchronize the systems.",
+                   EnumValue (SYNC_BARRIER),
+                   MakeEnumAccessor (&DistributedSimulatorImpl::m_synchronizationMode),
+                   MakeEnumChecker (SYNC_BARRIER, "Barrier",
+                                    SYNC_NULL_MESSAGE, "NullMessage"))
   ;
   return tid;
 }
@@ -105,6 +112,7 @@ DistributedSimulatorImpl::DistributedSimulatorImpl ()
   m_currentContext = 0xffffffff;
   m_unscheduledEvents = 0;
   m_events = 0;
+  m_stopScheduled = false;
 }
 
 DistributedSimulatorImpl::~DistributedSimulatorImpl ()
@@ -146,6 +154,7 @@ void
 DistributedSimulatorImpl::CalculateLookAhead (void)
 {
 #ifdef NS3_MPI
+  m_neighbourLookAhead.clear ();
   if (MpiInterface::GetSize () <= 1)
     {
       DistributedSimulatorImpl::m_lookAhead = Seconds (0);
@@ -197,6 +206,13 @@ DistributedSimulatorImpl::CalculateLookAhead (void)
               // it the new lookAhead.
               TimeValue delay;
               channel->GetAttribute ("Delay", delay);
+              // the null messages use the lookahead of each neighbour
+              uint32_t remoteId = remoteNode->GetSystemId ();
+              if (m_neighbourLookAhead.find (remoteId) == m_neighbourLookAhead.end ()
+                  || delay.Get () < m_neighbourLookAhead[remoteId])
+                {
+                  m_neighbourLookAhead[remoteId] = delay.Get ();
+                }
               if (DistributedSimulatorImpl::m_lookAhead.IsZero ())
                 {
                   DistributedSimulatorImpl::m_lookAhead = delay.Get ();
@@ -273,11 +289,30 @@ DistributedSimulatorImpl::Run (void)
 #ifdef NS3_MPI
   CalculateLookAhead ();
   m_stop = false;
+  if (m_synchronizationMode == SYNC_NULL_MESSAGE)
+    {
+      RunNullMessage ();
+    }
+  else
+    {
+      RunBarrier ();
+    }
+#else
+  NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
+#endif
+}
+
+void
+DistributedSimulatorImpl::RunBarrier (void)
+{
+#ifdef NS3_MPI
   while (!m_events->IsEmpty () && !m_stop)
     {
       Time nextTime = Next ();
       if (nextTime > m_grantedTime)
         { // Can't process, calculate a new LBTS
+          // Send the packets of the window which has ended
+          MpiInterface::FlushSendBuffers ();
           // First receive any pending messages
           MpiInterface::ReceiveMessages ();
           // reset next time
@@ -287,8 +322,10 @@ DistributedSimulatorImpl::Run (void)
           // Finally calculate the lbts
           LbtsMessage lMsg (MpiInterface::GetRxCount (), MpiInterface::GetTxCount (), m_myId, nextTime);
           m_pLBTS[m_myId] = lMsg;
+          double start = MPI_Wtime ();
           MPI_Allgather (&lMsg, sizeof (LbtsMessage), MPI_BYTE, m_pLBTS,
                          sizeof (LbtsMessage), MPI_BYTE, MPI_COMM_WORLD);
+          MpiInterface::AddBlockedTime (MPI_Wtime () - start);
           Time smallestTime = m_pLBTS[0].GetSmallestTime ();
           // The totRx and totTx counts insure there are no transient
           // messages;  If totRx != totTx, there are transients,
@@ -316,6 +353,7 @@ DistributedSimulatorImpl::Run (void)
           ProcessOneEvent ();
         }
     }
+  MpiInterface::FlushSendBuffers ();
 
   // If the simulator stopped naturally by lack of events, make a
   // consistency test to check that we didn't lose any events along the way.
@@ -325,6 +363,90 @@ DistributedSimulatorImpl::Run (void)
 #endif
 }
 
+Time
+DistributedSimulatorImpl::GetNullMessageGrantedTime (void) const
+{
+  Time granted = GetMaximumSimulationTime ();
+  for (std::map<uint32_t, Time>::const_iterator i = m_neighbourLookAhead.begin (); i != m_neighbourLookAhead.end (); ++i)
+    {
+      granted = Min (granted, MpiInterface::GetNullMessageTime (i->first));
+    }
+  return granted;
+}
+
+void
+DistributedSimulatorImpl::SendNullMessages (const Time &lbts)
+{
+  for (std::map<uint32_t, Time>::const_iterator i = m_neighbourLookAhead.begin (); i != m_neighbourLookAhead.end (); ++i)
+    {
+      Time guarantee = lbts + i->second;
+      std::map<uint32_t, Time>::iterator sent = m_nullMessageSent.find (i->first);
+      // the promises only need to be sent when they improve
+      if (sent != m_nullMessageSent.end () && guarantee <= sent->second)
+        {
+          continue;
+        }
+      MpiInterface::SendNullMessage (i->first, guarantee);
+      m_nullMessageSent[i->first] = guarantee;
+    }
+}
+
+void
+DistributedSimulatorImpl::RunNullMessage (void)
+{
+#ifdef NS3_MPI
+  if (!m_stopScheduled && !m_neighbourLookAhead.empty ())
+    {
+      NS_FATAL_ERROR ("The null message synchronization requires Simulator::Stop (time)");
+    }
+  while (!m_stop)
+    {
+      double start = MPI_Wtime ();
+      MpiInterface::ReceiveMessages ();
+      MpiInterface::TestSendComplete ();
+      Time grantedTime = GetNullMessageGrantedTime ();
+      bool blocked = true;
+      while (!m_stop && !m_events->IsEmpty () && Next () <= grantedTime)
+        {
+          ProcessOneEvent ();
+          blocked = false;
+        }
+      if (m_stop)
+        {
+          break;
+        }
+      if (m_events->IsEmpty () && m_neighbourLookAhead.empty ())
+        {
+          break;
+        }
+      // The future events of this system are not earlier than its next
+      // event or than the packets which its neighbours may still send.
+      Time lbts = grantedTime;
+      if (!m_events->IsEmpty ())
+        {
+          lbts = Min (lbts, Next ());
+        }
+      MpiInterface::FlushSendBuffers ();
+      SendNullMessages (lbts);
+      if (blocked)
+        {
+          // Nothing can be processed before a neighbour sends a packet
+          // or a better guarantee: wait for its message rather than poll.
+          MPI_Probe (MPI_ANY_SOURCE, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+          MpiInterface::AddBlockedTime (MPI_Wtime () - start);
+        }
+    }
+  // The neighbours may still need to process their events up to the
+  // time at which this system stopped.
+  MpiInterface::FlushSendBuffers ();
+  SendNullMessages (Now ());
+
+  NS_ASSERT (!m_events->IsEmpty () || m_unscheduledEvents == 0);
+#else
+  NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
+#endif
+}
+
 uint32_t DistributedSimulatorImpl::GetSystemId () const
 {
   return m_myId;
@@ -345,6 +467,7 @@ DistributedSimulatorImpl::Stop (void)
 void
 DistributedSimulatorImpl::Stop (Time const &time)
 {
+  m_stopScheduled = true;
   Simulator::Schedule (time, &Simulator::Stop);
 }
 
@@ -354,13 +477,13 @@ DistributedSimulatorImpl::Stop (Time const &time)
 EventId
 DistributedSimulatorImpl::Schedule (Time const &time, EventImpl *event)
 {
-  Time tAbsolute = time + TimeStep (m_currentTs);
-
-  NS_ASSERT (tAbsolute.IsPositive ());
-  NS_ASSERT (tAbsolute >= TimeStep (m_currentTs));
+  NS_ASSERT (time.IsPositive ());
   Scheduler::Event ev;
   ev.impl = event;
-  ev.key.m_ts = static_cast<uint64_t> (tAbsolute.GetTimeStep ());
+  ev.key.m_ts = m_currentTs + time.GetTimeStep ();
+  // the absolute time must still be a positive Time
+  NS_ASSERT_MSG (ev.key.m_ts >= m_currentTs && (int64_t)ev.key.m_ts >= 0,
+                 "Event scheduled " << time << " after " << m_currentTs << " overflows the time steps");
   ev.key.m_context = GetContext ();
   ev.key.m_uid = m_uid;
   m_uid++;
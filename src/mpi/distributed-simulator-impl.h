@@ -25,6 +25,7 @@
 #include "ns3/ptr.h"
 
 #include <list>
+#include <map>
 
 namespace ns3 {
 
@@ -83,12 +84,37 @@ private:
 
 /**
  * \brief distributed simulator implementation using lookahead
+ *
+ * Two synchronization algorithms are available, selected by the
+ * SynchronizationMode attribute:
+ *  - SYNC_BARRIER: every system computes the lower bound on the
+ *    timestamp of the next event of all the systems (LBTS) with a global
+ *    MPI_Allgather, and may then process the events up to this bound
+ *    plus the smallest lookahead of all the links between systems.
+ *  - SYNC_NULL_MESSAGE: the Chandy-Misra-Bryant algorithm.  Every system
+ *    sends a null message to each of its neighbours, promising that it
+ *    will not send it any packet with a timestamp lower than the lower
+ *    bound on its own future events plus the lookahead of the links to
+ *    this neighbour.  A system may process the events which are not
+ *    later than all the promises received from its neighbours, without
+ *    any global synchronization: the systems connected by long links
+ *    can run ahead of the others.  The simulation must be ended by
+ *    Simulator::Stop (time), scheduled by every system, since there is
+ *    no detection of the global termination.
  */
 class DistributedSimulatorImpl : public SimulatorImpl
 {
 public:
   static TypeId GetTypeId (void);
 
+  /**
+   * The synchronization algorithms between the systems.
+   */
+  enum SynchronizationMode {
+    SYNC_BARRIER, /** Compute the LBTS with a global reduction */
+    SYNC_NULL_MESSAGE, /** Exchange null messages with the neighbours */
+  };
+
   DistributedSimulatorImpl ();
   ~DistributedSimulatorImpl ();
 
@@ -117,6 +143,13 @@ public:
 private:
   virtual void DoDispose (void);
   void CalculateLookAhead (void);
+  void RunBarrier (void);
+  void RunNullMessage (void);
+  // the smallest promise received from the neighbours
+  Time GetNullMessageGrantedTime (void) const;
+  // promise to the neighbours that the events scheduled by this system
+  // will not be earlier than lbts
+  void SendNullMessages (const Time &lbts);
 
   void ProcessOneEvent (void);
   uint64_t NextTs (void) const;
@@ -139,6 +172,14 @@ private:
   Time         m_grantedTime; // Last LBTS
   static Time  m_lookAhead;   // Lookahead value
 
+  SynchronizationMode m_synchronizationMode;
+  // the lookahead of the links to each neighbour, indexed by MPI rank
+  std::map<uint32_t, Time> m_neighbourLookAhead;
+  // the last null message sent to each neighbour
+  std::map<uint32_t, Time> m_nullMessageSent;
+  // whether Stop (time) was called
+  bool m_stopScheduled;
+
 };
 
 } // namespace ns3
@@ -21,7 +21,8 @@
 
 #include <iostream>
 #include <iomanip>
-#include <list>
+#include <cstring>
+#include <algorithm>
 
 #include "mpi-interface.h"
 
@@ -31,6 +32,7 @@
 #include "ns3/simulator.h"
 #include "ns3/simulator-impl.h"
 #include "ns3/nstime.h"
+#include "ns3/assert.h"
 
 #ifdef NS3_MPI
 #include <mpi.h>
@@ -40,25 +42,34 @@ namespace ns3 {
 
 SentBuffer::SentBuffer ()
 {
-  m_buffer = 0;
+#ifdef NS3_MPI
+  m_request = MPI_REQUEST_NULL;
+#else
   m_request = 0;
+#endif
+  m_pending = false;
 }
 
 SentBuffer::~SentBuffer ()
 {
-  delete [] m_buffer;
 }
 
-uint8_t*
-SentBuffer::GetBuffer ()
+std::vector<uint8_t> &
+SentBuffer::GetData ()
 {
-  return m_buffer;
+  return m_data;
+}
+
+bool
+SentBuffer::IsPending (void) const
+{
+  return m_pending;
 }
 
 void
-SentBuffer::SetBuffer (uint8_t* buffer)
+SentBuffer::SetPending (bool pending)
 {
-  m_buffer = buffer;
+  m_pending = pending;
 }
 
 #ifdef NS3_MPI
@@ -75,25 +86,47 @@ bool                  MpiInterface::m_initialized = false;
 bool                  MpiInterface::m_enabled = false;
 uint32_t              MpiInterface::m_rxCount = 0;
 uint32_t              MpiInterface::m_txCount = 0;
-std::list<SentBuffer> MpiInterface::m_pendingTx;
-
-#ifdef NS3_MPI
-MPI_Request* MpiInterface::m_requests;
-char**       MpiInterface::m_pRxBuffers;
-#endif
+uint64_t              MpiInterface::m_txMessages = 0;
+uint64_t              MpiInterface::m_txBytes = 0;
+uint64_t              MpiInterface::m_rxMessages = 0;
+uint64_t              MpiInterface::m_rxBytes = 0;
+uint32_t              MpiInterface::m_peakSendBuffers = 0;
+double                MpiInterface::m_blockedTime = 0;
+std::vector<std::vector<uint8_t> > MpiInterface::m_batches;
+std::list<SentBuffer> MpiInterface::m_sendBuffers;
+std::vector<uint8_t>  MpiInterface::m_rxBuffer;
+std::vector<Time>     MpiInterface::m_nullMessageTime;
+
+// Each message is a batch of records.  A record is a header followed by
+// the serialized packet: the size of the packet, the receive time in
+// time steps, the destination node and the destination device.
+static const uint32_t RECORD_HEADER_SIZE = 4 + 8 + 4 + 4;
+
+// the destination node of the null messages
+static const uint32_t NULL_MESSAGE_NODE = 0xffffffff;
 
 void
 MpiInterface::Destroy ()
 {
 #ifdef NS3_MPI
-  for (uint32_t i = 0; i < GetSize (); ++i)
+  if (!m_enabled)
     {
-      delete [] m_pRxBuffers[i];
+      return;
     }
-  delete [] m_pRxBuffers;
-  delete [] m_requests;
-
-  m_pendingTx.clear ();
+  // The sends which are still pending complete in the background
+  for (std::list<SentBuffer>::iterator i = m_sendBuffers.begin (); i != m_sendBuffers.end (); ++i)
+    {
+      if (i->IsPending ())
+        {
+          MPI_Request_free (i->GetRequest ());
+        }
+    }
+  m_sendBuffers.clear ();
+  m_batches.clear ();
+  m_rxBuffer.clear ();
+  m_nullMessageTime.clear ();
+  MPI_Finalize ();
+  m_enabled = false;
 #endif
 }
 
@@ -109,6 +142,48 @@ MpiInterface::GetTxCount ()
   return m_txCount;
 }
 
+uint64_t
+MpiInterface::GetTxMessages ()
+{
+  return m_txMessages;
+}
+
+uint64_t
+MpiInterface::GetTxBytes ()
+{
+  return m_txBytes;
+}
+
+uint64_t
+MpiInterface::GetRxMessages ()
+{
+  return m_rxMessages;
+}
+
+uint64_t
+MpiInterface::GetRxBytes ()
+{
+  return m_rxBytes;
+}
+
+uint32_t
+MpiInterface::GetPeakSendBuffers ()
+{
+  return m_peakSendBuffers;
+}
+
+double
+MpiInterface::GetBlockedTime ()
+{
+  return m_blockedTime;
+}
+
+void
+MpiInterface::AddBlockedTime (double seconds)
+{
+  m_blockedTime += seconds;
+}
+
 uint32_t
 MpiInterface::GetSystemId ()
 {
@@ -153,15 +228,76 @@ MpiInterface::Enable (int* pargc, char*** pargv)
   MPI_Comm_size (MPI_COMM_WORLD, reinterpret_cast <int *> (&m_size));
   m_enabled = true;
   m_initialized = true;
-  // Post a non-blocking receive for all peers
-  m_pRxBuffers = new char*[m_size];
-  m_requests = new MPI_Request[m_size];
-  for (uint32_t i = 0; i < GetSize (); ++i)
+  m_nullMessageTime.assign (m_size, Seconds (0));
+  m_batches.resize (m_size);
+  m_sendBuffers.resize (MPI_SEND_POOL_SIZE);
+  m_peakSendBuffers = MPI_SEND_POOL_SIZE;
+#else
+  NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
+#endif
+}
+
+uint8_t*
+MpiInterface::AddRecord (uint32_t sid, uint32_t size, uint64_t ts, uint32_t node, uint32_t dev)
+{
+  std::vector<uint8_t> &batch = m_batches[sid];
+  uint32_t offset = batch.size ();
+  batch.resize (offset + RECORD_HEADER_SIZE + size);
+  uint8_t *record = &batch[offset];
+  // the records are not aligned
+  std::memcpy (record, &size, 4);
+  std::memcpy (record + 4, &ts, 8);
+  std::memcpy (record + 12, &node, 4);
+  std::memcpy (record + 16, &dev, 4);
+  return record + RECORD_HEADER_SIZE;
+}
+
+void
+MpiInterface::Flush (uint32_t sid)
+{
+#ifdef NS3_MPI
+  std::vector<uint8_t> &batch = m_batches[sid];
+  if (batch.empty ())
+    {
+      return;
+    }
+  // Take the oldest buffer whose send completed.  Never wait for a
+  // send: the neighbour may be blocked in the MPI_Allgather of the
+  // synchronization, and only receive once this system joins it.
+  std::list<SentBuffer>::iterator i = m_sendBuffers.begin ();
+  for (; i != m_sendBuffers.end (); ++i)
     {
-      m_pRxBuffers[i] = new char[MAX_MPI_MSG_SIZE];
-      MPI_Irecv (m_pRxBuffers[i], MAX_MPI_MSG_SIZE, MPI_CHAR, MPI_ANY_SOURCE, 0,
-                 MPI_COMM_WORLD, &m_requests[i]);
+      if (!i->IsPending ())
+        {
+          break;
+        }
+      int flag = 0;
+      MPI_Test (i->GetRequest (), &flag, MPI_STATUS_IGNORE);
+      if (flag)
+        {
+          i->SetPending (false);
+          break;
+        }
     }
+  if (i == m_sendBuffers.end ())
+    {
+      // All the buffers are in flight: grow the pool
+      i = m_sendBuffers.insert (m_sendBuffers.end (), SentBuffer ());
+      m_peakSendBuffers = std::max (m_peakSendBuffers, (uint32_t)m_sendBuffers.size ());
+    }
+  m_sendBuffers.splice (m_sendBuffers.end (), m_sendBuffers, i);
+  SentBuffer &buffer = *i;
+  // The batch takes the place of the data of the buffer, which keeps
+  // its capacity for the next batch.
+  buffer.GetData ().swap (batch);
+  batch.clear ();
+
+  std::vector<uint8_t> &data = buffer.GetData ();
+  MPI_Isend (reinterpret_cast<void *> (&data[0]), data.size (), MPI_CHAR, sid,
+             0, MPI_COMM_WORLD, buffer.GetRequest ());
+  buffer.SetPending (true);
+  m_txMessages++;
+  m_txBytes += data.size ();
 #else
   NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
 #endif
@@ -171,91 +307,125 @@ void
 MpiInterface::SendPacket (Ptr<Packet> p, const Time& rxTime, uint32_t node, uint32_t dev)
 {
 #ifdef NS3_MPI
-  SentBuffer sendBuf;
-  m_pendingTx.push_back (sendBuf);
-  std::list<SentBuffer>::reverse_iterator i = m_pendingTx.rbegin (); // Points to the last element
-
-  uint32_t serializedSize = p->GetSerializedSize ();
-  uint8_t* buffer =  new uint8_t[serializedSize + 16];
-  i->SetBuffer (buffer);
-  // Add the time, dest node and dest device
-  uint64_t t = rxTime.GetNanoSeconds ();
-  uint64_t* pTime = reinterpret_cast <uint64_t *> (buffer);
-  *pTime++ = t;
-  uint32_t* pData = reinterpret_cast<uint32_t *> (pTime);
-  *pData++ = node;
-  *pData++ = dev;
-  // Serialize the packet
-  p->Serialize (reinterpret_cast<uint8_t *> (pData), serializedSize);
-
   // Find the system id for the destination node
   Ptr<Node> destNode = NodeList::GetNode (node);
   uint32_t nodeSysId = destNode->GetSystemId ();
 
-  MPI_Isend (reinterpret_cast<void *> (i->GetBuffer ()), serializedSize + 16, MPI_CHAR, nodeSysId,
-             0, MPI_COMM_WORLD, (i->GetRequest ()));
+  // Serialize the packet in place, after the time, dest node and dest
+  // device
+  uint32_t serializedSize = p->GetSerializedSize ();
+  uint8_t *data = AddRecord (nodeSysId, serializedSize, rxTime.GetTimeStep (), node, dev);
+  p->Serialize (data, serializedSize);
   m_txCount++;
+
+  if (m_batches[nodeSysId].size () >= MAX_MPI_MSG_SIZE)
+    {
+      Flush (nodeSysId);
+    }
+#else
+  NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
+#endif
+}
+
+void
+MpiInterface::FlushSendBuffers ()
+{
+  for (uint32_t i = 0; i < m_batches.size (); ++i)
+    {
+      Flush (i);
+    }
+}
+
+void
+MpiInterface::SendNullMessage (uint32_t sid, const Time &guarantee)
+{
+#ifdef NS3_MPI
+  // A record without packet, after the packets already in the batch: it
+  // must not be received before them.
+  AddRecord (sid, 0, guarantee.GetTimeStep (), NULL_MESSAGE_NODE, 0);
+  Flush (sid);
 #else
   NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
 #endif
 }
 
+Time
+MpiInterface::GetNullMessageTime (uint32_t sid)
+{
+  NS_ASSERT (sid < m_nullMessageTime.size ());
+  return m_nullMessageTime[sid];
+}
+
 void
 MpiInterface::ReceiveMessages ()
-{ // Poll the non-block reads to see if data arrived
+{ // Poll for the messages which arrived
 #ifdef NS3_MPI
   while (true)
     {
       int flag = 0;
-      int index = 0;
       MPI_Status status;
 
-      MPI_Testany (GetSize (), m_requests, &index, &flag, &status);
+      MPI_Iprobe (MPI_ANY_SOURCE, 0, MPI_COMM_WORLD, &flag, &status);
       if (!flag)
         {
           break;        // No more messages
         }
       int count;
       MPI_Get_count (&status, MPI_CHAR, &count);
-      m_rxCount++; // Count this receive
-
-      // Get the meta data first
-      uint64_t* pTime = reinterpret_cast<uint64_t *> (m_pRxBuffers[index]);
-      uint64_t nanoSeconds = *pTime++;
-      uint32_t* pData = reinterpret_cast<uint32_t *> (pTime);
-      uint32_t node = *pData++;
-      uint32_t dev  = *pData++;
-
-      Time rxTime = NanoSeconds (nanoSeconds);
-
-      count -= sizeof (nanoSeconds) + sizeof (node) + sizeof (dev);
-
-      Ptr<Packet> p = Create<Packet> (reinterpret_cast<uint8_t *> (pData), count, true);
-
-      // Find the correct node/device to schedule receive event
-      Ptr<Node> pNode = NodeList::GetNode (node);
-      uint32_t nDevices = pNode->GetNDevices ();
-      Ptr<PointToPointNetDevice> pDev = 0;
-      for (uint32_t i = 0; i < nDevices; ++i)
+      m_rxBuffer.resize (count);
+      MPI_Recv (&m_rxBuffer[0], count, MPI_CHAR, status.MPI_SOURCE, 0,
+                MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+      m_rxMessages++;
+      m_rxBytes += count;
+
+      uint32_t offset = 0;
+      while (offset < static_cast<uint32_t> (count))
         {
-          Ptr<NetDevice> pThisDev = pNode->GetDevice (i);
-          if (pThisDev->GetIfIndex () == dev)
+          // Get the meta data first
+          const uint8_t *record = &m_rxBuffer[offset];
+          uint32_t size;
+          uint64_t ts;
+          uint32_t node;
+          uint32_t dev;
+          std::memcpy (&size, record, 4);
+          std::memcpy (&ts, record + 4, 8);
+          std::memcpy (&node, record + 12, 4);
+          std::memcpy (&dev, record + 16, 4);
+          offset += RECORD_HEADER_SIZE + size;
+          NS_ASSERT (offset <= static_cast<uint32_t> (count));
+
+          if (node == NULL_MESSAGE_NODE)
             {
-              pDev = DynamicCast<PointToPointNetDevice> (pThisDev);
-              break;
+              // The messages of a system are received in order
+              m_nullMessageTime[status.MPI_SOURCE] = Max (m_nullMessageTime[status.MPI_SOURCE],
+                                                          TimeStep (ts));
+              continue;
             }
-        }
+          m_rxCount++; // Count this receive
 
-      NS_ASSERT (pNode && pDev);
+          Ptr<Packet> p = Create<Packet> (record + RECORD_HEADER_SIZE, size, true);
 
-      // Schedule the rx event
-      Simulator::ScheduleWithContext (pNode->GetId (), rxTime - Simulator::Now (),
-                                      &PointToPointNetDevice::Receive,
-                                      pDev, p);
+          // Find the correct node/device to schedule receive event
+          Ptr<Node> pNode = NodeList::GetNode (node);
+          uint32_t nDevices = pNode->GetNDevices ();
+          Ptr<PointToPointNetDevice> pDev = 0;
+          for (uint32_t i = 0; i < nDevices; ++i)
+            {
+              Ptr<NetDevice> pThisDev = pNode->GetDevice (i);
+              if (pThisDev->GetIfIndex () == dev)
+                {
+                  pDev = DynamicCast<PointToPointNetDevice> (pThisDev);
+                  break;
+                }
+            }
 
-      // Re-queue the next read
-      MPI_Irecv (m_pRxBuffers[index], MAX_MPI_MSG_SIZE, MPI_CHAR, MPI_ANY_SOURCE, 0,
-                 MPI_COMM_WORLD, &m_requests[index]);
+          NS_ASSERT (pNode && pDev);
+
+          // Schedule the rx event
+          Simulator::ScheduleWithContext (pNode->GetId (), TimeStep (ts) - Simulator::Now (),
+                                          &PointToPointNetDevice::Receive,
+                                          pDev, p);
+        }
     }
 #else
   NS_FATAL_ERROR ("Can't use distributed simulator without MPI compiled in");
@@ -266,17 +436,26 @@ void
 MpiInterface::TestSendComplete ()
 {
 #ifdef NS3_MPI
-  std::list<SentBuffer>::iterator i = m_pendingTx.begin ();
-  while (i != m_pendingTx.end ())
+  std::list<SentBuffer>::iterator i = m_sendBuffers.begin ();
+  while (i != m_sendBuffers.end ())
     {
-      MPI_Status status;
-      int flag = 0;
-      MPI_Test (i->GetRequest (), &flag, &status);
-      std::list<SentBuffer>::iterator current = i; // Save current for erasing
-      i++;                                    // Advance to next
-      if (flag)
-        { // This message is complete
-          m_pendingTx.erase (current);
+      if (i->IsPending ())
+        {
+          int flag = 0;
+          MPI_Test (i->GetRequest (), &flag, MPI_STATUS_IGNORE);
+          if (flag)
+            { // This message is complete
+              i->SetPending (false);
+            }
+        }
+      if (!i->IsPending () && m_sendBuffers.size () > MPI_SEND_POOL_SIZE)
+        {
+          // The pool grew while the sends were in flight
+          i = m_sendBuffers.erase (i);
+        }
+      else
+        {
+          ++i;
         }
     }
 #else
@@ -23,6 +23,7 @@
 #define NS3_MPI_INTERFACE_H
 
 #include <stdint.h>
+#include <vector>
 #include <list>
 
 #include "ns3/nstime.h"
@@ -34,13 +35,23 @@ typedef struct ompi_request_t* MPI_Request;
 namespace ns3 {
 
 /**
- * maximum MPI message size for easy
- * buffer creation
+ * size above which the batch of packets sent to a system is sent
+ * without waiting for the end of the window
  */
-const uint32_t MAX_MPI_MSG_SIZE = 2000;
+const uint32_t MAX_MPI_MSG_SIZE = 65536;
+
+/**
+ * number of buffers kept for the non-blocking sends.  The pool grows
+ * while all of its buffers are in flight, since a send never waits, and
+ * shrinks back to this size as the sends complete.
+ */
+const uint32_t MPI_SEND_POOL_SIZE = 64;
 
 /**
  * Define a class for tracking the non-block sends
+ *
+ * The buffers are recycled: their data keeps its capacity from one
+ * message to the next.
  */
 class SentBuffer
 {
@@ -49,21 +60,28 @@ public:
   ~SentBuffer ();
 
   /**
-   * \return pointer to sent buffer
+   * \return the data of the message
    */
-  uint8_t* GetBuffer ();
-  /**
-   * \param buffer pointer to sent buffer
-   */
-  void SetBuffer (uint8_t* buffer);
+  std::vector<uint8_t> &GetData ();
   /**
    * \return MPI request
    */
   MPI_Request* GetRequest ();
+  /**
+   * \return true if the message was sent and its completion has not
+   *         been observed yet
+   */
+  bool IsPending (void) const;
+  /**
+   * \param pending whether the message was sent and its completion has
+   *        not been observed yet
+   */
+  void SetPending (bool pending);
 
 private:
-  uint8_t* m_buffer;
+  std::vector<uint8_t> m_data;
   MPI_Request m_request;
+  bool m_pending;
 };
 
 class Packet;
@@ -75,7 +93,7 @@ class MpiInterface
 {
 public:
   /**
-   * Delete all buffers
+   * Delete all buffers and finalize MPI
    */
   static void Destroy ();
   /**
@@ -104,9 +122,31 @@ public:
    * \param node destination node
    * \param dev destination device
    *
-   * Serialize and send a packet to the specified node and net device
+   * Serialize a packet for the specified node and net device in the
+   * batch of packets of the system of this node.  The batch is only
+   * sent by FlushSendBuffers, or when it becomes larger than
+   * MAX_MPI_MSG_SIZE.
    */
   static void SendPacket (Ptr<Packet> p, const Time &rxTime, uint32_t node, uint32_t dev);
+  /**
+   * Send the batches of packets of all the systems
+   */
+  static void FlushSendBuffers ();
+  /**
+   * \param sid system id of the neighbour
+   * \param guarantee time before which this system will not send any
+   *        packet to the neighbour
+   *
+   * Send a null message, used by the null message synchronization of
+   * DistributedSimulatorImpl
+   */
+  static void SendNullMessage (uint32_t sid, const Time &guarantee);
+  /**
+   * \param sid system id of a neighbour
+   * \return the largest guarantee received from this neighbour in a
+   *         null message, zero if none was received
+   */
+  static Time GetNullMessageTime (uint32_t sid);
   /**
    * Check for received messages complete
    */
@@ -123,6 +163,37 @@ public:
    * \return transmitted count in packets
    */
   static uint32_t GetTxCount ();
+  /**
+   * \return number of MPI messages sent, including the null messages
+   */
+  static uint64_t GetTxMessages ();
+  /**
+   * \return number of bytes sent in MPI messages
+   */
+  static uint64_t GetTxBytes ();
+  /**
+   * \return number of MPI messages received
+   */
+  static uint64_t GetRxMessages ();
+  /**
+   * \return number of bytes received in MPI messages
+   */
+  static uint64_t GetRxBytes ();
+  /**
+   * \return largest number of buffers of the pool of non-blocking sends
+   */
+  static uint32_t GetPeakSendBuffers ();
+  /**
+   * \return wall-clock time, in seconds, spent waiting for the other
+   *         systems
+   */
+  static double GetBlockedTime ();
+  /**
+   * \param seconds wall-clock time spent waiting for the other systems
+   *        outside of MpiInterface, for example by the synchronization of
+   *        DistributedSimulatorImpl
+   */
+  static void AddBlockedTime (double seconds);
 
 private:
   static uint32_t m_sid;
@@ -136,14 +207,32 @@ private:
   static bool     m_initialized;
   static bool     m_enabled;
 
-  // Pending non-blocking receives
-  static MPI_Request* m_requests;
+  // Statistics
+  static uint64_t m_txMessages;
+  static uint64_t m_txBytes;
+  static uint64_t m_rxMessages;
+  static uint64_t m_rxBytes;
+  static uint32_t m_peakSendBuffers;
+  static double   m_blockedTime;
+
+  // Add a record to the batch of a system
+  static uint8_t* AddRecord (uint32_t sid, uint32_t size, uint64_t ts, uint32_t node, uint32_t dev);
+  // Send the batch of a system
+  static void Flush (uint32_t sid);
+
+  // Packets waiting to be sent to each system
+  static std::vector<std::vector<uint8_t> > m_batches;
+
+  // Pool of buffers for the non-blocking sends, oldest send first.  A
+  // list, so that adding a buffer does not move the data of the pending
+  // sends.
+  static std::list<SentBuffer> m_sendBuffers;
 
-  // Data buffers for non-blocking reads
-  static char**   m_pRxBuffers;
+  // Buffer for the received messages
+  static std::vector<uint8_t> m_rxBuffer;
 
-  // List of pending non-blocking sends
-  static std::list<SentBuffer> m_pendingTx;
+  // Last guarantee received from each system in a null message
+  static std::vector<Time> m_nullMessageTime;
 };
 
 } // namespace ns3
@@ -0,0 +1,1012 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "multithreaded-simulator-impl.h"
+
+#include "ns3/simulator.h"
+#include "ns3/scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/system-thread.h"
+#include "ns3/channel.h"
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/nstime.h"
+#include "ns3/uinteger.h"
+#include "ns3/ptr.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+
+NS_LOG_COMPONENT_DEFINE ("MultithreadedSimulatorImpl");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (MultithreadedSimulatorImpl);
+
+static const uint64_t MAX_TS = ~((uint64_t)0);
+
+static uint64_t
+SaturatingAdd (uint64_t a, uint64_t b)
+{
+  return (a > MAX_TS - b) ? MAX_TS : a + b;
+}
+
+__thread MultithreadedSimulatorImpl::Partition *MultithreadedSimulatorImpl::m_currentPartition = 0;
+
+bool
+MultithreadedSimulatorImpl::MessageCompare::operator () (const Message &a, const Message &b) const
+{
+  if (a.ts != b.ts)
+    {
+      return a.ts < b.ts;
+    }
+  return a.sendTs < b.sendTs;
+}
+
+void
+MultithreadedSimulatorImpl::Partition::Run (void)
+{
+  simulator->RunPartition (this);
+}
+
+TypeId
+MultithreadedSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MultithreadedSimulatorImpl")
+    .SetParent<Object> ()
+    .AddConstructor<MultithreadedSimulatorImpl> ()
+    .AddAttribute ("Partitions",
+                   "The number of partitions in which the nodes are automatically "
+                   "distributed, or zero to use the system id of the nodes.",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&MultithreadedSimulatorImpl::m_nPartitionsWanted),
+                   MakeUintegerChecker<uint32_t> ())
+    ;
+  return tid;
+}
+
+MultithreadedSimulatorImpl::MultithreadedSimulatorImpl ()
+{
+  // uids are allocated from 4.
+  // uid 0 is "invalid" events
+  // uid 1 is "now" events
+  // uid 2 is "destroy" events
+  m_uid = 4;
+  // before ::Run is entered, the m_currentUid will be zero
+  m_currentUid = 0;
+  m_currentTs = 0;
+  m_currentContext = 0xffffffff;
+  m_unscheduledEvents = 0;
+  m_stop = false;
+  m_lookAhead = MAX_TS;
+  m_barrierCount = 0;
+  m_barrierGeneration = 0;
+  pthread_mutex_init (&m_destroyMutex, 0);
+  pthread_mutex_init (&m_barrierMutex, 0);
+  pthread_cond_init (&m_barrierCond, 0);
+}
+
+MultithreadedSimulatorImpl::~MultithreadedSimulatorImpl ()
+{
+  pthread_cond_destroy (&m_barrierCond);
+  pthread_mutex_destroy (&m_barrierMutex);
+  pthread_mutex_destroy (&m_destroyMutex);
+}
+
+void
+MultithreadedSimulatorImpl::DoDispose (void)
+{
+  if (m_events != 0)
+    {
+      while (!m_events->IsEmpty ())
+        {
+          Scheduler::Event next = m_events->RemoveNext ();
+          next.impl->Unref ();
+        }
+      m_events = 0;
+    }
+  for (std::vector<Partition *>::iterator i = m_partitions.begin (); i != m_partitions.end (); i++)
+    {
+      Partition *partition = *i;
+      while (!partition->events->IsEmpty ())
+        {
+          Scheduler::Event next = partition->events->RemoveNext ();
+          next.impl->Unref ();
+        }
+      for (uint32_t j = 0; j < partition->outbox.size (); j++)
+        {
+          for (uint32_t k = 0; k < partition->outbox[j].size (); k++)
+            {
+              partition->outbox[j][k].impl->Unref ();
+            }
+        }
+      delete partition;
+    }
+  m_partitions.clear ();
+  m_nodePartition.clear ();
+  SimulatorImpl::DoDispose ();
+}
+
+void
+MultithreadedSimulatorImpl::Destroy ()
+{
+  while (!m_destroyEvents.empty ())
+    {
+      Ptr<EventImpl> ev = m_destroyEvents.front ().PeekEventImpl ();
+      m_destroyEvents.pop_front ();
+      NS_LOG_LOGIC ("handle destroy " << ev);
+      if (!ev->IsCancelled ())
+        {
+          ev->Invoke ();
+        }
+    }
+}
+
+void
+MultithreadedSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
+{
+  m_schedulerFactory = schedulerFactory;
+  Ptr<Scheduler> scheduler = schedulerFactory.Create<Scheduler> ();
+  if (m_events != 0)
+    {
+      while (!m_events->IsEmpty ())
+        {
+          Scheduler::Event next = m_events->RemoveNext ();
+          scheduler->Insert (next);
+        }
+    }
+  m_events = scheduler;
+  for (std::vector<Partition *>::iterator i = m_partitions.begin (); i != m_partitions.end (); i++)
+    {
+      Partition *partition = *i;
+      scheduler = schedulerFactory.Create<Scheduler> ();
+      while (!partition->events->IsEmpty ())
+        {
+          Scheduler::Event next = partition->events->RemoveNext ();
+          scheduler->Insert (next);
+        }
+      partition->events = scheduler;
+    }
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetNPartitions (void) const
+{
+  return m_partitions.size ();
+}
+
+Time
+MultithreadedSimulatorImpl::GetLookAhead (void) const
+{
+  return TimeStep (m_lookAhead);
+}
+
+static uint32_t
+FindGroup (std::vector<uint32_t> &group, uint32_t i)
+{
+  while (group[i] != i)
+    {
+      group[i] = group[group[i]];
+      i = group[i];
+    }
+  return i;
+}
+
+void
+MultithreadedSimulatorImpl::PartitionAutomatically (void)
+{
+  uint32_t nNodes = NodeList::GetNNodes ();
+  if (nNodes == 0)
+    {
+      return;
+    }
+  // The nodes connected by a channel which cannot be cut end up in the
+  // same group.  The other links are the edges of the graph of groups.
+  std::vector<uint32_t> group (nNodes);
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      group[i] = i;
+    }
+  std::vector<std::vector<uint32_t> > neighbours (nNodes);
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      Ptr<Node> node = NodeList::GetNode (i);
+      for (uint32_t j = 0; j < node->GetNDevices (); j++)
+        {
+          Ptr<NetDevice> device = node->GetDevice (j);
+          Ptr<Channel> channel = device->GetChannel ();
+          if (channel == 0)
+            {
+              continue;
+            }
+          bool cut = false;
+          if (device->IsPointToPoint ())
+            {
+              TimeValue delay;
+              channel->GetAttribute ("Delay", delay);
+              cut = delay.Get ().IsStrictlyPositive ();
+            }
+          for (uint32_t k = 0; k < channel->GetNDevices (); k++)
+            {
+              uint32_t remote = channel->GetDevice (k)->GetNode ()->GetId ();
+              if (remote == i)
+                {
+                  continue;
+                }
+              if (cut)
+                {
+                  neighbours[i].push_back (remote);
+                }
+              else
+                {
+                  group[FindGroup (group, remote)] = FindGroup (group, i);
+                }
+            }
+        }
+    }
+  std::vector<std::vector<uint32_t> > members (nNodes);
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      members[FindGroup (group, i)].push_back (i);
+    }
+
+  // Order the groups by a breadth-first traversal so that consecutive
+  // groups, which are likely to end up in the same partition, are
+  // connected.
+  std::vector<uint32_t> order;
+  std::vector<bool> visited (nNodes, false);
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      uint32_t root = FindGroup (group, i);
+      if (visited[root])
+        {
+          continue;
+        }
+      std::deque<uint32_t> queue;
+      queue.push_back (root);
+      visited[root] = true;
+      while (!queue.empty ())
+        {
+          uint32_t current = queue.front ();
+          queue.pop_front ();
+          order.push_back (current);
+          for (uint32_t j = 0; j < members[current].size (); j++)
+            {
+              std::vector<uint32_t> &next = neighbours[members[current][j]];
+              for (uint32_t k = 0; k < next.size (); k++)
+                {
+                  uint32_t other = FindGroup (group, next[k]);
+                  if (!visited[other])
+                    {
+                      visited[other] = true;
+                      queue.push_back (other);
+                    }
+                }
+            }
+        }
+    }
+
+  // cut this order in chunks of similar sizes.
+  uint32_t nPartitions = std::min (m_nPartitionsWanted, nNodes);
+  uint32_t chunk = (nNodes + nPartitions - 1) / nPartitions;
+  uint32_t partition = 0;
+  uint32_t assigned = 0;
+  for (std::vector<uint32_t>::const_iterator i = order.begin (); i != order.end (); i++)
+    {
+      for (uint32_t j = 0; j < members[*i].size (); j++)
+        {
+          NodeList::GetNode (members[*i][j])->SetSystemId (partition);
+        }
+      assigned += members[*i].size ();
+      if (assigned >= chunk * (partition + 1) && partition + 1 < nPartitions)
+        {
+          partition++;
+        }
+    }
+  NS_LOG_INFO ("distributed " << nNodes << " nodes in " << partition + 1 << " partitions");
+}
+
+void
+MultithreadedSimulatorImpl::CalculateLookAhead (void)
+{
+  m_lookAhead = MAX_TS;
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); i++)
+    {
+      Ptr<Node> node = *i;
+      for (uint32_t j = 0; j < node->GetNDevices (); j++)
+        {
+          Ptr<NetDevice> device = node->GetDevice (j);
+          Ptr<Channel> channel = device->GetChannel ();
+          if (channel == 0)
+            {
+              continue;
+            }
+          for (uint32_t k = 0; k < channel->GetNDevices (); k++)
+            {
+              Ptr<Node> remote = channel->GetDevice (k)->GetNode ();
+              if (GetPartition (remote->GetId ()) == GetPartition (node->GetId ()))
+                {
+                  continue;
+                }
+              if (!device->IsPointToPoint ())
+                {
+                  NS_FATAL_ERROR ("Node " << node->GetId () << " and node " << remote->GetId () <<
+                                  " are in different partitions but are not connected by a point-to-point channel");
+                }
+              TimeValue delay;
+              channel->GetAttribute ("Delay", delay);
+              uint64_t ts = delay.Get ().GetTimeStep ();
+              if (ts == 0)
+                {
+                  NS_FATAL_ERROR ("Node " << node->GetId () << " and node " << remote->GetId () <<
+                                  " are in different partitions but are connected by a channel without delay");
+                }
+              m_lookAhead = std::min (m_lookAhead, ts);
+            }
+        }
+    }
+}
+
+void
+MultithreadedSimulatorImpl::CreatePartitions (void)
+{
+  if (m_nPartitionsWanted > 0)
+    {
+      PartitionAutomatically ();
+    }
+  // the partitions are sorted by system id
+  std::map<uint32_t, uint32_t> indexes;
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); i++)
+    {
+      indexes[(*i)->GetSystemId ()] = 0;
+    }
+  if (indexes.empty ())
+    {
+      indexes[0] = 0;
+    }
+  uint32_t index = 0;
+  for (std::map<uint32_t, uint32_t>::iterator i = indexes.begin (); i != indexes.end (); i++)
+    {
+      i->second = index;
+      Partition *partition = new Partition ();
+      partition->simulator = this;
+      partition->index = index;
+      partition->systemId = i->first;
+      partition->events = m_schedulerFactory.Create<Scheduler> ();
+      partition->uid = m_uid;
+      partition->currentUid = m_currentUid;
+      partition->currentTs = m_currentTs;
+      partition->currentContext = 0xffffffff;
+      partition->unscheduledEvents = 0;
+      partition->stop = false;
+      partition->windowEnd = 0;
+      partition->nextTs = MAX_TS;
+      partition->outbox.resize (indexes.size ());
+      m_partitions.push_back (partition);
+      index++;
+    }
+  m_nodePartition.resize (NodeList::GetNNodes ());
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); i++)
+    {
+      m_nodePartition[(*i)->GetId ()] = indexes[(*i)->GetSystemId ()];
+    }
+  CalculateLookAhead ();
+  NS_LOG_INFO (m_partitions.size () << " partitions, lookahead " << m_lookAhead);
+
+  while (!m_events->IsEmpty ())
+    {
+      Scheduler::Event next = m_events->RemoveNext ();
+      Partition *partition = GetPartition (next.key.m_context);
+      partition->events->Insert (next);
+      partition->unscheduledEvents++;
+      if (IsUnbound (next.key.m_context))
+        {
+          partition->unbound.insert (next.impl);
+        }
+    }
+  m_unscheduledEvents = 0;
+  for (std::list<Scheduler::EventKey>::const_iterator i = m_stopEvents.begin (); i != m_stopEvents.end (); i++)
+    {
+      for (std::vector<Partition *>::iterator j = m_partitions.begin (); j != m_partitions.end (); j++)
+        {
+          Scheduler::Event ev;
+          ev.impl = MakeEvent (&Simulator::Stop);
+          ev.key = *i;
+          (*j)->events->Insert (ev);
+          (*j)->unscheduledEvents++;
+        }
+    }
+  m_stopEvents.clear ();
+}
+
+MultithreadedSimulatorImpl::Partition *
+MultithreadedSimulatorImpl::GetPartition (uint32_t context) const
+{
+  if (context < m_nodePartition.size ())
+    {
+      return m_partitions[m_nodePartition[context]];
+    }
+  // the events which are not bound to a node are run by the first
+  // partition
+  return m_partitions[0];
+}
+
+bool
+MultithreadedSimulatorImpl::IsUnbound (uint32_t context) const
+{
+  return context >= m_nodePartition.size ();
+}
+
+MultithreadedSimulatorImpl::Partition *
+MultithreadedSimulatorImpl::GetOwner (const EventId &id) const
+{
+  if (!IsUnbound (id.GetContext ()))
+    {
+      return GetPartition (id.GetContext ());
+    }
+  // an event which is not bound to a node stays in the partition which
+  // scheduled it, like in Schedule
+  EventImpl *impl = id.PeekEventImpl ();
+  if (m_currentPartition != 0 && m_currentPartition->unbound.count (impl) != 0)
+    {
+      return m_currentPartition;
+    }
+  for (std::vector<Partition *>::const_iterator i = m_partitions.begin (); i != m_partitions.end (); i++)
+    {
+      if ((*i)->unbound.count (impl) != 0)
+        {
+          return *i;
+        }
+    }
+  return 0;
+}
+
+uint32_t
+MultithreadedSimulatorImpl::Insert (Partition *partition, uint64_t ts, uint32_t context, EventImpl *event)
+{
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = ts;
+  ev.key.m_context = context;
+  if (partition == 0)
+    {
+      ev.key.m_uid = m_uid;
+      m_uid++;
+      m_unscheduledEvents++;
+      m_events->Insert (ev);
+    }
+  else
+    {
+      ev.key.m_uid = partition->uid;
+      partition->uid++;
+      partition->unscheduledEvents++;
+      partition->events->Insert (ev);
+      if (IsUnbound (context))
+        {
+          partition->unbound.insert (event);
+        }
+    }
+  return ev.key.m_uid;
+}
+
+void
+MultithreadedSimulatorImpl::ProcessOneEvent (Partition *partition)
+{
+  Scheduler::Event next = partition->events->RemoveNext ();
+
+  NS_ASSERT (next.key.m_ts >= partition->currentTs);
+  partition->unscheduledEvents--;
+
+  NS_LOG_LOGIC ("handle " << next.key.m_ts << " in partition " << partition->index);
+  partition->currentTs = next.key.m_ts;
+  partition->currentContext = next.key.m_context;
+  partition->currentUid = next.key.m_uid;
+  if (IsUnbound (next.key.m_context))
+    {
+      partition->unbound.erase (next.impl);
+    }
+  next.impl->Invoke ();
+  next.impl->Unref ();
+}
+
+void
+MultithreadedSimulatorImpl::ReceiveMessages (Partition *partition)
+{
+  // The order of the messages does not depend on the order in which the
+  // threads were run: they are sorted by timestamp and then by time of
+  // sending, and the sort is stable.
+  partition->inbox.clear ();
+  for (std::vector<Partition *>::iterator i = m_partitions.begin (); i != m_partitions.end (); i++)
+    {
+      std::vector<Message> &outbox = (*i)->outbox[partition->index];
+      partition->inbox.insert (partition->inbox.end (), outbox.begin (), outbox.end ());
+      outbox.clear ();
+    }
+  std::stable_sort (partition->inbox.begin (), partition->inbox.end (), MessageCompare ());
+  for (std::vector<Message>::const_iterator i = partition->inbox.begin (); i != partition->inbox.end (); i++)
+    {
+      Insert (partition, i->ts, i->context, i->impl);
+    }
+  partition->inbox.clear ();
+}
+
+void
+MultithreadedSimulatorImpl::Barrier (void)
+{
+  pthread_mutex_lock (&m_barrierMutex);
+  uint32_t generation = m_barrierGeneration;
+  m_barrierCount++;
+  if (m_barrierCount == m_partitions.size ())
+    {
+      m_barrierCount = 0;
+      m_barrierGeneration++;
+      pthread_cond_broadcast (&m_barrierCond);
+    }
+  else
+    {
+      while (generation == m_barrierGeneration)
+        {
+          pthread_cond_wait (&m_barrierCond, &m_barrierMutex);
+        }
+    }
+  pthread_mutex_unlock (&m_barrierMutex);
+}
+
+void
+MultithreadedSimulatorImpl::RunPartition (Partition *partition)
+{
+  m_currentPartition = partition;
+  while (true)
+    {
+      while (!partition->stop &&
+             !partition->events->IsEmpty () &&
+             partition->events->PeekNext ().key.m_ts < partition->windowEnd)
+        {
+          ProcessOneEvent (partition);
+        }
+      Barrier ();
+      // every partition has finished its window: the outboxes and the
+      // stop flags can be read.
+      ReceiveMessages (partition);
+      if (partition->stop || partition->events->IsEmpty ())
+        {
+          partition->nextTs = MAX_TS;
+        }
+      else
+        {
+          partition->nextTs = partition->events->PeekNext ().key.m_ts;
+        }
+      bool stop = false;
+      for (std::vector<Partition *>::const_iterator i = m_partitions.begin (); i != m_partitions.end (); i++)
+        {
+          stop |= (*i)->stop;
+        }
+      Barrier ();
+      // every partition has published the timestamp of its next event
+      uint64_t next = MAX_TS;
+      for (std::vector<Partition *>::const_iterator i = m_partitions.begin (); i != m_partitions.end (); i++)
+        {
+          next = std::min (next, (*i)->nextTs);
+        }
+      if (stop || next == MAX_TS)
+        {
+          break;
+        }
+      partition->windowEnd = SaturatingAdd (next, m_lookAhead);
+    }
+  m_currentPartition = 0;
+}
+
+uint64_t
+MultithreadedSimulatorImpl::GetNextTs (void) const
+{
+  uint64_t next = MAX_TS;
+  if (m_partitions.empty ())
+    {
+      if (!m_events->IsEmpty ())
+        {
+          next = m_events->PeekNext ().key.m_ts;
+        }
+      return next;
+    }
+  for (std::vector<Partition *>::const_iterator i = m_partitions.begin (); i != m_partitions.end (); i++)
+    {
+      if (!(*i)->events->IsEmpty ())
+        {
+          next = std::min (next, (*i)->events->PeekNext ().key.m_ts);
+        }
+    }
+  return next;
+}
+
+bool
+MultithreadedSimulatorImpl::IsFinished (void) const
+{
+  return GetNextTs () == MAX_TS || m_stop;
+}
+
+Time
+MultithreadedSimulatorImpl::Next (void) const
+{
+  NS_ASSERT (GetNextTs () != MAX_TS);
+  return TimeStep (GetNextTs ());
+}
+
+void
+MultithreadedSimulatorImpl::Run (void)
+{
+  NS_ASSERT_MSG (m_currentPartition == 0, "Simulator::Run called from an event");
+  if (m_partitions.empty ())
+    {
+      CreatePartitions ();
+    }
+  m_stop = false;
+  uint64_t next = GetNextTs ();
+  if (next == MAX_TS)
+    {
+      return;
+    }
+  for (std::vector<Partition *>::iterator i = m_partitions.begin (); i != m_partitions.end (); i++)
+    {
+      (*i)->stop = false;
+      (*i)->windowEnd = SaturatingAdd (next, m_lookAhead);
+    }
+  m_barrierCount = 0;
+  std::vector<Ptr<SystemThread> > threads;
+  for (uint32_t i = 1; i < m_partitions.size (); i++)
+    {
+      Ptr<SystemThread> thread = Create<SystemThread> (MakeCallback (&Partition::Run, m_partitions[i]));
+      thread->Start ();
+      threads.push_back (thread);
+    }
+  RunPartition (m_partitions[0]);
+  for (std::vector<Ptr<SystemThread> >::iterator i = threads.begin (); i != threads.end (); i++)
+    {
+      (*i)->Join ();
+    }
+
+  bool empty = true;
+  for (std::vector<Partition *>::const_iterator i = m_partitions.begin (); i != m_partitions.end (); i++)
+    {
+      Partition *partition = *i;
+      m_currentTs = std::max (m_currentTs, partition->currentTs);
+      m_stop |= partition->stop;
+      empty &= partition->events->IsEmpty ();
+      // If the simulator stopped naturally by lack of events, make a
+      // consistency test to check that we didn't lose any events along the way.
+      NS_ASSERT (!partition->events->IsEmpty () || m_stop || partition->unscheduledEvents == 0);
+    }
+  NS_ASSERT (!empty || m_stop || m_unscheduledEvents == 0);
+}
+
+void
+MultithreadedSimulatorImpl::RunOneEvent (void)
+{
+  NS_ASSERT_MSG (m_currentPartition == 0, "Simulator::RunOneEvent called from an event");
+  if (m_partitions.empty ())
+    {
+      CreatePartitions ();
+    }
+  Partition *partition = 0;
+  for (std::vector<Partition *>::const_iterator i = m_partitions.begin (); i != m_partitions.end (); i++)
+    {
+      if (!(*i)->events->IsEmpty () &&
+          (partition == 0 ||
+           (*i)->events->PeekNext ().key.m_ts < partition->events->PeekNext ().key.m_ts))
+        {
+          partition = *i;
+        }
+    }
+  NS_ASSERT (partition != 0);
+  // the events scheduled in the other partitions are delivered at once
+  partition->windowEnd = partition->events->PeekNext ().key.m_ts;
+  m_currentPartition = partition;
+  ProcessOneEvent (partition);
+  m_currentPartition = 0;
+  for (std::vector<Partition *>::const_iterator i = m_partitions.begin (); i != m_partitions.end (); i++)
+    {
+      ReceiveMessages (*i);
+    }
+  m_currentTs = std::max (m_currentTs, partition->currentTs);
+}
+
+void
+MultithreadedSimulatorImpl::Stop (void)
+{
+  if (m_currentPartition != 0)
+    {
+      m_currentPartition->stop = true;
+    }
+  else
+    {
+      m_stop = true;
+    }
+}
+
+void
+MultithreadedSimulatorImpl::Stop (Time const &time)
+{
+  uint64_t ts = static_cast<uint64_t> ((time + Now ()).GetTimeStep ());
+  if (m_partitions.empty ())
+    {
+      Scheduler::EventKey key;
+      key.m_ts = ts;
+      key.m_uid = m_uid;
+      key.m_context = 0xffffffff;
+      m_uid++;
+      m_stopEvents.push_back (key);
+      return;
+    }
+  // every partition must stop at the same time
+  Partition *current = m_currentPartition;
+  for (std::vector<Partition *>::iterator i = m_partitions.begin (); i != m_partitions.end (); i++)
+    {
+      EventImpl *event = MakeEvent (&Simulator::Stop);
+      if (current == 0 || current == *i)
+        {
+          Insert (*i, ts, 0xffffffff, event);
+        }
+      else
+        {
+          Message message;
+          message.ts = std::max (ts, current->windowEnd);
+          message.sendTs = current->currentTs;
+          message.context = 0xffffffff;
+          message.impl = event;
+          current->outbox[(*i)->index].push_back (message);
+        }
+    }
+}
+
+//
+// Schedule an event for a _relative_ time in the future.
+//
+EventId
+MultithreadedSimulatorImpl::Schedule (Time const &time, EventImpl *event)
+{
+  Time tAbsolute = time + Now ();
+
+  NS_ASSERT (tAbsolute.IsPositive ());
+  NS_ASSERT (tAbsolute >= Now ());
+  uint64_t ts = (uint64_t) tAbsolute.GetTimeStep ();
+  uint32_t context = GetContext ();
+  Partition *partition = m_currentPartition;
+  if (partition == 0 && !m_partitions.empty ())
+    {
+      partition = GetPartition (context);
+    }
+  uint32_t uid = Insert (partition, ts, context, event);
+  return EventId (event, ts, context, uid);
+}
+
+void
+MultithreadedSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event)
+{
+  NS_LOG_FUNCTION (this << context << time.GetTimeStep () << event);
+
+  uint64_t ts = static_cast<uint64_t> (Now ().GetTimeStep ()) + time.GetTimeStep ();
+  if (m_partitions.empty ())
+    {
+      Insert (0, ts, context, event);
+      return;
+    }
+  Partition *current = m_currentPartition;
+  Partition *partition = GetPartition (context);
+  if (current == 0 || current == partition)
+    {
+      Insert (partition, ts, context, event);
+      return;
+    }
+  if (ts < current->windowEnd)
+    {
+      NS_FATAL_ERROR ("Event scheduled in another partition before the end of the current window: "
+                      "the delay between node " << current->currentContext << " and node " << context <<
+                      " is smaller than the lookahead");
+    }
+  Message message;
+  message.ts = ts;
+  message.sendTs = current->currentTs;
+  message.context = context;
+  message.impl = event;
+  current->outbox[partition->index].push_back (message);
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  return Schedule (TimeStep (0), event);
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleDestroy (EventImpl *event)
+{
+  EventId id (Ptr<EventImpl> (event, false), Now ().GetTimeStep (), 0xffffffff, 2);
+  pthread_mutex_lock (&m_destroyMutex);
+  m_destroyEvents.push_back (id);
+  pthread_mutex_unlock (&m_destroyMutex);
+  if (m_currentPartition != 0)
+    {
+      m_currentPartition->uid++;
+    }
+  else if (m_partitions.empty ())
+    {
+      m_uid++;
+    }
+  return id;
+}
+
+Time
+MultithreadedSimulatorImpl::Now (void) const
+{
+  if (m_currentPartition != 0)
+    {
+      return TimeStep (m_currentPartition->currentTs);
+    }
+  return TimeStep (m_currentTs);
+}
+
+Time
+MultithreadedSimulatorImpl::GetDelayLeft (const EventId &id) const
+{
+  if (IsExpired (id))
+    {
+      return TimeStep (0);
+    }
+  else
+    {
+      return TimeStep (id.GetTs ()) - Now ();
+    }
+}
+
+void
+MultithreadedSimulatorImpl::Remove (const EventId &id)
+{
+  if (id.GetUid () == 2)
+    {
+      // destroy events.
+      pthread_mutex_lock (&m_destroyMutex);
+      for (DestroyEvents::iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              m_destroyEvents.erase (i);
+              break;
+            }
+        }
+      pthread_mutex_unlock (&m_destroyMutex);
+      return;
+    }
+  if (IsExpired (id))
+    {
+      return;
+    }
+  Scheduler::Event event;
+  event.impl = id.PeekEventImpl ();
+  event.key.m_ts = id.GetTs ();
+  event.key.m_context = id.GetContext ();
+  event.key.m_uid = id.GetUid ();
+  if (m_partitions.empty ())
+    {
+      m_events->Remove (event);
+      m_unscheduledEvents--;
+    }
+  else
+    {
+      Partition *partition = GetOwner (id);
+      NS_ASSERT_MSG (m_currentPartition == 0 || m_currentPartition == partition,
+                     "Cannot remove an event of another partition");
+      partition->events->Remove (event);
+      partition->unscheduledEvents--;
+      partition->unbound.erase (event.impl);
+    }
+  event.impl->Cancel ();
+  // whenever we remove an event from the event list, we have to unref it.
+  event.impl->Unref ();
+}
+
+void
+MultithreadedSimulatorImpl::Cancel (const EventId &id)
+{
+  if (!IsExpired (id))
+    {
+      id.PeekEventImpl ()->Cancel ();
+    }
+}
+
+bool
+MultithreadedSimulatorImpl::IsExpired (const EventId &ev) const
+{
+  if (ev.GetUid () == 2)
+    {
+      if (ev.PeekEventImpl () == 0 ||
+          ev.PeekEventImpl ()->IsCancelled ())
+        {
+          return true;
+        }
+      // destroy events.
+      bool expired = true;
+      pthread_mutex_lock (&m_destroyMutex);
+      for (DestroyEvents::const_iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == ev)
+            {
+              expired = false;
+              break;
+            }
+        }
+      pthread_mutex_unlock (&m_destroyMutex);
+      return expired;
+    }
+  uint64_t currentTs = m_currentTs;
+  uint32_t currentUid = m_currentUid;
+  if (!m_partitions.empty ())
+    {
+      Partition *partition = GetOwner (ev);
+      if (partition == 0)
+        {
+          // an event not bound to a node which has run or was removed
+          return true;
+        }
+      NS_ASSERT_MSG (m_currentPartition == 0 || m_currentPartition == partition,
+                     "Cannot check an event of another partition");
+      currentTs = partition->currentTs;
+      currentUid = partition->currentUid;
+    }
+  if (ev.PeekEventImpl () == 0 ||
+      ev.GetTs () < currentTs ||
+      (ev.GetTs () == currentTs &&
+       ev.GetUid () <= currentUid) ||
+      ev.PeekEventImpl ()->IsCancelled ())
+    {
+      return true;
+    }
+  else
+    {
+      return false;
+    }
+}
+
+Time
+MultithreadedSimulatorImpl::GetMaximumSimulationTime (void) const
+{
+  return TimeStep (0x7fffffffffffffffLL);
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetSystemId (void) const
+{
+  if (m_currentPartition != 0)
+    {
+      return m_currentPartition->systemId;
+    }
+  return 0;
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetContext (void) const
+{
+  if (m_currentPartition != 0)
+    {
+      return m_currentPartition->currentContext;
+    }
+  return m_currentContext;
+}
+
+} // namespace ns3
@@ -0,0 +1,209 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MULTITHREADED_SIMULATOR_IMPL_H
+#define MULTITHREADED_SIMULATOR_IMPL_H
+
+#include "ns3/simulator-impl.h"
+#include "ns3/scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/object-factory.h"
+#include "ns3/ptr.h"
+
+#include <pthread.h>
+#include <list>
+#include <set>
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \brief multithreaded simulator implementation using lookahead
+ *
+ * The nodes are partitioned into logical processes, one per system id
+ * (see Node::GetSystemId) or, if the Partitions attribute is not zero,
+ * by a simple graph partitioning algorithm which assigns the system id
+ * of the nodes.  Each partition has its own event list, which is run by
+ * its own thread: the first partition is run by the thread which calls
+ * Simulator::Run.
+ *
+ * The partitions can only be connected by point-to-point channels.  As
+ * in DistributedSimulatorImpl, the smallest delay of these channels is
+ * the lookahead: the simulation proceeds by windows of this duration,
+ * during which every partition executes its events independently.  The
+ * events scheduled in another partition are kept in a queue per pair of
+ * partitions and inserted in the event list of their destination at the
+ * end of the window, after all the threads have reached a barrier.  The
+ * packets themselves are not serialized: PointToPointChannel hands over
+ * a Packet::DeepCopy to the receiving partition.
+ *
+ * The simulation is deterministic: it does not depend on the order in
+ * which the threads are scheduled.  For a given partitioning, each
+ * node sees the same sequence of events as with DefaultSimulatorImpl,
+ * with one exception: an event received from another partition is
+ * executed after the local events with the same timestamp which were
+ * scheduled during the window in which it was sent, even if they were
+ * scheduled after it.
+ *
+ * This simulator requires ns-3 to be configured with
+ * --enable-multithreading, which makes the reference counts atomic and
+ * the per-packet allocators thread-safe.  The models must not share
+ * mutable state between nodes of different partitions: for example,
+ * the trace sinks connected to nodes of several partitions are called
+ * concurrently.  Simulator::Stop () called from an event stops the
+ * other partitions at the end of the current window, and so does
+ * Simulator::Stop (time) if time is smaller than the lookahead.
+ */
+class MultithreadedSimulatorImpl : public SimulatorImpl
+{
+public:
+  static TypeId GetTypeId (void);
+
+  MultithreadedSimulatorImpl ();
+  ~MultithreadedSimulatorImpl ();
+
+  // virtual from SimulatorImpl
+  virtual void Destroy ();
+  virtual bool IsFinished (void) const;
+  virtual Time Next (void) const;
+  virtual void Stop (void);
+  virtual void Stop (Time const &time);
+  virtual EventId Schedule (Time const &time, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, Time const &time, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+  virtual EventId ScheduleDestroy (EventImpl *event);
+  virtual void Remove (const EventId &ev);
+  virtual void Cancel (const EventId &ev);
+  virtual bool IsExpired (const EventId &ev) const;
+  virtual void Run (void);
+  virtual void RunOneEvent (void);
+  virtual Time Now (void) const;
+  virtual Time GetDelayLeft (const EventId &id) const;
+  virtual Time GetMaximumSimulationTime (void) const;
+  virtual void SetScheduler (ObjectFactory schedulerFactory);
+  virtual uint32_t GetSystemId (void) const;
+  virtual uint32_t GetContext (void) const;
+
+  /**
+   * \returns the number of partitions, which is only known once the
+   *          simulation has started.
+   */
+  uint32_t GetNPartitions (void) const;
+  /**
+   * \returns the lookahead, which is only known once the simulation
+   *          has started.
+   */
+  Time GetLookAhead (void) const;
+
+private:
+  // an event scheduled in another partition
+  struct Message
+  {
+    uint64_t ts;
+    // the time at which it was scheduled
+    uint64_t sendTs;
+    uint32_t context;
+    EventImpl *impl;
+  };
+  struct MessageCompare
+  {
+    bool operator () (const Message &a, const Message &b) const;
+  };
+  struct Partition
+  {
+    void Run (void);
+
+    MultithreadedSimulatorImpl *simulator;
+    uint32_t index;
+    uint32_t systemId;
+    Ptr<Scheduler> events;
+    uint32_t uid;
+    uint32_t currentUid;
+    uint64_t currentTs;
+    uint32_t currentContext;
+    // number of events that have been inserted but not yet scheduled,
+    // not counting the "destroy" events; this is used for validation
+    int unscheduledEvents;
+    bool stop;
+    // end of the current window, excluded
+    uint64_t windowEnd;
+    // timestamp of the next event, published at the end of each window
+    uint64_t nextTs;
+    // the events scheduled in each partition during the current window
+    std::vector<std::vector<Message> > outbox;
+    std::vector<Message> inbox;
+    // the pending events of this partition which are not bound to a
+    // node: their context does not tell which partition owns them
+    std::set<EventImpl *> unbound;
+  };
+  typedef std::list<EventId> DestroyEvents;
+
+  virtual void DoDispose (void);
+  void CreatePartitions (void);
+  void PartitionAutomatically (void);
+  void CalculateLookAhead (void);
+  Partition *GetPartition (uint32_t context) const;
+  // the partition whose event list holds the event, or 0 if the event
+  // is no longer pending
+  Partition *GetOwner (const EventId &id) const;
+  bool IsUnbound (uint32_t context) const;
+  // insert in the event list of the partition, or in m_events if it is
+  // null, and return the uid of the event
+  uint32_t Insert (Partition *partition, uint64_t ts, uint32_t context, EventImpl *event);
+  void RunPartition (Partition *partition);
+  void ReceiveMessages (Partition *partition);
+  void ProcessOneEvent (Partition *partition);
+  uint64_t GetNextTs (void) const;
+  void Barrier (void);
+
+  ObjectFactory m_schedulerFactory;
+  uint32_t m_nPartitionsWanted;
+
+  // the events scheduled before the partitions are created
+  Ptr<Scheduler> m_events;
+  uint32_t m_uid;
+  int m_unscheduledEvents;
+  // the timestamps and uids of the Stop events scheduled before the
+  // partitions are created: they are replicated in every partition.
+  std::list<Scheduler::EventKey> m_stopEvents;
+
+  // the state seen by the threads which do not run a partition
+  uint64_t m_currentTs;
+  uint32_t m_currentContext;
+  uint32_t m_currentUid;
+  // whether the last run was stopped
+  bool m_stop;
+
+  std::vector<Partition *> m_partitions;
+  // indexed by node id
+  std::vector<uint32_t> m_nodePartition;
+  uint64_t m_lookAhead;
+
+  DestroyEvents m_destroyEvents;
+  mutable pthread_mutex_t m_destroyMutex;
+
+  pthread_mutex_t m_barrierMutex;
+  pthread_cond_t m_barrierCond;
+  uint32_t m_barrierCount;
+  uint32_t m_barrierGeneration;
+
+  // the partition run by the calling thread, if any
+  static __thread Partition *m_currentPartition;
+};
+
+} // namespace ns3
+
+#endif /* MULTITHREADED_SIMULATOR_IMPL_H */
@@ -61,8 +61,7 @@ TypeId DropTailQueue::GetTypeId (void)
 
 DropTailQueue::DropTailQueue () :
   Queue (),
-  m_packets (),
-  m_bytesInQueue (0)
+  m_packets ()
 {
   NS_LOG_FUNCTION_NOARGS ();
 }
@@ -91,14 +90,14 @@ DropTailQueue::DoEnqueue (Ptr<Packet> p)
 {
   NS_LOG_FUNCTION (this << p);
 
-  if (m_mode == PACKETS && (m_packets.size () >= m_maxPackets))
+  if (m_mode == PACKETS && (m_packets.GetNPackets () >= m_maxPackets))
     {
       NS_LOG_LOGIC ("Queue full (at max packets) -- droppping pkt");
       Drop (p);
       return false;
     }
 
-  if (m_mode == BYTES && (m_bytesInQueue + p->GetSize () >= m_maxBytes))
+  if (m_mode == BYTES && (m_packets.GetNBytes () + p->GetSize () >= m_maxBytes))
     {
       NS_LOG_LOGIC ("Queue full (packet would exceed max bytes) -- droppping pkt");
       Drop (p);
@@ -107,18 +106,17 @@ DropTailQueue::DoEnqueue (Ptr<Packet> p)
 
   //std::cout << "size of packet: " << p->GetSize() << std::endl;
 
-  m_bytesInQueue += p->GetSize ();
-  m_packets.push(p);
+  m_packets.PushBack (p);
 
   if (m_qdebug)
     {
       std::cout << "MAX_PACKETS: " << m_maxPackets << std::endl;
-      std::cout << "\tqsize " << m_packets.size () << std::endl;
-      std::cout << "\tbytes in queue " << m_bytesInQueue << std::endl;
+      std::cout << "\tqsize " << m_packets.GetNPackets () << std::endl;
+      std::cout << "\tbytes in queue " << m_packets.GetNBytes () << std::endl;
     }
 
-  NS_LOG_LOGIC ("Number packets " << m_packets.size ());
-  NS_LOG_LOGIC ("Number bytes " << m_bytesInQueue);
+  NS_LOG_LOGIC ("Number packets " << m_packets.GetNPackets ());
+  NS_LOG_LOGIC ("Number bytes " << m_packets.GetNBytes ());
 
   return true;
 }
@@ -128,20 +126,19 @@ DropTailQueue::DoDequeue (void)
 {
   NS_LOG_FUNCTION (this);
 
-  if (m_packets.empty()) 
+  if (m_packets.IsEmpty ()) 
     {
       NS_LOG_LOGIC ("Queue empty");
       return 0;
     }
 
-  Ptr<Packet> p = m_packets.front ();
-  m_packets.pop ();
-  m_bytesInQueue -= p->GetSize ();
+  Ptr<Packet> p = m_packets.Front ();
+  m_packets.PopFront ();
 
   NS_LOG_LOGIC ("Popped " << p);
 
-  NS_LOG_LOGIC ("Number packets " << m_packets.size ());
-  NS_LOG_LOGIC ("Number bytes " << m_bytesInQueue);
+  NS_LOG_LOGIC ("Number packets " << m_packets.GetNPackets ());
+  NS_LOG_LOGIC ("Number bytes " << m_packets.GetNBytes ());
 
   return p;
 }
@@ -151,16 +148,16 @@ DropTailQueue::DoPeek (void) const
 {
   NS_LOG_FUNCTION (this);
 
-  if (m_packets.empty()) 
+  if (m_packets.IsEmpty ()) 
     {
       NS_LOG_LOGIC ("Queue empty");
       return 0;
     }
 
-  Ptr<Packet> p = m_packets.front ();
+  Ptr<Packet> p = m_packets.Front ();
 
-  NS_LOG_LOGIC ("Number packets " << m_packets.size ());
-  NS_LOG_LOGIC ("Number bytes " << m_bytesInQueue);
+  NS_LOG_LOGIC ("Number packets " << m_packets.GetNPackets ());
+  NS_LOG_LOGIC ("Number bytes " << m_packets.GetNBytes ());
 
   return p;
 }
@@ -168,6 +165,7 @@ DropTailQueue::DoPeek (void) const
 } // namespace ns3
 
 #include "ns3/test.h"
+#include <vector>
 
 namespace ns3 {
 
@@ -227,6 +225,90 @@ DropTailQueueTestCase::DoRun (void)
   return false;
 }
 
+class PacketRingBufferTestCase : public TestCase
+{
+public:
+  PacketRingBufferTestCase ();
+  virtual bool DoRun (void);
+};
+
+PacketRingBufferTestCase::PacketRingBufferTestCase ()
+  : TestCase ("Packet ring buffer keeps FIFO order and byte counts across growth and wrap-around")
+{}
+
+static bool
+IsOddSized (const Ptr<Packet> &p)
+{
+  return p->GetSize () % 2 == 1;
+}
+
+bool
+PacketRingBufferTestCase::DoRun (void)
+{
+  PacketRingBuffer<Ptr<Packet> > ring;
+  std::vector<Ptr<Packet> > ref;
+  uint32_t bytes = 0;
+
+  // wrap the head around the initial capacity before forcing growth
+  for (uint32_t i = 0; i < 10; i++)
+    {
+      ring.PushBack (Create<Packet> (i));
+      ring.PopFront ();
+    }
+  for (uint32_t i = 1; i <= 40; i++)
+    {
+      Ptr<Packet> p = Create<Packet> (i);
+      ring.PushBack (p);
+      ref.push_back (p);
+      bytes += i;
+    }
+  Ptr<Packet> first = Create<Packet> (100);
+  ring.PushFront (first);
+  ref.insert (ref.begin (), first);
+  bytes += 100;
+  NS_TEST_EXPECT_MSG_EQ (ring.GetNPackets (), ref.size (), "packet count after growth");
+  NS_TEST_EXPECT_MSG_EQ (ring.GetNBytes (), bytes, "byte count after growth");
+  for (uint32_t i = 0; i < ref.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (ring.Get (i), ref[i], "order after growth, position " << i);
+    }
+
+  // remove near the front and near the back
+  bytes -= ref[3]->GetSize () + ref[35]->GetSize ();
+  ring.Remove (35);
+  ref.erase (ref.begin () + 35);
+  ring.Remove (3);
+  ref.erase (ref.begin () + 3);
+  NS_TEST_EXPECT_MSG_EQ (ring.GetNBytes (), bytes, "byte count after Remove");
+  for (uint32_t i = 0; i < ref.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (ring.Get (i), ref[i], "order after Remove, position " << i);
+    }
+
+  uint32_t removed = ring.RemoveIf (&IsOddSized);
+  std::vector<Ptr<Packet> > kept;
+  bytes = 0;
+  for (uint32_t i = 0; i < ref.size (); i++)
+    {
+      if (!IsOddSized (ref[i]))
+        {
+          kept.push_back (ref[i]);
+          bytes += ref[i]->GetSize ();
+        }
+    }
+  NS_TEST_EXPECT_MSG_EQ (removed, ref.size () - kept.size (), "RemoveIf count");
+  NS_TEST_EXPECT_MSG_EQ (ring.GetNBytes (), bytes, "byte count after RemoveIf");
+  for (uint32_t i = 0; i < kept.size (); i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (ring.Front (), kept[i], "FIFO order after RemoveIf, position " << i);
+      ring.PopFront ();
+    }
+  NS_TEST_EXPECT_MSG_EQ (ring.IsEmpty (), true, "drained");
+  NS_TEST_EXPECT_MSG_EQ (ring.GetNBytes (), 0, "no bytes left");
+
+  return GetErrorStatus ();
+}
+
 static class DropTailQueueTestSuite : public TestSuite
 {
 public:
@@ -234,6 +316,7 @@ public:
     : TestSuite ("drop-tail-queue", UNIT)
   {
     AddTestCase (new DropTailQueueTestCase ());
+    AddTestCase (new PacketRingBufferTestCase ());
   }
 } g_dropTailQueueTestSuite;
 
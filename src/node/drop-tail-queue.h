@@ -19,9 +19,9 @@
 #ifndef DROPTAIL_H
 #define DROPTAIL_H
 
-#include <queue>
 #include "ns3/packet.h"
 #include "ns3/queue.h"
+#include "packet-ring-buffer.h"
 
 namespace ns3 {
 
@@ -74,11 +74,10 @@ private:
   virtual Ptr<Packet> DoDequeue (void);
   virtual Ptr<const Packet> DoPeek (void) const;
 
-  std::queue<Ptr<Packet> > m_packets;
+  PacketRingBuffer<Ptr<Packet> > m_packets;
   uint32_t m_qdebug;
   uint32_t m_maxPackets;
   uint32_t m_maxBytes;
-  uint32_t m_bytesInQueue;
   Mode     m_mode;
  
 };
@@ -87,6 +87,16 @@ Ipv4Header::GetTos (void) const
 {
   return m_tos;
 }
+void
+Ipv4Header::SetEcn (EcnType ecn)
+{
+  m_tos = (m_tos & 0xfc) | ecn;
+}
+Ipv4Header::EcnType
+Ipv4Header::GetEcn (void) const
+{
+  return EcnType (m_tos & 0x03);
+}
 void 
 Ipv4Header::SetMoreFragments (void)
 {
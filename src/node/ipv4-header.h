@@ -56,6 +56,20 @@ public:
    * \param tos the 8 bits of Ipv4 TOS.
    */
   void SetTos (uint8_t tos);
+  /**
+   * ECN codepoints, the two low-order bits of the TOS field (RFC 3168)
+   */
+  enum EcnType
+    {
+      ECN_NotECT = 0x00,
+      ECN_ECT1 = 0x01,
+      ECN_ECT0 = 0x02,
+      ECN_CE = 0x03
+    };
+  /**
+   * \param ecn the ECN codepoint, the other TOS bits are kept
+   */
+  void SetEcn (EcnType ecn);
   /**
    * This packet is not the last packet of a fragmented ipv4 packet.
    */
@@ -105,6 +119,10 @@ public:
    * \returns the TOS field of this packet.
    */
   uint8_t GetTos (void) const;
+  /**
+   * \returns the ECN codepoint of this packet.
+   */
+  EcnType GetEcn (void) const;
   /**
    * \returns true if this is the last fragment of a packet, false otherwise.
    */
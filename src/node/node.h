@@ -88,6 +88,16 @@ public:
    */
   uint32_t GetSystemId (void) const;
 
+  /**
+   * \param systemId the system id for parallel simulations associated
+   *        to this node.
+   *
+   * The system id is usually given to the constructor.  This method
+   * allows a partitioning algorithm to assign the nodes of an existing
+   * topology, before the simulation starts.
+   */
+  void SetSystemId (uint32_t systemId);
+
   /**
    * \param device NetDevice to associate to this node.
    * \returns the index of the NetDevice into the Node's list of
@@ -0,0 +1,319 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef PACKET_RING_BUFFER_H
+#define PACKET_RING_BUFFER_H
+
+#include <stdint.h>
+#include <vector>
+#include "ns3/assert.h"
+#include "ns3/packet.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup queue
+ * \brief FIFO storage for the packets of a queue
+ *
+ * A growable ring buffer shared by the queue implementations.  The slots
+ * are kept in a vector whose capacity is a power of two and doubles when
+ * it is full, so that, once the queue has reached its working size, no
+ * operation allocates memory.  The number of packets and the number of
+ * bytes they hold are maintained on every operation and are returned in
+ * constant time.
+ *
+ * Item is either a Ptr<Packet> (or Ptr<const Packet>), or a structure with
+ * a public Ptr<...> packet member and a default constructor; the size of
+ * that packet is what GetNBytes () accounts for.  Slots are reset to a
+ * default Item when they are vacated, so the storage does not keep
+ * packets alive.
+ */
+template <typename Item>
+class PacketRingBuffer
+{
+public:
+  PacketRingBuffer ();
+
+  /**
+   * \return true if no packet is stored
+   */
+  bool IsEmpty (void) const;
+  /**
+   * \return the number of stored packets
+   */
+  uint32_t GetNPackets (void) const;
+  /**
+   * \return the sum of the sizes of the stored packets
+   */
+  uint32_t GetNBytes (void) const;
+
+  /**
+   * \param item the item to store after the last one
+   */
+  void PushBack (const Item &item);
+  /**
+   * \param item the item to store before the first one
+   */
+  void PushFront (const Item &item);
+  /**
+   * \return the first item; the buffer must not be empty
+   */
+  const Item &Front (void) const;
+  /**
+   * Remove the first item; the buffer must not be empty.
+   */
+  void PopFront (void);
+  /**
+   * \param i position of the item, 0 being the first one
+   * \return the item at position i
+   */
+  const Item &Get (uint32_t i) const;
+  /**
+   * Remove the item at position i, keeping the order of the others.
+   * This is linear in the distance from i to the closest end.
+   *
+   * \param i position of the item, 0 being the first one
+   */
+  void Remove (uint32_t i);
+  /**
+   * Remove, in a single linear pass, every item for which pred (item)
+   * is true, keeping the order of the others.
+   *
+   * \param pred a function or functor taking a const Item &
+   * \return the number of items removed
+   */
+  template <typename Predicate>
+  uint32_t RemoveIf (Predicate pred);
+  /**
+   * Remove all items.  The capacity is kept.
+   */
+  void Clear (void);
+
+private:
+  static uint32_t GetItemSize (const Ptr<Packet> &item);
+  static uint32_t GetItemSize (const Ptr<const Packet> &item);
+  template <typename U>
+  static uint32_t GetItemSize (const U &item);
+
+  uint32_t Index (uint32_t i) const;
+  void Grow (void);
+
+  std::vector<Item> m_items;
+  uint32_t m_head;
+  uint32_t m_nPackets;
+  uint32_t m_nBytes;
+};
+
+} // namespace ns3
+
+namespace ns3 {
+
+template <typename Item>
+PacketRingBuffer<Item>::PacketRingBuffer ()
+  : m_head (0),
+    m_nPackets (0),
+    m_nBytes (0)
+{}
+
+template <typename Item>
+bool
+PacketRingBuffer<Item>::IsEmpty (void) const
+{
+  return m_nPackets == 0;
+}
+
+template <typename Item>
+uint32_t
+PacketRingBuffer<Item>::GetNPackets (void) const
+{
+  return m_nPackets;
+}
+
+template <typename Item>
+uint32_t
+PacketRingBuffer<Item>::GetNBytes (void) const
+{
+  return m_nBytes;
+}
+
+template <typename Item>
+void
+PacketRingBuffer<Item>::PushBack (const Item &item)
+{
+  if (m_nPackets == m_items.size ())
+    {
+      Grow ();
+    }
+  m_items[Index (m_nPackets)] = item;
+  m_nPackets++;
+  m_nBytes += GetItemSize (item);
+}
+
+template <typename Item>
+void
+PacketRingBuffer<Item>::PushFront (const Item &item)
+{
+  if (m_nPackets == m_items.size ())
+    {
+      Grow ();
+    }
+  m_head = (m_head - 1) & (m_items.size () - 1);
+  m_items[m_head] = item;
+  m_nPackets++;
+  m_nBytes += GetItemSize (item);
+}
+
+template <typename Item>
+const Item &
+PacketRingBuffer<Item>::Front (void) const
+{
+  NS_ASSERT (m_nPackets > 0);
+  return m_items[m_head];
+}
+
+template <typename Item>
+void
+PacketRingBuffer<Item>::PopFront (void)
+{
+  NS_ASSERT (m_nPackets > 0);
+  m_nBytes -= GetItemSize (m_items[m_head]);
+  m_items[m_head] = Item ();
+  m_head = (m_head + 1) & (m_items.size () - 1);
+  m_nPackets--;
+}
+
+template <typename Item>
+const Item &
+PacketRingBuffer<Item>::Get (uint32_t i) const
+{
+  NS_ASSERT (i < m_nPackets);
+  return m_items[Index (i)];
+}
+
+template <typename Item>
+void
+PacketRingBuffer<Item>::Remove (uint32_t i)
+{
+  NS_ASSERT (i < m_nPackets);
+  m_nBytes -= GetItemSize (m_items[Index (i)]);
+  if (i < m_nPackets / 2)
+    { // shift the items before i one slot towards the back
+      for (uint32_t j = i; j > 0; j--)
+        {
+          m_items[Index (j)] = m_items[Index (j - 1)];
+        }
+      m_items[m_head] = Item ();
+      m_head = (m_head + 1) & (m_items.size () - 1);
+    }
+  else
+    { // shift the items after i one slot towards the front
+      for (uint32_t j = i; j + 1 < m_nPackets; j++)
+        {
+          m_items[Index (j)] = m_items[Index (j + 1)];
+        }
+      m_items[Index (m_nPackets - 1)] = Item ();
+    }
+  m_nPackets--;
+}
+
+template <typename Item>
+template <typename Predicate>
+uint32_t
+PacketRingBuffer<Item>::RemoveIf (Predicate pred)
+{
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < m_nPackets; i++)
+    {
+      Item &item = m_items[Index (i)];
+      if (pred (static_cast<const Item &> (item)))
+        {
+          m_nBytes -= GetItemSize (item);
+        }
+      else
+        {
+          if (kept != i)
+            {
+              m_items[Index (kept)] = item;
+            }
+          kept++;
+        }
+    }
+  uint32_t removed = m_nPackets - kept;
+  for (uint32_t i = kept; i < m_nPackets; i++)
+    {
+      m_items[Index (i)] = Item ();
+    }
+  m_nPackets = kept;
+  return removed;
+}
+
+template <typename Item>
+void
+PacketRingBuffer<Item>::Clear (void)
+{
+  while (m_nPackets > 0)
+    {
+      PopFront ();
+    }
+  m_head = 0;
+}
+
+template <typename Item>
+uint32_t
+PacketRingBuffer<Item>::GetItemSize (const Ptr<Packet> &item)
+{
+  return item->GetSize ();
+}
+
+template <typename Item>
+uint32_t
+PacketRingBuffer<Item>::GetItemSize (const Ptr<const Packet> &item)
+{
+  return item->GetSize ();
+}
+
+template <typename Item>
+template <typename U>
+uint32_t
+PacketRingBuffer<Item>::GetItemSize (const U &item)
+{
+  return item.packet->GetSize ();
+}
+
+template <typename Item>
+uint32_t
+PacketRingBuffer<Item>::Index (uint32_t i) const
+{
+  return (m_head + i) & (m_items.size () - 1);
+}
+
+template <typename Item>
+void
+PacketRingBuffer<Item>::Grow (void)
+{
+  // unwrap the items at the front of a vector twice as large
+  uint32_t capacity = m_items.size ();
+  std::vector<Item> items (capacity == 0 ? 16 : 2 * capacity);
+  for (uint32_t i = 0; i < m_nPackets; i++)
+    {
+      items[i] = m_items[Index (i)];
+    }
+  m_items.swap (items);
+  m_head = 0;
+}
+
+} // namespace ns3
+
+#endif /* PACKET_RING_BUFFER_H */
@@ -205,4 +205,22 @@ Queue::Drop (Ptr<Packet> p)
   m_traceDrop (p);
 }
 
+void
+Queue::SetMarkCallback (MarkCallback cb)
+{
+  NS_LOG_FUNCTION (this);
+  m_markCallback = cb;
+}
+
+bool
+Queue::Mark (Ptr<Packet> p)
+{
+  NS_LOG_FUNCTION (this << p);
+  if (m_markCallback.IsNull ())
+    {
+      return false;
+    }
+  return m_markCallback (p);
+}
+
 } // namespace ns3
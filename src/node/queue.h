@@ -29,6 +29,7 @@
 #include "ns3/packet.h"
 #include "ns3/object.h"
 #include "ns3/traced-callback.h"
+#include "ns3/callback.h"
 
 namespace ns3 {
 
@@ -115,6 +116,21 @@ public:
    */
   void ResetStatistics (void);
 
+  /**
+   * \brief Callback used by an active queue to set the ECN Congestion
+   * Experienced codepoint of a packet instead of dropping it.
+   *
+   * The queue only sees the frame handed down by its NetDevice, so the
+   * device, which knows its own framing, installs this callback.  It must
+   * return true if the packet was marked, and false if the packet does not
+   * carry an ECN-capable transport (in which case the queue drops it).
+   */
+  typedef Callback<bool, Ptr<Packet> > MarkCallback;
+  /**
+   * \param cb the callback invoked by Mark ()
+   */
+  void SetMarkCallback (MarkCallback cb);
+
 #if 0
   // average calculation requires keeping around
   // a buffer with the date of arrival of past received packets
@@ -148,11 +164,15 @@ private:
 protected:
   // called by subclasses to notify parent of packet drops.
   void Drop (Ptr<Packet> packet);
+  // called by subclasses to set the CE codepoint of a packet; returns
+  // false if no mark callback is set or the packet is not ECN-capable.
+  bool Mark (Ptr<Packet> packet);
 
 private:
   TracedCallback<Ptr<const Packet> > m_traceEnqueue;
   TracedCallback<Ptr<const Packet> > m_traceDequeue;
   TracedCallback<Ptr<const Packet> > m_traceDrop;
+  MarkCallback m_markCallback;
 
   uint32_t m_nBytes;
   uint32_t m_nTotalReceivedBytes;
@@ -63,6 +63,7 @@
 #include "ns3/random-variable.h"
 
 #include <cstdlib>
+#include <cmath>
 
 NS_LOG_COMPONENT_DEFINE ("RedQueue");
 
@@ -101,6 +102,11 @@ TypeId RedQueue::GetTypeId (void)
                    BooleanValue (true),
                    MakeBooleanAccessor (&RedQueue::m_gentle),
                    MakeBooleanChecker ())
+    .AddAttribute ("UseEcn",
+                   "True to mark ECN-capable packets instead of dropping them early",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&RedQueue::m_useEcn),
+                   MakeBooleanChecker ())
     .AddAttribute ("m_minTh",
                    "Min avg length threshold in packets/bytes",
                    DoubleValue (5),
@@ -141,6 +147,62 @@ TypeId RedQueue::GetTypeId (void)
                    TimeValue (MilliSeconds (20)),
                    MakeTimeAccessor (&RedQueue::m_linkDelay),
                    MakeTimeChecker ())
+    .AddAttribute ("ARED",
+                   "True to enable Adaptive RED (adapt max_p to keep the average queue between the thresholds)",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&RedQueue::m_isARED),
+                   MakeBooleanChecker ())
+    .AddAttribute ("FengAdaptive",
+                   "True to use Feng's self-configuring RED instead of the Floyd AIMD rule (needs ARED)",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&RedQueue::m_isFengAdaptive),
+                   MakeBooleanChecker ())
+    .AddAttribute ("Interval",
+                   "Time between max_p updates in Adaptive RED",
+                   TimeValue (Seconds (0.5)),
+                   MakeTimeAccessor (&RedQueue::m_interval),
+                   MakeTimeChecker ())
+    .AddAttribute ("TargetDelay",
+                   "Target queueing delay, used to set m_minTh automatically when it is 0",
+                   TimeValue (Seconds (0.005)),
+                   MakeTimeAccessor (&RedQueue::m_targetDelay),
+                   MakeTimeChecker ())
+    .AddAttribute ("Top",
+                   "Upper bound for max_p in Adaptive RED",
+                   DoubleValue (0.5),
+                   MakeDoubleAccessor (&RedQueue::m_top),
+                   MakeDoubleChecker <double> (0, 1))
+    .AddAttribute ("Bottom",
+                   "Lower bound for max_p in Adaptive RED, 0 for automatic",
+                   DoubleValue (0.0),
+                   MakeDoubleAccessor (&RedQueue::m_bottom),
+                   MakeDoubleChecker <double> (0, 1))
+    .AddAttribute ("Alpha",
+                   "Additive increase of max_p in Adaptive RED",
+                   DoubleValue (0.01),
+                   MakeDoubleAccessor (&RedQueue::m_alpha),
+                   MakeDoubleChecker <double> (0))
+    .AddAttribute ("Beta",
+                   "Multiplicative decrease of max_p in Adaptive RED",
+                   DoubleValue (0.9),
+                   MakeDoubleAccessor (&RedQueue::m_beta),
+                   MakeDoubleChecker <double> (0, 1))
+    .AddAttribute ("FengAlpha",
+                   "Decrease factor of max_p in Feng's Adaptive RED",
+                   DoubleValue (3.0),
+                   MakeDoubleAccessor (&RedQueue::m_fengAlpha),
+                   MakeDoubleChecker <double> (1))
+    .AddAttribute ("FengBeta",
+                   "Increase factor of max_p in Feng's Adaptive RED",
+                   DoubleValue (2.0),
+                   MakeDoubleAccessor (&RedQueue::m_fengBeta),
+                   MakeDoubleChecker <double> (1))
+    .AddTraceSource ("CurMaxP",
+                     "The current max_p, changed by Adaptive RED",
+                     MakeTraceSourceAccessor (&RedQueue::m_curMaxP))
+    .AddTraceSource ("QueueAvg",
+                     "The average queue size",
+                     MakeTraceSourceAccessor (&RedQueue::m_qAvg))
   ;
 
   return tid;
@@ -159,6 +221,12 @@ RedQueue::SetTh(double min, double max)
   m_maxTh = max;
 }
 
+RedQueue::Stats
+RedQueue::GetStats (void)
+{
+  return m_stats;
+}
+
 /*
  * Note: if the link bandwidth changes in the course of the
  * simulation, the bandwidth-dependent RED parameters do not change.
@@ -170,7 +238,36 @@ RedQueue::InitializeParams (void)
 {
   m_cautious = 0;
   m_ptc = m_linkBandwidth.GetBitRate () / (8.0 * m_meanPktSize);
-  
+
+  if (m_isARED)
+    {
+      // Adaptive RED is meant to be run in gentle mode
+      m_gentle = true;
+    }
+
+  /*
+   * A zero threshold means it is set automatically: m_minTh from the
+   * target queueing delay at the link bandwidth (at least 5 packets),
+   * m_maxTh three times m_minTh.
+   */
+  if (m_minTh == 0)
+    {
+      double targetQueue = m_targetDelay.GetSeconds () * m_ptc;
+      m_minTh = 5.0;
+      if (m_minTh < targetQueue / 2.0)
+        {
+          m_minTh = targetQueue / 2.0;
+        }
+      if (GetMode () == BYTES)
+        {
+          m_minTh *= m_meanPktSize;
+        }
+    }
+  if (m_maxTh == 0)
+    {
+      m_maxTh = 3.0 * m_minTh;
+    }
+
   m_curMaxP = 0.02;
 
   m_qAvg = 0.0;
@@ -199,6 +296,22 @@ RedQueue::InitializeParams (void)
       m_vD = 2.0 * m_curMaxP - 1.0;
     }
   m_idleTime = NanoSeconds (0);
+  m_lastSet = Seconds (0);
+  m_fengStatus = Above;
+
+  if (m_bottom == 0)
+    {
+      m_bottom = 0.01;
+      // Set bottom to at most 1/W, for W the delay-bandwidth
+      // product in packets for a connection with this bandwidth,
+      // 1000-byte packets, and 100 ms RTTs.
+      // So W = 0.1 * link_bandwidth / 8000
+      double bottom1 = 80000.0 / m_linkBandwidth.GetBitRate ();
+      if (bottom1 < m_bottom)
+        {
+          m_bottom = bottom1;
+        }
+    }
 
 /*
  * If q_weight=0, set it to a reasonable value of 1-exp(-1/C)
@@ -232,11 +345,15 @@ RedQueue::InitializeParams (void)
       m_qW = 1.0 - exp(-10.0 / m_ptc);
     }
 
-  if (m_minPacketsTh == 0)
+  /*
+   * m_decayTable[i] = (1 - m_qW)^i, built by repeated multiplication
+   * so that short idle gaps give the same result as ns-2's loop.
+   */
+  m_decayTable.resize (RED_DECAY_TABLE_SIZE);
+  m_decayTable[0] = 1.0;
+  for (uint32_t i = 1; i < RED_DECAY_TABLE_SIZE; i++)
     {
-      m_minPacketsTh = 5.0;
-
-      // TODO: implement adaptative RED
+      m_decayTable[i] = m_decayTable[i - 1] * (1.0 - m_qW);
     }
 
   // std::cout << "m_delay " << m_linkDelay.GetSeconds () << "; m_wait " << m_wait << "; m_qW " << m_qW << "; m_ptc " << m_ptc << "; m_minTh " << m_minTh << "; m_maxTh " << m_maxTh << "; m_gentle " << m_gentle << "; th_diff" << th_diff << "; lInternm " << m_lInterm << "; va " << m_vA <<  "; cur_max_p " << m_curMaxP << "; v_b " << m_vB <<  "; m_vC " << m_vC << "; m_vD " <<  m_vD << std::endl;
@@ -245,10 +362,15 @@ RedQueue::InitializeParams (void)
 RedQueue::RedQueue ()
   : Queue (),
     m_packets (),
-    m_bytesInQueue (0),
     m_redParams(false)
 {
-
+  NS_LOG_FUNCTION_NOARGS ();
+  m_stats.unforcedDrop = 0;
+  m_stats.unforcedMark = 0;
+  m_stats.forcedDrop = 0;
+  m_stats.pdrop = 0;
+  m_stats.other = 0;
+  m_stats.backlog = 0;
 }
 
 RedQueue::~RedQueue ()
@@ -275,31 +397,99 @@ RedQueue::Estimator (uint32_t nQueued, uint32_t m, double qAvg, double qW)
 {
   double newAve;
 
-  newAve = qAvg;
-  while (--m >= 1)
-    {
-      newAve *= 1.0 - qW;
-    }
-  newAve *= 1.0 - qW;
+  /*
+   * The average decays by (1 - qW) once per packet time; m is the
+   * number of packet times since the last update.  ns-2 applies the
+   * decay in a loop, which is O(m) after a long idle period.  Use the
+   * per-queue table for the common (short) gaps and pow () otherwise.
+   */
+  newAve = qAvg * Decay (m, qW);
   newAve += qW * nQueued;
 
-  // TODO: implement adaptative RED
-  // new param: m_adaptative; m_fengAdaptative
-  /*
   Time now = Simulator::Now ();
-  if (m_adaptative == 1)
+  if (m_isARED)
     {
-      if (m_fengAdaptative == 1)
+      if (m_isFengAdaptive)
         {
-          UpdateMaxPFeng(newAve);
+          UpdateMaxPFeng (newAve);
+        }
+      else if (now > m_lastSet + m_interval)
+        {
+          UpdateMaxP (newAve, now);
         }
-      else if ()
     }
-  */
 
   return newAve;
 }
 
+// update m_curMaxP to keep the average queue length within the thresholds
+void
+RedQueue::UpdateMaxP (double newAve, Time now)
+{
+  double part = 0.4 * (m_maxTh - m_minTh);
+  // AIMD rule to keep target queue ~1/2(m_minTh + m_maxTh)
+  if (newAve < m_minTh + part && m_curMaxP > m_bottom)
+    {
+      // we should increase the average queue size, so decrease max_p
+      m_curMaxP = m_curMaxP * m_beta;
+      m_lastSet = now;
+    }
+  else if (newAve > m_maxTh - part && m_top > m_curMaxP)
+    {
+      // we should decrease the average queue size, so increase max_p
+      double alpha = m_alpha;
+      if (alpha > 0.25 * m_curMaxP)
+        {
+          alpha = 0.25 * m_curMaxP;
+        }
+      m_curMaxP = m_curMaxP + alpha;
+      m_lastSet = now;
+    }
+  UpdateGentleParams ();
+}
+
+// update m_curMaxP based on Feng's self-configuring RED
+void
+RedQueue::UpdateMaxPFeng (double newAve)
+{
+  if (m_minTh < newAve && newAve < m_maxTh)
+    {
+      m_fengStatus = Between;
+    }
+  else if (newAve < m_minTh && m_fengStatus != Below)
+    {
+      m_fengStatus = Below;
+      m_curMaxP = m_curMaxP / m_fengAlpha;
+    }
+  else if (newAve > m_maxTh && m_fengStatus != Above)
+    {
+      m_fengStatus = Above;
+      m_curMaxP = m_curMaxP * m_fengBeta;
+    }
+  UpdateGentleParams ();
+}
+
+// the "gentle" slope goes from max_p at m_maxTh to 1 at twice m_maxTh
+void
+RedQueue::UpdateGentleParams (void)
+{
+  if (m_gentle)
+    {
+      m_vC = (1.0 - m_curMaxP) / m_maxTh;
+      m_vD = 2.0 * m_curMaxP - 1.0;
+    }
+}
+
+double
+RedQueue::Decay (uint32_t m, double qW) const
+{
+  if (qW == m_qW && m < m_decayTable.size ())
+    {
+      return m_decayTable[m];
+    }
+  return pow (1.0 - qW, (double) m);
+}
+
 double 
 RedQueue::ModifyP(double p, uint32_t count, uint32_t countBytes,
                   uint32_t meanPktSize, bool wait, uint32_t size)
@@ -452,11 +642,11 @@ RedQueue::GetQueueSize (void)
 {
   if (GetMode () == BYTES)
     {
-      return m_bytesInQueue;
+      return m_packets.GetNBytes ();
     }
   else // packets
     {
-      return m_packets.size ();
+      return m_packets.GetNPackets ();
     }
 }
 
@@ -476,7 +666,7 @@ RedQueue::DoEnqueue (Ptr<Packet> p)
   if (GetMode () == BYTES)
     {
       /*
-      if (m_bytesInQueue + p->GetSize () >= m_maxBytes)
+      if (m_packets.GetNBytes () + p->GetSize () >= m_maxBytes)
         {
           NS_LOG_LOGIC ("Queue full (packet would exceed max bytes) -- droppping pkt");
           Drop (p);
@@ -484,12 +674,12 @@ RedQueue::DoEnqueue (Ptr<Packet> p)
         }
       */
       NS_LOG_DEBUG("Enqueue in bytes mode");
-      nQueued = m_bytesInQueue;
+      nQueued = m_packets.GetNBytes ();
     }
   else if (GetMode () == PACKETS)
     {
       /*
-      if (m_packets.size () >= m_maxPackets)
+      if (m_packets.GetNPackets () >= m_maxPackets)
         {
           NS_LOG_LOGIC ("Queue full (at max packets) -- droppping pkt");
           Drop (p);
@@ -497,7 +687,7 @@ RedQueue::DoEnqueue (Ptr<Packet> p)
         }
       */
       NS_LOG_DEBUG("Enqueue in packets mode");
-      nQueued = m_packets.size ();
+      nQueued = m_packets.GetNPackets ();
     }
 
   uint32_t m = 0;
@@ -506,14 +696,26 @@ RedQueue::DoEnqueue (Ptr<Packet> p)
     {
       Time now = Simulator::Now ();
 
+      double idlePkts;
+
       if (m_cautious == 3)
         {
           double ptc = m_ptc * m_meanPktSize / m_idlePktSize;
-          m = uint32_t(ptc * (now - m_idleTime).GetSeconds());
+          idlePkts = ptc * (now - m_idleTime).GetSeconds();
         }
       else
         {
-          m = uint32_t(m_ptc * (now - m_idleTime).GetSeconds());
+          idlePkts = m_ptc * (now - m_idleTime).GetSeconds();
+        }
+
+      // keep m + 1 from wrapping around after a very long idle period
+      if (idlePkts >= 4294967294.0)
+        {
+          m = 4294967294U;
+        }
+      else
+        {
+          m = uint32_t(idlePkts);
         }
 
       m_idle = 0;
@@ -521,8 +723,8 @@ RedQueue::DoEnqueue (Ptr<Packet> p)
 
   m_qAvg = Estimator (nQueued, m + 1, m_qAvg, m_qW);
 
-  NS_LOG_DEBUG ("\t bytesInQueue  " << m_bytesInQueue << "\tQavg " << m_qAvg);
-  NS_LOG_DEBUG ("\t packetsInQueue  " << m_packets.size () << "\tQavg " << m_qAvg);
+  NS_LOG_DEBUG ("\t bytesInQueue  " << m_packets.GetNBytes () << "\tQavg " << m_qAvg);
+  NS_LOG_DEBUG ("\t packetsInQueue  " << m_packets.GetNPackets () << "\tQavg " << m_qAvg);
 
   m_count++;
   m_countBytes += p->GetSize ();
@@ -568,7 +770,14 @@ RedQueue::DoEnqueue (Ptr<Packet> p)
       dropType = DTYPE_FORCED;
     }
 
-  if (dropType == DTYPE_UNFORCED)
+  if (dropType == DTYPE_UNFORCED && m_useEcn && Mark (p))
+    {
+      // An ECN-capable packet is marked in place of the early drop
+      // (RFC 3168, sec. 5); forced drops are never turned into marks.
+      NS_LOG_DEBUG ("\t Marking due to Prob Mark " << m_qAvg);
+      m_stats.unforcedMark++;
+    }
+  else if (dropType == DTYPE_UNFORCED)
     {
       NS_LOG_DEBUG ("\t Dropping due to Prob Mark " << m_qAvg);
       m_stats.unforcedDrop++;
@@ -588,11 +797,10 @@ RedQueue::DoEnqueue (Ptr<Packet> p)
       return false;
     }
 
-  m_bytesInQueue += p->GetSize ();
-  m_packets.push_back (p);
+  m_packets.PushBack (p);
 
-  NS_LOG_LOGIC ("Number packets " << m_packets.size ());
-  NS_LOG_LOGIC ("Number bytes " << m_bytesInQueue);
+  NS_LOG_LOGIC ("Number packets " << m_packets.GetNPackets ());
+  NS_LOG_LOGIC ("Number bytes " << m_packets.GetNBytes ());
   
   return true;
 }
@@ -602,7 +810,7 @@ RedQueue::DoDequeue (void)
 {
   NS_LOG_FUNCTION (this);
 
-  if (m_packets.empty ())
+  if (m_packets.IsEmpty ())
     {
       NS_LOG_LOGIC ("Queue empty");
       m_idle = 1;
@@ -613,14 +821,13 @@ RedQueue::DoDequeue (void)
   else
     {
       m_idle = 0;
-      Ptr<Packet> p = m_packets.front ();
-      m_packets.pop_front ();
-      m_bytesInQueue -= p->GetSize ();
+      Ptr<Packet> p = m_packets.Front ();
+      m_packets.PopFront ();
 
       NS_LOG_LOGIC ("Popped " << p);
 
-      NS_LOG_LOGIC ("Number packets " << m_packets.size ());
-      NS_LOG_LOGIC ("Number bytes " << m_bytesInQueue);
+      NS_LOG_LOGIC ("Number packets " << m_packets.GetNPackets ());
+      NS_LOG_LOGIC ("Number bytes " << m_packets.GetNBytes ());
 
       return p;
     }
@@ -631,18 +838,260 @@ RedQueue::DoPeek (void) const
 {
   NS_LOG_FUNCTION (this);
 
-  if (m_packets.empty ())
+  if (m_packets.IsEmpty ())
     {
       NS_LOG_LOGIC ("Queue empty");
       return 0;
     }
 
-  Ptr<Packet> p = m_packets.front ();
+  Ptr<Packet> p = m_packets.Front ();
 
-  NS_LOG_LOGIC ("Number packets " << m_packets.size ());
-  NS_LOG_LOGIC ("Number bytes " << m_bytesInQueue);
+  NS_LOG_LOGIC ("Number packets " << m_packets.GetNPackets ());
+  NS_LOG_LOGIC ("Number bytes " << m_packets.GetNBytes ());
 
   return p;
 }
 
 } // namespace ns3
+
+#include "ns3/test.h"
+#include <limits>
+
+namespace ns3 {
+
+class RedQueueEstimatorTestCase : public TestCase
+{
+public:
+  RedQueueEstimatorTestCase ();
+private:
+  virtual bool DoRun (void);
+  double LoopEstimator (uint32_t nQueued, uint32_t m, double qAvg, double qW);
+  bool CheckWeight (double qW);
+};
+
+RedQueueEstimatorTestCase::RedQueueEstimatorTestCase ()
+  : TestCase ("Closed-form RED estimator matches the ns-2 decay loop")
+{
+}
+
+// the ns-2 estimator, one multiply per packet time
+double
+RedQueueEstimatorTestCase::LoopEstimator (uint32_t nQueued, uint32_t m, double qAvg, double qW)
+{
+  double newAve = qAvg;
+  while (--m >= 1)
+    {
+      newAve *= 1.0 - qW;
+    }
+  newAve *= 1.0 - qW;
+  newAve += qW * nQueued;
+  return newAve;
+}
+
+bool
+RedQueueEstimatorTestCase::CheckWeight (double qW)
+{
+  Ptr<RedQueue> queue = CreateObject<RedQueue> ();
+  queue->SetAttribute ("m_qW", DoubleValue (qW));
+  queue->InitializeParams ();
+
+  uint32_t gaps[] = { 1, 2, 3, 10, 63, 64, 65, 100, 1000, 12345, 100000, 1000000 };
+  uint32_t nQueued[] = { 0, 1, 7, 25 };
+  double qAvg[] = { 0.0, 0.5, 4.2, 17.0 };
+
+  for (uint32_t i = 0; i < sizeof (gaps) / sizeof (gaps[0]); i++)
+    {
+      for (uint32_t j = 0; j < sizeof (nQueued) / sizeof (nQueued[0]); j++)
+        {
+          for (uint32_t k = 0; k < sizeof (qAvg) / sizeof (qAvg[0]); k++)
+            {
+              double expected = LoopEstimator (nQueued[j], gaps[i], qAvg[k], qW);
+              double got = queue->Estimator (nQueued[j], gaps[i], qAvg[k], qW);
+              // documented bound: (m + 1) * 2^-53 relative, doubled for slack,
+              // plus the denormals the loop can leave after a long idle period
+              double tol = 2.0 * (gaps[i] + 1) * std::ldexp (1.0, -53) * expected
+                + std::numeric_limits<double>::min ();
+              NS_TEST_ASSERT_MSG_EQ_TOL (got, expected, tol,
+                                         "qW=" << qW << " m=" << gaps[i] << " nQueued=" << nQueued[j]
+                                         << " qAvg=" << qAvg[k]);
+            }
+        }
+    }
+  return false;
+}
+
+bool
+RedQueueEstimatorTestCase::DoRun (void)
+{
+  // weights used by the Floyd validation scripts, and a fast-link weight
+  CheckWeight (0.002);
+  CheckWeight (0.003);
+  CheckWeight (1.0 - std::exp (-1.0 / 1250000.0));
+  return GetErrorStatus ();
+}
+
+class RedQueueAdaptiveTestCase : public TestCase
+{
+public:
+  RedQueueAdaptiveTestCase ();
+private:
+  virtual bool DoRun (void);
+  void MaxPTrace (double oldValue, double newValue);
+  uint32_t m_maxPChanges;
+};
+
+RedQueueAdaptiveTestCase::RedQueueAdaptiveTestCase ()
+  : TestCase ("Adaptive RED and Feng's self-configuring RED update max_p"),
+    m_maxPChanges (0)
+{
+}
+
+void
+RedQueueAdaptiveTestCase::MaxPTrace (double oldValue, double newValue)
+{
+  m_maxPChanges++;
+}
+
+bool
+RedQueueAdaptiveTestCase::DoRun (void)
+{
+  // automatic thresholds: 10Mbps, 500 byte packets => 2500 pkts/s,
+  // 5ms target delay => target queue 12.5 packets
+  Ptr<RedQueue> queue = CreateObject<RedQueue> ();
+  queue->SetAttribute ("ARED", BooleanValue (true));
+  queue->SetAttribute ("LinkBandwidth", DataRateValue (DataRate ("10Mbps")));
+  queue->SetAttribute ("m_minTh", DoubleValue (0));
+  queue->SetAttribute ("m_maxTh", DoubleValue (0));
+  queue->SetAttribute ("m_lInterm", DoubleValue (10));
+  queue->TraceConnectWithoutContext ("CurMaxP", MakeCallback (&RedQueueAdaptiveTestCase::MaxPTrace, this));
+  queue->InitializeParams ();
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue->m_minTh, 6.25, 1e-9, "automatic m_minTh");
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue->m_maxTh, 18.75, 1e-9, "automatic m_maxTh");
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue->m_bottom, 0.008, 1e-12, "automatic bottom, 80000 / link bandwidth");
+  NS_TEST_ASSERT_MSG_EQ (queue->m_gentle, true, "ARED runs in gentle mode");
+
+  // average below the target range: multiplicative decrease
+  uint32_t changes = m_maxPChanges;
+  queue->UpdateMaxP (6.5, Seconds (1));
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue->m_curMaxP.Get (), 0.09, 1e-12, "max_p * beta");
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue->m_vD, 2 * 0.09 - 1, 1e-12, "gentle slope follows max_p");
+  NS_TEST_ASSERT_MSG_EQ (m_maxPChanges, changes + 1, "max_p change is traced");
+  // within the target range: unchanged
+  queue->UpdateMaxP (12.5, Seconds (2));
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue->m_curMaxP.Get (), 0.09, 1e-12, "max_p unchanged");
+  // above the target range: additive increase, limited to max_p / 4
+  queue->UpdateMaxP (18.0, Seconds (3));
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue->m_curMaxP.Get (), 0.1, 1e-12, "max_p + alpha");
+  queue->m_curMaxP = 0.02;
+  queue->UpdateMaxP (18.0, Seconds (4));
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue->m_curMaxP.Get (), 0.025, 1e-12, "max_p + max_p / 4");
+  // never above top
+  queue->m_curMaxP = 0.5;
+  queue->UpdateMaxP (18.0, Seconds (5));
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue->m_curMaxP.Get (), 0.5, 1e-12, "max_p bounded by top");
+  // the estimator only adapts once per interval
+  queue->m_curMaxP = 0.1;
+  queue->m_lastSet = Simulator::Now ();
+  queue->Estimator (0, 1, 0.0, queue->m_qW);
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue->m_curMaxP.Get (), 0.1, 1e-12, "no update within the interval");
+
+  // Feng: divide when falling below m_minTh, multiply when rising above m_maxTh
+  queue = CreateObject<RedQueue> ();
+  queue->SetAttribute ("ARED", BooleanValue (true));
+  queue->SetAttribute ("FengAdaptive", BooleanValue (true));
+  queue->SetAttribute ("m_lInterm", DoubleValue (10));
+  queue->InitializeParams ();
+  queue->UpdateMaxPFeng (2.0);
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue->m_curMaxP.Get (), 0.1 / 3.0, 1e-12, "max_p / FengAlpha");
+  queue->UpdateMaxPFeng (2.0);
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue->m_curMaxP.Get (), 0.1 / 3.0, 1e-12, "only once per crossing");
+  queue->UpdateMaxPFeng (10.0);
+  queue->UpdateMaxPFeng (20.0);
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue->m_curMaxP.Get (), 0.2 / 3.0, 1e-12, "max_p * FengBeta");
+  queue->Estimator (0, 1, 1.0, queue->m_qW);
+  NS_TEST_ASSERT_MSG_EQ_TOL (queue->m_curMaxP.Get (), 0.2 / 9.0, 1e-12, "the estimator drives Feng's update");
+
+  return GetErrorStatus ();
+}
+
+class RedQueueEcnTestCase : public TestCase
+{
+public:
+  RedQueueEcnTestCase ();
+private:
+  virtual bool DoRun (void);
+  bool MarkPacket (Ptr<Packet> p);
+  bool m_ect;
+  uint32_t m_marked;
+};
+
+RedQueueEcnTestCase::RedQueueEcnTestCase ()
+  : TestCase ("RED marks ECN-capable packets instead of dropping them early"),
+    m_ect (true),
+    m_marked (0)
+{
+}
+
+bool
+RedQueueEcnTestCase::MarkPacket (Ptr<Packet> p)
+{
+  if (m_ect)
+    {
+      m_marked++;
+    }
+  return m_ect;
+}
+
+bool
+RedQueueEcnTestCase::DoRun (void)
+{
+  // the average follows the instantaneous queue, well above m_minTh
+  // and below the gentle forced-drop region
+  for (uint32_t i = 0; i < 2; i++)
+    {
+      m_ect = (i == 0);
+      m_marked = 0;
+      Ptr<RedQueue> queue = CreateObject<RedQueue> ();
+      queue->SetAttribute ("UseEcn", BooleanValue (true));
+      queue->SetAttribute ("m_qW", DoubleValue (1.0));
+      queue->SetAttribute ("m_minTh", DoubleValue (2));
+      queue->SetAttribute ("m_maxTh", DoubleValue (100));
+      queue->SetAttribute ("m_lInterm", DoubleValue (1));
+      queue->SetAttribute ("QueueLimit", UintegerValue (1000));
+      queue->SetMarkCallback (MakeCallback (&RedQueueEcnTestCase::MarkPacket, this));
+      for (uint32_t j = 0; j < 150; j++)
+        {
+          queue->Enqueue (Create<Packet> (500));
+        }
+      RedQueue::Stats st = queue->GetStats ();
+      NS_TEST_ASSERT_MSG_EQ (st.forcedDrop, 0, "no forced drops below the gentle region");
+      if (m_ect)
+        {
+          NS_TEST_ASSERT_MSG_EQ (st.unforcedDrop, 0, "ECN-capable packets are not dropped early");
+          NS_TEST_ASSERT_MSG_EQ (st.unforcedMark, m_marked, "every early mark is counted");
+          NS_TEST_ASSERT_MSG_EQ ((st.unforcedMark > 0), true, "early marks happen");
+          NS_TEST_ASSERT_MSG_EQ (queue->GetNPackets (), 150, "marked packets are queued");
+        }
+      else
+        {
+          NS_TEST_ASSERT_MSG_EQ (st.unforcedMark, 0, "non-ECT packets are not marked");
+          NS_TEST_ASSERT_MSG_EQ ((st.unforcedDrop > 0), true, "non-ECT packets are dropped early");
+          NS_TEST_ASSERT_MSG_EQ (queue->GetNPackets () + st.unforcedDrop, 150, "dropped packets are not queued");
+        }
+    }
+  return GetErrorStatus ();
+}
+
+static class RedQueueTestSuite : public TestSuite
+{
+public:
+  RedQueueTestSuite ()
+    : TestSuite ("red-queue", UNIT)
+  {
+    AddTestCase (new RedQueueEstimatorTestCase ());
+    AddTestCase (new RedQueueAdaptiveTestCase ());
+    AddTestCase (new RedQueueEcnTestCase ());
+  }
+} g_redQueueTestSuite;
+
+} // namespace ns3
@@ -57,9 +57,13 @@
 #define RED_QUEUE_H
 
 #include <queue>
+#include <vector>
 #include "ns3/packet.h"
 #include "ns3/queue.h"
 #include "ns3/nstime.h"
+#include "packet-ring-buffer.h"
+#include "ns3/traced-value.h"
+#include "ns3/trace-source-accessor.h"
 #include "ns3/random-variable.h"
 #include "ns3/boolean.h"
 #include "ns3/data-rate.h"
@@ -69,6 +73,9 @@
 #define	DTYPE_FORCED	1	/* a "forced" drop */
 #define	DTYPE_UNFORCED	2	/* an "unforced" (random) drop */
 
+/* number of precomputed (1 - qW)^m entries for short idle periods */
+#define	RED_DECAY_TABLE_SIZE	64
+
 namespace ns3 {
 
 class TraceContainer;
@@ -86,6 +93,7 @@ public:
   struct Stats
   {
     uint32_t unforcedDrop;  ///< Early probability drops
+    uint32_t unforcedMark;  ///< Early probability ECN marks
     uint32_t forcedDrop;  ///< Forced drops, qavg > max threshold
     uint32_t pdrop;  ///< Drops due to queue limits
     uint32_t other;  ///< Drops due to drop calls
@@ -131,12 +139,66 @@ public:
   void SetQueueLimit(uint32_t lim);
   void SetTh(double min, double max);
 
+  /**
+   * \returns the drop and mark counters of this queue
+   */
+  Stats GetStats (void);
+
 private:
   void SetParams (uint32_t minTh, uint32_t maxTh,
                   uint32_t wLog, uint32_t pLog, uint64_t scellLog );
 
+  friend class RedQueueEstimatorTestCase;
+  friend class RedQueueAdaptiveTestCase;
+
+  /**
+   * Position of the average queue relative to the thresholds, used
+   * by Feng's Adaptive RED.
+   */
+  enum FengStatus
+  {
+    Above,
+    Between,
+    Below
+  };
+
   void InitializeParams (void);
+  /**
+   * \brief Compute the new average queue size
+   *
+   * \param nQueued current queue size
+   * \param m number of packet times since the last update (at least 1)
+   * \param qAvg previous average queue size
+   * \param qW queue weight
+   * \returns qAvg * (1 - qW)^m + qW * nQueued
+   *
+   * This is done in constant time.  ns-2 applies the (1 - qW) decay
+   * in a loop, one rounded multiply per packet time, so the two
+   * results differ by a relative error of at most (m + 1) * 2^-53
+   * (about 1e-13 for m = 1000), plus the denormal residue the loop
+   * may leave where pow () underflows to zero.
+   *
+   * With Adaptive RED enabled this also updates max_p.
+   */
   double Estimator (uint32_t nQueued, uint32_t m, double qAvg, double qW);
+  /**
+   * \returns (1 - qW)^m, from the decay table when possible
+   */
+  double Decay (uint32_t m, double qW) const;
+  /**
+   * \brief Adaptive RED (Floyd, Gummadi, Shenker) AIMD update of max_p
+   *
+   * \param newAve new average queue size
+   * \param now current time
+   */
+  void UpdateMaxP (double newAve, Time now);
+  /**
+   * \brief Feng's self-configuring RED update of max_p
+   *
+   * \param newAve new average queue size
+   */
+  void UpdateMaxPFeng (double newAve);
+  void UpdateGentleParams (void);
   double ModifyP(double p, uint32_t count, uint32_t countBytes,
                  uint32_t meanPktSize, bool wait, uint32_t size);
   double CalculatePNew (double qAvg, double maxTh, bool gentle, double vA,
@@ -147,11 +209,12 @@ private:
   virtual Ptr<Packet> DoDequeue (void);
   virtual Ptr<const Packet> DoPeek (void) const;
 
-  std::list<Ptr<Packet> > m_packets;
+  PacketRingBuffer<Ptr<Packet> > m_packets;
 
-  uint32_t m_bytesInQueue;
   bool m_redParams;
   Stats m_stats;
+  // mark ECN-capable packets instead of dropping them early
+  bool m_useEcn;
 
   //** variables supplied by user
   // bytes or packets?
@@ -179,6 +242,26 @@ private:
   DataRate m_linkBandwidth;
   // link delay
   Time m_linkDelay;
+  // true for Adaptive RED
+  bool m_isARED;
+  // true to use Feng's Adaptive RED instead of Floyd's
+  bool m_isFengAdaptive;
+  // time interval to update max_p
+  Time m_interval;
+  // target queueing delay, for the automatic m_minTh
+  Time m_targetDelay;
+  // upper bound for max_p in Adaptive RED
+  double m_top;
+  // lower bound for max_p in Adaptive RED
+  double m_bottom;
+  // additive increment to max_p in Adaptive RED
+  double m_alpha;
+  // multiplicative decrement to max_p in Adaptive RED
+  double m_beta;
+  // decrease factor of max_p in Feng's Adaptive RED
+  double m_fengAlpha;
+  // increase factor of max_p in Feng's Adaptive RED
+  double m_fengBeta;
 
   //** variables maintained by RED
   /* prob. of packet drop before "count". */
@@ -188,7 +271,7 @@ private:
   double m_vC;		/* used for "gentle" mode */
   double m_vD;		/* used for "gentle" mode */
   // current max_p
-  double m_curMaxP;
+  TracedValue<double> m_curMaxP;
   /* prob. of packet drop */
   double m_vProb;
   /* # of bytes since last drop */
@@ -198,16 +281,17 @@ private:
   uint32_t m_idle; // 0/1 idle status
   /* packet time constant in packets/second */
   double m_ptc;
-  double m_qAvg; ///> average q length; is double..
+  TracedValue<double> m_qAvg; ///> average q length; is double..
   uint32_t m_count;  ///> number of packets since last random number generation
   /* 0 for default RED */
   /* 1 for not dropping/marking when the */
   /*  instantaneous queue is much below the */
   /*  average */
   uint32_t m_cautious;
-  double m_minPacketsTh; /* always maintained in packets */
-  double m_maxPacketsTh; /* always maintained in packets */
   Time m_idleTime; ///> start of current idle period
+  Time m_lastSet; ///> last time max_p was updated by Adaptive RED
+  FengStatus m_fengStatus; ///> status of the average queue in Feng's Adaptive RED
+  std::vector<double> m_decayTable; ///> m_decayTable[i] = (1 - m_qW)^i
 
   //remover
   uint32_t drop_early_test;
@@ -653,6 +653,29 @@ private:
 };
 
 
+/**
+ * \brief This class implements a tag that carries the socket-specific
+ * TOS of a packet (e.g., its ECN codepoint) to the IP layer
+ */
+class SocketIpTosTag : public Tag
+{
+public:
+  SocketIpTosTag ();
+  void SetTos (uint8_t tos);
+  uint8_t GetTos (void) const;
+
+  static TypeId GetTypeId (void);  
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+private:
+  uint8_t m_tos;
+};
+
+
 /**
  * \brief indicated whether packets should be sent out with
  * the DF flag set.
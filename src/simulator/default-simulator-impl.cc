@@ -187,13 +187,13 @@ DefaultSimulatorImpl::Stop (Time const &time)
 EventId
 DefaultSimulatorImpl::Schedule (Time const &time, EventImpl *event)
 {
-  Time tAbsolute = time + TimeStep (m_currentTs);
-
-  NS_ASSERT (tAbsolute.IsPositive ());
-  NS_ASSERT (tAbsolute >= TimeStep (m_currentTs));
+  NS_ASSERT (time.IsPositive ());
   Scheduler::Event ev;
   ev.impl = event;
-  ev.key.m_ts = (uint64_t) tAbsolute.GetTimeStep ();
+  ev.key.m_ts = m_currentTs + time.GetTimeStep ();
+  // the absolute time must still be a positive Time
+  NS_ASSERT_MSG (ev.key.m_ts >= m_currentTs && (int64_t)ev.key.m_ts >= 0,
+                 "Event scheduled " << time << " after " << m_currentTs << " overflows the time steps");
   ev.key.m_context = GetContext ();
   ev.key.m_uid = m_uid;
   m_uid++;
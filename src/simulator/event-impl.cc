@@ -19,9 +19,320 @@
  */
 
 #include "event-impl.h"
+#include "ns3/core-config.h"
+#include "ns3/simulator-config.h"
+#include <stdlib.h>
+#include <new>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif /* HAVE_PTHREAD_H */
 
 namespace ns3 {
 
+// sizes are rounded up to a multiple of EVENT_POOL_GRANULARITY, which
+// also keeps the blocks aligned.
+static const std::size_t EVENT_POOL_GRANULARITY = 16;
+static const std::size_t EVENT_POOL_N_CLASSES = 16;
+// number of free blocks each thread caches per size class
+static const uint32_t EVENT_POOL_CACHE_SIZE = 1024;
+// number of blocks a thread exchanges with the depot at once
+static const uint32_t EVENT_POOL_BATCH_SIZE = 512;
+// number of batches of each size class kept in the depot
+static const uint32_t EVENT_POOL_DEPOT_SIZE = 64;
+
+struct EventPoolBlock
+{
+  EventPoolBlock *next;
+};
+
+#ifdef HAVE_THREAD_LOCAL_STORAGE
+
+struct EventPoolCache
+{
+  EventPoolBlock *head[EVENT_POOL_N_CLASSES];
+  uint32_t n[EVENT_POOL_N_CLASSES];
+  bool registered;
+};
+
+struct EventPoolDepot
+{
+  EventPoolBlock *batches[EVENT_POOL_N_CLASSES][EVENT_POOL_DEPOT_SIZE];
+  uint32_t n[EVENT_POOL_N_CLASSES];
+};
+
+// zero-initialized: all the caches start empty
+static __thread EventPoolCache g_eventCache;
+static EventPoolDepot g_eventDepot;
+// set when the static destructors of this file have run: the events
+// deleted later are given back to the system. Read and written
+// atomically, since the threads test it without the depot mutex.
+static uint32_t g_eventDepotDestroyed = 0;
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t g_eventDepotMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t g_eventCacheKey;
+static pthread_once_t g_eventCacheKeyOnce = PTHREAD_ONCE_INIT;
+#endif /* HAVE_PTHREAD_H */
+
+static void
+FreeBlocks (EventPoolBlock *block)
+{
+  while (block != 0)
+    {
+      EventPoolBlock *next = block->next;
+      free (block);
+      block = next;
+    }
+}
+
+static bool
+IsDepotDestroyed (void)
+{
+  return __sync_fetch_and_add (&g_eventDepotDestroyed, 0) != 0;
+}
+
+static void
+LockDepot (void)
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock (&g_eventDepotMutex);
+#endif /* HAVE_PTHREAD_H */
+}
+
+static void
+UnlockDepot (void)
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_unlock (&g_eventDepotMutex);
+#endif /* HAVE_PTHREAD_H */
+}
+
+// gives a list of blocks of the size class to the depot, or frees it if
+// the depot is full.
+static void
+PutBatch (std::size_t sizeClass, EventPoolBlock *batch)
+{
+  LockDepot ();
+  if (!g_eventDepotDestroyed && g_eventDepot.n[sizeClass] < EVENT_POOL_DEPOT_SIZE)
+    {
+      g_eventDepot.batches[sizeClass][g_eventDepot.n[sizeClass]++] = batch;
+      batch = 0;
+    }
+  UnlockDepot ();
+  FreeBlocks (batch);
+}
+
+static EventPoolBlock *
+GetBatch (std::size_t sizeClass)
+{
+  EventPoolBlock *batch = 0;
+  LockDepot ();
+  if (g_eventDepot.n[sizeClass] > 0)
+    {
+      batch = g_eventDepot.batches[sizeClass][--g_eventDepot.n[sizeClass]];
+    }
+  UnlockDepot ();
+  return batch;
+}
+
+// gives the whole cache of a thread to the depot.
+static void
+FlushCache (EventPoolCache *cache)
+{
+  for (std::size_t i = 0; i < EVENT_POOL_N_CLASSES; i++)
+    {
+      if (cache->head[i] != 0)
+        {
+          PutBatch (i, cache->head[i]);
+          cache->head[i] = 0;
+          cache->n[i] = 0;
+        }
+    }
+}
+
+#ifdef HAVE_PTHREAD_H
+static void
+ThreadExit (void *cache)
+{
+  FlushCache (static_cast<EventPoolCache *> (cache));
+}
+
+static void
+CreateCacheKey (void)
+{
+  pthread_key_create (&g_eventCacheKey, &ThreadExit);
+}
+#endif /* HAVE_PTHREAD_H */
+
+static EventPoolCache *
+GetCache (void)
+{
+  EventPoolCache *cache = &g_eventCache;
+#ifdef HAVE_PTHREAD_H
+  if (!cache->registered)
+    {
+      // the cache of a thread goes to the depot when the thread exits
+      pthread_once (&g_eventCacheKeyOnce, &CreateCacheKey);
+      pthread_setspecific (g_eventCacheKey, cache);
+      cache->registered = true;
+    }
+#endif /* HAVE_PTHREAD_H */
+  return cache;
+}
+
+static struct EventPoolDepotDestructor
+{
+  ~EventPoolDepotDestructor ()
+  {
+    LockDepot ();
+    __sync_lock_test_and_set (&g_eventDepotDestroyed, 1);
+    UnlockDepot ();
+    FlushCache (&g_eventCache);
+    for (std::size_t i = 0; i < EVENT_POOL_N_CLASSES; i++)
+      {
+        while (g_eventDepot.n[i] > 0)
+          {
+            FreeBlocks (g_eventDepot.batches[i][--g_eventDepot.n[i]]);
+          }
+      }
+  }
+} g_eventDepotDestructor;
+
+#endif /* HAVE_THREAD_LOCAL_STORAGE */
+
+// events can be created and destroyed by different threads in the
+// realtime simulator.
+static volatile uint32_t g_eventNLive = 0;
+static volatile uint32_t g_eventPeakNLive = 0;
+
+static void
+EventCreated (void)
+{
+  uint32_t live = __sync_add_and_fetch (&g_eventNLive, 1);
+  uint32_t peak = g_eventPeakNLive;
+  while (live > peak
+         && !__sync_bool_compare_and_swap (&g_eventPeakNLive, peak, live))
+    {
+      peak = g_eventPeakNLive;
+    }
+}
+
+static void
+EventDestroyed (void)
+{
+  __sync_sub_and_fetch (&g_eventNLive, 1);
+}
+
+void *
+EventImpl::operator new (std::size_t size)
+{
+  EventCreated ();
+#ifdef HAVE_THREAD_LOCAL_STORAGE
+  std::size_t sizeClass = (size + EVENT_POOL_GRANULARITY - 1) / EVENT_POOL_GRANULARITY - 1;
+  if (sizeClass < EVENT_POOL_N_CLASSES)
+    {
+      if (!IsDepotDestroyed ())
+        {
+          EventPoolCache *cache = GetCache ();
+          if (cache->head[sizeClass] == 0)
+            {
+              EventPoolBlock *batch = GetBatch (sizeClass);
+              uint32_t n = 0;
+              for (EventPoolBlock *cur = batch; cur != 0; cur = cur->next)
+                {
+                  n++;
+                }
+              cache->head[sizeClass] = batch;
+              cache->n[sizeClass] = n;
+            }
+          EventPoolBlock *block = cache->head[sizeClass];
+          if (block != 0)
+            {
+              cache->head[sizeClass] = block->next;
+              cache->n[sizeClass]--;
+              return block;
+            }
+        }
+      // every block of a size class has the size of the class, so that
+      // any thread can reuse it.
+      void *p = malloc ((sizeClass + 1) * EVENT_POOL_GRANULARITY);
+      if (p == 0)
+        {
+          EventDestroyed ();
+          throw std::bad_alloc ();
+        }
+      return p;
+    }
+#endif /* HAVE_THREAD_LOCAL_STORAGE */
+  return ::operator new (size);
+}
+
+void
+EventImpl::operator delete (void *p, std::size_t size)
+{
+  if (p == 0)
+    {
+      return;
+    }
+  EventDestroyed ();
+#ifdef HAVE_THREAD_LOCAL_STORAGE
+  std::size_t sizeClass = (size + EVENT_POOL_GRANULARITY - 1) / EVENT_POOL_GRANULARITY - 1;
+  if (sizeClass < EVENT_POOL_N_CLASSES)
+    {
+      if (IsDepotDestroyed ())
+        {
+          free (p);
+          return;
+        }
+      // the block goes to the cache of the thread which deletes the
+      // event, whichever thread created it. A full cache gives its
+      // oldest blocks to the depot, from which the other threads refill.
+      EventPoolCache *cache = GetCache ();
+      if (cache->n[sizeClass] == EVENT_POOL_CACHE_SIZE)
+        {
+          EventPoolBlock *last = cache->head[sizeClass];
+          for (uint32_t i = 1; i < EVENT_POOL_CACHE_SIZE - EVENT_POOL_BATCH_SIZE; i++)
+            {
+              last = last->next;
+            }
+          PutBatch (sizeClass, last->next);
+          last->next = 0;
+          cache->n[sizeClass] -= EVENT_POOL_BATCH_SIZE;
+        }
+      EventPoolBlock *block = static_cast<EventPoolBlock *> (p);
+      block->next = cache->head[sizeClass];
+      cache->head[sizeClass] = block;
+      cache->n[sizeClass]++;
+      return;
+    }
+#endif /* HAVE_THREAD_LOCAL_STORAGE */
+  ::operator delete (p);
+}
+
+uint32_t
+EventImpl::GetNFree (void)
+{
+  uint32_t n = 0;
+#ifdef HAVE_THREAD_LOCAL_STORAGE
+  for (std::size_t i = 0; i < EVENT_POOL_N_CLASSES; i++)
+    {
+      n += g_eventCache.n[i];
+    }
+#endif /* HAVE_THREAD_LOCAL_STORAGE */
+  return n;
+}
+
+uint32_t
+EventImpl::GetNLive (void)
+{
+  return g_eventNLive;
+}
+
+uint32_t
+EventImpl::GetPeakNLive (void)
+{
+  return g_eventPeakNLive;
+}
+
 EventImpl::~EventImpl ()
 {}
 
@@ -21,6 +21,7 @@
 #define EVENT_IMPL_H
 
 #include <stdint.h>
+#include <cstddef>
 #include "ns3/simple-ref-count.h"
 
 namespace ns3 {
@@ -58,6 +59,33 @@ public:
    */
   bool IsCancelled (void);
 
+  /**
+   * Events are allocated from per-thread caches of free blocks, one per
+   * size class: once the number of live events has reached its peak,
+   * scheduling an event does not call malloc.  A cache which grows
+   * too large, because its thread deletes the events created by another
+   * one, gives a batch of blocks to a depot shared by all the threads,
+   * from which an empty cache refills.  The depot is bounded, the cache
+   * of a thread goes to the depot when the thread exits, and the depot
+   * is freed at exit.  Events larger than the largest size class are
+   * allocated with the global operator new.
+   */
+  static void *operator new (std::size_t size);
+  static void operator delete (void *p, std::size_t size);
+
+  /**
+   * \returns the number of events which currently exist
+   */
+  static uint32_t GetNLive (void);
+  /**
+   * \returns the largest number of events which existed at the same time
+   */
+  static uint32_t GetPeakNLive (void);
+  /**
+   * \returns the number of free blocks cached by the calling thread
+   */
+  static uint32_t GetNFree (void);
+
 protected:
   virtual void Notify (void) = 0;
 
@@ -0,0 +1,313 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ladder-scheduler.h"
+#include "event-impl.h"
+#include <algorithm>
+#include "ns3/assert.h"
+#include "ns3/log.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("LadderScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (LadderScheduler);
+
+// a bucket with more events than this is spread over a new rung
+static const uint32_t LADDER_THRESHOLD = 50;
+static const uint32_t LADDER_MAX_RUNGS = 8;
+
+static bool
+EventGreater (const Scheduler::Event &a, const Scheduler::Event &b)
+{
+  return a.key > b.key;
+}
+
+TypeId
+LadderScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::LadderScheduler")
+    .SetParent<Scheduler> ()
+    .AddConstructor<LadderScheduler> ()
+  ;
+  return tid;
+}
+
+LadderScheduler::LadderScheduler ()
+  : m_topStart (0),
+    m_topMin (0),
+    m_topMax (0),
+    m_rungs (LADDER_MAX_RUNGS),
+    m_nRungs (0),
+    m_bottomLimit (LADDER_THRESHOLD),
+    m_size (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+LadderScheduler::~LadderScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+uint64_t
+LadderScheduler::GetRungCurrent (const Rung &rung) const
+{
+  return rung.start + rung.current * rung.width;
+}
+int32_t
+LadderScheduler::FindRung (uint64_t ts) const
+{
+  // each rung covers the range between its current bucket and the
+  // current bucket of the rung above it.
+  for (uint32_t i = 0; i < m_nRungs; i++)
+    {
+      if (ts >= GetRungCurrent (m_rungs[i]))
+        {
+          return i;
+        }
+    }
+  return -1;
+}
+uint32_t
+LadderScheduler::GetBucket (const Rung &rung, uint64_t ts) const
+{
+  NS_ASSERT (ts >= rung.start);
+  uint64_t bucket = (ts - rung.start) / rung.width;
+  NS_ASSERT (bucket < rung.buckets.size ());
+  return bucket;
+}
+LadderScheduler::Rung *
+LadderScheduler::NewRung (uint64_t start, uint64_t width, uint32_t nBuckets)
+{
+  NS_LOG_FUNCTION (this << start << width << nBuckets);
+  NS_ASSERT (m_nRungs < LADDER_MAX_RUNGS);
+  Rung *rung = &m_rungs[m_nRungs];
+  m_nRungs++;
+  // the buckets of an unused rung are all empty
+  rung->buckets.resize (nBuckets);
+  rung->width = width;
+  rung->start = start;
+  rung->current = 0;
+  rung->nEvents = 0;
+  return rung;
+}
+
+void
+LadderScheduler::Insert (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.key.m_ts << ev.key.m_uid);
+  m_size++;
+  uint64_t ts = ev.key.m_ts;
+  if (ts >= m_topStart)
+    {
+      if (m_top.empty ())
+        {
+          m_topMin = ts;
+          m_topMax = ts;
+        }
+      m_topMin = std::min (m_topMin, ts);
+      m_topMax = std::max (m_topMax, ts);
+      m_top.push_back (ev);
+      return;
+    }
+  int32_t i = FindRung (ts);
+  if (i >= 0)
+    {
+      Rung &rung = m_rungs[i];
+      rung.buckets[GetBucket (rung, ts)].push_back (ev);
+      rung.nEvents++;
+      return;
+    }
+  Bucket::iterator pos = std::upper_bound (m_bottom.begin (), m_bottom.end (), ev, &EventGreater);
+  m_bottom.insert (pos, ev);
+  if (m_bottom.size () > m_bottomLimit
+      && m_nRungs < LADDER_MAX_RUNGS)
+    {
+      SpreadBottom ();
+    }
+}
+bool
+LadderScheduler::IsEmpty (void) const
+{
+  return m_size == 0;
+}
+Scheduler::Event
+LadderScheduler::PeekNext (void) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  const_cast<LadderScheduler *> (this)->FillBottom ();
+  return m_bottom.back ();
+}
+Scheduler::Event
+LadderScheduler::RemoveNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (!IsEmpty ());
+  FillBottom ();
+  Scheduler::Event ev = m_bottom.back ();
+  m_bottom.pop_back ();
+  m_size--;
+  NS_LOG_LOGIC ("remove ts=" << ev.key.m_ts << ", key=" << ev.key.m_uid);
+  return ev;
+}
+void
+LadderScheduler::Remove (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.key.m_ts << ev.key.m_uid);
+  NS_ASSERT (!IsEmpty ());
+  m_size--;
+  uint64_t ts = ev.key.m_ts;
+  if (ts >= m_topStart)
+    {
+      // discarded when the top is spread over the first rung
+      m_topRemoved.insert (ev.key.m_uid);
+      return;
+    }
+  int32_t i = FindRung (ts);
+  if (i >= 0)
+    {
+      Rung &rung = m_rungs[i];
+      Bucket &bucket = rung.buckets[GetBucket (rung, ts)];
+      for (Bucket::iterator j = bucket.begin (); j != bucket.end (); ++j)
+        {
+          if (j->key.m_uid == ev.key.m_uid)
+            {
+              NS_ASSERT (ev.impl == j->impl);
+              *j = bucket.back ();
+              bucket.pop_back ();
+              rung.nEvents--;
+              return;
+            }
+        }
+      NS_ASSERT (false);
+    }
+  Bucket::iterator pos = std::lower_bound (m_bottom.begin (), m_bottom.end (), ev, &EventGreater);
+  NS_ASSERT (pos != m_bottom.end () && pos->key.m_uid == ev.key.m_uid);
+  NS_ASSERT (ev.impl == pos->impl);
+  m_bottom.erase (pos);
+}
+
+void
+LadderScheduler::FillBottom (void)
+{
+  while (m_bottom.empty ())
+    {
+      if (m_nRungs == 0)
+        {
+          SpreadTop ();
+          continue;
+        }
+      Rung *rung = &m_rungs[m_nRungs - 1];
+      if (rung->nEvents == 0)
+        {
+          m_nRungs--;
+          continue;
+        }
+      while (rung->buckets[rung->current].empty ())
+        {
+          rung->current++;
+        }
+      uint32_t current = rung->current;
+      Bucket *bucket = &rung->buckets[current];
+      rung->nEvents -= bucket->size ();
+      // events scheduled later in the range of this bucket go to
+      // the new rung or to the bottom.
+      rung->current++;
+      if (bucket->size () > LADDER_THRESHOLD
+          && rung->width > 1
+          && m_nRungs < LADDER_MAX_RUNGS)
+        {
+          SpreadBucket (rung, current);
+        }
+      else
+        {
+          SortIntoBottom (bucket);
+        }
+    }
+}
+void
+LadderScheduler::SpreadTop (void)
+{
+  NS_LOG_FUNCTION (this << m_top.size () << m_topMin << m_topMax);
+  NS_ASSERT (!m_top.empty ());
+  uint64_t span = m_topMax - m_topMin;
+  uint64_t width = span / m_top.size () + 1;
+  uint32_t nBuckets = span / width + 1;
+  Rung *rung = NewRung (m_topMin, width, nBuckets);
+  for (Bucket::const_iterator i = m_top.begin (); i != m_top.end (); ++i)
+    {
+      if (!m_topRemoved.empty ()
+          && m_topRemoved.erase (i->key.m_uid) == 1)
+        {
+          continue;
+        }
+      rung->buckets[GetBucket (*rung, i->key.m_ts)].push_back (*i);
+      rung->nEvents++;
+    }
+  NS_ASSERT (m_topRemoved.empty ());
+  m_top.clear ();
+  m_topStart = m_topMin + nBuckets * width;
+}
+void
+LadderScheduler::SpreadBucket (Rung *parent, uint32_t bucket)
+{
+  Bucket *events = &parent->buckets[bucket];
+  NS_LOG_FUNCTION (this << bucket << events->size ());
+  uint64_t start = parent->start + bucket * parent->width;
+  uint64_t width = (parent->width + events->size () - 1) / events->size ();
+  uint32_t nBuckets = (parent->width + width - 1) / width;
+  // m_rungs is never resized: parent stays valid.
+  Rung *rung = NewRung (start, width, nBuckets);
+  for (Bucket::const_iterator i = events->begin (); i != events->end (); ++i)
+    {
+      rung->buckets[GetBucket (*rung, i->key.m_ts)].push_back (*i);
+    }
+  rung->nEvents = events->size ();
+  events->clear ();
+}
+void
+LadderScheduler::SpreadBottom (void)
+{
+  NS_LOG_FUNCTION (this << m_bottom.size ());
+  // the bottom holds the events before the current bucket of the
+  // last rung, or before the top if there is no rung.
+  uint64_t end = m_nRungs > 0 ? GetRungCurrent (m_rungs[m_nRungs - 1]) : m_topStart;
+  uint64_t start = m_bottom.back ().key.m_ts;
+  NS_ASSERT (end > m_bottom.front ().key.m_ts);
+  uint64_t span = end - start;
+  uint64_t width = (span + m_bottom.size () - 1) / m_bottom.size ();
+  uint32_t nBuckets = (span + width - 1) / width;
+  Rung *rung = NewRung (start, width, nBuckets);
+  for (Bucket::const_iterator i = m_bottom.begin (); i != m_bottom.end (); ++i)
+    {
+      rung->buckets[GetBucket (*rung, i->key.m_ts)].push_back (*i);
+    }
+  rung->nEvents = m_bottom.size ();
+  m_bottom.clear ();
+}
+void
+LadderScheduler::SortIntoBottom (Bucket *bucket)
+{
+  NS_ASSERT (m_bottom.empty ());
+  m_bottom.swap (*bucket);
+  std::sort (m_bottom.begin (), m_bottom.end (), &EventGreater);
+  // a bucket which could not be spread must not be moved back to a
+  // rung on every insertion.
+  m_bottomLimit = std::max (LADDER_THRESHOLD, 2 * (uint32_t)m_bottom.size ());
+}
+
+} // namespace ns3
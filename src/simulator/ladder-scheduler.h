@@ -0,0 +1,109 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef LADDER_SCHEDULER_H
+#define LADDER_SCHEDULER_H
+
+#include "scheduler.h"
+#include <stdint.h>
+#include <vector>
+#include <set>
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief a ladder queue event scheduler
+ *
+ * This event scheduler implements the ladder queue described in
+ * "Ladder Queue: An O(1) Priority Queue Structure for Large-Scale
+ * Discrete Event Simulation" by Wai Teng Tang, Rick Siow Mong Goh and
+ * Ian Li-Jin Thng (ACM TOMACS, 2005).  Events are kept in three tiers:
+ *  - Top: an unsorted array which receives the events scheduled beyond
+ *    the current epoch;
+ *  - the rungs: arrays of unsorted buckets.  When the Bottom is empty,
+ *    the Top is spread over a first rung and the earliest non-empty
+ *    bucket of the last rung is either sorted into the Bottom or, if it
+ *    holds too many events, spread over a new, finer, rung;
+ *  - Bottom: a small sorted array from which events are dequeued.
+ *
+ * Each event is moved at most once per rung, so that both Insert and
+ * RemoveNext are O(1) amortized whatever the distribution of the event
+ * timestamps.  Remove is O(1) amortized for events in the Top (they are
+ * marked and discarded when the Top is spread over a rung) and linear
+ * in the size of a bucket or of the Bottom otherwise.
+ */
+class LadderScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  LadderScheduler ();
+  virtual ~LadderScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+private:
+  typedef std::vector<Scheduler::Event> Bucket;
+  struct Rung
+  {
+    std::vector<Bucket> buckets;
+    // duration of a bucket
+    uint64_t width;
+    // timestamp of the start of the first bucket
+    uint64_t start;
+    // first bucket which might not be empty
+    uint32_t current;
+    // number of events in the rung
+    uint32_t nEvents;
+  };
+
+  void FillBottom (void);
+  void SpreadTop (void);
+  void SpreadBucket (Rung *parent, uint32_t bucket);
+  void SpreadBottom (void);
+  void SortIntoBottom (Bucket *bucket);
+  Rung *NewRung (uint64_t start, uint64_t width, uint32_t nBuckets);
+  uint64_t GetRungCurrent (const Rung &rung) const;
+  int32_t FindRung (uint64_t ts) const;
+  uint32_t GetBucket (const Rung &rung, uint64_t ts) const;
+
+  // events scheduled at or after m_topStart
+  Bucket m_top;
+  uint64_t m_topStart;
+  uint64_t m_topMin;
+  uint64_t m_topMax;
+  // uid of the events removed from the top but not yet discarded
+  std::set<uint32_t> m_topRemoved;
+  // only the first m_nRungs rungs are in use: the others keep their
+  // buckets allocated for the next epochs.
+  std::vector<Rung> m_rungs;
+  uint32_t m_nRungs;
+  // sorted by decreasing key: the next event is at the back
+  Bucket m_bottom;
+  // size above which the bottom is spread over a new rung
+  uint32_t m_bottomLimit;
+  // number of events in queue
+  uint32_t m_size;
+};
+
+} // namespace ns3
+
+#endif /* LADDER_SCHEDULER_H */
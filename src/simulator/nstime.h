@@ -30,6 +30,8 @@
 
 namespace ns3 {
 
+class Time;
+inline Time TimeStep (uint64_t ts);
 
 /**
  * \ingroup simulator
@@ -146,6 +148,14 @@ namespace ns3 {
  * use one of these models (and it's likely), it's going to be hard to change
  * the global simulation resolution in a way which gives reasonable results. This
  * issue has been filed as bug 954 in the ns-3 bugzilla installation.
+ *
+ * If ns-3 is configured with --enable-int64-time, a Time object is a
+ * plain 64 bit integer number of time steps, and the comparisons, the
+ * additions and the subtractions are integer operations. Values which
+ * are not a whole number of time steps are then truncated when the Time
+ * object is created, and the quotient of two Time objects is a Scalar
+ * rather than a Time. HighPrecision is only used to convert the double
+ * values and to multiply or divide by a Scalar.
  */
 class Time
 {
@@ -164,6 +174,22 @@ public:
       LAST = 6
     };
 
+#ifdef USE_INT64_TIME
+  inline Time &operator = (const Time &o)
+  {
+    m_ts = o.m_ts;
+    return *this;
+  }
+  inline Time ()
+    : m_ts (0)
+  {}
+  inline Time(const Time &o)
+    : m_ts (o.m_ts)
+  {}
+  explicit inline Time (const HighPrecision &data)
+    : m_ts (data.GetInteger ())
+  {}
+#else
   inline Time &operator = (const Time &o)
   {
     m_data = o.m_data;
@@ -178,6 +204,7 @@ public:
   explicit inline Time (const HighPrecision &data)
     : m_data (data)
   {}
+#endif
 
   /**
    * \brief String constructor
@@ -202,40 +229,44 @@ public:
    */
   inline bool IsZero (void) const
   {
-    return m_data.Compare (HighPrecision::Zero ()) == 0;
+    return Sign () == 0;
   }
   /**
    * \return true if the time is negative or zero, false otherwise.
    */
   inline bool IsNegative (void) const
   {
-    return m_data.Compare (HighPrecision::Zero ()) <= 0;
+    return Sign () <= 0;
   }
   /**
    * \return true if the time is positive or zero, false otherwise.
    */
   inline bool IsPositive (void) const
   {
-    return m_data.Compare (HighPrecision::Zero ()) >= 0;
+    return Sign () >= 0;
   }
   /**
    * \return true if the time is strictly negative, false otherwise.
    */
   inline bool IsStrictlyNegative (void) const
   {
-    return m_data.Compare (HighPrecision::Zero ()) < 0;
+    return Sign () < 0;
   }
   /**
    * \return true if the time is strictly positive, false otherwise.
    */
   inline bool IsStrictlyPositive (void) const
   {
-    return m_data.Compare (HighPrecision::Zero ()) > 0;
+    return Sign () > 0;
   }
 
   inline int Compare (const Time &o) const
   {
+#ifdef USE_INT64_TIME
+    return (m_ts < o.m_ts) ? -1 : (m_ts == o.m_ts) ? 0 : 1;
+#else
     return m_data.Compare (o.m_data);
+#endif
   }
 
   /**
@@ -245,6 +276,12 @@ public:
    * \return the ns3::HighPrecision object which holds the value
    *         stored in this instance of Time type.
    */
+#ifdef USE_INT64_TIME
+  inline HighPrecision GetHighPrecision (void) const
+  {
+    return HighPrecision (m_ts, false);
+  }
+#else
   inline HighPrecision const &GetHighPrecision (void) const
   {
     return m_data;
@@ -253,6 +290,7 @@ public:
   {
     return &m_data;
   }
+#endif
 
   /**
    * \returns an approximation in seconds of the time stored in this
@@ -309,8 +347,12 @@ public:
    */
   inline int64_t GetTimeStep (void) const
   {
+#ifdef USE_INT64_TIME
+    return m_ts;
+#else
     int64_t timeValue = m_data.GetInteger ();
     return timeValue;
+#endif
   }
 
 
@@ -334,17 +376,36 @@ public:
    * This method interprets the input value according to the input
    * unit and constructs a matching Time object.
    *
+   * When Time is stored as an integer number of time steps, the value
+   * must be a whole number of time steps which fits in 63 bits.
+   *
    * \sa FromDouble, ToDouble, ToInteger
    */
   inline static Time FromInteger (uint64_t value, enum Unit timeUnit)
   {
     struct Information *info = PeekInformation (timeUnit);
+#ifdef USE_INT64_TIME
+    if (info->fromMul)
+      {
+        NS_ASSERT_MSG (value <= 0x7fffffffffffffffULL / info->factor,
+                       "Time value " << value << " overflows the time steps");
+        value *= info->factor;
+      }
+    else
+      {
+        NS_ASSERT_MSG (value % info->factor == 0,
+                       "Time value " << value << " is not a whole number of time steps");
+        value /= info->factor;
+      }
+    return TimeStep (value);
+#else
     if (info->fromMul)
       {
         value *= info->factor;
         return Time (HighPrecision (value, false));
       }
     return From (HighPrecision (value, false), timeUnit);
+#endif
   }
   /**
    * \param value to convert into a Time object
@@ -367,7 +428,7 @@ public:
   inline static uint64_t ToInteger (const Time &time, enum Unit timeUnit)
   {
     struct Information *info = PeekInformation (timeUnit);
-    uint64_t v = time.m_data.GetInteger ();
+    uint64_t v = time.GetTimeStep ();
     if (info->toMul)
       {
         v *= info->factor;
@@ -387,7 +448,21 @@ public:
    */
   inline static double ToDouble (const Time &time, enum Unit timeUnit)
   {
+#ifdef USE_INT64_TIME
+    struct Information *info = PeekInformation (timeUnit);
+    double v = time.m_ts;
+    if (info->toMul)
+      {
+        v *= info->factor;
+      }
+    else
+      {
+        v /= info->factor;
+      }
+    return v;
+#else
     return To (time, timeUnit).GetDouble ();
+#endif
   }
 
 private:
@@ -445,10 +520,25 @@ private:
     return tmp;
   }
 
+  inline int Sign (void) const
+  {
+#ifdef USE_INT64_TIME
+    return (m_ts < 0) ? -1 : (m_ts == 0) ? 0 : 1;
+#else
+    return m_data.Compare (HighPrecision::Zero ());
+#endif
+  }
+
   static struct Resolution GetNsResolution (void);
   static void SetResolution (enum Unit unit, struct Resolution *resolution);
 
+  friend Time TimeStep (uint64_t ts);
+
+#ifdef USE_INT64_TIME
+  int64_t m_ts;
+#else
   HighPrecision m_data;
+#endif
 };
 
 inline bool
@@ -481,6 +571,27 @@ operator > (Time const &lhs, Time const &rhs)
 {
   return lhs.Compare (rhs) > 0;
 }
+#ifdef USE_INT64_TIME
+inline Time operator + (Time const &lhs, Time const &rhs)
+{
+  return TimeStep (lhs.GetTimeStep () + rhs.GetTimeStep ());
+}
+inline Time operator - (Time const &lhs, Time const &rhs)
+{
+  return TimeStep (lhs.GetTimeStep () - rhs.GetTimeStep ());
+}
+inline Time &operator += (Time &lhs, Time const &rhs)
+{
+  lhs = lhs + rhs;
+  return lhs;
+}
+inline Time &operator -= (Time &lhs, Time const &rhs)
+{
+  lhs = lhs - rhs;
+  return lhs;
+}
+// the products and quotients are defined with class Scalar below
+#else
 inline Time operator + (Time const &lhs, Time const &rhs)
 {
   HighPrecision retval = lhs.GetHighPrecision ();
@@ -530,6 +641,7 @@ inline Time &operator /= (Time &lhs, Time const &rhs)
   lhsv->Div (rhs.GetHighPrecision ());
   return lhs;
 }
+#endif /* USE_INT64_TIME */
 
 
 /**
@@ -540,7 +652,11 @@ inline Time &operator /= (Time &lhs, Time const &rhs)
  */
 inline Time Abs (Time const &time)
 {
+#ifdef USE_INT64_TIME
+  return time.IsStrictlyNegative () ? TimeStep (-time.GetTimeStep ()) : time;
+#else
   return Time (Abs (time.GetHighPrecision ()));
+#endif
 }
 /**
  * \anchor ns3-Time-Max
@@ -551,9 +667,13 @@ inline Time Abs (Time const &time)
  */
 inline Time Max (Time const &ta, Time const &tb)
 {
+#ifdef USE_INT64_TIME
+  return (ta < tb) ? tb : ta;
+#else
   HighPrecision a = ta.GetHighPrecision ();
   HighPrecision b = tb.GetHighPrecision ();
   return Time (Max (a, b));
+#endif
 }
 /**
  * \anchor ns3-Time-Min
@@ -564,9 +684,13 @@ inline Time Max (Time const &ta, Time const &tb)
  */
 inline Time Min (Time const &ta, Time const &tb)
 {
+#ifdef USE_INT64_TIME
+  return (tb < ta) ? tb : ta;
+#else
   HighPrecision a = ta.GetHighPrecision ();
   HighPrecision b = tb.GetHighPrecision ();
   return Time (Min (a, b));
+#endif
 }
 
 
@@ -662,7 +786,13 @@ inline Time FemtoSeconds (uint64_t fs)
 // internal function not publicly documented
 inline Time TimeStep (uint64_t ts)
 {
+#ifdef USE_INT64_TIME
+  Time t;
+  t.m_ts = ts;
+  return t;
+#else
   return Time (HighPrecision (ts, false));
+#endif
 }
 
 class Scalar
@@ -687,7 +817,11 @@ public:
     : m_v (v)
   {}
   inline Scalar (Time t)
+#ifdef USE_INT64_TIME
+    : m_v (t.GetTimeStep ())
+#else
     : m_v (t.GetHighPrecision ().GetDouble ())
+#endif
   {}
   inline operator Time ()
   {
@@ -701,6 +835,84 @@ private:
   double m_v;
 };
 
+#ifdef USE_INT64_TIME
+/*
+ * A Time holds an integer number of time steps, so it cannot hold the
+ * fractional value of a Scalar: the products and the quotients by a
+ * Scalar are calculated with HighPrecision and truncated to a number of
+ * time steps, as GetTimeStep does in the other builds.  The quotient of
+ * two Time objects is a Scalar, which /= truncates in the same way.
+ */
+// whether the product of two numbers of time steps is a number of time
+// steps.  The magnitudes are negated as unsigned values, because the
+// negation of the smallest int64_t overflows.
+inline bool TimeStepProductFits (int64_t a, int64_t b)
+{
+  uint64_t ua = (a < 0) ? 0 - (uint64_t)a : (uint64_t)a;
+  uint64_t ub = (b < 0) ? 0 - (uint64_t)b : (uint64_t)b;
+  uint64_t max = ((a < 0) != (b < 0)) ? 0x8000000000000000ULL : 0x7fffffffffffffffULL;
+  return ua == 0 || ub <= max / ua;
+}
+inline Time operator * (Time const &lhs, Time const &rhs)
+{
+  // the product of the time steps, as with HighPrecision
+  int64_t a = lhs.GetTimeStep ();
+  int64_t b = rhs.GetTimeStep ();
+  NS_ASSERT_MSG (TimeStepProductFits (a, b), "Time product overflows the time steps");
+  return TimeStep (a * b);
+}
+inline Time operator * (Scalar const &lhs, Time const &rhs)
+{
+  HighPrecision retval = HighPrecision (lhs.GetDouble ());
+  retval.Mul (rhs.GetHighPrecision ());
+  return Time (retval);
+}
+inline Time operator * (Time const &lhs, Scalar const &rhs)
+{
+  return rhs * lhs;
+}
+inline Scalar operator * (Scalar const &lhs, Scalar const &rhs)
+{
+  return Scalar (lhs.GetDouble () * rhs.GetDouble ());
+}
+inline Scalar operator / (Time const &lhs, Time const &rhs)
+{
+  NS_ASSERT (!rhs.IsZero ());
+  return Scalar ((double) lhs.GetTimeStep () / rhs.GetTimeStep ());
+}
+inline Time operator / (Time const &lhs, Scalar const &rhs)
+{
+  NS_ASSERT (rhs.GetDouble () != 0);
+  HighPrecision retval = lhs.GetHighPrecision ();
+  retval.Div (HighPrecision (rhs.GetDouble ()));
+  return Time (retval);
+}
+inline Scalar operator / (Scalar const &lhs, Scalar const &rhs)
+{
+  return Scalar (lhs.GetDouble () / rhs.GetDouble ());
+}
+inline Time &operator *= (Time &lhs, Time const &rhs)
+{
+  lhs = lhs * rhs;
+  return lhs;
+}
+inline Time &operator *= (Time &lhs, Scalar const &rhs)
+{
+  lhs = lhs * rhs;
+  return lhs;
+}
+inline Time &operator /= (Time &lhs, Time const &rhs)
+{
+  lhs = lhs / rhs;
+  return lhs;
+}
+inline Time &operator /= (Time &lhs, Scalar const &rhs)
+{
+  lhs = lhs / rhs;
+  return lhs;
+}
+#endif /* USE_INT64_TIME */
+
 typedef Time TimeInvert;
 typedef Time TimeSquare;
 
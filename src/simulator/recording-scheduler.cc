@@ -0,0 +1,111 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "recording-scheduler.h"
+#include "map-scheduler.h"
+#include "ns3/object-factory.h"
+#include "ns3/string.h"
+#include "ns3/fatal-error.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("RecordingScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (RecordingScheduler);
+
+TypeId
+RecordingScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::RecordingScheduler")
+    .SetParent<Scheduler> ()
+    .AddConstructor<RecordingScheduler> ()
+    .AddAttribute ("Scheduler",
+                   "The type of the scheduler which really holds the events.",
+                   TypeIdValue (MapScheduler::GetTypeId ()),
+                   MakeTypeIdAccessor (&RecordingScheduler::m_schedulerType),
+                   MakeTypeIdChecker ())
+    .AddAttribute ("FileName",
+                   "The file to which the scheduler operations are written.",
+                   StringValue ("scheduler-events.txt"),
+                   MakeStringAccessor (&RecordingScheduler::m_fileName),
+                   MakeStringChecker ())
+  ;
+  return tid;
+}
+
+RecordingScheduler::RecordingScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+RecordingScheduler::~RecordingScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+RecordingScheduler::Start (void)
+{
+  NS_LOG_FUNCTION (this << m_schedulerType << m_fileName);
+  ObjectFactory factory;
+  factory.SetTypeId (m_schedulerType);
+  m_scheduler = factory.Create<Scheduler> ();
+  m_os.open (m_fileName.c_str ());
+  if (!m_os.is_open ())
+    {
+      NS_FATAL_ERROR ("Could not open " << m_fileName);
+    }
+}
+
+void
+RecordingScheduler::Insert (const Event &ev)
+{
+  if (m_scheduler == 0)
+    {
+      Start ();
+    }
+  m_os << "i " << ev.key.m_ts << " " << ev.key.m_uid << "\n";
+  m_scheduler->Insert (ev);
+}
+bool
+RecordingScheduler::IsEmpty (void) const
+{
+  return m_scheduler == 0 || m_scheduler->IsEmpty ();
+}
+Scheduler::Event
+RecordingScheduler::PeekNext (void) const
+{
+  NS_ASSERT (!IsEmpty ());
+  m_os << "p\n";
+  return m_scheduler->PeekNext ();
+}
+Scheduler::Event
+RecordingScheduler::RemoveNext (void)
+{
+  NS_ASSERT (!IsEmpty ());
+  m_os << "n\n";
+  return m_scheduler->RemoveNext ();
+}
+void
+RecordingScheduler::Remove (const Event &ev)
+{
+  NS_ASSERT (!IsEmpty ());
+  m_os << "r " << ev.key.m_ts << " " << ev.key.m_uid << "\n";
+  m_scheduler->Remove (ev);
+}
+
+} // namespace ns3
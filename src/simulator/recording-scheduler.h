@@ -0,0 +1,76 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef RECORDING_SCHEDULER_H
+#define RECORDING_SCHEDULER_H
+
+#include "scheduler.h"
+#include "ns3/ptr.h"
+#include <stdint.h>
+#include <string>
+#include <fstream>
+
+namespace ns3 {
+
+/**
+ * \ingroup scheduler
+ * \brief an event scheduler which records the operations made on it
+ *
+ * This class forwards every operation to another scheduler, whose
+ * type is given by the Scheduler attribute, and writes it to the file
+ * given by the FileName attribute, one operation per line:
+ *  - "i ts uid": Insert
+ *  - "p": PeekNext
+ *  - "n": RemoveNext
+ *  - "r ts uid": Remove
+ *
+ * The resulting file can be replayed by utils/bench-scheduler to compare
+ * the schedulers on the event set of a real simulation.  To record a
+ * run, select this scheduler with the SchedulerType global value, for
+ * example:
+ * \code
+ * NS_GLOBAL_VALUE="SchedulerType=ns3::RecordingScheduler" \
+ * NS_ATTRIBUTE_DEFAULT="ns3::RecordingScheduler::FileName=events.txt" \
+ *   ./waf --run ...
+ * \endcode
+ */
+class RecordingScheduler : public Scheduler
+{
+public:
+  static TypeId GetTypeId (void);
+
+  RecordingScheduler ();
+  virtual ~RecordingScheduler ();
+
+  virtual void Insert (const Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Event PeekNext (void) const;
+  virtual Event RemoveNext (void);
+  virtual void Remove (const Event &ev);
+
+private:
+  // the attributes are only known once the constructor has returned
+  void Start (void);
+
+  TypeId m_schedulerType;
+  std::string m_fileName;
+  Ptr<Scheduler> m_scheduler;
+  mutable std::ofstream m_os;
+};
+
+} // namespace ns3
+
+#endif /* RECORDING_SCHEDULER_H */
@@ -18,6 +18,7 @@
  * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
  */
 #include "ns3/core-config.h"
+#include "ns3/simulator-config.h"
 #include "simulator.h"
 #include "simulator-impl.h"
 #include "scheduler.h"
@@ -386,6 +387,14 @@ Simulator::GetImplementation (void)
 #include "map-scheduler.h"
 #include "calendar-scheduler.h"
 #include "ns2-calendar-scheduler.h"
+#include "ladder-scheduler.h"
+#include "recording-scheduler.h"
+#include "ns3/random-variable.h"
+#ifdef HAVE_PTHREAD_H
+#include "ns3/system-thread.h"
+#endif /* HAVE_PTHREAD_H */
+#include <set>
+#include <iterator>
 
 namespace ns3 {
 
@@ -532,6 +541,243 @@ SimulatorEventsTestCase::DoRun (void)
   return false;
 }
 
+class SchedulerOrderTestCase : public TestCase
+{
+public:
+  SchedulerOrderTestCase (ObjectFactory schedulerFactory);
+  virtual bool DoRun (void);
+  ObjectFactory m_schedulerFactory;
+};
+
+SchedulerOrderTestCase::SchedulerOrderTestCase (ObjectFactory schedulerFactory)
+  : TestCase ("Check the order of a random event set with " +
+              schedulerFactory.GetTypeId ().GetName ()),
+    m_schedulerFactory (schedulerFactory)
+{}
+bool
+SchedulerOrderTestCase::DoRun (void)
+{
+  // a hold model mixed with removals, clusters of events scheduled at
+  // the same time and events scheduled far in the future, checked
+  // against a std::set.
+  Ptr<Scheduler> scheduler = m_schedulerFactory.Create<Scheduler> ();
+  std::set<Scheduler::Event> expected;
+  std::vector<Scheduler::Event> pending;
+  UniformVariable rng;
+  uint64_t now = 0;
+  uint32_t uid = 0;
+  for (uint32_t i = 0; i < 20000; i++)
+    {
+      uint32_t action = rng.GetInteger (0, 9);
+      if (action < 5 || pending.empty ())
+        {
+          Scheduler::Event ev;
+          ev.impl = 0;
+          ev.key.m_ts = now;
+          ev.key.m_uid = uid++;
+          ev.key.m_context = 0;
+          uint32_t delay = rng.GetInteger (0, 99);
+          if (delay < 80)
+            {
+              ev.key.m_ts += rng.GetInteger (0, 1000);
+            }
+          else if (delay < 95)
+            {
+              ev.key.m_ts += 500;
+            }
+          else
+            {
+              ev.key.m_ts += rng.GetInteger (0, 100000000);
+            }
+          scheduler->Insert (ev);
+          expected.insert (ev);
+          pending.push_back (ev);
+        }
+      else if (action < 7)
+        {
+          uint32_t j = rng.GetInteger (0, pending.size () - 1);
+          Scheduler::Event ev = pending[j];
+          pending[j] = pending.back ();
+          pending.pop_back ();
+          expected.erase (ev);
+          scheduler->Remove (ev);
+        }
+      else
+        {
+          Scheduler::Event next = scheduler->PeekNext ();
+          NS_TEST_ASSERT_MSG_EQ (next.key.m_uid, expected.begin ()->key.m_uid, "Wrong next event");
+          next = scheduler->RemoveNext ();
+          NS_TEST_ASSERT_MSG_EQ (next.key.m_uid, expected.begin ()->key.m_uid, "Wrong next event");
+          expected.erase (expected.begin ());
+          now = next.key.m_ts;
+          for (std::vector<Scheduler::Event>::iterator k = pending.begin (); k != pending.end (); ++k)
+            {
+              if (k->key.m_uid == next.key.m_uid)
+                {
+                  *k = pending.back ();
+                  pending.pop_back ();
+                  break;
+                }
+            }
+        }
+      NS_TEST_ASSERT_MSG_EQ (scheduler->IsEmpty (), expected.empty (), "Wrong scheduler size");
+    }
+  while (!expected.empty ())
+    {
+      Scheduler::Event next = scheduler->RemoveNext ();
+      NS_TEST_ASSERT_MSG_EQ (next.key.m_uid, expected.begin ()->key.m_uid, "Wrong next event");
+      expected.erase (expected.begin ());
+    }
+  NS_TEST_ASSERT_MSG_EQ (scheduler->IsEmpty (), true, "Scheduler should be empty");
+  return false;
+}
+
+class RecordingSchedulerTestCase : public TestCase
+{
+public:
+  RecordingSchedulerTestCase ();
+  virtual bool DoRun (void);
+};
+
+RecordingSchedulerTestCase::RecordingSchedulerTestCase ()
+  : TestCase ("Check that RecordingScheduler writes the scheduler operations")
+{}
+bool
+RecordingSchedulerTestCase::DoRun (void)
+{
+  std::string fileName = GetTempDir () + "recording-scheduler.txt";
+  {
+    Ptr<RecordingScheduler> scheduler = CreateObject<RecordingScheduler> ();
+    scheduler->SetAttribute ("FileName", StringValue (fileName));
+    scheduler->SetAttribute ("Scheduler", TypeIdValue (HeapScheduler::GetTypeId ()));
+    Scheduler::Event a = {0, {20, 1, 0}};
+    Scheduler::Event b = {0, {10, 2, 0}};
+    scheduler->Insert (a);
+    scheduler->Insert (b);
+    NS_TEST_ASSERT_MSG_EQ (scheduler->PeekNext ().key.m_uid, 2, "Wrong next event");
+    scheduler->Remove (b);
+    NS_TEST_ASSERT_MSG_EQ (scheduler->RemoveNext ().key.m_uid, 1, "Wrong next event");
+    NS_TEST_ASSERT_MSG_EQ (scheduler->IsEmpty (), true, "Scheduler should be empty");
+  }
+  std::ifstream is (fileName.c_str ());
+  std::string content ((std::istreambuf_iterator<char> (is)), std::istreambuf_iterator<char> ());
+  NS_TEST_ASSERT_MSG_EQ (content, "i 20 1\ni 10 2\np\nr 10 2\nn\n", "Wrong recorded operations");
+  return false;
+}
+
+class EventImplPoolTestCase : public TestCase
+{
+public:
+  EventImplPoolTestCase ();
+  virtual bool DoRun (void);
+  void Nothing (void);
+};
+
+EventImplPoolTestCase::EventImplPoolTestCase ()
+  : TestCase ("Check the allocation and the counting of EventImpl objects")
+{}
+void
+EventImplPoolTestCase::Nothing (void)
+{}
+bool
+EventImplPoolTestCase::DoRun (void)
+{
+  uint32_t nLive = EventImpl::GetNLive ();
+  EventImpl *a = MakeEvent (&EventImplPoolTestCase::Nothing, this);
+  NS_TEST_ASSERT_MSG_EQ (EventImpl::GetNLive (), nLive + 1, "Event not counted");
+  a->Unref ();
+  NS_TEST_ASSERT_MSG_EQ (EventImpl::GetNLive (), nLive, "Event not uncounted");
+#ifdef HAVE_THREAD_LOCAL_STORAGE
+  EventImpl *b = MakeEvent (&EventImplPoolTestCase::Nothing, this);
+  NS_TEST_ASSERT_MSG_EQ (b, a, "The block of a deleted event should be reused first");
+  b->Unref ();
+#endif /* HAVE_THREAD_LOCAL_STORAGE */
+
+  for (uint32_t i = 0; i < 1000; i++)
+    {
+      Simulator::Schedule (MicroSeconds (i), &EventImplPoolTestCase::Nothing, this);
+    }
+  NS_TEST_ASSERT_MSG_EQ (EventImpl::GetNLive (), nLive + 1000, "Events not counted");
+  NS_TEST_ASSERT_MSG_EQ ((EventImpl::GetPeakNLive () >= nLive + 1000), true, "Wrong peak");
+  Simulator::Run ();
+  NS_TEST_ASSERT_MSG_EQ (EventImpl::GetNLive (), nLive, "Events not uncounted");
+  Simulator::Destroy ();
+  return false;
+}
+
+class EventImplCycleTestCase : public TestCase
+{
+public:
+  EventImplCycleTestCase ();
+  virtual bool DoRun (void);
+  void Nothing (void);
+  void Allocate (void);
+  void Release (void);
+private:
+  std::vector<EventImpl *> m_events;
+};
+
+EventImplCycleTestCase::EventImplCycleTestCase ()
+  : TestCase ("Check the EventImpl counters and free lists across allocation cycles")
+{}
+void
+EventImplCycleTestCase::Nothing (void)
+{}
+void
+EventImplCycleTestCase::Allocate (void)
+{
+  for (uint32_t i = 0; i < 5000; i++)
+    {
+      m_events.push_back (MakeEvent (&EventImplCycleTestCase::Nothing, this));
+    }
+}
+void
+EventImplCycleTestCase::Release (void)
+{
+  for (uint32_t i = 0; i < m_events.size (); i++)
+    {
+      m_events[i]->Unref ();
+    }
+  m_events.clear ();
+}
+bool
+EventImplCycleTestCase::DoRun (void)
+{
+  uint32_t nLive = EventImpl::GetNLive ();
+  uint32_t nFree = EventImpl::GetNFree ();
+  Allocate ();
+  NS_TEST_ASSERT_MSG_EQ (EventImpl::GetNLive (), nLive + 5000, "Events not counted");
+  NS_TEST_ASSERT_MSG_EQ ((EventImpl::GetPeakNLive () >= nLive + 5000), true, "Wrong peak");
+  Release ();
+  NS_TEST_ASSERT_MSG_EQ (EventImpl::GetNLive (), nLive, "Events not uncounted");
+  uint32_t peak = EventImpl::GetPeakNLive ();
+  // the caches are bounded: the blocks beyond go to the depot
+  NS_TEST_ASSERT_MSG_EQ ((EventImpl::GetNFree () < nFree + 5000), true, "The cache of the thread kept every block");
+  for (uint32_t cycle = 0; cycle < 10; cycle++)
+    {
+      Allocate ();
+      NS_TEST_ASSERT_MSG_EQ (EventImpl::GetNLive (), nLive + 5000, "Events not counted");
+      Release ();
+      NS_TEST_ASSERT_MSG_EQ (EventImpl::GetNLive (), nLive, "Events not uncounted");
+      NS_TEST_ASSERT_MSG_EQ (EventImpl::GetPeakNLive (), peak, "Cycles of the same size raised the peak");
+      NS_TEST_ASSERT_MSG_EQ ((EventImpl::GetNFree () < nFree + 5000), true, "The cache of the thread grew");
+    }
+#ifdef HAVE_PTHREAD_H
+  // events created by other threads and deleted by this one
+  for (uint32_t cycle = 0; cycle < 10; cycle++)
+    {
+      Ptr<SystemThread> thread = Create<SystemThread> (MakeCallback (&EventImplCycleTestCase::Allocate, this));
+      thread->Start ();
+      thread->Join ();
+      NS_TEST_ASSERT_MSG_EQ (EventImpl::GetNLive (), nLive + 5000, "Events of another thread not counted");
+      Release ();
+      NS_TEST_ASSERT_MSG_EQ (EventImpl::GetNLive (), nLive, "Events of another thread not uncounted");
+      NS_TEST_ASSERT_MSG_EQ ((EventImpl::GetNFree () < nFree + 5000), true, "The cache of the thread grew");
+    }
+#endif /* HAVE_PTHREAD_H */
+  return false;
+}
+
 class SimulatorTemplateTestCase : public TestCase
 {
 public:
@@ -842,6 +1088,17 @@ public:
     AddTestCase (new SimulatorEventsTestCase (factory));
     factory.SetTypeId (Ns2CalendarScheduler::GetTypeId ());
     AddTestCase (new SimulatorEventsTestCase (factory));
+    factory.SetTypeId (LadderScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventsTestCase (factory));
+    factory.SetTypeId (MapScheduler::GetTypeId ());
+    AddTestCase (new SchedulerOrderTestCase (factory));
+    factory.SetTypeId (HeapScheduler::GetTypeId ());
+    AddTestCase (new SchedulerOrderTestCase (factory));
+    factory.SetTypeId (LadderScheduler::GetTypeId ());
+    AddTestCase (new SchedulerOrderTestCase (factory));
+    AddTestCase (new RecordingSchedulerTestCase ());
+    AddTestCase (new EventImplPoolTestCase ());
+    AddTestCase (new EventImplCycleTestCase ());
   }
 } g_simulatorTestSuite;
 
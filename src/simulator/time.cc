@@ -298,7 +298,64 @@ ArithTestCase::DoRun (void)
   return false;
 }
 
+// The results must not depend on the representation of Time: run it in
+// builds configured with and without --enable-int64-time.
+class TimeStepArithTestCase : public TestCase
+{
+public:
+  TimeStepArithTestCase ();
+private:
+  virtual bool DoRun (void);
+  virtual void DoTeardown (void);
+  enum Time::Unit m_originalResolution;
+};
 
+TimeStepArithTestCase::TimeStepArithTestCase ()
+  : TestCase ("Check the arithmetic operators on time steps")
+{
+}
+bool
+TimeStepArithTestCase::DoRun (void)
+{
+  m_originalResolution = Time::GetResolution ();
+  Time::SetResolution (Time::NS);
+#ifdef USE_INT64_TIME
+  NS_TEST_ASSERT_MSG_EQ (sizeof (Time), sizeof (int64_t), "Time is not stored as a 64-bit integer");
+#endif /* USE_INT64_TIME */
+  NS_TEST_ASSERT_MSG_EQ (MilliSeconds (3).GetTimeStep (), 3000000, "Wrong conversion from ms");
+  NS_TEST_ASSERT_MSG_EQ (MicroSeconds (1500).GetMilliSeconds (), 1, "Wrong conversion to ms");
+  NS_TEST_ASSERT_MSG_EQ (Seconds (1.5).GetTimeStep (), 1500000000, "Wrong conversion from s");
+  NS_TEST_ASSERT_MSG_EQ ((MilliSeconds (3) + MicroSeconds (2)).GetTimeStep (), 3002000, "Wrong sum");
+  NS_TEST_ASSERT_MSG_EQ ((MilliSeconds (3) - MicroSeconds (2)).GetTimeStep (), 2998000, "Wrong difference");
+  NS_TEST_ASSERT_MSG_EQ ((TimeStep (2) - TimeStep (5)).GetTimeStep (), -3, "Wrong negative difference");
+  NS_TEST_ASSERT_MSG_EQ ((TimeStep (3) * TimeStep (4)).GetTimeStep (), 12, "Wrong product");
+  NS_TEST_ASSERT_MSG_EQ (Scalar (MilliSeconds (3) / MilliSeconds (2)).GetDouble (), 1.5, "Wrong quotient");
+
+  // the quotient is truncated to time steps, whichever operator computes it
+  Time a = TimeStep (3);
+  a /= TimeStep (2);
+  NS_TEST_ASSERT_MSG_EQ (a.GetTimeStep (), 1, "Wrong truncated quotient");
+  Time b = TimeStep (3) / TimeStep (2);
+  NS_TEST_ASSERT_MSG_EQ (b.GetTimeStep (), a.GetTimeStep (), "/ and /= differ");
+  Time c = TimeStep (7);
+  c *= TimeStep (6);
+  NS_TEST_ASSERT_MSG_EQ (c.GetTimeStep (), 42, "Wrong product");
+  Time d = MilliSeconds (10) * Scalar (0.25);
+  NS_TEST_ASSERT_MSG_EQ (d.GetTimeStep (), 2500000, "Wrong product by a scalar");
+  d /= Scalar (2.0);
+  NS_TEST_ASSERT_MSG_EQ (d.GetTimeStep (), 1250000, "Wrong quotient by a scalar");
+
+  NS_TEST_ASSERT_MSG_EQ ((MilliSeconds (1) < MilliSeconds (2)), true, "Wrong comparison");
+  NS_TEST_ASSERT_MSG_EQ (Max (MilliSeconds (1), MilliSeconds (2)), MilliSeconds (2), "Wrong max");
+  NS_TEST_ASSERT_MSG_EQ (Abs (TimeStep (2) - TimeStep (5)), TimeStep (3), "Wrong absolute value");
+  return false;
+}
+
+void
+TimeStepArithTestCase::DoTeardown (void)
+{
+  Time::SetResolution (m_originalResolution);
+}
 
 static class TimeTestSuite : public TestSuite
 {
@@ -309,6 +366,7 @@ public:
     AddTestCase (new Bug863TestCase ());
     AddTestCase (new TimeSimpleTestCase (Time::US));
     AddTestCase (new ArithTestCase ());
+    AddTestCase (new TimeStepArithTestCase ());
   }
 } g_timeTestSuite;
 
@@ -0,0 +1,129 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/node.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/fatal-impl.h"
+#include "ns3/binary-trace-file.h"
+#include "ns3/trace-helper.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/node-container.h"
+#include "ns3/net-device-container.h"
+#include <sstream>
+
+using namespace ns3;
+
+static void
+SendPacket (Ptr<NetDevice> device, uint32_t size)
+{
+  device->Send (Create<Packet> (size), device->GetBroadcast (), 0x0800);
+}
+
+class BinaryTraceHelperTestCase : public TestCase
+{
+public:
+  BinaryTraceHelperTestCase ();
+  virtual ~BinaryTraceHelperTestCase () {}
+
+private:
+  virtual bool DoRun (void);
+};
+
+BinaryTraceHelperTestCase::BinaryTraceHelperTestCase ()
+  : TestCase ("Check that the records written through BinaryTraceHelper are read back")
+{
+}
+
+bool
+BinaryTraceHelperTestCase::DoRun (void)
+{
+  std::string filename = GetTempDir () + "binary-trace-helper.btr";
+
+  NodeContainer nodes;
+  nodes.Create (2);
+  PointToPointHelper p2p;
+  NetDeviceContainer devices = p2p.Install (nodes);
+
+  BinaryTraceHelper helper;
+  Ptr<BinaryTraceFile> file = helper.CreateFile (filename, 2);
+  helper.Enable (file, devices);
+
+  Simulator::Schedule (Seconds (1), &SendPacket, devices.Get (0), 100);
+  Simulator::Run ();
+
+  // the records are still in the chunk in memory: the fatal error
+  // handler must write them before it flushes the file.
+  FatalImpl::FlushStreams ();
+
+  BinaryTraceReader reader;
+  NS_TEST_ASSERT_MSG_EQ (reader.Open (filename), true, "Open must succeed");
+  NS_TEST_EXPECT_MSG_EQ (reader.GetPacketBytes (), 2, "Unexpected number of packet bytes");
+
+  uint32_t node0 = nodes.Get (0)->GetId ();
+  uint32_t node1 = nodes.Get (1)->GetId ();
+  std::ostringstream device0;
+  device0 << "/NodeList/" << node0 << "/DeviceList/0/$ns3::PointToPointNetDevice/";
+  std::ostringstream device1;
+  device1 << "/NodeList/" << node1 << "/DeviceList/0/$ns3::PointToPointNetDevice/";
+
+  // the queue of the sender sees the packet with its PPP header, the
+  // receiver after the header was removed.
+  BinaryTraceReader::Record record;
+  NS_TEST_ASSERT_MSG_EQ (reader.Read (record), true, "The enqueue record is missing");
+  NS_TEST_EXPECT_MSG_EQ (record.event, BinaryTraceFile::ENQUEUE, "Unexpected event");
+  NS_TEST_EXPECT_MSG_EQ (record.context, device0.str () + "TxQueue/Enqueue", "Unexpected context");
+  NS_TEST_EXPECT_MSG_EQ (record.node, node0, "Unexpected node");
+  NS_TEST_EXPECT_MSG_EQ (record.device, 0, "Unexpected device");
+  NS_TEST_EXPECT_MSG_EQ (record.time, Seconds (1), "Unexpected time");
+  NS_TEST_EXPECT_MSG_EQ (record.size, 102, "Unexpected size");
+  NS_TEST_EXPECT_MSG_EQ ((uint32_t)record.bytes[1], 0x21, "Unexpected PPP protocol");
+  uint64_t uid = record.uid;
+
+  NS_TEST_ASSERT_MSG_EQ (reader.Read (record), true, "The dequeue record is missing");
+  NS_TEST_EXPECT_MSG_EQ (record.event, BinaryTraceFile::DEQUEUE, "Unexpected event");
+  NS_TEST_EXPECT_MSG_EQ (record.context, device0.str () + "TxQueue/Dequeue", "Unexpected context");
+  NS_TEST_EXPECT_MSG_EQ (record.uid, uid, "Unexpected uid");
+
+  NS_TEST_ASSERT_MSG_EQ (reader.Read (record), true, "The receive record is missing");
+  NS_TEST_EXPECT_MSG_EQ (record.event, BinaryTraceFile::RECEIVE, "Unexpected event");
+  NS_TEST_EXPECT_MSG_EQ (record.context, device1.str () + "MacRx", "Unexpected context");
+  NS_TEST_EXPECT_MSG_EQ (record.node, node1, "Unexpected node");
+  NS_TEST_EXPECT_MSG_EQ (record.uid, uid, "Unexpected uid");
+  NS_TEST_EXPECT_MSG_EQ (record.size, 100, "Unexpected size");
+  NS_TEST_EXPECT_MSG_EQ ((record.time > Seconds (1)), true, "Unexpected time");
+
+  NS_TEST_EXPECT_MSG_EQ (reader.Read (record), false, "Too many records");
+
+  file->Close ();
+  Simulator::Destroy ();
+  return GetErrorStatus ();
+}
+
+class BinaryTraceHelperTestSuite : public TestSuite
+{
+public:
+  BinaryTraceHelperTestSuite ();
+};
+
+BinaryTraceHelperTestSuite::BinaryTraceHelperTestSuite ()
+  : TestSuite ("binary-trace-helper", UNIT)
+{
+  AddTestCase (new BinaryTraceHelperTestCase);
+}
+
+BinaryTraceHelperTestSuite g_binaryTraceHelperTestSuite;
@@ -0,0 +1,215 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/global-value.h"
+#include "ns3/config.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/node.h"
+#include "ns3/node-container.h"
+#include "ns3/net-device-container.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-address-generator.h"
+#include "ns3/udp-echo-helper.h"
+
+#include <vector>
+#include <utility>
+
+using namespace ns3;
+
+typedef std::vector<std::pair<uint64_t, uint32_t> > Receptions;
+
+// Each device writes to its own vector, so that the sink is never called
+// concurrently for the same vector.
+static void
+RecordRx (Receptions *receptions, Ptr<const Packet> p)
+{
+  receptions->push_back (std::make_pair (Simulator::Now ().GetTimeStep (), p->GetSize ()));
+}
+
+// Four nodes in a chain, with echo traffic on every link.  The nodes 0
+// and 1 are run by the first partition, the nodes 2 and 3 by the second.
+class MultithreadedSimulatorEcho : public TestCase
+{
+public:
+  MultithreadedSimulatorEcho ();
+  virtual ~MultithreadedSimulatorEcho ();
+
+private:
+  virtual bool DoRun (void);
+  std::vector<Receptions> RunChain (std::string impl, uint32_t partitions);
+};
+
+MultithreadedSimulatorEcho::MultithreadedSimulatorEcho ()
+  : TestCase ("Echo traffic over a chain of point-to-point links gives the same results with DefaultSimulatorImpl and MultithreadedSimulatorImpl")
+{
+}
+
+MultithreadedSimulatorEcho::~MultithreadedSimulatorEcho ()
+{
+}
+
+std::vector<Receptions>
+MultithreadedSimulatorEcho::RunChain (std::string impl, uint32_t partitions)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue (impl));
+  Config::SetDefault ("ns3::MultithreadedSimulatorImpl::Partitions", UintegerValue (partitions));
+  Ipv4AddressGenerator::Reset ();
+
+  NodeContainer nodes;
+  nodes.Add (CreateObject<Node> (0));
+  nodes.Add (CreateObject<Node> (0));
+  nodes.Add (CreateObject<Node> (1));
+  nodes.Add (CreateObject<Node> (1));
+
+  InternetStackHelper stack;
+  stack.Install (nodes);
+
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("5Mbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
+
+  std::vector<Receptions> receptions (nodes.GetN ());
+  Ipv4AddressHelper address;
+  address.SetBase ("10.1.1.0", "255.255.255.0");
+  UdpEchoServerHelper server (9);
+  server.Install (nodes).Start (Seconds (0.0));
+  for (uint32_t i = 0; i + 1 < nodes.GetN (); i++)
+    {
+      NetDeviceContainer devices = p2p.Install (nodes.Get (i), nodes.Get (i + 1));
+      devices.Get (0)->TraceConnectWithoutContext ("MacRx", MakeBoundCallback (&RecordRx, &receptions[i]));
+      devices.Get (1)->TraceConnectWithoutContext ("MacRx", MakeBoundCallback (&RecordRx, &receptions[i + 1]));
+      Ipv4InterfaceContainer interfaces = address.Assign (devices);
+      address.NewNetwork ();
+
+      // both ends send to each other
+      for (uint32_t j = 0; j < 2; j++)
+        {
+          UdpEchoClientHelper client (interfaces.GetAddress (1 - j), 9);
+          client.SetAttribute ("MaxPackets", UintegerValue (20));
+          client.SetAttribute ("Interval", TimeValue (MilliSeconds (3 + i + j)));
+          client.SetAttribute ("PacketSize", UintegerValue (100 + 100 * i + j));
+          client.Install (nodes.Get (i + j)).Start (MilliSeconds (1 + j));
+        }
+    }
+
+  Simulator::Stop (Seconds (1.0));
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return receptions;
+}
+
+bool
+MultithreadedSimulatorEcho::DoRun (void)
+{
+  std::vector<Receptions> reference = RunChain ("ns3::DefaultSimulatorImpl", 0);
+  std::vector<Receptions> manual = RunChain ("ns3::MultithreadedSimulatorImpl", 0);
+  std::vector<Receptions> automatic = RunChain ("ns3::MultithreadedSimulatorImpl", 2);
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+  Config::SetDefault ("ns3::MultithreadedSimulatorImpl::Partitions", UintegerValue (0));
+
+  for (uint32_t i = 0; i < reference.size (); i++)
+    {
+      // 20 requests and 20 replies on each link
+      uint32_t expected = (i == 0 || i == 3) ? 40 : 80;
+      NS_TEST_ASSERT_MSG_EQ (reference[i].size (), expected,
+                             "Unexpected number of receptions on node " << i);
+      NS_TEST_ASSERT_MSG_EQ ((manual[i] == reference[i]), true,
+                             "Different receptions on node " << i << " with the system ids of the nodes");
+      NS_TEST_ASSERT_MSG_EQ ((automatic[i] == reference[i]), true,
+                             "Different receptions on node " << i << " with automatic partitioning");
+    }
+  return GetErrorStatus ();
+}
+
+// The events which are still pending after a stop can be checked and
+// removed from the main thread, whichever partition owns them.
+class MultithreadedSimulatorEventIds : public TestCase
+{
+public:
+  MultithreadedSimulatorEventIds ();
+  virtual ~MultithreadedSimulatorEventIds ();
+
+private:
+  virtual bool DoRun (void);
+  void ScheduleLater (void);
+  void Count (void);
+  EventId m_later;
+  uint32_t m_count;
+};
+
+MultithreadedSimulatorEventIds::MultithreadedSimulatorEventIds ()
+  : TestCase ("Pending events of every partition can be checked and removed with their EventId")
+{
+}
+
+MultithreadedSimulatorEventIds::~MultithreadedSimulatorEventIds ()
+{
+}
+
+void
+MultithreadedSimulatorEventIds::ScheduleLater (void)
+{
+  m_later = Simulator::Schedule (MilliSeconds (19), &MultithreadedSimulatorEventIds::Count, this);
+}
+
+void
+MultithreadedSimulatorEventIds::Count (void)
+{
+  m_count++;
+}
+
+bool
+MultithreadedSimulatorEventIds::DoRun (void)
+{
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::MultithreadedSimulatorImpl"));
+  m_count = 0;
+
+  NodeContainer nodes;
+  nodes.Add (CreateObject<Node> (0));
+  nodes.Add (CreateObject<Node> (1));
+  PointToPointHelper p2p;
+  p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
+  p2p.Install (nodes);
+
+  // not bound to a node: owned by the first partition
+  EventId unbound = Simulator::Schedule (MilliSeconds (10), &MultithreadedSimulatorEventIds::Count, this);
+  // bound to the node of the second partition
+  Simulator::ScheduleWithContext (nodes.Get (1)->GetId (), MilliSeconds (1),
+                                  &MultithreadedSimulatorEventIds::ScheduleLater, this);
+  Simulator::Stop (MilliSeconds (5));
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (unbound.IsExpired (), false, "Event not bound to a node expired early");
+  NS_TEST_EXPECT_MSG_EQ (m_later.IsExpired (), false, "Event of the second partition expired early");
+  Simulator::Remove (unbound);
+  Simulator::Remove (m_later);
+  NS_TEST_EXPECT_MSG_EQ (unbound.IsExpired (), true, "Removed event not bound to a node is not expired");
+  NS_TEST_EXPECT_MSG_EQ (m_later.IsExpired (), true, "Removed event of the second partition is not expired");
+  Simulator::Run ();
+  NS_TEST_EXPECT_MSG_EQ (m_count, 0, "A removed event ran");
+
+  Simulator::Destroy ();
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+  return GetErrorStatus ();
+}
+
+class MultithreadedSimulatorTestSuite : public TestSuite
+{
+public:
+  MultithreadedSimulatorTestSuite ();
+};
+
+MultithreadedSimulatorTestSuite::MultithreadedSimulatorTestSuite ()
+  : TestSuite ("multithreaded-simulator", SYSTEM)
+{
+  AddTestCase (new MultithreadedSimulatorEcho);
+  AddTestCase (new MultithreadedSimulatorEventIds);
+}
+
+MultithreadedSimulatorTestSuite multithreadedSimulatorTestSuite;
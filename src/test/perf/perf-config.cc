@@ -0,0 +1,155 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Measure the time spent wiring traces and attributes through the config
+// namespace before a simulation starts.
+//
+// The topology is made of --nodes nodes connected in pairs by point to
+// point links, so that every node holds one device.  The workloads are:
+//  - connect: one Config::Connect per device and trace source, with the
+//    node and device indexes in the path, as the helpers do
+//  - many: a single Config::ConnectMany with the paths of the connect
+//    workload
+//  - set: one Config::Set per device, with the indexes in the path
+//  - wildcard: a single Config::Connect on /NodeList/*/DeviceList/*
+// One CSV line is written to stdout per workload:
+//   workload,nodes,paths,ms
+
+#include <sys/time.h>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/simulator-module.h"
+#include "ns3/node-module.h"
+#include "ns3/core-module.h"
+#include "ns3/helper-module.h"
+
+using namespace ns3;
+
+static uint64_t
+GetRealtimeInNs (void)
+{
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec * (uint64_t)1000000000 + tv.tv_usec * (uint64_t)1000;
+}
+
+static void
+Report (std::string workload, uint32_t nodes, uint32_t paths, uint64_t ns)
+{
+  std::cout << workload << "," << nodes << "," << paths << ","
+            << ns / 1000000 << std::endl;
+}
+
+static void
+Sink (TraceContext context, Ptr<const Packet> p)
+{
+}
+
+static std::string
+DevicePath (uint32_t node, std::string leaf)
+{
+  std::ostringstream oss;
+  oss << "/NodeList/" << node << "/DeviceList/0/$ns3::PointToPointNetDevice/" << leaf;
+  return oss.str ();
+}
+
+static void
+BenchConnect (uint32_t nodes)
+{
+  uint64_t start = GetRealtimeInNs ();
+  for (uint32_t i = 0; i < nodes; ++i)
+    {
+      Config::Connect (DevicePath (i, "MacRx"), MakeCallback (&Sink));
+      Config::Connect (DevicePath (i, "MacTx"), MakeCallback (&Sink));
+    }
+  Report ("connect", nodes, 2 * nodes, GetRealtimeInNs () - start);
+}
+
+static void
+BenchConnectMany (uint32_t nodes)
+{
+  uint64_t start = GetRealtimeInNs ();
+  std::vector<std::string> paths;
+  for (uint32_t i = 0; i < nodes; ++i)
+    {
+      paths.push_back (DevicePath (i, "MacRx"));
+      paths.push_back (DevicePath (i, "MacTx"));
+    }
+  Config::ConnectMany (paths, MakeCallback (&Sink));
+  Report ("many", nodes, paths.size (), GetRealtimeInNs () - start);
+}
+
+static void
+BenchSet (uint32_t nodes)
+{
+  uint64_t start = GetRealtimeInNs ();
+  for (uint32_t i = 0; i < nodes; ++i)
+    {
+      Config::Set (DevicePath (i, "Mtu"), UintegerValue (1500));
+    }
+  Report ("set", nodes, nodes, GetRealtimeInNs () - start);
+}
+
+static void
+BenchWildcard (uint32_t nodes)
+{
+  uint64_t start = GetRealtimeInNs ();
+  Config::Connect ("/NodeList/*/DeviceList/*/$ns3::PointToPointNetDevice/MacRx", MakeCallback (&Sink));
+  Report ("wildcard", nodes, 1, GetRealtimeInNs () - start);
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t nodes = 20000;
+  std::string workload = "all";
+
+  CommandLine cmd;
+  cmd.AddValue ("nodes", "Number of nodes of the topology", nodes);
+  cmd.AddValue ("workload", "connect, many, set, wildcard or all", workload);
+  cmd.Parse (argc, argv);
+
+  NodeContainer container;
+  container.Create (nodes + nodes % 2);
+  PointToPointHelper p2p;
+  for (uint32_t i = 0; i + 1 < container.GetN (); i += 2)
+    {
+      p2p.Install (container.Get (i), container.Get (i + 1));
+    }
+
+  if (workload == "connect" || workload == "all")
+    {
+      BenchConnect (nodes);
+    }
+  if (workload == "many" || workload == "all")
+    {
+      BenchConnectMany (nodes);
+    }
+  if (workload == "set" || workload == "all")
+    {
+      BenchSet (nodes);
+    }
+  if (workload == "wildcard" || workload == "all")
+    {
+      BenchWildcard (nodes);
+    }
+
+  Simulator::Destroy ();
+  return 0;
+}
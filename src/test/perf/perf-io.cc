@@ -28,6 +28,7 @@
 #include "ns3/core-module.h"
 #include "ns3/helper-module.h"
 #include "ns3/abort.h"
+#include "ns3/pcap-file.h"
 
 using namespace ns3;
 using namespace std;
@@ -68,6 +69,15 @@ PerfStream (ostream &stream, uint32_t n, const char *buffer, uint32_t size)
     }
 }
 
+void
+PerfPcap (PcapFile &file, uint32_t n, Ptr<const Packet> p)
+{
+  for (uint32_t i = 0; i < n; ++i)
+    {
+      file.Write (i / 1000, (i % 1000) * 1000, p);
+    }
+}
+
 int 
 main (int argc, char *argv[])
 {
@@ -75,6 +85,9 @@ main (int argc, char *argv[])
   uint32_t iter = 50;
   bool doStream = false;
   bool binmode = true;
+  bool doPcap = false;
+  uint32_t writeBuffer = 0;
+  bool background = false;
  
 
   CommandLine cmd;
@@ -82,13 +95,39 @@ main (int argc, char *argv[])
   cmd.AddValue ("iter", "How many times to run the test looking for a min (defaults to 50)", iter);
   cmd.AddValue ("doStream", "Run the C++ I/O benchmark otherwise the C I/O ", doStream);
   cmd.AddValue ("binmode", "Select binary mode for the C++ I/O benchmark (defaults to true)", binmode);
+  cmd.AddValue ("doPcap", "Run the PcapFile benchmark", doPcap);
+  cmd.AddValue ("writeBuffer", "Block size of the PcapFile benchmark, zero to write every record directly (defaults to 0)", writeBuffer);
+  cmd.AddValue ("background", "Write the blocks of the PcapFile benchmark from a separate thread (defaults to false)", background);
   cmd.Parse (argc, argv);
 
   uint64_t result = std::numeric_limits<uint64_t>::max ();
   
   char buffer[1024];
 
-  if (doStream)
+  if (doPcap)
+    {
+      //
+      // The time includes the close of the file, so that the records which
+      // are still in the blocks are accounted for.
+      //
+      Ptr<Packet> p = Create<Packet> ((uint8_t const *)buffer, 1024);
+      for (uint32_t i = 0; i < iter; ++i)
+        {
+          PcapFile file;
+          file.Open ("pcaptest", std::ios::out);
+          file.Init (1);
+          file.SetWriteBuffer (writeBuffer, background);
+
+          uint64_t start = GetRealtimeInNs ();
+          PerfPcap (file, n, p);
+          file.Close ();
+          uint64_t et = GetRealtimeInNs () - start;
+          result = std::min (result, et);
+          std::cout << "."; std::cout.flush ();
+        }
+      std::cout << std::endl;
+    }
+  else if (doStream)
     {
       //
       // This will probably run on a machine doing other things.  Run it some
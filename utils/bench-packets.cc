@@ -115,6 +115,44 @@ BenchHeader<N>::Deserialize (Buffer::Iterator start)
   return N;
 }
 
+template <int N>
+class BenchTrailer : public Trailer
+{
+public:
+  static std::string GetName (void) {
+    std::ostringstream oss;
+    oss << "ns3::BenchTrailer<" << N << ">";
+    return oss.str ();
+  }
+  static TypeId GetTypeId (void) {
+    static TypeId tid = TypeId (GetName ().c_str ())
+      .SetParent<Trailer> ()
+      ;
+    return tid;
+  }
+  virtual TypeId GetInstanceTypeId (void) const {
+    return GetTypeId ();
+  }
+  virtual void Print (std::ostream &os) const {
+    os << "N=" << N;
+  }
+  virtual uint32_t GetSerializedSize (void) const {
+    return N;
+  }
+  virtual void Serialize (Buffer::Iterator start) const {
+    start.Prev (N);
+    start.WriteU8 (N, N);
+  }
+  virtual uint32_t Deserialize (Buffer::Iterator start) {
+    start.Prev (N);
+    for (int i = 0; i < N; i++)
+      {
+        start.ReadU8 ();
+      }
+    return N;
+  }
+};
+
 template <int N>
 class BenchTag : public Tag
 {
@@ -241,6 +279,28 @@ benchC (uint32_t n)
   }
 }
 
+static void
+benchE (uint32_t n)
+{
+  BenchHeader<25> ipv4;
+  BenchHeader<8> udp;
+  BenchTrailer<14> trailer;
+
+  for (uint32_t i = 0; i < n; i++) {
+    Ptr<Packet> p = Create<Packet> (2000);
+    p->AddHeader (udp);
+    p->AddTrailer (trailer);
+    Ptr<Packet> a = p->CreateFragment (0, 1000);
+    Ptr<Packet> b = p->CreateFragment (1000, p->GetSize () - 1000);
+    a->AddHeader (ipv4);
+    b->AddHeader (ipv4);
+    a->RemoveHeader (ipv4);
+    b->RemoveHeader (ipv4);
+    a->AddAtEnd (b);
+    a->RemoveTrailer (trailer);
+    a->RemoveHeader (udp);
+  }
+}
 
 static void
 runBench (void (*bench) (uint32_t), uint32_t n, char const *name)
@@ -266,9 +326,14 @@ int main (int argc, char *argv[])
           iss.str (nAscii);
           iss >> n;
         }
-      if (strncmp ("--enable-printing", argv[0], strlen ("--enable-printing")) == 0)
+      if (strcmp ("--enable-printing", argv[0]) == 0)
+        {
+          // Packet::EnablePrinting is disabled in this tree.
+          PacketMetadata::Enable ();
+        }
+      if (strcmp ("--enable-printing-ipv4", argv[0]) == 0)
         {
-          Packet::EnablePrinting ();
+          Packet::EnablePrinting (BenchHeader<25>::GetTypeId ());
         }
       argc--;
       argv++;
@@ -285,6 +350,7 @@ int main (int argc, char *argv[])
   runBench (&benchB, n, "b");
   runBench (&benchC, n, "c");
   runBench (&benchD, n, "d");
+  runBench (&benchE, n, "e");
 
   return 0;
 }
@@ -0,0 +1,177 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Enqueue/dequeue cost of the queue packet storage.  The std::list and
+// std::queue runs reproduce the storage RedQueue and DropTailQueue used
+// before PacketRingBuffer, including the size () call made on every
+// enqueue; the queue runs go through the full Queue::Enqueue/Dequeue path.
+
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/packet.h"
+#include "ns3/packet-ring-buffer.h"
+#include "ns3/drop-tail-queue.h"
+#include "ns3/red-queue.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <list>
+#include <queue>
+#include <vector>
+#include <string.h>
+#include <stdlib.h> // for exit ()
+
+using namespace ns3;
+
+// packets are created once: only the storage is measured
+static std::vector<Ptr<Packet> > g_packets;
+static uint32_t g_depth = 0;
+static volatile uint32_t g_sink = 0; // keeps the size () calls
+
+static void
+benchList (uint32_t n)
+{
+  std::list<Ptr<Packet> > storage;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      g_sink += storage.size ();
+      storage.push_back (g_packets[i % g_packets.size ()]);
+      if (storage.size () > g_depth)
+        {
+          storage.pop_front ();
+        }
+    }
+}
+
+static void
+benchStdQueue (uint32_t n)
+{
+  std::queue<Ptr<Packet> > storage;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      g_sink += storage.size ();
+      storage.push (g_packets[i % g_packets.size ()]);
+      if (storage.size () > g_depth)
+        {
+          storage.pop ();
+        }
+    }
+}
+
+static void
+benchRing (uint32_t n)
+{
+  PacketRingBuffer<Ptr<Packet> > storage;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      g_sink += storage.GetNPackets ();
+      storage.PushBack (g_packets[i % g_packets.size ()]);
+      if (storage.GetNPackets () > g_depth)
+        {
+          storage.PopFront ();
+        }
+    }
+}
+
+static void
+benchQueue (Ptr<Queue> queue, uint32_t n)
+{
+  for (uint32_t i = 0; i < n; i++)
+    {
+      queue->Enqueue (g_packets[i % g_packets.size ()]);
+      if (queue->GetNPackets () > g_depth)
+        {
+          queue->Dequeue ();
+        }
+    }
+}
+
+static void
+benchDropTail (uint32_t n)
+{
+  Ptr<DropTailQueue> queue = CreateObject<DropTailQueue> ();
+  queue->SetAttribute ("MaxPackets", UintegerValue (g_depth + 1));
+  benchQueue (queue, n);
+}
+
+static void
+benchRed (uint32_t n)
+{
+  // thresholds above the standing queue: no early drops
+  Ptr<RedQueue> queue = CreateObject<RedQueue> ();
+  queue->SetAttribute ("QueueLimit", UintegerValue (g_depth + 2));
+  queue->SetAttribute ("m_minTh", DoubleValue (g_depth + 1));
+  queue->SetAttribute ("m_maxTh", DoubleValue (3 * (g_depth + 1)));
+  benchQueue (queue, n);
+}
+
+static void
+runBench (void (*bench) (uint32_t), uint32_t n, char const *name)
+{
+  SystemWallClockMs time;
+  time.Start ();
+  (*bench) (n);
+  uint64_t deltaMs = time.End ();
+  double nsPerOp = deltaMs;
+  nsPerOp *= 1000000;
+  nsPerOp /= n;
+  std::cout << name << "=" << nsPerOp << " ns/op" << std::endl;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t n = 0;
+  g_depth = 100;
+  while (argc > 0) {
+      if (strncmp ("--n=", argv[0],strlen ("--n=")) == 0)
+        {
+          char const *nAscii = argv[0] + strlen ("--n=");
+          std::istringstream iss;
+          iss.str (nAscii);
+          iss >> n;
+        }
+      if (strncmp ("--depth=", argv[0],strlen ("--depth=")) == 0)
+        {
+          char const *depthAscii = argv[0] + strlen ("--depth=");
+          std::istringstream iss;
+          iss.str (depthAscii);
+          iss >> g_depth;
+        }
+      argc--;
+      argv++;
+  }
+  if (n == 0)
+    {
+      std::cerr << "Error-- number of operations must be specified " <<
+        "by command-line argument --n=(number of operations)" << std::endl;
+      exit (1);
+    }
+  std::cout << "Running bench-queue with n=" << n << " depth=" << g_depth << std::endl;
+
+  for (uint32_t i = 0; i < 2 * g_depth + 1; i++)
+    {
+      g_packets.push_back (Create<Packet> (500 + i));
+    }
+
+  runBench (&benchList, n, "std::list");
+  runBench (&benchStdQueue, n, "std::queue");
+  runBench (&benchRing, n, "PacketRingBuffer");
+  runBench (&benchDropTail, n, "DropTailQueue");
+  runBench (&benchRed, n, "RedQueue");
+
+  return 0;
+}
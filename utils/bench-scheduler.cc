@@ -0,0 +1,439 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Compare the Scheduler implementations outside of the simulator.
+//
+// The hold model fills a scheduler with size events and then performs
+// holds: each hold removes the next event and inserts a new one at the
+// time of the removed event plus an increment drawn from the selected
+// distribution.  The trace workload replays the Insert, PeekNext,
+// RemoveNext and Remove calls recorded by ns3::RecordingScheduler
+// during a real simulation.
+//
+// Every run is made in a child process so that its peak resident set
+// size is its own; it still includes the few megabytes of the benchmark
+// itself and, for the trace workload, the replayed trace.  One CSV line
+// is written to stdout per run:
+//   workload,scheduler,size,operations,ns_per_op,peak_rss_kb,cache_misses
+// cache_misses is -1 when hardware counters are not available.
+
+#include "ns3/core-module.h"
+#include "ns3/scheduler.h"
+#include "ns3/recording-scheduler.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+using namespace ns3;
+
+// increments of the hold model are taken cyclically from this table, so
+// that the cost of the random variables is not measured.
+static const uint32_t N_INCREMENTS = 1 << 16;
+// mean of the distributions, in timestamp units
+static const double TIME_SCALE = 1000000000.0;
+
+struct TraceOp
+{
+  char type;
+  uint64_t ts;
+  uint32_t uid;
+};
+
+class CacheMissCounter
+{
+public:
+  CacheMissCounter ();
+  ~CacheMissCounter ();
+  void Start (void);
+  // returns -1 if the counter is not available
+  int64_t Stop (void);
+private:
+  int m_fd;
+};
+
+CacheMissCounter::CacheMissCounter ()
+  : m_fd (-1)
+{
+#ifdef __linux__
+  struct perf_event_attr attr;
+  memset (&attr, 0, sizeof (attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof (attr);
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  m_fd = syscall (__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+CacheMissCounter::~CacheMissCounter ()
+{
+  if (m_fd >= 0)
+    {
+      close (m_fd);
+    }
+}
+void
+CacheMissCounter::Start (void)
+{
+#ifdef __linux__
+  if (m_fd >= 0)
+    {
+      ioctl (m_fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl (m_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+int64_t
+CacheMissCounter::Stop (void)
+{
+#ifdef __linux__
+  if (m_fd >= 0)
+    {
+      ioctl (m_fd, PERF_EVENT_IOC_DISABLE, 0);
+      int64_t count;
+      if (read (m_fd, &count, sizeof (count)) == sizeof (count))
+        {
+          return count;
+        }
+    }
+#endif
+  return -1;
+}
+
+static uint64_t
+GetRealtimeInNs (void)
+{
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec * (uint64_t)1000000000 + tv.tv_usec * (uint64_t)1000;
+}
+
+static long
+GetPeakRssKb (void)
+{
+  struct rusage usage;
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+static void
+Report (std::string workload, TypeId scheduler, uint32_t size, uint64_t operations,
+        uint64_t ns, int64_t cacheMisses)
+{
+  std::cout << workload << "," << scheduler.GetName () << "," << size << ","
+            << operations << "," << (double)ns / operations << ","
+            << GetPeakRssKb () << "," << cacheMisses << std::endl;
+}
+
+static std::vector<uint64_t>
+GetIncrements (std::string distribution)
+{
+  std::vector<uint64_t> increments;
+  ExponentialVariable exponential (1.0);
+  UniformVariable uniform;
+  TriangularVariable triangular (0.0, 1.5, 1.0);
+  for (uint32_t i = 0; i < N_INCREMENTS; i++)
+    {
+      double value;
+      if (distribution == "exponential")
+        {
+          value = exponential.GetValue ();
+        }
+      else if (distribution == "bimodal")
+        {
+          // 90% of short delays, 10% of long ones
+          if (uniform.GetValue () < 0.9)
+            {
+              value = uniform.GetValue (0.0, 0.2);
+            }
+          else
+            {
+              value = uniform.GetValue (9.0, 11.0);
+            }
+        }
+      else if (distribution == "triangular")
+        {
+          value = triangular.GetValue ();
+        }
+      else
+        {
+          NS_FATAL_ERROR ("Unknown distribution " << distribution);
+        }
+      increments.push_back ((uint64_t)(value * TIME_SCALE));
+    }
+  return increments;
+}
+
+static void
+RunHold (TypeId tid, std::string distribution, uint32_t size, uint32_t holds)
+{
+  std::vector<uint64_t> increments = GetIncrements (distribution);
+  ObjectFactory factory;
+  factory.SetTypeId (tid);
+  Ptr<Scheduler> scheduler = factory.Create<Scheduler> ();
+  uint32_t uid = 0;
+  uint32_t next = 0;
+  for (uint32_t i = 0; i < size; i++)
+    {
+      Scheduler::Event ev = {0, {increments[next], uid++, 0}};
+      next = (next + 1) % N_INCREMENTS;
+      scheduler->Insert (ev);
+    }
+
+  CacheMissCounter counter;
+  uint64_t start = GetRealtimeInNs ();
+  counter.Start ();
+  for (uint32_t i = 0; i < holds; i++)
+    {
+      Scheduler::Event ev = scheduler->RemoveNext ();
+      ev.key.m_ts += increments[next];
+      ev.key.m_uid = uid++;
+      next = (next + 1) % N_INCREMENTS;
+      scheduler->Insert (ev);
+    }
+  int64_t cacheMisses = counter.Stop ();
+  uint64_t end = GetRealtimeInNs ();
+  Report (distribution, tid, size, holds, end - start, cacheMisses);
+}
+
+static void
+RunTrace (TypeId tid, const std::vector<TraceOp> &trace, uint32_t size)
+{
+  ObjectFactory factory;
+  factory.SetTypeId (tid);
+  Ptr<Scheduler> scheduler = factory.Create<Scheduler> ();
+
+  CacheMissCounter counter;
+  uint64_t start = GetRealtimeInNs ();
+  counter.Start ();
+  for (std::vector<TraceOp>::const_iterator i = trace.begin (); i != trace.end (); ++i)
+    {
+      Scheduler::Event ev = {0, {i->ts, i->uid, 0}};
+      switch (i->type)
+        {
+        case 'i':
+          scheduler->Insert (ev);
+          break;
+        case 'p':
+          scheduler->PeekNext ();
+          break;
+        case 'n':
+          scheduler->RemoveNext ();
+          break;
+        case 'r':
+          scheduler->Remove (ev);
+          break;
+        }
+    }
+  int64_t cacheMisses = counter.Stop ();
+  uint64_t end = GetRealtimeInNs ();
+  Report ("trace", tid, size, trace.size (), end - start, cacheMisses);
+}
+
+// returns the largest number of pending events
+static uint32_t
+ReadTrace (std::string fileName, std::vector<TraceOp> *trace)
+{
+  std::ifstream is (fileName.c_str ());
+  if (!is.is_open ())
+    {
+      NS_FATAL_ERROR ("Could not open " << fileName);
+    }
+  uint32_t size = 0;
+  uint32_t maxSize = 0;
+  std::string line;
+  while (std::getline (is, line))
+    {
+      std::istringstream iss (line);
+      TraceOp op = {0, 0, 0};
+      iss >> op.type;
+      switch (op.type)
+        {
+        case 'i':
+          iss >> op.ts >> op.uid;
+          size++;
+          maxSize = std::max (size, maxSize);
+          break;
+        case 'r':
+          iss >> op.ts >> op.uid;
+          // fall through
+        case 'n':
+          size--;
+          break;
+        case 'p':
+          break;
+        default:
+          continue;
+        }
+      trace->push_back (op);
+    }
+  return maxSize;
+}
+
+static std::vector<std::string>
+Split (std::string list)
+{
+  std::vector<std::string> items;
+  std::istringstream iss (list);
+  std::string item;
+  while (std::getline (iss, item, ','))
+    {
+      if (!item.empty ())
+        {
+          items.push_back (item);
+        }
+    }
+  return items;
+}
+
+static std::vector<TypeId>
+GetSchedulers (std::string list)
+{
+  std::vector<TypeId> schedulers;
+  if (list.empty ())
+    {
+      for (uint32_t i = 0; i < TypeId::GetRegisteredN (); i++)
+        {
+          TypeId tid = TypeId::GetRegistered (i);
+          if (tid.IsChildOf (Scheduler::GetTypeId ())
+              && tid.HasConstructor ()
+              && tid != RecordingScheduler::GetTypeId ())
+            {
+              schedulers.push_back (tid);
+            }
+        }
+      return schedulers;
+    }
+  std::vector<std::string> names = Split (list);
+  for (std::vector<std::string>::const_iterator i = names.begin (); i != names.end (); ++i)
+    {
+      schedulers.push_back (TypeId::LookupByName (*i));
+    }
+  return schedulers;
+}
+
+// the runs are made one at a time in a child process
+static pid_t
+Fork (void)
+{
+  std::cout.flush ();
+  pid_t pid = fork ();
+  if (pid < 0)
+    {
+      NS_FATAL_ERROR ("fork failed");
+    }
+  return pid;
+}
+static void
+Wait (pid_t pid)
+{
+  int status;
+  waitpid (pid, &status, 0);
+  if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+    {
+      std::cerr << "a run failed" << std::endl;
+    }
+}
+
+int main (int argc, char *argv[])
+{
+  std::string schedulerList;
+  std::string distributionList = "exponential,bimodal,triangular";
+  std::string sizeList = "100,1000,10000,100000,1000000,10000000";
+  std::string traceFile;
+  uint32_t holds = 1000000;
+  uint32_t maxListSize = 10000;
+
+  CommandLine cmd;
+  cmd.AddValue ("schedulers", "Comma-separated scheduler types (default: all)", schedulerList);
+  cmd.AddValue ("distributions", "Comma-separated hold model distributions "
+                "(exponential, bimodal, triangular), or none", distributionList);
+  cmd.AddValue ("sizes", "Comma-separated hold model event set sizes", sizeList);
+  cmd.AddValue ("holds", "Number of holds measured per hold model run", holds);
+  cmd.AddValue ("trace", "File recorded by ns3::RecordingScheduler to replay", traceFile);
+  cmd.AddValue ("maxListSize", "Largest size run with ns3::ListScheduler, "
+                "whose insertion is linear", maxListSize);
+  cmd.Parse (argc, argv);
+
+  std::vector<TypeId> schedulers = GetSchedulers (schedulerList);
+  std::vector<std::string> distributions;
+  if (distributionList != "none")
+    {
+      distributions = Split (distributionList);
+    }
+  std::vector<std::string> sizes = Split (sizeList);
+
+  std::cout << "workload,scheduler,size,operations,ns_per_op,peak_rss_kb,cache_misses" << std::endl;
+
+  for (std::vector<std::string>::const_iterator d = distributions.begin (); d != distributions.end (); ++d)
+    {
+      for (std::vector<std::string>::const_iterator s = sizes.begin (); s != sizes.end (); ++s)
+        {
+          uint32_t size = atoi (s->c_str ());
+          for (std::vector<TypeId>::const_iterator t = schedulers.begin (); t != schedulers.end (); ++t)
+            {
+              if (t->GetName () == "ns3::ListScheduler" && size > maxListSize)
+                {
+                  continue;
+                }
+              pid_t pid = Fork ();
+              if (pid == 0)
+                {
+                  RunHold (*t, *d, size, holds);
+                  exit (0);
+                }
+              Wait (pid);
+            }
+        }
+    }
+
+  if (!traceFile.empty ())
+    {
+      std::vector<TraceOp> trace;
+      uint32_t size = ReadTrace (traceFile, &trace);
+      for (std::vector<TypeId>::const_iterator t = schedulers.begin (); t != schedulers.end (); ++t)
+        {
+          if (t->GetName () == "ns3::ListScheduler" && size > maxListSize)
+            {
+              continue;
+            }
+          pid_t pid = Fork ();
+          if (pid == 0)
+            {
+              RunTrace (*t, trace, size);
+              exit (0);
+            }
+          Wait (pid);
+        }
+    }
+
+  return 0;
+}
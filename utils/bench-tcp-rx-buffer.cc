@@ -0,0 +1,143 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Cost of the TcpRxBuffer operations made by the receiver of a bulk
+// transfer over a lossy path with a large bandwidth-delay product: the
+// sender keeps the receive window full of segments, each of which is
+// lost with a fixed probability and retransmitted one window later. The
+// receiver adds every segment it gets, and the application reads all
+// the data available after each one.
+
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/packet.h"
+#include "ns3/random-variable.h"
+#include "ns3/tcp-header.h"
+#include "ns3/tcp-rx-buffer.h"
+#include <iostream>
+#include <sstream>
+#include <deque>
+#include <utility>
+#include <string>
+#include <string.h>
+#include <stdlib.h> // for exit ()
+
+using namespace ns3;
+
+static uint32_t g_window = 64 << 20;
+static uint32_t g_segmentSize = 536;
+static double g_loss = 0.01;
+
+static void
+benchReceive (uint32_t n)
+{
+  TcpRxBuffer buffer (0);
+  buffer.SetMaxBufferSize (g_window);
+  UniformVariable rng;
+  // retransmissions, in the order they are due: the number of
+  // segments sent when they are, and their sequence number
+  std::deque<std::pair<uint32_t, uint32_t> > retransmissions;
+  uint32_t windowSegments = g_window / g_segmentSize;
+  uint32_t next = 0;
+  uint32_t delivered = 0;
+  for (uint32_t sent = 0; delivered < n; sent++)
+    {
+      uint32_t seq;
+      // the sender does not go beyond the window advertised by the ACKs
+      bool blocked = SequenceNumber32 (next + g_segmentSize)
+        > buffer.NextRxSequence () + SequenceNumber32 (g_window);
+      if (!retransmissions.empty () && (blocked || retransmissions.front ().first <= sent))
+        {
+          seq = retransmissions.front ().second;
+          retransmissions.pop_front ();
+        }
+      else
+        {
+          NS_ASSERT (!blocked);
+          seq = next;
+          next += g_segmentSize;
+        }
+      if (rng.GetValue () < g_loss)
+        {
+          retransmissions.push_back (std::make_pair (sent + windowSegments, seq));
+          continue;
+        }
+      TcpHeader header;
+      header.SetSequenceNumber (SequenceNumber32 (seq));
+      buffer.Add (Create<Packet> (g_segmentSize), header);
+      buffer.Extract (buffer.Available ());
+      delivered++;
+    }
+}
+
+static void
+runBench (void (*bench) (uint32_t), uint32_t n, char const *name)
+{
+  SystemWallClockMs time;
+  time.Start ();
+  (*bench) (n);
+  uint64_t deltaMs = time.End ();
+  double nsPerOp = deltaMs;
+  nsPerOp *= 1000000;
+  nsPerOp /= n;
+  std::cout << name << "=" << nsPerOp << " ns/segment" << std::endl;
+}
+
+static double
+ParseValue (char const *arg, char const *name)
+{
+  double value = 0;
+  std::istringstream iss;
+  iss.str (arg + strlen (name));
+  iss >> value;
+  return value;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t n = 0;
+  while (argc > 0) {
+      if (strncmp ("--n=", argv[0], strlen ("--n=")) == 0)
+        {
+          n = ParseValue (argv[0], "--n=");
+        }
+      if (strncmp ("--window=", argv[0], strlen ("--window=")) == 0)
+        {
+          g_window = ParseValue (argv[0], "--window=");
+        }
+      if (strncmp ("--segment=", argv[0], strlen ("--segment=")) == 0)
+        {
+          g_segmentSize = ParseValue (argv[0], "--segment=");
+        }
+      if (strncmp ("--loss=", argv[0], strlen ("--loss=")) == 0)
+        {
+          g_loss = ParseValue (argv[0], "--loss=");
+        }
+      argc--;
+      argv++;
+  }
+  if (n == 0)
+    {
+      std::cerr << "Error-- number of segments must be specified " <<
+        "by command-line argument --n=(number of segments)" << std::endl;
+      exit (1);
+    }
+  std::cout << "Running bench-tcp-rx-buffer with n=" << n << " window=" << g_window
+            << " segment=" << g_segmentSize << " loss=" << g_loss << std::endl;
+
+  runBench (&benchReceive, n, "receive");
+
+  return 0;
+}
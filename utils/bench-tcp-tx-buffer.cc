@@ -0,0 +1,145 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Cost of the TcpTxBuffer operations made by TcpSocketBase with a full
+// window in flight: on each ACK, DiscardUpTo, the application refills
+// the buffer with Add, and SendPendingData copies the new segments from
+// the tail of the window with CopyFromSequence. The retransmission run
+// copies the segment at the head of the window instead.
+
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/packet.h"
+#include "ns3/tcp-tx-buffer.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string.h>
+#include <stdlib.h> // for exit ()
+
+using namespace ns3;
+
+static uint32_t g_window = 64 << 20;
+static uint32_t g_writeSize = 1000;
+static uint32_t g_segmentSize = 536;
+
+// fills the buffer and sends all of it, then returns the sequence number of the next
+// segment to send.
+static SequenceNumber32
+FillWindow (TcpTxBuffer &buffer)
+{
+  buffer.SetMaxBufferSize (g_window);
+  while (buffer.Add (Create<Packet> (g_writeSize)))
+    {
+    }
+  SequenceNumber32 next = buffer.HeadSequence ();
+  while (buffer.SizeFromSequence (next) >= g_segmentSize)
+    {
+      next += buffer.CopyFromSequence (g_segmentSize, next)->GetSize ();
+    }
+  return next;
+}
+
+static void
+benchSend (TcpTxBuffer &buffer, SequenceNumber32 next, uint32_t n)
+{
+  for (uint32_t i = 0; i < n; i++)
+    {
+      // an ACK for two segments opens the window by two segments
+      buffer.DiscardUpTo (buffer.HeadSequence () + 2 * g_segmentSize);
+      while (buffer.Add (Create<Packet> (g_writeSize)))
+        {
+        }
+      for (uint32_t j = 0; j < 2; j++)
+        {
+          next += buffer.CopyFromSequence (g_segmentSize, next)->GetSize ();
+        }
+    }
+}
+
+static void
+benchRetransmit (TcpTxBuffer &buffer, SequenceNumber32 next, uint32_t n)
+{
+  for (uint32_t i = 0; i < n; i++)
+    {
+      buffer.CopyFromSequence (g_segmentSize, buffer.HeadSequence ());
+    }
+}
+
+static void
+runBench (void (*bench) (TcpTxBuffer &, SequenceNumber32, uint32_t),
+          uint32_t n, char const *name)
+{
+  TcpTxBuffer buffer (1);
+  SystemWallClockMs time;
+  time.Start ();
+  SequenceNumber32 next = FillWindow (buffer);
+  uint64_t fillMs = time.End ();
+  time.Start ();
+  (*bench) (buffer, next, n);
+  uint64_t deltaMs = time.End ();
+  double nsPerOp = deltaMs;
+  nsPerOp *= 1000000;
+  nsPerOp /= n;
+  std::cout << name << "=" << nsPerOp << " ns/op (fill=" << fillMs << " ms)" << std::endl;
+}
+
+static uint32_t
+ParseValue (char const *arg, char const *name)
+{
+  uint32_t value = 0;
+  std::istringstream iss;
+  iss.str (arg + strlen (name));
+  iss >> value;
+  return value;
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t n = 0;
+  while (argc > 0) {
+      if (strncmp ("--n=", argv[0], strlen ("--n=")) == 0)
+        {
+          n = ParseValue (argv[0], "--n=");
+        }
+      if (strncmp ("--window=", argv[0], strlen ("--window=")) == 0)
+        {
+          g_window = ParseValue (argv[0], "--window=");
+        }
+      if (strncmp ("--write=", argv[0], strlen ("--write=")) == 0)
+        {
+          g_writeSize = ParseValue (argv[0], "--write=");
+        }
+      if (strncmp ("--segment=", argv[0], strlen ("--segment=")) == 0)
+        {
+          g_segmentSize = ParseValue (argv[0], "--segment=");
+        }
+      argc--;
+      argv++;
+  }
+  if (n == 0)
+    {
+      std::cerr << "Error-- number of ACKs must be specified " <<
+        "by command-line argument --n=(number of ACKs)" << std::endl;
+      exit (1);
+    }
+  std::cout << "Running bench-tcp-tx-buffer with n=" << n << " window=" << g_window
+            << " write=" << g_writeSize << " segment=" << g_segmentSize << std::endl;
+
+  runBench (&benchSend, n, "send");
+  runBench (&benchRetransmit, n, "retransmit");
+
+  return 0;
+}
@@ -0,0 +1,177 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Measure the cost of the Time arithmetic seen by the simulator.
+//
+// The representation of ns3::Time is chosen when ns-3 is configured:
+// --enable-int64-time selects the 64-bit integer, and otherwise the
+// HighPrecision implementation is the 128-bit integer, the cairo 128-bit
+// integer or, with --high-precision-as-double, the long double.  Run this
+// program in each configuration to compare them.  The workloads are:
+//  - schedule: each event schedules the next one with Simulator::Schedule
+//  - now: calls to Simulator::Now from a single event
+//  - arith: additions, comparisons and GetSeconds of Time objects
+//  - scalar: products of Time objects by a Scalar
+// One CSV line is written to stdout per workload:
+//   representation,workload,operations,ns_per_op
+
+#include "ns3/simulator-module.h"
+#include "ns3/core-module.h"
+#include "ns3/simulator-config.h"
+#include <iostream>
+#include <string>
+#include <stdint.h>
+#include <sys/time.h>
+
+using namespace ns3;
+
+static uint32_t g_remaining;
+static uint64_t g_sink;
+
+static uint64_t
+GetRealtimeInNs (void)
+{
+  struct timeval tv;
+  gettimeofday (&tv, NULL);
+  return tv.tv_sec * (uint64_t)1000000000 + tv.tv_usec * (uint64_t)1000;
+}
+
+static std::string
+GetRepresentation (void)
+{
+#if defined (USE_INT64_TIME)
+  return "int64";
+#elif defined (USE_HIGH_PRECISION_DOUBLE)
+  return "double";
+#elif defined (USE_HIGH_PRECISION_128)
+  return "128";
+#else
+  return "cairo";
+#endif
+}
+
+static void
+Report (std::string workload, uint32_t operations, uint64_t ns)
+{
+  std::cout << GetRepresentation () << "," << workload << "," << operations << ","
+            << (double)ns / operations << std::endl;
+}
+
+static void
+ScheduleNext (void)
+{
+  g_sink += Simulator::Now ().GetTimeStep ();
+  if (--g_remaining > 0)
+    {
+      Simulator::Schedule (NanoSeconds (10 + (g_remaining & 0xff)), &ScheduleNext);
+    }
+}
+
+static void
+CallNow (void)
+{
+  for (uint32_t i = 0; i < g_remaining; i++)
+    {
+      g_sink += Simulator::Now ().GetTimeStep ();
+    }
+}
+
+static void
+BenchSchedule (uint32_t n)
+{
+  g_remaining = n;
+  Simulator::Schedule (Seconds (0.0), &ScheduleNext);
+  uint64_t start = GetRealtimeInNs ();
+  Simulator::Run ();
+  Report ("schedule", n, GetRealtimeInNs () - start);
+  Simulator::Destroy ();
+}
+
+static void
+BenchNow (uint32_t n)
+{
+  g_remaining = n;
+  Simulator::Schedule (Seconds (1.0), &CallNow);
+  uint64_t start = GetRealtimeInNs ();
+  Simulator::Run ();
+  Report ("now", n, GetRealtimeInNs () - start);
+  Simulator::Destroy ();
+}
+
+static void
+BenchArith (uint32_t n)
+{
+  Time t = Seconds (0.0);
+  Time step = NanoSeconds (7);
+  Time limit = MilliSeconds (1);
+  double seconds = 0.0;
+  uint64_t start = GetRealtimeInNs ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      t += step;
+      if (t > limit)
+        {
+          t -= limit;
+        }
+      seconds += t.GetSeconds ();
+    }
+  Report ("arith", n, GetRealtimeInNs () - start);
+  g_sink += (uint64_t)seconds;
+}
+
+static void
+BenchScalar (uint32_t n)
+{
+  Time t = MicroSeconds (10);
+  Time total = Seconds (0.0);
+  uint64_t start = GetRealtimeInNs ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      total += Scalar (1.5) * t;
+    }
+  Report ("scalar", n, GetRealtimeInNs () - start);
+  g_sink += total.GetTimeStep ();
+}
+
+int main (int argc, char *argv[])
+{
+  uint32_t n = 10000000;
+  std::string workload = "all";
+
+  CommandLine cmd;
+  cmd.AddValue ("n", "Number of operations per workload", n);
+  cmd.AddValue ("workload", "schedule, now, arith, scalar or all", workload);
+  cmd.Parse (argc, argv);
+
+  if (workload == "schedule" || workload == "all")
+    {
+      BenchSchedule (n);
+    }
+  if (workload == "now" || workload == "all")
+    {
+      BenchNow (n);
+    }
+  if (workload == "arith" || workload == "all")
+    {
+      BenchArith (n);
+    }
+  if (workload == "scalar" || workload == "all")
+    {
+      BenchScalar (n);
+    }
+  // keep the compiler from removing the loops
+  return g_sink == 42 ? 1 : 0;
+}
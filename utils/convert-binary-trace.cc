@@ -0,0 +1,48 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Convert a file written by BinaryTraceHelper to the format of the
+// ascii traces, on the standard output:
+//
+//   ./waf --run "convert-binary-trace --input=trace.btr" > trace.tr
+
+#include "ns3/core-module.h"
+#include "ns3/binary-trace-file.h"
+#include <iostream>
+#include <string>
+
+using namespace ns3;
+
+int main (int argc, char *argv[])
+{
+  std::string input;
+
+  CommandLine cmd;
+  cmd.AddValue ("input", "Binary trace file to convert", input);
+  cmd.Parse (argc, argv);
+
+  if (input.empty ())
+    {
+      std::cerr << "convert-binary-trace: missing --input" << std::endl;
+      return 1;
+    }
+  if (!BinaryTraceReader::ConvertToAscii (input, std::cout))
+    {
+      std::cerr << "convert-binary-trace: " << input << " is not a valid binary trace file" << std::endl;
+      return 1;
+    }
+  return 0;
+}
@@ -0,0 +1,74 @@
+#! /usr/bin/env python
+## -*- Mode: python; py-indent-offset: 4; indent-tabs-mode: nil; coding: utf-8; -*-
+#
+# Runs examples/mpi/distributed-sync-check with mpirun on the local host,
+# once with the barrier synchronization of DistributedSimulatorImpl and
+# once with the null message synchronization, and checks that every
+# logical processor received the same packets at the same times.
+#
+# ns-3 must have been configured with --enable-mpi and built.  Usage:
+#
+#   ./utils/mpi-sync-test.py --np 4
+#
+
+import optparse
+import os
+import subprocess
+import sys
+
+def run(options, sync):
+    program = os.path.join(options.build, 'examples', 'mpi', 'distributed-sync-check')
+    env = os.environ.copy()
+    env['LD_LIBRARY_PATH'] = options.build + os.pathsep + env.get('LD_LIBRARY_PATH', '')
+    argv = [options.mpirun, '-np', str(options.np)] + options.mpirun_args.split() + \
+        ['-x', 'LD_LIBRARY_PATH', program, '--sync=%s' % sync, '--packets=%d' % options.packets]
+    proc = subprocess.Popen(argv, stdout=subprocess.PIPE, env=env)
+    output = proc.communicate()[0]
+    if proc.returncode != 0:
+        print >> sys.stderr, "%s failed with status %d" % (' '.join(argv), proc.returncode)
+        sys.exit(1)
+    results = {}
+    stats = {}
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) == 8 and fields[0] == 'rank':
+            results[int(fields[1])] = dict(zip(fields[2::2], fields[3::2]))
+        elif len(fields) == 10 and fields[0] == 'stats':
+            stats[int(fields[1])] = dict(zip(fields[2::2], fields[3::2]))
+    if len(results) != options.np:
+        print >> sys.stderr, "%s: expected %d results, got:\n%s" % (sync, options.np, output)
+        sys.exit(1)
+    for rank in sorted(stats.keys()):
+        print "%s rank %d: %s messages, %s bytes, %s send buffers, %ss blocked" % \
+            (sync, rank, stats[rank]['messages'], stats[rank]['bytes'], stats[rank]['buffers'],
+             stats[rank]['blocked'])
+    return results
+
+def main(argv):
+    parser = optparse.OptionParser()
+    parser.add_option("--np", type="int", default=3,
+                      help="number of logical processors")
+    parser.add_option("--packets", type="int", default=100,
+                      help="number of packets sent in each direction of each link")
+    parser.add_option("--build", default=os.path.join('build', 'debug'),
+                      help="build directory of the variant to test")
+    parser.add_option("--mpirun", default='mpirun',
+                      help="mpirun program")
+    parser.add_option("--mpirun-args", default='',
+                      help="extra arguments of mpirun, for example --oversubscribe")
+    (options, args) = parser.parse_args(argv)
+
+    barrier = run(options, 'Barrier')
+    null = run(options, 'NullMessage')
+
+    status = 0
+    for rank in sorted(barrier.keys()):
+        if barrier[rank] != null[rank]:
+            print "rank %d: FAIL barrier %s null message %s" % (rank, barrier[rank], null[rank])
+            status = 1
+        else:
+            print "rank %d: PASS rx %s last %s" % (rank, barrier[rank]['rx'], barrier[rank]['last'])
+    return status
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,49 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// Print the log messages kept in the ring buffers of a program run with
+// NS_LOG_RING=file, or written with LogWriteRingBuffer, on the standard
+// output:
+//
+//   NS_LOG="*" NS_LOG_RING=log.bin ./waf --run simple-global-routing
+//   ./waf --run "print-log --input=log.bin" > log.txt
+
+#include "ns3/core-module.h"
+#include <iostream>
+#include <string>
+
+using namespace ns3;
+
+int main (int argc, char *argv[])
+{
+  std::string input;
+
+  CommandLine cmd;
+  cmd.AddValue ("input", "Log ring buffer file to print", input);
+  cmd.Parse (argc, argv);
+
+  if (input.empty ())
+    {
+      std::cerr << "print-log: missing --input" << std::endl;
+      return 1;
+    }
+  if (!LogPrintRingBuffer (input, std::cout))
+    {
+      std::cerr << "print-log: " << input << " is not a valid log ring buffer file" << std::endl;
+      return 1;
+    }
+  return 0;
+}